@@ -237,6 +237,9 @@ void list_protocols() {
 #endif
 #ifdef USE_LIBMEMCACHED
     printf("libmemcached,");
+#endif
+#ifdef USE_REQL
+    printf("reql,");
 #endif
     printf("sqlite");
 }
@@ -317,6 +320,12 @@ void usage(const char *name) {
     printf("].\n\n");
 
     printf("\t\tFor memcached and rethinkdb protocols the host argument should be in the form host:port.\n");
+#ifdef USE_REQL
+    printf("\t\tFor reql protocol the host argument should be in the following\n" \
+           "\t\tformat: host:port[/database/table][?option&option...], where port is the\n" \
+           "\t\tdriver port and the options are auth=KEY, batch=N (send inserts N at a\n" \
+           "\t\ttime) and range=filter (do range reads with a filter, not between).\n\n");
+#endif
 #ifdef USE_MYSQL
     printf("\t\tFor mysql protocol the host argument should be in the following\n" \
            "\t\tformat: username/password@host:port+database.\n\n");
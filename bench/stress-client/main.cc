@@ -334,6 +334,21 @@ int main(int argc, char *argv[])
     printf("Total running time: %f seconds\n", ticks_to_secs(get_ticks() - start_time));
     printf("Total operations: %d\n", total_stats.queries);
     printf("Total keys inserted minus keys deleted: %d\n", total_inserts_minus_deletes);
+    printf("Average operations per second: %f\n", total_stats.queries / ticks_to_secs(get_ticks() - start_time));
+
+    /* We only have latency samples if there is a latency file. */
+    if (total_stats.latency_samples.size() > 0) {
+        std::vector<ticks_t> latencies(total_stats.latency_samples.samples,
+                                       total_stats.latency_samples.samples + total_stats.latency_samples.size());
+        std::sort(latencies.begin(), latencies.end());
+        const double percentiles[] = { 50, 90, 95, 99, 99.9 };
+        printf("Latency percentiles (us):");
+        for (size_t i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); i++) {
+            size_t index = std::min(latencies.size() - 1, static_cast<size_t>(latencies.size() * percentiles[i] / 100));
+            printf(" %g%%: %.2f", percentiles[i], ticks_to_us(latencies[index]));
+        }
+        printf("\n");
+    }
 
     // Dump key vectors if we have an out file
     if(config.out_file[0] != 0) {
@@ -64,6 +64,9 @@ enum protocol_enum_t {
 #endif
 #ifdef USE_LIBMEMCACHED
     protocol_libmemcached,
+#endif
+#ifdef USE_REQL
+    protocol_reql,
 #endif
     protocol_sqlite,
 };
@@ -83,6 +86,10 @@ struct server_t {
 #ifdef USE_LIBMEMCACHED
         } else if (strcmp(name, "libmemcached") == 0) {
             return protocol_libmemcached;
+#endif
+#ifdef USE_REQL
+        } else if (strcmp(name, "reql") == 0) {
+            return protocol_reql;
 #endif
         } else if(strcmp(name, "sqlite") == 0) {
             return protocol_sqlite;
@@ -117,6 +124,10 @@ struct server_t {
 #ifdef USE_LIBMEMCACHED
         } else if (protocol == protocol_libmemcached) {
             printf("libmemcached");
+#endif
+#ifdef USE_REQL
+        } else if (protocol == protocol_reql) {
+            printf("reql");
 #endif
         } else if (protocol == protocol_sqlite) {
             printf("sqlite");
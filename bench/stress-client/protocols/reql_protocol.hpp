@@ -0,0 +1,594 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#ifndef __STRESS_CLIENT_PROTOCOLS_REQL_PROTOCOL_HPP__
+#define __STRESS_CLIENT_PROTOCOLS_REQL_PROTOCOL_HPP__
+
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "protocol.hpp"
+#include "protocols/ql2.pb.h"
+
+/* reql_protocol_t speaks ReQL to the driver port of a RethinkDB server, with
+the same protobufs as the client drivers (see src/rdb_protocol/ql2.proto). The
+host string has the form
+
+    host:port[/database/table][?option&option...]
+
+The database and table default to "test" and "stress". The table is created,
+with "id" as its primary key, if it doesn't exist yet. Each key is stored as
+the "id" of a row and its value in the row's "val" field. The options are:
+
+    auth=KEY        The server's authorization key.
+    batch=N         Send inserts N at a time, as one insert of an array. A key
+                    doesn't exist on the server until its batch is sent.
+    range=filter    Do range reads with a filter over the whole table instead
+                    of with between.
+
+Reads can be pipelined: the server answers the queries on a connection in
+order, so enqueue_read() just sends the query and the dequeue functions read
+the responses back in the same order. */
+
+class reql_error_t : public protocol_error_t {
+public:
+    reql_error_t(const std::string& message) : protocol_error_t("ReQL error: " + message) { }
+    virtual ~reql_error_t() throw () { }
+};
+
+struct reql_protocol_t : public protocol_t {
+    reql_protocol_t(const char *conn_str)
+        : sockfd(-1), next_token(1), outstanding_reads(0),
+          db_name("test"), table_name("stress"), insert_batch_size(1), range_with_filter(false),
+          recv_start(0)
+    {
+        std::string host_name;
+        int port;
+        std::string auth_key;
+        parse_conn_str(conn_str, &host_name, &port, &auth_key);
+
+        // init the socket
+        sockfd = socket(AF_INET, SOCK_STREAM, 0);
+        if (sockfd < 0) {
+            fprintf(stderr, "Could not create socket\n");
+            exit(-1);
+        }
+
+        // Setup the host/port data structures
+        struct sockaddr_in sin;
+        struct hostent *host = gethostbyname(host_name.c_str());
+        if (!host) {
+            herror("Could not gethostbyname()");
+            exit(-1);
+        }
+        memcpy(&sin.sin_addr.s_addr, host->h_addr, host->h_length);
+        sin.sin_family = AF_INET;
+        sin.sin_port = htons(port);
+
+        // Connect to server
+        int res = ::connect(sockfd, (struct sockaddr *)&sin, sizeof(sin));
+        if (res < 0) {
+            int err = errno;
+            fprintf(stderr, "Could not connect to server (%d)\n", err);
+            exit(-1);
+        }
+
+        handshake(auth_key);
+        create_table_if_necessary();
+    }
+
+    virtual ~reql_protocol_t() {
+        if (!pending_inserts.empty()) {
+            send_inserts();
+        }
+        if (sockfd != -1) {
+            int res = close(sockfd);
+            if (res != 0) {
+                fprintf(stderr, "Could not close socket\n");
+                exit(-1);
+            }
+        }
+    }
+
+    virtual void remove(const char *key, size_t key_size) {
+        assert(!exist_outstanding_pipeline_reads());
+        Query query;
+        Term *del = start_query(&query, Term::DELETE);
+        make_get(del->add_args(), key, key_size);
+        run(query);
+    }
+
+    virtual void update(const char *key, size_t key_size,
+                        const char *value, size_t value_size) {
+        assert(!exist_outstanding_pipeline_reads());
+        Query query;
+        Term *update = start_query(&query, Term::UPDATE);
+        make_get(update->add_args(), key, key_size);
+        make_row(update->add_args(), NULL, 0, value, value_size);
+        run(query);
+    }
+
+    virtual void insert(const char *key, size_t key_size,
+                        const char *value, size_t value_size) {
+        assert(!exist_outstanding_pipeline_reads());
+        pending_inserts.push_back(std::make_pair(std::string(key, key_size), std::string(value, value_size)));
+        if (static_cast<int>(pending_inserts.size()) >= insert_batch_size) {
+            send_inserts();
+        }
+    }
+
+    virtual void read(payload_t *keys, int count, payload_t *values = NULL) {
+        assert(!exist_outstanding_pipeline_reads());
+        enqueue_read(keys, count, values);
+        dequeue_read(keys, count, values);
+    }
+
+    /* add a read to the pipeline */
+    virtual void enqueue_read(payload_t *keys, int count, UNUSED payload_t *values = NULL) {
+        Query query;
+        make_read(&query, keys, count);
+        send_query(query);
+        outstanding_reads++;
+    }
+
+    /* Returns false if the response to the oldest read isn't here yet. */
+    virtual bool dequeue_read_maybe(UNUSED payload_t *keys, int count, payload_t *values = NULL) {
+        Response response;
+        if (!receive_response(&response, false)) {
+            return false;
+        }
+        outstanding_reads--;
+        check_read(response, count, values);
+        return true;
+    }
+
+    /* Waits for the response to the oldest read */
+    virtual void dequeue_read(UNUSED payload_t *keys, int count, payload_t *values = NULL) {
+        Response response;
+        receive_response(&response, true);
+        outstanding_reads--;
+        check_read(response, count, values);
+    }
+
+    bool exist_outstanding_pipeline_reads() {
+        return outstanding_reads != 0;
+    }
+
+    virtual void range_read(char* lkey, size_t lkey_size, char* rkey, size_t rkey_size, int count_limit, payload_t *values = NULL) {
+        assert(!exist_outstanding_pipeline_reads());
+        Query query;
+        Term *limit = start_query(&query, Term::LIMIT);
+        Term *selection = limit->add_args();
+        if (range_with_filter) {
+            // table.filter(lambda row: (row["id"] >= lkey) & (row["id"] <= rkey))
+            selection->set_type(Term::FILTER);
+            make_table(selection->add_args());
+            Term *all = make_func(selection->add_args(), Term::ALL);
+            Term *ge = all->add_args();
+            ge->set_type(Term::GE);
+            make_row_id(ge->add_args());
+            make_string(ge->add_args(), lkey, lkey_size);
+            Term *le = all->add_args();
+            le->set_type(Term::LE);
+            make_row_id(le->add_args());
+            make_string(le->add_args(), rkey, rkey_size);
+        } else {
+            selection->set_type(Term::BETWEEN);
+            make_table(selection->add_args());
+            make_string(selection->add_args(), lkey, lkey_size);
+            make_string(selection->add_args(), rkey, rkey_size);
+        }
+        make_num(limit->add_args(), count_limit);
+        run(query);
+
+        if (values) {
+            fprintf(stderr, "Value verification not implemented for range reads\n");
+        }
+    }
+
+    virtual void append(const char *key, size_t key_size,
+                        const char *value, size_t value_size) {
+        concat(key, key_size, value, value_size, true);
+    }
+
+    virtual void prepend(const char *key, size_t key_size,
+                          const char *value, size_t value_size) {
+        concat(key, key_size, value, value_size, false);
+    }
+
+private:
+    void parse_conn_str(const char *conn_str, std::string *host_out, int *port_out, std::string *auth_key_out) {
+        std::string str(conn_str);
+
+        size_t options_start = str.find('?');
+        if (options_start != std::string::npos) {
+            parse_options(str.substr(options_start + 1), auth_key_out);
+            str.erase(options_start);
+        }
+
+        size_t path_start = str.find('/');
+        if (path_start != std::string::npos) {
+            const std::string path = str.substr(path_start + 1);
+            str.erase(path_start);
+            size_t slash = path.find('/');
+            if (slash == std::string::npos || slash == 0 || slash == path.size() - 1) {
+                fprintf(stderr, "Please use host string of the form host:port/database/table.\n");
+                exit(-1);
+            }
+            db_name = path.substr(0, slash);
+            table_name = path.substr(slash + 1);
+        }
+
+        size_t colon = str.find(':');
+        if (colon == std::string::npos) {
+            fprintf(stderr, "Please use host string of the form host:port.\n");
+            exit(-1);
+        }
+        *host_out = str.substr(0, colon);
+        *port_out = atoi(str.c_str() + colon + 1);
+        if (*port_out == 0) {
+            fprintf(stderr, "Cannot parse port string: \"%s\".\n", str.c_str() + colon + 1);
+            exit(-1);
+        }
+    }
+
+    void parse_options(const std::string &options, std::string *auth_key_out) {
+        size_t start = 0;
+        while (start < options.size()) {
+            size_t end = options.find('&', start);
+            if (end == std::string::npos) {
+                end = options.size();
+            }
+            const std::string option = options.substr(start, end - start);
+            if (option.compare(0, 5, "auth=") == 0) {
+                *auth_key_out = option.substr(5);
+            } else if (option.compare(0, 6, "batch=") == 0) {
+                insert_batch_size = atoi(option.c_str() + 6);
+                if (insert_batch_size < 1) {
+                    fprintf(stderr, "Insert batch size must be at least 1.\n");
+                    exit(-1);
+                }
+            } else if (option == "range=filter") {
+                range_with_filter = true;
+            } else if (option == "range=between") {
+                range_with_filter = false;
+            } else {
+                fprintf(stderr, "Unknown ReQL option: \"%s\".\n", option.c_str());
+                exit(-1);
+            }
+            start = end + 1;
+        }
+    }
+
+    void handshake(const std::string &auth_key) {
+        int32_t magic = VersionDummy::V0_2;
+        send_bytes(&magic, sizeof(magic));
+        int32_t key_size = auth_key.size();
+        send_bytes(&key_size, sizeof(key_size));
+        send_bytes(auth_key.data(), auth_key.size());
+
+        // The server answers with a null-terminated string.
+        std::string answer;
+        char c;
+        do {
+            recv_bytes(&c, 1);
+            answer.push_back(c);
+        } while (c != '\0');
+        answer.resize(answer.size() - 1);
+        if (answer != "SUCCESS") {
+            fprintf(stderr, "Could not connect to server: %s\n", answer.c_str());
+            exit(-1);
+        }
+    }
+
+    void create_table_if_necessary() {
+        // Several clients may try this at once, so "already exists" errors are fine.
+        Query db_query;
+        Term *db_create = start_query(&db_query, Term::DB_CREATE);
+        make_string(db_create->add_args(), db_name.data(), db_name.size());
+        try {
+            run(db_query);
+        } catch (const reql_error_t &) { }
+
+        Query table_query;
+        Term *table_create = start_query(&table_query, Term::TABLE_CREATE);
+        Term *db = table_create->add_args();
+        db->set_type(Term::DB);
+        make_string(db->add_args(), db_name.data(), db_name.size());
+        make_string(table_create->add_args(), table_name.data(), table_name.size());
+        Term::AssocPair *primary_key = table_create->add_optargs();
+        primary_key->set_key("primary_key");
+        make_string(primary_key->mutable_val(), "id", 2);
+        try {
+            run(table_query);
+        } catch (const reql_error_t &) { }
+    }
+
+    void send_inserts() {
+        Query query;
+        Term *insert = start_query(&query, Term::INSERT);
+        make_table(insert->add_args());
+        if (pending_inserts.size() == 1) {
+            make_row(insert->add_args(), pending_inserts[0].first.data(), pending_inserts[0].first.size(),
+                     pending_inserts[0].second.data(), pending_inserts[0].second.size());
+        } else {
+            Term *rows = insert->add_args();
+            rows->set_type(Term::MAKE_ARRAY);
+            for (size_t i = 0; i < pending_inserts.size(); i++) {
+                make_row(rows->add_args(), pending_inserts[i].first.data(), pending_inserts[i].first.size(),
+                         pending_inserts[i].second.data(), pending_inserts[i].second.size());
+            }
+        }
+        Term::AssocPair *upsert = insert->add_optargs();
+        upsert->set_key("upsert");
+        upsert->mutable_val()->set_type(Term::DATUM);
+        upsert->mutable_val()->mutable_datum()->set_type(Datum::R_BOOL);
+        upsert->mutable_val()->mutable_datum()->set_r_bool(true);
+        pending_inserts.clear();
+        run(query);
+    }
+
+    void concat(const char *key, size_t key_size,
+                const char *value, size_t value_size, bool append) {
+        assert(!exist_outstanding_pipeline_reads());
+        // table.get(key).update(lambda row: {"val": row["val"] + value}), or
+        // value + row["val"] to prepend.
+        Query query;
+        Term *update = start_query(&query, Term::UPDATE);
+        make_get(update->add_args(), key, key_size);
+        Term *obj = make_func(update->add_args(), Term::MAKE_OBJ);
+        Term::AssocPair *val = obj->add_optargs();
+        val->set_key("val");
+        Term *add = val->mutable_val();
+        add->set_type(Term::ADD);
+        if (append) {
+            make_row_field(add->add_args(), "val");
+            make_string(add->add_args(), value, value_size);
+        } else {
+            make_string(add->add_args(), value, value_size);
+            make_row_field(add->add_args(), "val");
+        }
+        run(query);
+    }
+
+    // One key is a get, several are an array of gets.
+    void make_read(Query *query, payload_t *keys, int count) {
+        query->set_type(Query::START);
+        query->set_token(next_token++);
+        Term *term = query->mutable_query();
+        if (count == 1) {
+            make_get(term, keys[0].first, keys[0].second);
+        } else {
+            term->set_type(Term::MAKE_ARRAY);
+            for (int i = 0; i < count; i++) {
+                make_get(term->add_args(), keys[i].first, keys[i].second);
+            }
+        }
+    }
+
+    void check_read(const Response &response, int count, payload_t *values) {
+        check_for_error(response);
+        if (!values) {
+            return;
+        }
+        for (int i = 0; i < count; i++) {
+            const Datum *row = NULL;
+            if (count == 1 && response.response_size() == 1) {
+                row = &response.response(0);
+            } else if (response.response_size() == 1 && response.response(0).r_array_size() == count) {
+                row = &response.response(0).r_array(i);
+            }
+            std::string value;
+            if (row) {
+                for (int j = 0; j < row->r_object_size(); j++) {
+                    if (row->r_object(j).key() == "val") {
+                        value = row->r_object(j).val().r_str();
+                    }
+                }
+            }
+            if (value != std::string(values[i].first, values[i].second)) {
+                fprintf(stderr, "Got unexpected value: %s instead of %.*s\n", value.c_str(),
+                        static_cast<int>(values[i].second), values[i].first);
+            }
+        }
+    }
+
+    Term *start_query(Query *query, Term::TermType type) {
+        query->set_type(Query::START);
+        query->set_token(next_token++);
+        Term *term = query->mutable_query();
+        term->set_type(type);
+        return term;
+    }
+
+    void make_string(Term *term, const char *str, size_t size) {
+        term->set_type(Term::DATUM);
+        term->mutable_datum()->set_type(Datum::R_STR);
+        term->mutable_datum()->set_r_str(str, size);
+    }
+
+    void make_num(Term *term, double num) {
+        term->set_type(Term::DATUM);
+        term->mutable_datum()->set_type(Datum::R_NUM);
+        term->mutable_datum()->set_r_num(num);
+    }
+
+    void make_table(Term *term) {
+        term->set_type(Term::TABLE);
+        Term *db = term->add_args();
+        db->set_type(Term::DB);
+        make_string(db->add_args(), db_name.data(), db_name.size());
+        make_string(term->add_args(), table_name.data(), table_name.size());
+    }
+
+    void make_get(Term *term, const char *key, size_t key_size) {
+        term->set_type(Term::GET);
+        make_table(term->add_args());
+        make_string(term->add_args(), key, key_size);
+    }
+
+    // {"id": key, "val": value}, or just {"val": value} if there is no key.
+    void make_row(Term *term, const char *key, size_t key_size, const char *value, size_t value_size) {
+        term->set_type(Term::MAKE_OBJ);
+        if (key) {
+            Term::AssocPair *id = term->add_optargs();
+            id->set_key("id");
+            make_string(id->mutable_val(), key, key_size);
+        }
+        Term::AssocPair *val = term->add_optargs();
+        val->set_key("val");
+        make_string(val->mutable_val(), value, value_size);
+    }
+
+    // A function of one row, whose body is returned to be filled in.
+    Term *make_func(Term *term, Term::TermType body_type) {
+        term->set_type(Term::FUNC);
+        Term *params = term->add_args();
+        params->set_type(Term::MAKE_ARRAY);
+        make_num(params->add_args(), 1);
+        Term *body = term->add_args();
+        body->set_type(body_type);
+        return body;
+    }
+
+    void make_row_field(Term *term, const char *field) {
+        term->set_type(Term::GETATTR);
+        Term *var = term->add_args();
+        var->set_type(Term::VAR);
+        make_num(var->add_args(), 1);
+        make_string(term->add_args(), field, strlen(field));
+    }
+
+    void make_row_id(Term *term) {
+        make_row_field(term, "id");
+    }
+
+    /* Runs a query and reads all of its results. */
+    void run(const Query &query) {
+        send_query(query);
+        Response response;
+        receive_response(&response, true);
+        check_for_error(response);
+        while (response.type() == Response::SUCCESS_PARTIAL) {
+            Query more;
+            more.set_type(Query::CONTINUE);
+            more.set_token(query.token());
+            send_query(more);
+            receive_response(&response, true);
+            check_for_error(response);
+        }
+    }
+
+    void check_for_error(const Response &response) {
+        if (response.type() == Response::CLIENT_ERROR
+            || response.type() == Response::COMPILE_ERROR
+            || response.type() == Response::RUNTIME_ERROR) {
+            throw reql_error_t(response.response_size() > 0 ? response.response(0).r_str() : "unknown error");
+        }
+    }
+
+    void send_query(const Query &query) {
+        std::string data;
+        if (!query.SerializeToString(&data)) {
+            fprintf(stderr, "Could not serialize query\n");
+            exit(-1);
+        }
+        int32_t size = data.size();
+        send_buffer.resize(sizeof(size) + data.size());
+        memcpy(send_buffer.data(), &size, sizeof(size));
+        memcpy(send_buffer.data() + sizeof(size), data.data(), data.size());
+        send_bytes(send_buffer.data(), send_buffer.size());
+    }
+
+    /* Reads the next response. If `block` is false and the whole response
+    hasn't arrived yet, returns false instead of waiting for it. */
+    bool receive_response(Response *response_out, bool block) {
+        int32_t size;
+        for (;;) {
+            const size_t available = recv_buffer.size() - recv_start;
+            if (available >= sizeof(size)) {
+                memcpy(&size, recv_buffer.data() + recv_start, sizeof(size));
+                if (size < 0) {
+                    throw protocol_error_t("Negative response size");
+                }
+                if (available >= sizeof(size) + size) {
+                    break;
+                }
+            }
+            if (!fill_recv_buffer(block)) {
+                return false;
+            }
+        }
+
+        if (!response_out->ParseFromArray(recv_buffer.data() + recv_start + sizeof(size), size)) {
+            throw protocol_error_t("Could not parse response");
+        }
+        recv_start += sizeof(size) + size;
+        if (recv_start > 4096) {
+            recv_buffer.erase(recv_buffer.begin(), recv_buffer.begin() + recv_start);
+            recv_start = 0;
+        }
+        return true;
+    }
+
+    bool fill_recv_buffer(bool block) {
+        const size_t old_size = recv_buffer.size();
+        recv_buffer.resize(old_size + 16384);
+        const ssize_t bytes_read = recv(sockfd, recv_buffer.data() + old_size, 16384, block ? 0 : MSG_DONTWAIT);
+        if (bytes_read == -1 && !block && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            recv_buffer.resize(old_size);
+            return false;
+        } else if (bytes_read == 0) {
+            fprintf(stderr, "reql_protocol: error: server closed the connection\n");
+            exit(-1);
+        } else if (bytes_read < 0) {
+            perror("Unable to read from socket");
+            exit(-1);
+        }
+        recv_buffer.resize(old_size + bytes_read);
+        return true;
+    }
+
+    void recv_bytes(void *buf, size_t size) {
+        const ssize_t bytes_read = recv(sockfd, buf, size, MSG_WAITALL);
+        if (bytes_read < static_cast<ssize_t>(size)) {
+            perror("Unable to read from socket");
+            exit(-1);
+        }
+    }
+
+    void send_bytes(const void *buf, size_t total) {
+        size_t count = 0;
+        while (count < total) {
+            ssize_t res = write(sockfd, static_cast<const char *>(buf) + count, total - count);
+            if (res < 0) {
+                fprintf(stderr, "Could not send command (%d)\n", errno);
+                exit(-1);
+            }
+            count += res;
+        }
+    }
+
+    int sockfd;
+    int64_t next_token;
+    int outstanding_reads;
+
+    std::string db_name, table_name;
+    int insert_batch_size;
+    bool range_with_filter;
+    std::vector<std::pair<std::string, std::string> > pending_inserts;
+
+    std::vector<char> send_buffer;
+    std::vector<char> recv_buffer;
+    size_t recv_start;
+};
+
+#endif  // __STRESS_CLIENT_PROTOCOLS_REQL_PROTOCOL_HPP__
@@ -121,5 +121,7 @@ NO_EVENTFD ?= 0
 NO_EPOLL ?= 0
 LEGACY_PROC_STAT ?= 0
 UNIT_TEST_FILTER ?= *
+MICROBENCH_FILTER ?=
+MICROBENCH_OUTPUT ?= $(BUILD_DIR)/microbench.json
 PACKAGE_FOR_SUSE_10 ?= 0
 NO_COMPILE_JS ?= 0
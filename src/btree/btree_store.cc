@@ -1,6 +1,9 @@
 // Copyright 2010-2013 RethinkDB, all rights reserved.
 #include "btree/btree_store.hpp"
 
+#include "errors.hpp"
+#include <boost/bind.hpp>
+
 #include "btree/operations.hpp"
 #include "btree/secondary_operations.hpp"
 #include "concurrency/wait_any.hpp"
@@ -90,6 +93,8 @@ btree_store_t<protocol_t>::btree_store_t(serializer_t *serializer,
 template <class protocol_t>
 btree_store_t<protocol_t>::~btree_store_t() {
     assert_thread();
+    // Waits for an introspection that might still be looking at the cache.
+    heat_registration.reset();
 }
 
 template <class protocol_t>
@@ -110,6 +115,10 @@ void btree_store_t<protocol_t>::read(
 
     check_metainfo(DEBUG_ONLY(metainfo_checker, ) txn.get(), superblock.get());
 
+    if (heat_sketch.count(false)) {
+        record_heat(read.get_region(), false);
+    }
+
     // Ugly hack
     scoped_ptr_t<superblock_t> superblock2;
     superblock2.init(superblock.release());
@@ -131,6 +140,10 @@ void btree_store_t<protocol_t>::write(
         THROWS_ONLY(interrupted_exc_t) {
     assert_thread();
 
+    if (heat_sketch.count(true)) {
+        record_heat(write.get_region(), true);
+    }
+
     scoped_ptr_t<transaction_t> txn;
     scoped_ptr_t<real_superblock_t> real_superblock;
     const int expected_change_count = 2; // FIXME: this is incorrect, but will do for now
@@ -141,6 +154,54 @@ void btree_store_t<protocol_t>::write(
     protocol_write(write, response, timestamp, btree.get(), txn.get(), &superblock, token_pair, interruptor);
 }
 
+template <class protocol_t>
+void btree_store_t<protocol_t>::write_batch(
+        DEBUG_ONLY(const metainfo_checker_t<protocol_t>& metainfo_checker, )
+        const std::vector<batched_store_write_t<protocol_t> > &writes,
+        const write_durability_t durability,
+        signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t) {
+    assert_thread();
+
+    scoped_ptr_t<transaction_t> txn;
+    for (size_t i = 0; i < writes.size(); ++i) {
+        const batched_store_write_t<protocol_t> &w = writes[i];
+
+        if (heat_sketch.count(true)) {
+            record_heat(w.write->get_region(), true);
+        }
+
+        /* A write joins the open transaction only if its token has already
+        reached the head of the queue, which it has unless somebody else got a
+        token in between. Waiting for that somebody with the transaction open
+        could deadlock: their transaction might be queued behind a flush, and
+        the flush waits for ours. */
+        scoped_ptr_t<real_superblock_t> real_superblock;
+        if (txn.has() && w.token_pair->main_write_token->is_pulsed()) {
+            object_buffer_t<fifo_enforcer_sink_t::exit_write_t>::destruction_sentinel_t destroyer(&w.token_pair->main_write_token);
+            txn->set_recency_timestamp(w.timestamp.to_repli_timestamp());
+            txn->set_token_pair(w.token_pair);
+            get_btree_superblock(txn.get(), rwi_write, &real_superblock);
+        } else {
+            txn.reset();
+            // FIXME: like in `write()`, two changed blocks per write is a guess
+            const int expected_change_count = 2 * (writes.size() - i);
+            acquire_superblock_for_write(rwi_write, w.timestamp.to_repli_timestamp(), expected_change_count, durability, w.token_pair, &txn, &real_superblock, interruptor);
+        }
+
+        if (i == 0) {
+            check_and_update_metainfo(DEBUG_ONLY(metainfo_checker, ) w.new_metainfo, txn.get(), real_superblock.get());
+        } else {
+            metainfo_t old_metainfo;
+            get_metainfo_internal(txn.get(), real_superblock->get(), &old_metainfo);
+            update_metainfo(old_metainfo, w.new_metainfo, txn.get(), real_superblock.get());
+        }
+
+        scoped_ptr_t<superblock_t> superblock(real_superblock.release());
+        protocol_write(*w.write, w.response, w.timestamp, btree.get(), txn.get(), &superblock, w.token_pair, interruptor);
+    }
+}
+
 // TODO: Figure out wtf does the backfill filtering, figure out wtf constricts delete range operations to hit only a certain hash-interval, figure out what filters keys.
 template <class protocol_t>
 bool btree_store_t<protocol_t>::send_backfill(
@@ -1043,6 +1104,80 @@ void btree_store_t<protocol_t>::acquire_superblock_for_write(
 }
 
 /* store_view_t interface */
+template <class protocol_t>
+void btree_store_t<protocol_t>::register_with_cache_balancer(cache_balancer_t *balancer) {
+    assert_thread();
+    cache->register_with_balancer(balancer);
+}
+
+template <class protocol_t>
+void btree_store_t<protocol_t>::register_with_heat_registry(range_heat_registry_t *registry,
+                                                            const uuid_u &namespace_id) {
+    assert_thread();
+    heat_registration.init(new range_heat_registration_t(registry, namespace_id, &heat_sketch,
+                                                         boost::bind(&btree_store_t<protocol_t>::introspect,
+                                                                     this, _1)));
+}
+
+template <class protocol_t>
+void btree_store_t<protocol_t>::enable_cache_prewarm(const serializer_filepath_t &hot_list_path) {
+    assert_thread();
+    cache_prewarmer.init(new cache_prewarmer_t(cache.get(), hot_list_path));
+}
+
+template <class protocol_t>
+void btree_store_t<protocol_t>::introspect(store_introspection_t *out) {
+    assert_thread();
+    out->range = this->get_region().inner;
+    cache->introspect(&out->cache);
+
+    range_heat_samples_t heat;
+    heat_sketch.peek(&heat);
+    out->reads = heat.reads;
+    out->writes = heat.writes;
+
+    introspect_btree(cache.get(), SUPERBLOCK_ID, out->range, &out->btree);
+    add_heat_samples_to_introspection(heat.samples, &out->btree);
+}
+
+template <class protocol_t>
+void btree_store_t<protocol_t>::record_heat(const typename protocol_t::region_t &region,
+                                            bool is_write) {
+    /* Operations are charged to the first key they touch.  Operations on the
+    whole key space (table scans, distribution queries) would all land on the
+    smallest key, so they are left out. */
+    if (region.inner.left == store_key_t::min() && region.inner.right.unbounded) {
+        return;
+    }
+    heat_sketch.record(region.inner.left, is_write);
+}
+
+template <class protocol_t>
+repli_timestamp_t btree_store_t<protocol_t>::export_snapshot(const std::string &path,
+                                                             repli_timestamp_t since,
+                                                             signal_t *interruptor)
+    THROWS_ONLY(interrupted_exc_t, snapshot_export_exc_t) {
+    assert_thread();
+    snapshot_export_value_exporter_t *exporter = get_snapshot_export_value_exporter();
+    snapshot_export_writer_t writer(path, exporter->value_format(), since);
+
+    repli_timestamp_t max_recency;
+    {
+        object_buffer_t<fifo_enforcer_sink_t::exit_read_t> token;
+        new_read_token(&token);
+
+        scoped_ptr_t<transaction_t> txn;
+        scoped_ptr_t<real_superblock_t> superblock;
+        acquire_superblock_for_read(rwi_read, &token, &txn, &superblock, interruptor, true);
+
+        max_recency = btree_snapshot_export(txn.get(), superblock.get(), key_range_t::universe(),
+                                            since, exporter, &writer, interruptor);
+    }
+
+    writer.finish(max_recency);
+    return max_recency;
+}
+
 template <class protocol_t>
 void btree_store_t<protocol_t>::new_read_token(object_buffer_t<fifo_enforcer_sink_t::exit_read_t> *token_out) {
     assert_thread();
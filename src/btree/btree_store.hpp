@@ -13,9 +13,13 @@
 #include <boost/ptr_container/ptr_vector.hpp>
 
 #include "btree/erase_range.hpp"
+#include "btree/introspection.hpp"
 #include "btree/operations.hpp"
+#include "btree/range_heat.hpp"
 #include "btree/secondary_operations.hpp"
+#include "btree/snapshot_export.hpp"
 #include "buffer_cache/mirrored/config.hpp"  // TODO: Move to buffer_cache/config.hpp or something.
+#include "buffer_cache/prewarm.hpp"
 #include "buffer_cache/types.hpp"
 #include "concurrency/auto_drainer.hpp"
 #include "containers/disk_backed_queue.hpp"
@@ -26,6 +30,7 @@ struct rdb_protocol_t;
 template <class T> class btree_store_t;
 
 class btree_slice_t;
+class cache_balancer_t;
 class io_backender_t;
 class superblock_t;
 class real_superblock_t;
@@ -54,6 +59,31 @@ public:
                   const base_path_t &base_path);
     virtual ~btree_store_t();
 
+    // Hands control of the cache's size to the node-wide cache balancer.
+    void register_with_cache_balancer(cache_balancer_t *balancer);
+
+    // Lets the node's heat balancer see where this store's load lands.
+    void register_with_heat_registry(range_heat_registry_t *registry,
+                                     const uuid_u &namespace_id);
+
+    // Saves which blocks are in the cache now and then, and loads the last
+    // saved ones back into it, so that it starts out warm after a restart.
+    void enable_cache_prewarm(const serializer_filepath_t &hot_list_path);
+
+    /* Reports what the store's cache holds, how much of the btree is in memory
+    by level and by key range, and where its load lands (see
+    btree/introspection.hpp).  It never reads from disk. */
+    void introspect(store_introspection_t *out);
+
+    /* Writes the rows that changed at or after `since` to a snapshot export
+    file at `path` (see btree/snapshot_export.hpp), from a snapshot of the main
+    B-Tree.  Pass `repli_timestamp_t::distant_past` to export every row.
+    Returns the most recent change that the export includes. */
+    repli_timestamp_t export_snapshot(const std::string &path,
+                                      repli_timestamp_t since,
+                                      signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t, snapshot_export_exc_t);
+
     /* store_view_t interface */
     void new_read_token(object_buffer_t<fifo_enforcer_sink_t::exit_read_t> *token_out);
     void new_write_token(object_buffer_t<fifo_enforcer_sink_t::exit_write_t> *token_out);
@@ -100,6 +130,13 @@ public:
             signal_t *interruptor)
         THROWS_ONLY(interrupted_exc_t);
 
+    void write_batch(
+            DEBUG_ONLY(const metainfo_checker_t<protocol_t>& metainfo_checker, )
+            const std::vector<batched_store_write_t<protocol_t> > &writes,
+            write_durability_t durability,
+            signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t);
+
     bool send_backfill(
             const region_map_t<protocol_t, state_timestamp_t> &start_point,
             send_backfill_callback_t<protocol_t> *send_backfill_cb,
@@ -351,6 +388,9 @@ public:
                                      write_token_pair_t *token_pair,
                                      signal_t *interruptor) = 0;
 
+    // How values are written to snapshot exports.
+    virtual snapshot_export_value_exporter_t *get_snapshot_export_value_exporter() = 0;
+
     void get_metainfo_internal(transaction_t* txn, buf_lock_t* sb_buf, region_map_t<protocol_t, binary_blob_t> *out) const THROWS_NOTHING;
 
     void acquire_superblock_for_read(
@@ -425,9 +465,17 @@ public:
     std::vector<internal_disk_backed_queue_t *> sindex_queues;
     mutex_t sindex_queue_mutex;
 
+    // Where reads and writes land, for the heat balancer.
+    range_heat_sketch_t heat_sketch;
+    scoped_ptr_t<range_heat_registration_t> heat_registration;
+
+    scoped_ptr_t<cache_prewarmer_t> cache_prewarmer;
+
     auto_drainer_t drainer;
 
 private:
+    void record_heat(const typename protocol_t::region_t &region, bool is_write);
+
     DISABLE_COPYING(btree_store_t);
 };
 
@@ -28,7 +28,16 @@ bool btree_depth_first_traversal(btree_slice_t *slice, transaction_t *transactio
             r.decrement();
             end_index = internal_node::get_offset_index(inode, r.btree_key()) + 1;
         }
+        /* We start loading the next few children before we acquire each one,
+        so that by the time we get to them, they are in memory and the
+        callback's work on this child overlapped with reading them. */
+        int next_to_prefetch = start_index + 1;
         for (int i = start_index; i < end_index; i++) {
+            while (next_to_prefetch < end_index
+                   && next_to_prefetch <= i + slice->traversal_prefetch_window) {
+                transaction->prefetch_block(internal_node::get_pair_by_index(inode, next_to_prefetch)->lnode);
+                ++next_to_prefetch;
+            }
             const btree_internal_pair *pair = internal_node::get_pair_by_index(inode, i);
             buf_lock_t lock(transaction, pair->lnode, rwi_read);
             if (!btree_depth_first_traversal(slice, transaction, &lock, range, cb)) {
@@ -0,0 +1,155 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include "btree/introspection.hpp"
+
+#include <deque>
+#include <utility>
+
+#include "arch/runtime/coroutines.hpp"
+#include "btree/internal_node.hpp"
+#include "btree/node.hpp"
+#include "buffer_cache/buffer_cache.hpp"
+
+// Counts `block_id` at `level`, and returns it if it is in memory.
+const node_t *count_block(cache_t *cache, block_id_t block_id, size_t level,
+                 btree_introspection_t *out) {
+    if (out->blocks_seen_by_level.size() <= level) {
+        out->blocks_seen_by_level.resize(level + 1, 0);
+        out->blocks_resident_by_level.resize(level + 1, 0);
+    }
+    ++out->blocks_seen_by_level[level];
+    const node_t *node = static_cast<const node_t *>(cache->peek_block_if_resident(block_id));
+    if (node != NULL) {
+        ++out->blocks_resident_by_level[level];
+    }
+    return node;
+}
+
+/* The range of the root's `i`th child.  The child holds the keys after the
+previous pair's key, up to and including its own pair's key; the last pair's
+key is special and doesn't bound anything. */
+key_range_t root_child_range(const internal_node_t *inode, int i, const key_range_t &range) {
+    key_range_t child_range = range;
+    if (i > 0) {
+        store_key_t left(&internal_node::get_pair_by_index(inode, i - 1)->key);
+        if (left.increment() && child_range.left < left) {
+            child_range.left = left;
+        }
+    }
+    if (i < inode->npairs - 1) {
+        store_key_t right(&internal_node::get_pair_by_index(inode, i)->key);
+        if (right.increment()) {
+            key_range_t::right_bound_t bound(right);
+            if (bound < child_range.right) {
+                child_range.right = bound;
+            }
+        }
+    }
+    return child_range;
+}
+
+struct introspection_node_t {
+    introspection_node_t(block_id_t _block_id, size_t _level, size_t _range_index)
+        : block_id(_block_id), level(_level), range_index(_range_index) { }
+
+    block_id_t block_id;
+    size_t level;
+    // Which of the root's children it is under.
+    size_t range_index;
+};
+
+void introspect_btree(cache_t *cache, block_id_t superblock_id,
+                      const key_range_t &range, btree_introspection_t *out) {
+    const btree_superblock_t *superblock
+        = static_cast<const btree_superblock_t *>(cache->peek_block_if_resident(superblock_id));
+    if (superblock == NULL) {
+        out->ranges.push_back(btree_range_introspection_t(range));
+        out->complete = false;
+        return;
+    }
+
+    const block_id_t root_block_id = superblock->root_block;
+    if (root_block_id == NULL_BLOCK_ID) {
+        // The tree is empty.
+        out->ranges.push_back(btree_range_introspection_t(range));
+        return;
+    }
+
+    const node_t *root = count_block(cache, root_block_id, 0, out);
+    if (root == NULL || node::is_leaf(root)) {
+        btree_range_introspection_t whole(range);
+        whole.blocks_seen = 1;
+        whole.blocks_resident = root == NULL ? 0 : 1;
+        out->ranges.push_back(whole);
+        return;
+    }
+
+    /* The root's children are counted right away, since they decide the
+    ranges; every other level is counted when its parent comes off the queue.
+    Nothing here blocks until we yield, so the root's data stays valid for
+    that long. */
+    std::deque<introspection_node_t> queue;
+    const internal_node_t *inode = reinterpret_cast<const internal_node_t *>(root);
+    for (int i = 0; i < inode->npairs; ++i) {
+        btree_range_introspection_t child(root_child_range(inode, i, range));
+        const block_id_t child_id = internal_node::get_pair_by_index(inode, i)->lnode;
+        child.blocks_seen = 1;
+        const node_t *child_node = count_block(cache, child_id, 1, out);
+        if (child_node != NULL) {
+            child.blocks_resident = 1;
+            if (node::is_internal(child_node)) {
+                queue.push_back(introspection_node_t(child_id, 1, out->ranges.size()));
+            }
+        }
+        out->ranges.push_back(child);
+    }
+
+    int nodes_walked = 1;
+    while (!queue.empty()) {
+        if (nodes_walked >= BTREE_INTROSPECTION_MAX_NODES) {
+            out->complete = false;
+            break;
+        }
+        if (nodes_walked % BTREE_INTROSPECTION_NODES_PER_YIELD == 0) {
+            coro_t::yield();
+        }
+
+        const introspection_node_t parent = queue.front();
+        queue.pop_front();
+
+        // It may have been evicted, freed or reused while we yielded.
+        const node_t *current = static_cast<const node_t *>(cache->peek_block_if_resident(parent.block_id));
+        if (current == NULL || !node::is_internal(current)) {
+            continue;
+        }
+        ++nodes_walked;
+
+        const internal_node_t *parent_node = reinterpret_cast<const internal_node_t *>(current);
+        btree_range_introspection_t *parent_range = &out->ranges[parent.range_index];
+        for (int i = 0; i < parent_node->npairs; ++i) {
+            const block_id_t child_id = internal_node::get_pair_by_index(parent_node, i)->lnode;
+            ++parent_range->blocks_seen;
+            const node_t *child_node = count_block(cache, child_id, parent.level + 1, out);
+            if (child_node != NULL) {
+                ++parent_range->blocks_resident;
+                if (node::is_internal(child_node)) {
+                    queue.push_back(introspection_node_t(child_id, parent.level + 1,
+                                                         parent.range_index));
+                }
+            }
+        }
+    }
+}
+
+void add_heat_samples_to_introspection(const std::vector<range_heat_sample_t> &samples,
+                                       btree_introspection_t *out) {
+    for (std::vector<range_heat_sample_t>::const_iterator it = samples.begin();
+         it != samples.end(); ++it) {
+        for (std::vector<btree_range_introspection_t>::iterator jt = out->ranges.begin();
+             jt != out->ranges.end(); ++jt) {
+            if (jt->range.contains_key(it->key)) {
+                ++(it->is_write ? jt->sampled_writes : jt->sampled_reads);
+                break;
+            }
+        }
+    }
+}
@@ -0,0 +1,78 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#ifndef BTREE_INTROSPECTION_HPP_
+#define BTREE_INTROSPECTION_HPP_
+
+#include <vector>
+
+#include "btree/keys.hpp"
+#include "btree/range_heat.hpp"
+#include "buffer_cache/mirrored/stats.hpp"
+#include "buffer_cache/types.hpp"
+
+/* The part of a store's btree under one child of the root. */
+struct btree_range_introspection_t {
+    btree_range_introspection_t()
+        : blocks_seen(0), blocks_resident(0), sampled_reads(0), sampled_writes(0) { }
+    explicit btree_range_introspection_t(const key_range_t &_range)
+        : range(_range), blocks_seen(0), blocks_resident(0),
+          sampled_reads(0), sampled_writes(0) { }
+
+    key_range_t range;
+
+    // The blocks in the range that the walk found, and how many of them are in
+    // memory.
+    int64_t blocks_seen;
+    int64_t blocks_resident;
+
+    // The heat samples that landed in the range.
+    int64_t sampled_reads;
+    int64_t sampled_writes;
+};
+
+/* How much of a btree is in memory.  The walk only looks inside internal nodes
+that are already in memory, so the blocks under one that isn't aren't seen at
+all; a cold tree shows up as few blocks seen, and few of those resident. */
+struct btree_introspection_t {
+    btree_introspection_t() : complete(true) { }
+
+    // Indexed by level, with the root at 0.
+    std::vector<int64_t> blocks_seen_by_level;
+    std::vector<int64_t> blocks_resident_by_level;
+
+    // In key order.  If the root isn't an internal node in memory, this is a
+    // single range covering the whole tree.
+    std::vector<btree_range_introspection_t> ranges;
+
+    // False if the superblock wasn't in memory, or if the walk stopped at
+    // `BTREE_INTROSPECTION_MAX_NODES` internal nodes, leaving the lower levels
+    // partly unseen.
+    bool complete;
+};
+
+/* Everything that introspecting a store finds out. */
+struct store_introspection_t {
+    store_introspection_t() : reads(0), writes(0) { }
+
+    key_range_t range;
+    mc_cache_introspection_t cache;
+    btree_introspection_t btree;
+
+    // The operations counted by the store's heat sketch since the heat
+    // balancer last collected it.
+    int64_t reads;
+    int64_t writes;
+};
+
+/* Walks the btree under the superblock at `superblock_id`, which covers
+`range`, breadth first.  It only peeks at blocks that are in memory, without
+locking them or reading anything from disk, so it never waits for the disk and
+never gets in the way of queries; the price is that the counts can be slightly
+off if the tree changes while the walk is letting other coroutines run. */
+void introspect_btree(cache_t *cache, block_id_t superblock_id,
+                      const key_range_t &range, btree_introspection_t *out);
+
+// Charges each sample to the range of `out` that its key falls in.
+void add_heat_samples_to_introspection(const std::vector<range_heat_sample_t> &samples,
+                                       btree_introspection_t *out);
+
+#endif  // BTREE_INTROSPECTION_HPP_
@@ -324,6 +324,16 @@ void ensure_stat_block(transaction_t *txn, superblock_t *sb, eviction_priority_t
     }
 }
 
+int64_t get_btree_population(transaction_t *txn, superblock_t *sb) {
+    block_id_t node_id = sb->get_stat_block_id();
+    if (node_id == NULL_BLOCK_ID) {
+        // Nothing has ever been written to this btree.
+        return 0;
+    }
+    buf_lock_t stat_block(txn, node_id, rwi_read);
+    return static_cast<const btree_statblock_t *>(stat_block.get_data_read())->population;
+}
+
 // Get a root block given a superblock, or make a new root if there isn't one.
 void get_root(value_sizer_t<void> *sizer, transaction_t *txn, superblock_t* sb, buf_lock_t *buf_out, eviction_priority_t root_eviction_priority) {
     rassert(!buf_out->is_acquired());
@@ -225,6 +225,9 @@ void insert_root(block_id_t root_id, superblock_t* sb);
 /* Create a stat block for the superblock if it doesn't already have one. */
 void ensure_stat_block(transaction_t *txn, superblock_t *sb, eviction_priority_t stat_block_eviction_priority);
 
+/* Returns the number of keys in the btree, as recorded in its stat block. */
+int64_t get_btree_population(transaction_t *txn, superblock_t *sb);
+
 void get_btree_superblock(transaction_t *txn, access_t access, scoped_ptr_t<real_superblock_t> *got_superblock_out);
 
 void get_btree_superblock_and_txn(btree_slice_t *slice, access_t access, int expected_change_count,
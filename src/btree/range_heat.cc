@@ -0,0 +1,150 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include "btree/range_heat.hpp"
+
+#include <algorithm>
+
+#include "errors.hpp"
+#include <boost/bind.hpp>
+
+#include "arch/runtime/runtime.hpp"
+#include "btree/introspection.hpp"
+#include "concurrency/pmap.hpp"
+
+range_heat_sketch_t::range_heat_sketch_t() : ops_since_sample(0), next_sample(0) { }
+
+void range_heat_sketch_t::record(const store_key_t &key, bool is_write) {
+    // Once the ring is full, newer samples replace the oldest ones.
+    if (counts.samples.size() < RANGE_HEAT_MAX_SAMPLES) {
+        counts.samples.push_back(range_heat_sample_t(key, is_write));
+    } else {
+        counts.samples[next_sample] = range_heat_sample_t(key, is_write);
+        next_sample = (next_sample + 1) % RANGE_HEAT_MAX_SAMPLES;
+    }
+}
+
+void range_heat_sketch_t::collect(range_heat_samples_t *out) {
+    out->reads += counts.reads;
+    out->writes += counts.writes;
+    out->samples.insert(out->samples.end(), counts.samples.begin(), counts.samples.end());
+    counts = range_heat_samples_t();
+    next_sample = 0;
+}
+
+void range_heat_sketch_t::peek(range_heat_samples_t *out) const {
+    out->reads += counts.reads;
+    out->writes += counts.writes;
+    out->samples.insert(out->samples.end(), counts.samples.begin(), counts.samples.end());
+}
+
+range_heat_registration_t::range_heat_registration_t(range_heat_registry_t *_registry,
+                                                     const uuid_u &_namespace_id,
+                                                     range_heat_sketch_t *_sketch,
+                                                     const boost::function<void(store_introspection_t *)> &_introspect)
+    : registry(_registry), namespace_id(_namespace_id), sketch(_sketch),
+      introspect(_introspect), sketch_thread(get_thread_id()) {
+    on_thread_t thread_switcher(registry->home_thread());
+    mutex_t::acq_t acq(&registry->sketches_mutex);
+    registry->sketches.insert(this);
+}
+
+range_heat_registration_t::~range_heat_registration_t() {
+    rassert(get_thread_id() == sketch_thread);
+    on_thread_t thread_switcher(registry->home_thread());
+    // Waits for a collection or introspection that might still be using our
+    // sketch.
+    mutex_t::acq_t acq(&registry->sketches_mutex);
+    registry->sketches.erase(this);
+}
+
+range_heat_registry_t::~range_heat_registry_t() {
+    assert_thread();
+    rassert(sketches.empty(), "Stores must unregister before the registry is destroyed.");
+}
+
+void range_heat_registry_t::collect(std::map<uuid_u, range_heat_samples_t> *out) {
+    assert_thread();
+    mutex_t::acq_t acq(&sketches_mutex);
+    const std::vector<range_heat_registration_t *> regs(sketches.begin(), sketches.end());
+
+    std::vector<range_heat_samples_t> samples(regs.size());
+    pmap(regs.size(), boost::bind(&range_heat_registry_t::collect_sketch,
+                                  this, &regs, &samples, _1));
+
+    for (size_t i = 0; i < regs.size(); ++i) {
+        range_heat_samples_t *merged = &(*out)[regs[i]->namespace_id];
+        merged->reads += samples[i].reads;
+        merged->writes += samples[i].writes;
+        merged->samples.insert(merged->samples.end(),
+                               samples[i].samples.begin(), samples[i].samples.end());
+    }
+}
+
+void range_heat_registry_t::collect_sketch(const std::vector<range_heat_registration_t *> *regs,
+                                           std::vector<range_heat_samples_t> *samples_out,
+                                           int i) {
+    range_heat_registration_t *reg = (*regs)[i];
+    on_thread_t thread_switcher(reg->sketch_thread);
+    reg->sketch->collect(&(*samples_out)[i]);
+}
+
+void range_heat_registry_t::introspect(std::map<uuid_u, std::vector<store_introspection_t> > *out) {
+    assert_thread();
+    mutex_t::acq_t acq(&sketches_mutex);
+    const std::vector<range_heat_registration_t *> regs(sketches.begin(), sketches.end());
+
+    std::vector<store_introspection_t> stores(regs.size());
+    pmap(regs.size(), boost::bind(&range_heat_registry_t::introspect_store,
+                                  this, &regs, &stores, _1));
+
+    for (size_t i = 0; i < regs.size(); ++i) {
+        (*out)[regs[i]->namespace_id].push_back(stores[i]);
+    }
+}
+
+void range_heat_registry_t::introspect_store(const std::vector<range_heat_registration_t *> *regs,
+                                             std::vector<store_introspection_t> *stores_out,
+                                             int i) {
+    range_heat_registration_t *reg = (*regs)[i];
+    on_thread_t thread_switcher(reg->sketch_thread);
+    reg->introspect(&(*stores_out)[i]);
+}
+
+bool suggest_heat_split_point(const std::vector<range_heat_sample_t> &samples,
+                              const key_range_t &range,
+                              size_t min_samples,
+                              store_key_t *split_out) {
+    std::vector<store_key_t> keys;
+    for (std::vector<range_heat_sample_t>::const_iterator it = samples.begin();
+         it != samples.end(); ++it) {
+        if (range.contains_key(it->key)) {
+            keys.push_back(it->key);
+        }
+    }
+    if (keys.size() < min_samples || keys.empty()) {
+        return false;
+    }
+    std::sort(keys.begin(), keys.end());
+
+    /* Splitting at `keys[i]` puts the first `i` samples on the left.  We can
+    only split where the key changes, and look for the place closest to the
+    middle. */
+    const size_t n = keys.size();
+    const size_t middle = n / 2;
+    size_t best = 0;
+    for (size_t i = 1; i < n; ++i) {
+        if (keys[i] == keys[i - 1]) {
+            continue;
+        }
+        const size_t distance = i > middle ? i - middle : middle - i;
+        const size_t best_distance = best > middle ? best - middle : middle - best;
+        if (best == 0 || distance < best_distance) {
+            best = i;
+        }
+    }
+    if (best == 0 || std::min(best, n - best) * 4 < n) {
+        return false;
+    }
+
+    *split_out = keys[best];
+    return true;
+}
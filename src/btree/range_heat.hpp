@@ -0,0 +1,140 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#ifndef BTREE_RANGE_HEAT_HPP_
+#define BTREE_RANGE_HEAT_HPP_
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include "errors.hpp"
+#include <boost/function.hpp>
+
+#include "btree/keys.hpp"
+#include "concurrency/mutex.hpp"
+#include "config/args.hpp"
+#include "containers/uuid.hpp"
+#include "utils.hpp"
+
+/* One sampled operation: the first key it touched. */
+struct range_heat_sample_t {
+    range_heat_sample_t() : is_write(false) { }
+    range_heat_sample_t(const store_key_t &_key, bool _is_write)
+        : key(_key), is_write(_is_write) { }
+
+    store_key_t key;
+    bool is_write;
+};
+
+/* What a range heat sketch saw since it was last collected. */
+struct range_heat_samples_t {
+    range_heat_samples_t() : reads(0), writes(0) { }
+
+    // Every operation is counted, but only some are sampled.
+    int64_t reads;
+    int64_t writes;
+    std::vector<range_heat_sample_t> samples;
+};
+
+/* Tracks where a store's reads and writes land.  Every operation is counted,
+and one in every `RANGE_HEAT_SAMPLE_RATE` of them has its key recorded in a ring
+of `RANGE_HEAT_MAX_SAMPLES`, so that the hot path is a counter increment for
+almost all operations and the memory used is bounded.  It lives on the store's
+thread. */
+class range_heat_sketch_t {
+public:
+    range_heat_sketch_t();
+
+    // Counts an operation, and tells whether the caller should sample it with
+    // `record()`.  Working out an operation's key can be expensive, so callers
+    // only do it when they have to.
+    bool count(bool is_write) {
+        ++(is_write ? counts.writes : counts.reads);
+        if (++ops_since_sample < RANGE_HEAT_SAMPLE_RATE) {
+            return false;
+        }
+        ops_since_sample = 0;
+        return true;
+    }
+    void record(const store_key_t &key, bool is_write);
+
+    // Hands over everything since the last collection, and starts over.
+    void collect(range_heat_samples_t *out);
+
+    // Copies everything since the last collection, without starting over.
+    void peek(range_heat_samples_t *out) const;
+
+private:
+    int ops_since_sample;
+    range_heat_samples_t counts;
+    size_t next_sample;
+
+    DISABLE_COPYING(range_heat_sketch_t);
+};
+
+class range_heat_registry_t;
+struct store_introspection_t;
+
+/* Ties one store's sketch to a range_heat_registry_t for as long as it exists.
+It is created and destroyed on the store's thread, and the sketch must outlive
+it.  `introspect` is called on the store's thread, and may block. */
+class range_heat_registration_t {
+public:
+    range_heat_registration_t(range_heat_registry_t *registry,
+                              const uuid_u &namespace_id,
+                              range_heat_sketch_t *sketch,
+                              const boost::function<void(store_introspection_t *)> &introspect);
+    ~range_heat_registration_t();
+
+private:
+    friend class range_heat_registry_t;
+
+    range_heat_registry_t *registry;
+    uuid_u namespace_id;
+    range_heat_sketch_t *sketch;
+    boost::function<void(store_introspection_t *)> introspect;
+    int sketch_thread;
+
+    DISABLE_COPYING(range_heat_registration_t);
+};
+
+/* Knows all the stores on this machine, by table, for their heat sketches and
+for introspection. */
+class range_heat_registry_t : public home_thread_mixin_t {
+public:
+    range_heat_registry_t() { }
+    ~range_heat_registry_t();
+
+    // Collects every store's sketch; the stores of a table are merged.
+    void collect(std::map<uuid_u, range_heat_samples_t> *out);
+
+    // Introspects every store, leaving the sketches alone.
+    void introspect(std::map<uuid_u, std::vector<store_introspection_t> > *out);
+
+private:
+    friend class range_heat_registration_t;
+
+    void collect_sketch(const std::vector<range_heat_registration_t *> *regs,
+                        std::vector<range_heat_samples_t> *samples_out,
+                        int i);
+    void introspect_store(const std::vector<range_heat_registration_t *> *regs,
+                          std::vector<store_introspection_t> *stores_out,
+                          int i);
+
+    // Held while collecting or introspecting, and while stores register or
+    // unregister.
+    mutex_t sketches_mutex;
+    std::set<range_heat_registration_t *> sketches;
+
+    DISABLE_COPYING(range_heat_registry_t);
+};
+
+/* Picks the key to split `range` at so that the sampled operations in it are
+divided as evenly as possible.  Fails if there are fewer than `min_samples`
+samples in the range, or if no split point gives each side at least a quarter
+of them (e.g. because most of the load is on a single key). */
+MUST_USE bool suggest_heat_split_point(const std::vector<range_heat_sample_t> &samples,
+                                       const key_range_t &range,
+                                       size_t min_samples,
+                                       store_key_t *split_out);
+
+#endif  // BTREE_RANGE_HEAT_HPP_
@@ -52,7 +52,8 @@ btree_slice_t::btree_slice_t(cache_t *c, perfmon_collection_t *parent, const std
     : stats(parent, identifier),
       cache_(c),
       superblock_id_(_superblock_id),
-      root_eviction_priority(INITIAL_ROOT_EVICTION_PRIORITY) {
+      root_eviction_priority(INITIAL_ROOT_EVICTION_PRIORITY),
+      traversal_prefetch_window(DEFAULT_TRAVERSAL_PREFETCH_WINDOW) {
     cache()->create_cache_account(BACKFILL_CACHE_PRIORITY, &backfill_account);
 
     pre_begin_txn_checkpoint_.set_tagappend("pre_begin_txn");
@@ -82,6 +82,10 @@ private:
     //Information for cache eviction
 public:
     eviction_priority_t root_eviction_priority;
+
+    // How many children ahead a depth-first traversal prefetches; 0 turns
+    // prefetching off.
+    int traversal_prefetch_window;
 };
 
 #endif /* BTREE_SLICE_HPP_ */
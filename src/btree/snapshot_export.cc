@@ -0,0 +1,290 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include "btree/snapshot_export.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "errors.hpp"
+#include <boost/bind.hpp>
+
+#include "arch/runtime/thread_pool.hpp"
+#include "btree/internal_node.hpp"
+#include "btree/leaf_node.hpp"
+#include "btree/node.hpp"
+#include "btree/operations.hpp"
+#include "buffer_cache/buffer_cache.hpp"
+#include "concurrency/cond_var.hpp"
+#include "concurrency/signal.hpp"
+
+// Data is written out in pieces of about this size.
+static const size_t SNAPSHOT_EXPORT_WRITE_SIZE = 4 * MEGABYTE;
+
+static void open_blocking(const std::string &path, int *fd_out, std::string *error_out) {
+    *fd_out = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (*fd_out == -1) {
+        *error_out = strprintf("Could not open `%s` for writing: %s",
+                               path.c_str(), errno_string(errno).c_str());
+    }
+}
+
+static void close_and_unlink_blocking(int fd, const std::string &path) {
+    ::close(fd);
+    ::unlink(path.c_str());
+}
+
+static void sync_close_rename_blocking(int fd, const std::string &from, const std::string &to,
+                                       std::string *error_out) {
+    if (fsync(fd) != 0) {
+        *error_out = strprintf("Could not sync `%s`: %s", from.c_str(), errno_string(errno).c_str());
+        close_and_unlink_blocking(fd, from);
+        return;
+    }
+    ::close(fd);
+    if (::rename(from.c_str(), to.c_str()) != 0) {
+        *error_out = strprintf("Could not rename `%s` to `%s`: %s",
+                               from.c_str(), to.c_str(), errno_string(errno).c_str());
+        ::unlink(from.c_str());
+    }
+}
+
+snapshot_export_writer_t::snapshot_export_writer_t(const std::string &_path,
+                                                   snapshot_export_value_format_t value_format,
+                                                   repli_timestamp_t since)
+    THROWS_ONLY(snapshot_export_exc_t)
+    : path(_path), temp_path(_path + ".tmp"), fd(-1), buffer_offset(0),
+      block_start(0), block_rows(0), num_blocks(0) {
+    std::string error;
+    thread_pool_t::run_in_blocker_pool(boost::bind(&open_blocking, temp_path, &fd, &error));
+    if (fd == -1) {
+        throw snapshot_export_exc_t(error);
+    }
+
+    snapshot_export_header_t header;
+    memcpy(header.magic, SNAPSHOT_EXPORT_HEADER_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_EXPORT_VERSION;
+    header.value_format = value_format;
+    header.since = since.longtime;
+    append(&header, sizeof(header));
+    block_start = sizeof(header);
+}
+
+snapshot_export_writer_t::~snapshot_export_writer_t() {
+    if (fd != -1) {
+        // We didn't finish, so don't leave a partial file behind.
+        thread_pool_t::run_in_blocker_pool(boost::bind(&close_and_unlink_blocking, fd, temp_path));
+    }
+}
+
+void snapshot_export_writer_t::add_row(const btree_key_t *key, const std::string &value)
+    THROWS_ONLY(snapshot_export_exc_t) {
+    const uint8_t key_size = key->size;
+    const uint32_t value_size = value.size();
+    append(&key_size, sizeof(key_size));
+    append(key->contents, key_size);
+    append(&value_size, sizeof(value_size));
+    append(value.data(), value.size());
+    ++block_rows;
+    if (buffer.size() >= SNAPSHOT_EXPORT_WRITE_SIZE) {
+        flush();
+    }
+}
+
+void snapshot_export_writer_t::finish_block(const key_range_t &range)
+    THROWS_ONLY(snapshot_export_exc_t) {
+    const uint64_t block_end = buffer_offset + buffer.size();
+
+    snapshot_export_index_entry_t entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.offset = block_start;
+    entry.size = block_end - block_start;
+    entry.num_rows = block_rows;
+    entry.left_size = range.left.size();
+    memcpy(entry.left, range.left.contents(), range.left.size());
+    entry.right_unbounded = range.right.unbounded ? 1 : 0;
+    if (!range.right.unbounded) {
+        entry.right_size = range.right.key.size();
+        memcpy(entry.right, range.right.key.contents(), range.right.key.size());
+    }
+    index.append(reinterpret_cast<const char *>(&entry), sizeof(entry));
+    ++num_blocks;
+
+    block_start = block_end;
+    block_rows = 0;
+}
+
+void snapshot_export_writer_t::finish(repli_timestamp_t max_recency)
+    THROWS_ONLY(snapshot_export_exc_t) {
+    rassert(block_rows == 0, "finish() called in the middle of a block");
+
+    snapshot_export_footer_t footer;
+    footer.index_offset = buffer_offset + buffer.size();
+    footer.num_blocks = num_blocks;
+    footer.max_recency = max_recency.longtime;
+    memcpy(footer.magic, SNAPSHOT_EXPORT_FOOTER_MAGIC, sizeof(footer.magic));
+
+    append(index.data(), index.size());
+    append(&footer, sizeof(footer));
+    flush();
+
+    std::string error;
+    const int fd_to_close = fd;
+    fd = -1;
+    thread_pool_t::run_in_blocker_pool(boost::bind(&sync_close_rename_blocking,
+                                                   fd_to_close, temp_path, path, &error));
+    if (!error.empty()) {
+        throw snapshot_export_exc_t(error);
+    }
+}
+
+void snapshot_export_writer_t::append(const void *data, size_t size) {
+    buffer.append(reinterpret_cast<const char *>(data), size);
+}
+
+void snapshot_export_writer_t::flush() THROWS_ONLY(snapshot_export_exc_t) {
+    std::string error;
+    thread_pool_t::run_in_blocker_pool(boost::bind(&snapshot_export_writer_t::flush_blocking,
+                                                   this, &error));
+    if (!error.empty()) {
+        throw snapshot_export_exc_t(error);
+    }
+}
+
+void snapshot_export_writer_t::flush_blocking(std::string *error_out) {
+    size_t written = 0;
+    while (written < buffer.size()) {
+        ssize_t res = ::pwrite(fd, buffer.data() + written, buffer.size() - written,
+                               buffer_offset + written);
+        if (res == -1 && errno == EINTR) {
+            continue;
+        } else if (res == -1) {
+            *error_out = strprintf("Could not write to `%s`: %s",
+                                   temp_path.c_str(), errno_string(errno).c_str());
+            return;
+        }
+        written += res;
+    }
+    buffer_offset += buffer.size();
+    buffer.clear();
+}
+
+class subtree_recencies_waiter_t : public get_subtree_recencies_callback_t {
+public:
+    void got_subtree_recencies() { done.pulse(); }
+    cond_t done;
+};
+
+static void export_subtree(transaction_t *txn, buf_lock_t *block, const key_range_t &range,
+                           repli_timestamp_t since,
+                           snapshot_export_value_exporter_t *exporter,
+                           snapshot_export_writer_t *writer, signal_t *interruptor)
+    THROWS_ONLY(interrupted_exc_t, snapshot_export_exc_t) {
+    if (interruptor->is_pulsed()) {
+        throw interrupted_exc_t();
+    }
+
+    const node_t *node = reinterpret_cast<const node_t *>(block->get_data_read());
+    if (node::is_internal(node)) {
+        const internal_node_t *inode = reinterpret_cast<const internal_node_t *>(node);
+        const int start_index = internal_node::get_offset_index(inode, range.left.btree_key());
+        int end_index;
+        if (range.right.unbounded) {
+            end_index = inode->npairs;
+        } else {
+            store_key_t r = range.right.key;
+            r.decrement();
+            end_index = internal_node::get_offset_index(inode, r.btree_key()) + 1;
+        }
+
+        /* Look up which children changed without loading any of them.  The
+        recencies are those of the current version of the tree, which are at
+        least as recent as the snapshot's, so we never skip a change. */
+        std::vector<block_id_t> block_ids(end_index - start_index);
+        std::vector<repli_timestamp_t> recencies(end_index - start_index, repli_timestamp_t::invalid);
+        for (int i = start_index; i < end_index; ++i) {
+            block_ids[i - start_index] = internal_node::get_pair_by_index(inode, i)->lnode;
+        }
+        if (since != repli_timestamp_t::distant_past && !block_ids.empty()) {
+            subtree_recencies_waiter_t waiter;
+            txn->get_subtree_recencies(block_ids.data(), block_ids.size(), recencies.data(), &waiter);
+            waiter.done.wait_lazily_unordered();
+        }
+
+        for (int i = start_index; i < end_index; ++i) {
+            if (since != repli_timestamp_t::distant_past && recencies[i - start_index] < since) {
+                continue;
+            }
+
+            /* The child holds the keys after the previous pair's key, up to and
+            including its own pair's key; the last pair's key is special and
+            doesn't bound anything. */
+            key_range_t child_range = range;
+            if (i > 0) {
+                store_key_t left(&internal_node::get_pair_by_index(inode, i - 1)->key);
+                if (left.increment() && child_range.left < left) {
+                    child_range.left = left;
+                }
+            }
+            if (i < inode->npairs - 1) {
+                store_key_t right(&internal_node::get_pair_by_index(inode, i)->key);
+                if (right.increment()) {
+                    key_range_t::right_bound_t bound(right);
+                    if (bound < child_range.right) {
+                        child_range.right = bound;
+                    }
+                }
+            }
+            if (child_range.is_empty()) {
+                continue;
+            }
+
+            buf_lock_t lock(txn, block_ids[i - start_index], rwi_read);
+            export_subtree(txn, &lock, child_range, since, exporter, writer, interruptor);
+        }
+    } else {
+        const leaf_node_t *lnode = reinterpret_cast<const leaf_node_t *>(node);
+        std::string value;
+        const btree_key_t *key;
+        for (leaf::live_iter_t it = leaf::iter_for_inclusive_lower_bound(lnode, range.left.btree_key());
+             (key = it.get_key(lnode)) && (range.right.unbounded || sized_strcmp(key->contents, key->size, range.right.key.contents(), range.right.key.size()) < 0);
+             it.step(lnode)) {
+            value.clear();
+            exporter->export_value(txn, it.get_value(lnode), &value);
+            writer->add_row(key, value);
+        }
+        writer->finish_block(range);
+    }
+}
+
+repli_timestamp_t btree_snapshot_export(transaction_t *txn,
+                                        superblock_t *superblock,
+                                        const key_range_t &range,
+                                        repli_timestamp_t since,
+                                        snapshot_export_value_exporter_t *exporter,
+                                        snapshot_export_writer_t *writer,
+                                        signal_t *interruptor)
+    THROWS_ONLY(interrupted_exc_t, snapshot_export_exc_t) {
+    const block_id_t root_block_id = superblock->get_root_block_id();
+    if (root_block_id == NULL_BLOCK_ID) {
+        superblock->release();
+        /* An empty tree still has to say that the range is empty, even in an
+        incremental export: we can't tell whether it was empty at `since` too,
+        and saying so again does no harm. */
+        writer->finish_block(range);
+        return repli_timestamp_t::distant_past;
+    }
+
+    buf_lock_t root_block(txn, root_block_id, rwi_read);
+    superblock->release();
+
+    const repli_timestamp_t max_recency = root_block.get_recency();
+    if (since == repli_timestamp_t::distant_past || max_recency >= since) {
+        export_subtree(txn, &root_block, range, since, exporter, writer, interruptor);
+    }
+    return max_recency;
+}
@@ -0,0 +1,150 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#ifndef BTREE_SNAPSHOT_EXPORT_HPP_
+#define BTREE_SNAPSHOT_EXPORT_HPP_
+
+#include <stdint.h>
+
+#include <exception>
+#include <string>
+
+#include "btree/keys.hpp"
+#include "buffer_cache/types.hpp"
+#include "config/args.hpp"
+#include "repli_timestamp.hpp"
+#include "utils.hpp"
+
+class superblock_t;
+class signal_t;
+
+/* A snapshot export file holds the rows of one store, sorted by key, in a form
+that tools can memory-map and search without a running server.  All integers
+are in the byte order of the machine that wrote the file.
+
+    header:  snapshot_export_header_t
+    data:    one data block per btree leaf, each one the leaf's rows as
+             [uint8_t key size][key][uint32_t value size][value]
+    index:   one snapshot_export_index_entry_t per data block, sorted by key
+    footer:  snapshot_export_footer_t
+
+Every data block covers a key range, and holds every row in that range.  In a
+full export (`since` is `repli_timestamp_t::distant_past`) the ranges cover the
+store's whole key range.  An incremental export only has the ranges that
+changed at or after `since`; its rows replace all of the rows in those ranges
+of the export it is applied to, so deletions carry over too.  The next
+incremental export should use the footer's `max_recency` plus one as its
+`since`. */
+
+#define SNAPSHOT_EXPORT_HEADER_MAGIC "RDBSNAP1"
+#define SNAPSHOT_EXPORT_FOOTER_MAGIC "RDBSNAPF"
+#define SNAPSHOT_EXPORT_VERSION 1
+
+// How the values in a snapshot export are encoded.
+enum snapshot_export_value_format_t {
+    // The value's bytes as they are.
+    SNAPSHOT_EXPORT_RAW_VALUES = 0,
+    // JSON text.
+    SNAPSHOT_EXPORT_JSON_VALUES = 1
+};
+
+struct snapshot_export_header_t {
+    char magic[8];
+    uint32_t version;
+    uint32_t value_format;
+    uint64_t since;
+} __attribute__((__packed__));
+
+/* The fixed size makes it possible to binary-search the index in place. */
+struct snapshot_export_index_entry_t {
+    // Where the data block starts, relative to the start of the file.
+    uint64_t offset;
+    uint32_t size;
+    uint32_t num_rows;
+    // The range is [left, right), or [left, infinity) if `right_unbounded`.
+    uint8_t left_size;
+    uint8_t left[MAX_KEY_SIZE];
+    uint8_t right_unbounded;
+    uint8_t right_size;
+    uint8_t right[MAX_KEY_SIZE];
+} __attribute__((__packed__));
+
+struct snapshot_export_footer_t {
+    uint64_t index_offset;
+    uint64_t num_blocks;
+    // The most recent change in the snapshot that was exported.
+    uint64_t max_recency;
+    char magic[8];
+} __attribute__((__packed__));
+
+class snapshot_export_exc_t : public std::exception {
+public:
+    explicit snapshot_export_exc_t(const std::string &_info) : info(_info) { }
+    ~snapshot_export_exc_t() throw () { }
+    const char *what() const throw () { return info.c_str(); }
+private:
+    std::string info;
+};
+
+/* Writes a snapshot export file.  The file is written under a temporary name and
+only moved to `path` by `finish()`, so a file at `path` is always complete.
+File IO happens in the blocker pool. */
+class snapshot_export_writer_t {
+public:
+    snapshot_export_writer_t(const std::string &path,
+                             snapshot_export_value_format_t value_format,
+                             repli_timestamp_t since)
+        THROWS_ONLY(snapshot_export_exc_t);
+    ~snapshot_export_writer_t();
+
+    // Rows must be added in key order, and within the range of the block they
+    // belong to.
+    void add_row(const btree_key_t *key, const std::string &value)
+        THROWS_ONLY(snapshot_export_exc_t);
+    void finish_block(const key_range_t &range) THROWS_ONLY(snapshot_export_exc_t);
+
+    void finish(repli_timestamp_t max_recency) THROWS_ONLY(snapshot_export_exc_t);
+
+private:
+    void append(const void *data, size_t size);
+    void flush() THROWS_ONLY(snapshot_export_exc_t);
+    void flush_blocking(std::string *error_out);
+
+    const std::string path;
+    const std::string temp_path;
+    int fd;
+
+    // Data that hasn't been written yet, and the file offset it starts at.
+    std::string buffer;
+    uint64_t buffer_offset;
+
+    uint64_t block_start;
+    uint32_t block_rows;
+    std::string index;
+    uint64_t num_blocks;
+
+    DISABLE_COPYING(snapshot_export_writer_t);
+};
+
+/* Turns a btree value into the bytes that go into the export. */
+class snapshot_export_value_exporter_t {
+public:
+    virtual snapshot_export_value_format_t value_format() const = 0;
+    virtual void export_value(transaction_t *txn, const void *value, std::string *out) = 0;
+protected:
+    virtual ~snapshot_export_value_exporter_t() { }
+};
+
+/* Exports the part of the btree in `range`, as seen by `txn`, which should be a
+snapshotted transaction so that the export is consistent.  Only the subtrees
+that changed at or after `since` are exported, except that an empty btree is
+always exported as one empty block covering `range`.  Returns the most recent
+change in the btree. */
+repli_timestamp_t btree_snapshot_export(transaction_t *txn,
+                                        superblock_t *superblock,
+                                        const key_range_t &range,
+                                        repli_timestamp_t since,
+                                        snapshot_export_value_exporter_t *exporter,
+                                        snapshot_export_writer_t *writer,
+                                        signal_t *interruptor)
+    THROWS_ONLY(interrupted_exc_t, snapshot_export_exc_t);
+
+#endif  // BTREE_SNAPSHOT_EXPORT_HPP_
@@ -0,0 +1,139 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include "buffer_cache/mirrored/balancer.hpp"
+
+#include <algorithm>
+
+#include "errors.hpp"
+#include <boost/bind.hpp>
+
+#include "arch/runtime/coroutines.hpp"
+#include "arch/runtime/runtime.hpp"
+#include "buffer_cache/mirrored/mirrored.hpp"
+#include "concurrency/pmap.hpp"
+#include "config/args.hpp"
+
+cache_balancer_registration_t::cache_balancer_registration_t(cache_balancer_t *_balancer,
+                                                             mc_cache_t *_cache)
+    : balancer(_balancer), cache(_cache), cache_thread(get_thread_id()) {
+    on_thread_t thread_switcher(balancer->home_thread());
+    mutex_t::acq_t acq(&balancer->caches_mutex);
+    balancer->caches.insert(this);
+}
+
+cache_balancer_registration_t::~cache_balancer_registration_t() {
+    rassert(get_thread_id() == cache_thread);
+    on_thread_t thread_switcher(balancer->home_thread());
+    // Waits for a rebalance that might still be resizing our cache.
+    mutex_t::acq_t acq(&balancer->caches_mutex);
+    balancer->caches.erase(this);
+}
+
+cache_balancer_t::cache_balancer_t(int64_t _total_cache_size)
+    : total_cache_size(_total_cache_size),
+      rebalance_in_progress(false),
+      timer(CACHE_BALANCER_INTERVAL_MS, this) {
+    guarantee(total_cache_size > 0);
+}
+
+cache_balancer_t::~cache_balancer_t() {
+    assert_thread();
+    rassert(caches.empty(), "Caches must unregister before the balancer is destroyed.");
+}
+
+void cache_balancer_t::on_ring() {
+    assert_thread();
+    if (!rebalance_in_progress && !caches.empty()) {
+        rebalance_in_progress = true;
+        coro_t::spawn_sometime(boost::bind(&cache_balancer_t::rebalance, this,
+                                           auto_drainer_t::lock_t(&drainer)));
+    }
+}
+
+void cache_balancer_t::rebalance(auto_drainer_t::lock_t keepalive) {
+    assert_thread();
+    keepalive.assert_is_holding(&drainer);
+
+    mutex_t::acq_t acq(&caches_mutex);
+    const std::vector<cache_balancer_registration_t *> regs(caches.begin(), caches.end());
+
+    std::vector<cache_balancer_sample_t> samples(regs.size());
+    pmap(regs.size(), boost::bind(&cache_balancer_t::sample_cache, this, &regs, &samples, _1));
+
+    std::vector<int64_t> sizes;
+    compute_cache_balance(total_cache_size, samples, &sizes);
+
+    pmap(regs.size(), boost::bind(&cache_balancer_t::resize_cache, this, &regs, &sizes, _1));
+
+    rebalance_in_progress = false;
+}
+
+void cache_balancer_t::sample_cache(const std::vector<cache_balancer_registration_t *> *regs,
+                                    std::vector<cache_balancer_sample_t> *samples_out,
+                                    int i) {
+    cache_balancer_registration_t *reg = (*regs)[i];
+    on_thread_t thread_switcher(reg->cache_thread);
+    reg->cache->take_balancer_sample(&(*samples_out)[i]);
+}
+
+void cache_balancer_t::resize_cache(const std::vector<cache_balancer_registration_t *> *regs,
+                                    const std::vector<int64_t> *sizes,
+                                    int i) {
+    cache_balancer_registration_t *reg = (*regs)[i];
+    on_thread_t thread_switcher(reg->cache_thread);
+    reg->cache->set_max_size((*sizes)[i]);
+}
+
+void compute_cache_balance(int64_t total_cache_size,
+                           const std::vector<cache_balancer_sample_t> &samples,
+                           std::vector<int64_t> *sizes_out) {
+    const int64_t num_caches = samples.size();
+    sizes_out->assign(num_caches, 0);
+    if (num_caches == 0) {
+        return;
+    }
+
+    // Every cache keeps a floor, so that a table that has been idle for a while
+    // still has its root and upper btree levels in memory when it wakes up.
+    const int64_t floor_size = std::min<int64_t>(CACHE_BALANCER_MIN_CACHE_SIZE,
+                                                 total_cache_size / num_caches);
+    const int64_t spare = total_cache_size - floor_size * num_caches;
+
+    // A cache that was used wants room for its blocks in memory plus the ones
+    // it had to read from disk.  An idle cache wants nothing beyond its floor.
+    std::vector<int64_t> wanted(num_caches);
+    int64_t total_wanted = 0;
+    std::vector<double> cost(num_caches);
+    double total_cost = 0;
+    int64_t total_old = 0;
+    for (int64_t i = 0; i < num_caches; ++i) {
+        const cache_balancer_sample_t &s = samples[i];
+        const int64_t working_set = s.accesses == 0
+            ? 0
+            : (s.blocks_in_memory + s.misses) * s.block_size;
+        wanted[i] = std::max<int64_t>(0, working_set - floor_size);
+        total_wanted += wanted[i];
+        // Every cache gets some weight so that spare memory is never left over.
+        cost[i] = 1.0 + ticks_to_secs(s.miss_ticks);
+        total_cost += cost[i];
+        total_old += s.max_size;
+    }
+
+    for (int64_t i = 0; i < num_caches; ++i) {
+        int64_t target;
+        if (total_wanted <= spare) {
+            // Everybody fits; hand out what's left by how much misses cost.
+            const double extra = static_cast<double>(spare - total_wanted) * cost[i] / total_cost;
+            target = floor_size + wanted[i] + static_cast<int64_t>(extra);
+        } else {
+            const double share = static_cast<double>(spare) * wanted[i] / total_wanted;
+            target = floor_size + static_cast<int64_t>(share);
+        }
+
+        // Only move halfway toward the target, unless the old sizes are over
+        // budget (e.g. because a cache just registered).  Both halves stay
+        // within the budget, so their average does too.
+        (*sizes_out)[i] = total_old <= total_cache_size
+            ? (samples[i].max_size + target) / 2
+            : target;
+    }
+}
@@ -0,0 +1,99 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#ifndef BUFFER_CACHE_MIRRORED_BALANCER_HPP_
+#define BUFFER_CACHE_MIRRORED_BALANCER_HPP_
+
+#include <set>
+#include <vector>
+
+#include "arch/timing.hpp"
+#include "concurrency/auto_drainer.hpp"
+#include "concurrency/mutex.hpp"
+#include "utils.hpp"
+
+class mc_cache_t;
+class cache_balancer_t;
+
+/* What a cache tells the balancer about itself.  The counters cover the time
+since the previous sample was taken. */
+struct cache_balancer_sample_t {
+    cache_balancer_sample_t()
+        : block_size(0), max_size(0), blocks_in_memory(0),
+          accesses(0), misses(0), miss_ticks(0) { }
+
+    int64_t block_size;
+    int64_t max_size;
+    int64_t blocks_in_memory;
+
+    // Block acquisitions, and how many of them had to wait for a disk read.
+    int64_t accesses;
+    int64_t misses;
+    // Time spent waiting for those disk reads; this is what a miss costs.
+    ticks_t miss_ticks;
+};
+
+/* A cache_balancer_registration_t ties one mc_cache_t to a cache_balancer_t for
+as long as it exists.  It is created and destroyed on the cache's thread, and
+the cache must outlive it. */
+class cache_balancer_registration_t {
+public:
+    cache_balancer_registration_t(cache_balancer_t *balancer, mc_cache_t *cache);
+    ~cache_balancer_registration_t();
+
+private:
+    friend class cache_balancer_t;
+
+    cache_balancer_t *balancer;
+    mc_cache_t *cache;
+    int cache_thread;
+
+    DISABLE_COPYING(cache_balancer_registration_t);
+};
+
+/* The cache balancer splits one node-wide memory budget between all the
+mirrored caches on the node.  Every `CACHE_BALANCER_INTERVAL_MS` it samples each
+cache's working set and misses, and hands out new sizes: every cache keeps a
+small floor, caches get enough to hold what they are actually using, and
+whatever is left over goes to the caches whose misses cost the most.  New sizes
+are blended with the old ones so that a short burst on one table doesn't empty
+the cache of another. */
+class cache_balancer_t : public home_thread_mixin_t, private repeating_timer_callback_t {
+public:
+    explicit cache_balancer_t(int64_t total_cache_size);
+    ~cache_balancer_t();
+
+    int64_t get_total_cache_size() const { return total_cache_size; }
+
+private:
+    friend class cache_balancer_registration_t;
+
+    void on_ring();
+    void rebalance(auto_drainer_t::lock_t keepalive);
+
+    void sample_cache(const std::vector<cache_balancer_registration_t *> *caches,
+                      std::vector<cache_balancer_sample_t> *samples_out,
+                      int i);
+    void resize_cache(const std::vector<cache_balancer_registration_t *> *caches,
+                      const std::vector<int64_t> *sizes,
+                      int i);
+
+    const int64_t total_cache_size;
+
+    // Held while a rebalance is underway, and while caches register or
+    // unregister, so that no cache goes away while we are resizing it.
+    mutex_t caches_mutex;
+    std::set<cache_balancer_registration_t *> caches;
+
+    bool rebalance_in_progress;
+
+    auto_drainer_t drainer;
+    repeating_timer_t timer;
+
+    DISABLE_COPYING(cache_balancer_t);
+};
+
+// Computes the new cache sizes from the samples; exposed for the unit tests.
+void compute_cache_balance(int64_t total_cache_size,
+                           const std::vector<cache_balancer_sample_t> &samples,
+                           std::vector<int64_t> *sizes_out);
+
+#endif  // BUFFER_CACHE_MIRRORED_BALANCER_HPP_
@@ -160,7 +160,11 @@ void mc_inner_buf_t::load_inner_buf(bool should_lock, file_account_t *io_account
         rassert(lock.locked());
     }
 
-    // Read the block...
+    // Read the block...  The balancer counts every read as a miss, and the
+    // time it takes as what the miss cost.
+    loading = true;
+    ++cache->blocks_being_read;
+    const ticks_t read_start = get_ticks();
     {
         on_thread_t thread(cache->serializer->home_thread());
         subtree_recency = cache->serializer->get_recency(block_id);
@@ -169,6 +173,10 @@ void mc_inner_buf_t::load_inner_buf(bool should_lock, file_account_t *io_account
         guarantee(data_token.has());
         cache->serializer->block_read(data_token, data.get(), io_account);
     }
+    ++cache->balancer_misses;
+    cache->balancer_miss_ticks += get_ticks() - read_start;
+    --cache->blocks_being_read;
+    loading = false;
 
     if (should_lock) {
         lock.unlock();
@@ -186,6 +194,7 @@ mc_inner_buf_t::mc_inner_buf_t(mc_cache_t *_cache, block_id_t _block_id, file_ac
       lock(),
       refcount(0),
       do_delete(false),
+      loading(false),
       cow_refcount(0),
       snap_refcount(0) {
 
@@ -203,7 +212,7 @@ mc_inner_buf_t::mc_inner_buf_t(mc_cache_t *_cache, block_id_t _block_id, file_ac
     refcount++; // Make the refcount nonzero so this block won't be considered safe to unload.
 
     _cache->page_repl.make_space();
-    _cache->maybe_unregister_read_ahead_callback();
+    _cache->maybe_finish_read_ahead_warm_up();
 
     refcount--;
 }
@@ -220,6 +229,7 @@ mc_inner_buf_t::mc_inner_buf_t(mc_cache_t *_cache, block_id_t _block_id, void *_
       lock(),
       refcount(0),
       do_delete(false),
+      loading(false),
       cow_refcount(0),
       snap_refcount(0) {
 
@@ -230,7 +240,7 @@ mc_inner_buf_t::mc_inner_buf_t(mc_cache_t *_cache, block_id_t _block_id, void *_
     ++_cache->stats->pm_n_blocks_in_memory;
     refcount++; // Make the refcount nonzero so this block won't be considered safe to unload.
     _cache->page_repl.make_space();
-    _cache->maybe_unregister_read_ahead_callback();
+    _cache->maybe_finish_read_ahead_warm_up();
     refcount--;
 }
 
@@ -278,6 +288,7 @@ void mc_inner_buf_t::initialize_to_new(version_id_t _snapshot_version, repli_tim
 #endif
     version_id = _snapshot_version;
     do_delete = false;
+    loading = false;
     cow_refcount = 0;
     snap_refcount = 0;
     data_token.reset();
@@ -305,7 +316,7 @@ mc_inner_buf_t::mc_inner_buf_t(mc_cache_t *_cache, block_id_t _block_id, version
     ++refcount; // Make the refcount nonzero so this block won't be considered safe to unload.
 
     _cache->page_repl.make_space();
-    _cache->maybe_unregister_read_ahead_callback();
+    _cache->maybe_finish_read_ahead_warm_up();
 
     --refcount;
 }
@@ -489,12 +500,15 @@ mc_buf_lock_t::mc_buf_lock_t(mc_transaction_t *transaction,
     // unloaded), or else inner_buf could be selected for deletion from the cache, then recreated,
     // and we'd have two inner_bufs corresponding to the same block id floating around.
 
+    mc_cache_t *cache = transaction->cache;
+    ++cache->balancer_accesses;
+
     if (!inner_buf) {
         /* The buf isn't in the cache and must be loaded from disk */
         // We are either not snapshotted or our snapshot is consistent with the latest version;
         // otherwise, the inner buf would be around to keep track of the snapshotted version. Thus,
         // it is not wasteful to load the latest version if should_load is true.
-        inner_buf = new mc_inner_buf_t(transaction->cache, block_id, transaction->get_io_account());
+        inner_buf = new mc_inner_buf_t(cache, block_id, transaction->get_io_account());
     } else {
         // TODO: the logic for when to load an inner_buf's versions (most recent or snapshotted) is
         // scattered around everywhere (eg: here). consolidate it, perhaps in mc_buf_lock_t.
@@ -507,7 +521,7 @@ mc_buf_lock_t::mc_buf_lock_t(mc_transaction_t *transaction,
         {
             // The inner_buf doesn't have any data currently. We need the data though,
             // so load it!
-            inner_buf->data.init_malloc(transaction->cache->serializer);
+            inner_buf->data.init_malloc(cache->serializer);
 
             // Please keep in mind that this is blocking...
             inner_buf->load_inner_buf(true, transaction->get_io_account());
@@ -1046,6 +1060,12 @@ void mc_transaction_t::set_token_pair(write_token_pair_t *_token_pair) {
     token_pair = _token_pair;
 }
 
+void mc_transaction_t::set_recency_timestamp(repli_timestamp_t _recency_timestamp) {
+    rassert(access == rwi_write);
+    rassert(recency_timestamp <= _recency_timestamp);
+    recency_timestamp = _recency_timestamp;
+}
+
 file_account_t *mc_transaction_t::get_io_account() const {
     return (cache_account == NULL ? cache->reads_io_account.get() : cache_account->io_account_);
 }
@@ -1084,6 +1104,11 @@ void mc_transaction_t::get_subtree_recencies(block_id_t *block_ids, size_t num_b
     }
 }
 
+void mc_transaction_t::prefetch_block(block_id_t block_id) {
+    assert_thread();
+    cache->prefetch_block(block_id);
+}
+
 mc_cache_account_t::mc_cache_account_t(int thread, file_account_t *io_account)
     : thread_(thread), io_account_(io_account) { }
 
@@ -1136,8 +1161,12 @@ mc_cache_t::mc_cache_t(serializer_t *_serializer,
     num_live_writeback_transactions(0),
     num_live_non_writeback_transactions(0),
     to_pulse_when_last_transaction_commits(NULL),
-    read_ahead_registered(false),
-    next_snapshot_version(mc_inner_buf_t::faux_version_id+1) {
+    read_ahead_warming_up(false),
+    next_snapshot_version(mc_inner_buf_t::faux_version_id+1),
+    balancer_accesses(0),
+    balancer_misses(0),
+    balancer_miss_ticks(0),
+    blocks_being_read(0) {
 
     {
         on_thread_t thread_switcher(serializer->home_thread());
@@ -1145,9 +1174,11 @@ mc_cache_t::mc_cache_t(serializer_t *_serializer,
         writes_io_account.init(serializer->make_io_account(dynamic_config.io_priority_writes));
     }
 
+    prefetch_drainer.init(new auto_drainer_t);
+
     // Register us for read ahead to warm up faster
     serializer->register_read_ahead_cb(this);
-    read_ahead_registered = true;
+    read_ahead_warming_up = true;
 
     /* Init the stat system with the block size */
     stats->pm_block_size.block_size = get_block_size().ser_value();
@@ -1156,9 +1187,15 @@ mc_cache_t::mc_cache_t(serializer_t *_serializer,
 mc_cache_t::~mc_cache_t() {
     assert_thread();
 
+    // Unregister first, so that the balancer doesn't resize us while we shut down.
+    balancer_registration.reset();
+
     shutting_down = true;
     serializer->unregister_read_ahead_cb(this);
 
+    // Prefetches use `reads_io_account` and offer their blocks to us.
+    prefetch_drainer.reset();
+
     rassert(num_live_non_writeback_transactions == 0,
             "num_live_non_writeback_transactions is %d\n",
             num_live_non_writeback_transactions);
@@ -1208,6 +1245,50 @@ block_size_t mc_cache_t::get_block_size() const {
     return serializer->get_block_size();
 }
 
+void mc_cache_t::register_with_balancer(cache_balancer_t *balancer) {
+    assert_thread();
+    guarantee(!balancer_registration.has());
+    balancer_registration.init(new cache_balancer_registration_t(balancer, this));
+}
+
+void mc_cache_t::take_balancer_sample(cache_balancer_sample_t *sample_out) {
+    assert_thread();
+    sample_out->block_size = get_block_size().ser_value();
+    sample_out->max_size = dynamic_config.max_size;
+    sample_out->blocks_in_memory = num_blocks();
+    sample_out->accesses = balancer_accesses;
+    sample_out->misses = balancer_misses;
+    sample_out->miss_ticks = balancer_miss_ticks;
+    balancer_accesses = 0;
+    balancer_misses = 0;
+    balancer_miss_ticks = 0;
+}
+
+void mc_cache_t::set_max_size(int64_t max_size) {
+    assert_thread();
+    dynamic_config.max_size = max_size;
+    const int64_t max_blocks = max_size / get_block_size().ser_value();
+    page_repl.set_unload_threshold(std::max<int64_t>(max_blocks, 1));
+}
+
+void mc_cache_t::introspect(mc_cache_introspection_t *out) {
+    assert_thread();
+    out->block_size = get_block_size().ser_value();
+    out->max_size = dynamic_config.max_size;
+    out->blocks_in_memory = num_blocks();
+    out->blocks_dirty = writeback.num_dirty_blocks();
+    out->blocks_being_read = blocks_being_read;
+    out->blocks_being_prefetched = blocks_being_fetched.size();
+    out->blocks_being_written = writeback.num_blocks_being_written();
+    out->active_flushes = writeback.num_active_flushes();
+    out->snapshots = active_snapshots.size();
+    out->snapshotted_blocks = 0;
+    for (std::map<mc_inner_buf_t::version_id_t, mc_transaction_t *>::const_iterator it = active_snapshots.begin();
+         it != active_snapshots.end(); ++it) {
+        out->snapshotted_blocks += it->second->owned_buf_snapshots.size();
+    }
+}
+
 void mc_cache_t::register_snapshot(mc_transaction_t *txn) {
     ++stats->pm_registered_snapshots;
     rassert(txn->snapshot_version == mc_inner_buf_t::faux_version_id, "Snapshot has been already created for this transaction");
@@ -1269,6 +1350,15 @@ bool mc_cache_t::contains_block(block_id_t block_id) {
     return find_buf(block_id) != NULL;
 }
 
+const void *mc_cache_t::peek_block_if_resident(block_id_t block_id) {
+    assert_thread();
+    mc_inner_buf_t *inner_buf = find_buf(block_id);
+    if (inner_buf == NULL || inner_buf->do_delete || inner_buf->loading || !inner_buf->data.has()) {
+        return NULL;
+    }
+    return inner_buf->data.get();
+}
+
 
 void mc_cache_t::create_cache_account(int priority, scoped_ptr_t<mc_cache_account_t> *out) {
     // We assume that a priority of 100 means that the transaction should have the same priority as
@@ -1338,11 +1428,225 @@ bool mc_cache_t::can_read_ahead_block_be_accepted(block_id_t block_id) {
     return !we_already_have_the_block && writeback_has_no_objections;
 }
 
-void mc_cache_t::maybe_unregister_read_ahead_callback() {
-    // Unregister when 90 % of the cache are filled up.
-    if (read_ahead_registered && page_repl.is_full(dynamic_config.max_size / serializer->get_block_size().ser_value() / 10 + 1)) {
-        read_ahead_registered = false;
-        // unregister_read_ahead_cb requires a coro context, but we might not be in any
-        coro_t::spawn_now_dangerously(boost::bind(&serializer_t::unregister_read_ahead_cb, serializer, this));
+bool mc_cache_t::start_fetching_block(block_id_t block_id) {
+    assert_thread();
+    if (shutting_down || find_buf(block_id) != NULL
+        || blocks_being_fetched.count(block_id) != 0) {
+        return false;
+    }
+    blocks_being_fetched.insert(std::make_pair(block_id, true));
+    return true;
+}
+
+// Returns true if what was read for the block can be offered to the cache.
+bool mc_cache_t::finish_fetching_block(block_id_t block_id) {
+    assert_thread();
+    std::map<block_id_t, bool>::iterator it = blocks_being_fetched.find(block_id);
+    rassert(it != blocks_being_fetched.end());
+    const bool current = it->second;
+    blocks_being_fetched.erase(it);
+    return current;
+}
+
+void mc_cache_t::prefetch_block(block_id_t block_id) {
+    assert_thread();
+
+    // Blocks that are prefetched but not used yet take memory that other blocks
+    // could use, so we only allow a small part of the cache to be in flight.
+    const int64_t max_blocks = dynamic_config.max_size / get_block_size().ser_value();
+    if (static_cast<int64_t>(blocks_being_fetched.size()) >= max_blocks / MAX_PREFETCH_CACHE_FRACTION) {
+        return;
+    }
+
+    if (!start_fetching_block(block_id)) {
+        return;
+    }
+    ++stats->pm_n_blocks_prefetched;
+    // The prefetches always use the cache's own IO account, because the
+    // account of the transaction that asked for them may go away first.
+    coro_t::spawn_sometime(boost::bind(&mc_cache_t::do_prefetch_block, this, block_id,
+                                       auto_drainer_t::lock_t(prefetch_drainer.get())));
+}
+
+void mc_cache_t::do_prefetch_block(block_id_t block_id, auto_drainer_t::lock_t keepalive) {
+    assert_thread();
+    keepalive.assert_is_holding(prefetch_drainer.get());
+
+    counted_t<standard_block_token_t> token;
+    repli_timestamp_t recency_timestamp = repli_timestamp_t::invalid;
+    void *buf = NULL;
+    {
+        on_thread_t thread(serializer->home_thread());
+        // The block may have been deleted since whoever asked for it saw it.
+        token = serializer->index_read(block_id);
+        if (token.has()) {
+            recency_timestamp = serializer->get_recency(block_id);
+            buf = serializer->malloc();
+            serializer->block_read(token, buf, reads_io_account.get());
+        }
+    }
+
+    const bool current = finish_fetching_block(block_id);
+    if (token.has()) {
+        if (current) {
+            // This checks that nobody loaded or deleted the block in the meantime.
+            offer_read_ahead_buf_home_thread(block_id, buf, token, recency_timestamp);
+        } else {
+            serializer->free(buf);
+        }
+    }
+}
+
+struct hot_block_t {
+    hot_block_t(eviction_priority_t _priority, block_id_t _block_id)
+        : priority(_priority), block_id(_block_id) { }
+    bool operator<(const hot_block_t &other) const {
+        return priority < other.priority
+            || (priority == other.priority && block_id < other.block_id);
+    }
+    eviction_priority_t priority;
+    block_id_t block_id;
+};
+
+void mc_cache_t::get_hot_block_ids(std::vector<block_id_t> *out) {
+    assert_thread();
+    // Blocks with a lower eviction priority are the last to be evicted.
+    std::vector<hot_block_t> blocks;
+    blocks.reserve(page_repl.num_bufs());
+    for (unsigned int i = 0; i < page_repl.num_bufs(); ++i) {
+        mc_inner_buf_t *inner_buf = static_cast<mc_inner_buf_t *>(page_repl.get_buf(i));
+        if (!inner_buf->do_delete && !inner_buf->loading) {
+            blocks.push_back(hot_block_t(inner_buf->eviction_priority, inner_buf->block_id));
+        }
+    }
+    std::sort(blocks.begin(), blocks.end());
+
+    out->reserve(out->size() + blocks.size());
+    for (std::vector<hot_block_t>::const_iterator it = blocks.begin(); it != blocks.end(); ++it) {
+        out->push_back(it->block_id);
+    }
+}
+
+void mc_cache_t::prewarm(const std::vector<block_id_t> &block_ids, signal_t *interruptor)
+    THROWS_ONLY(interrupted_exc_t) {
+    assert_thread();
+
+    scoped_ptr_t<file_account_t> io_account;
+    {
+        on_thread_t thread_switcher(serializer->home_thread());
+        io_account.init(serializer->make_io_account(CACHE_PREWARM_IO_PRIORITY));
+    }
+
+    stats->pm_n_blocks_prewarm_pending += block_ids.size();
+    size_t next = 0;
+    while (next < block_ids.size() && !interruptor->is_pulsed() && !shutting_down
+           && !page_repl.is_full(CACHE_PREWARM_BATCH_BLOCKS)) {
+        std::vector<block_id_t> batch;
+        for (; next < block_ids.size() && batch.size() < static_cast<size_t>(CACHE_PREWARM_BATCH_BLOCKS); ++next) {
+            if (start_fetching_block(block_ids[next])) {
+                batch.push_back(block_ids[next]);
+            }
+            --stats->pm_n_blocks_prewarm_pending;
+        }
+        prewarm_batch(batch, io_account.get());
+    }
+    // The rest of the list is colder than what we loaded, so it can wait for
+    // the queries that need it.
+    stats->pm_n_blocks_prewarm_pending -= block_ids.size() - next;
+
+    {
+        /* IO accounts must be destroyed on the thread they were created on */
+        on_thread_t thread_switcher(serializer->home_thread());
+        io_account.reset();
+    }
+
+    if (interruptor->is_pulsed()) {
+        throw interrupted_exc_t();
+    }
+}
+
+struct prewarm_read_t {
+    bool operator<(const prewarm_read_t &other) const {
+        return offset < other.offset;
+    }
+    block_id_t block_id;
+    counted_t<standard_block_token_t> token;
+    int64_t offset;
+    repli_timestamp_t recency_timestamp;
+    void *buf;
+};
+
+class prewarm_batch_waiter_t : public iocallback_t {
+public:
+    explicit prewarm_batch_waiter_t(size_t _remaining) : remaining(_remaining) { }
+    void on_io_complete() {
+        rassert(remaining > 0);
+        if (--remaining == 0) {
+            done.pulse();
+        }
+    }
+    cond_t done;
+private:
+    size_t remaining;
+};
+
+void mc_cache_t::prewarm_batch(const std::vector<block_id_t> &block_ids, file_account_t *io_account) {
+    assert_thread();
+
+    std::vector<prewarm_read_t> reads;
+    {
+        on_thread_t thread(serializer->home_thread());
+        const block_id_t max_block_id = serializer->max_block_id();
+        for (std::vector<block_id_t>::const_iterator it = block_ids.begin(); it != block_ids.end(); ++it) {
+            // The list may be older than the file, so some blocks may be gone.
+            if (*it >= max_block_id) {
+                continue;
+            }
+            prewarm_read_t read;
+            read.block_id = *it;
+            read.token = serializer->index_read(*it);
+            if (!read.token.has()) {
+                continue;
+            }
+            read.offset = serializer->get_block_offset(read.token);
+            read.recency_timestamp = serializer->get_recency(*it);
+            read.buf = serializer->malloc();
+            reads.push_back(read);
+        }
+
+        if (!reads.empty()) {
+            std::sort(reads.begin(), reads.end());
+            prewarm_batch_waiter_t waiter(reads.size());
+            for (std::vector<prewarm_read_t>::const_iterator it = reads.begin(); it != reads.end(); ++it) {
+                serializer->block_read(it->token, it->buf, io_account, &waiter);
+            }
+            waiter.done.wait();
+        }
+    }
+
+    for (std::vector<prewarm_read_t>::const_iterator it = reads.begin(); it != reads.end(); ++it) {
+        if (!finish_fetching_block(it->block_id)) {
+            serializer->free(it->buf);
+            continue;
+        }
+        // This checks that nobody loaded or deleted the block in the meantime.
+        if (can_read_ahead_block_be_accepted(it->block_id)) {
+            ++stats->pm_n_blocks_prewarmed;
+        }
+        offer_read_ahead_buf_home_thread(it->block_id, it->buf, it->token, it->recency_timestamp);
+    }
+    // The blocks we didn't read at all.
+    for (std::vector<block_id_t>::const_iterator it = block_ids.begin(); it != block_ids.end(); ++it) {
+        blocks_being_fetched.erase(*it);
+    }
+}
+
+void mc_cache_t::maybe_finish_read_ahead_warm_up() {
+    // Stop warming up when 90 % of the cache are filled up.  We stay registered
+    // for the blocks that the serializer reads ahead of sequential reads.
+    if (read_ahead_warming_up && page_repl.is_full(dynamic_config.max_size / serializer->get_block_size().ser_value() / 10 + 1)) {
+        read_ahead_warming_up = false;
+        // finish_read_ahead_warm_up requires a coro context, but we might not be in any
+        coro_t::spawn_now_dangerously(boost::bind(&serializer_t::finish_read_ahead_warm_up, serializer, this));
     }
 }
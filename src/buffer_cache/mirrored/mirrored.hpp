@@ -4,12 +4,14 @@
 
 #include <algorithm>
 #include <map>
+#include <set>
 #include <utility>
 #include <vector>
 
 #include "arch/types.hpp"
 #include "buffer_cache/types.hpp"
 #include "concurrency/access.hpp"
+#include "concurrency/auto_drainer.hpp"
 #include "concurrency/coro_fifo.hpp"
 #include "concurrency/fifo_checker.hpp"
 #include "concurrency/rwi_lock.hpp"
@@ -18,6 +20,7 @@
 #include "containers/intrusive_list.hpp"
 #include "containers/two_level_array.hpp"
 #include "containers/scoped.hpp"
+#include "buffer_cache/mirrored/balancer.hpp"
 #include "buffer_cache/mirrored/config.hpp"
 #include "buffer_cache/mirrored/stats.hpp"
 #include "repli_timestamp.hpp"
@@ -116,6 +119,9 @@ private:
     // true if this block is to be deleted.
     bool do_delete;
 
+    // true while `load_inner_buf()` is reading the block's data from disk.
+    bool loading;
+
     // number of references from mc_buf_lock_t buffers, which hold a
     // pointer to the data in read_outdated_ok mode.
     size_t cow_refcount;
@@ -240,6 +246,11 @@ public:
 
     void get_subtree_recencies(block_id_t *block_ids, size_t num_block_ids, repli_timestamp_t *recencies_out, get_subtree_recencies_callback_t *cb);
 
+    // Starts loading the block in the background if it isn't in memory, so that
+    // acquiring it later doesn't have to wait for the disk.  Nothing is locked;
+    // the cache may drop the request if too many of them are in flight.
+    void prefetch_block(block_id_t block_id);
+
     // This just sets the snapshotted flag, we finalize the snapshot as soon as the first block has been acquired (see finalize_version() )
     void snapshot();
 
@@ -247,6 +258,10 @@ public:
 
     void set_token_pair(write_token_pair_t *_token_pair);
 
+    // Changes the recency that blocks acquired for write from now on are
+    // touched with, so one transaction can apply several timestamped writes.
+    void set_recency_timestamp(repli_timestamp_t _recency_timestamp);
+
 private:
     void register_buf_snapshot(mc_inner_buf_t *inner_buf, mc_inner_buf_t::buf_snapshot_t *snap);
 
@@ -320,6 +335,12 @@ public:
 
     bool contains_block(block_id_t block_id);
 
+    /* Returns the current data of the block if it's in memory, or NULL, without
+    locking the block or going to disk.  The data is only good until the caller
+    blocks, and nothing stops a writer from changing it after that; this is for
+    introspection, not for reading values. */
+    const void *peek_block_if_resident(block_id_t block_id);
+
     unsigned int num_blocks();
 
     mc_inner_buf_t::version_id_t get_current_version_id() { return next_snapshot_version; }
@@ -336,6 +357,27 @@ public:
     void register_snapshot(mc_transaction_t *txn);
     void unregister_snapshot(mc_transaction_t *txn);
 
+    // Lets `balancer` decide how much memory this cache gets from now on.
+    void register_with_balancer(cache_balancer_t *balancer);
+    // Fills in `sample_out` and restarts the counters; used by the balancer.
+    void take_balancer_sample(cache_balancer_sample_t *sample_out);
+    // Changes how much memory the cache may use, evicting blocks if it shrank.
+    void set_max_size(int64_t max_size);
+
+    void introspect(mc_cache_introspection_t *out);
+
+    /* Lists the blocks in memory, hottest first.  The eviction priorities say
+    how hot a block is: the upper levels of the btree come first. */
+    void get_hot_block_ids(std::vector<block_id_t> *out);
+
+    /* Loads the blocks in `block_ids` that aren't in memory, in that order of
+    preference, in batches of `CACHE_PREWARM_BATCH_BLOCKS` that are read in the
+    order they are in the file, on an IO account of its own with a low priority.
+    It stops once the cache is full, so that it never evicts blocks that were
+    loaded by queries, and between batches if `interruptor` is pulsed. */
+    void prewarm(const std::vector<block_id_t> &block_ids, signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t);
+
 private:
     bool no_active_snapshots() const { return active_snapshots.empty(); }
     bool no_active_snapshots(mc_inner_buf_t::version_id_t from_version, mc_inner_buf_t::version_id_t to_version) const {
@@ -354,7 +396,15 @@ public:
 private:
     void offer_read_ahead_buf_home_thread(block_id_t block_id, void *buf, const counted_t<standard_block_token_t>& token, repli_timestamp_t recency_timestamp);
     bool can_read_ahead_block_be_accepted(block_id_t block_id);
-    void maybe_unregister_read_ahead_callback();
+    void maybe_finish_read_ahead_warm_up();
+
+    bool start_fetching_block(block_id_t block_id);
+    bool finish_fetching_block(block_id_t block_id);
+
+    void prefetch_block(block_id_t block_id);
+    void do_prefetch_block(block_id_t block_id, auto_drainer_t::lock_t keepalive);
+
+    void prewarm_batch(const std::vector<block_id_t> &block_ids, file_account_t *io_account);
 
 public:
     coro_fifo_t& co_begin_coro_fifo() { return co_begin_coro_fifo_; }
@@ -396,13 +446,37 @@ private:
 
     cond_t *to_pulse_when_last_transaction_commits;
 
-    bool read_ahead_registered;
+    bool read_ahead_warming_up;
+
+    /* The blocks that prefetches and prewarming are reading from the serializer
+    outside of any `mc_inner_buf_t`, each mapped to whether what we read can
+    still be offered to the cache.  Their index entries are looked up after
+    they go in here, so what we read is at least as new as anything the cache
+    has written before.  It stops being offerable when a buf for the block gets
+    created in the meantime: the block could then be changed, flushed and
+    evicted again before the read finishes, and what we read would be out of
+    date. */
+    std::map<block_id_t, bool> blocks_being_fetched;
+    scoped_ptr_t<auto_drainer_t> prefetch_drainer;
 
     std::map<mc_inner_buf_t::version_id_t, mc_transaction_t *> active_snapshots;
     mc_inner_buf_t::version_id_t next_snapshot_version;
 
     coro_fifo_t co_begin_coro_fifo_;
 
+    // Block acquisitions since the last balancer sample, how many blocks had
+    // to be read from disk, and how long those reads took.  The reads are
+    // counted and timed in `mc_inner_buf_t::load_inner_buf()`, because the
+    // constructor that starts one returns before it finishes.
+    int64_t balancer_accesses;
+    int64_t balancer_misses;
+    ticks_t balancer_miss_ticks;
+
+    scoped_ptr_t<cache_balancer_registration_t> balancer_registration;
+
+    // Blocks that `mc_inner_buf_t::load_inner_buf()` is reading right now.
+    int64_t blocks_being_read;
+
     DISABLE_COPYING(mc_cache_t);
 };
 
@@ -5,6 +5,13 @@
 void array_map_t::constructing_inner_buf(inner_buf_t *gbuf) {
     rassert(!gbuf->cache->page_map.array.get(gbuf->block_id));
     gbuf->cache->page_map.array.set(gbuf->block_id, gbuf);
+
+    // Every buf is created through here, so this is where a prefetch or
+    // prewarm read of the same block learns that it may be out of date.
+    std::map<block_id_t, bool>::iterator it = gbuf->cache->blocks_being_fetched.find(gbuf->block_id);
+    if (it != gbuf->cache->blocks_being_fetched.end()) {
+        it->second = false;
+    }
 }
 
 void array_map_t::destroying_inner_buf(inner_buf_t *gbuf) {
@@ -119,8 +119,25 @@ void page_repl_random_t::make_space(unsigned int space_needed) {
     }
 }
 
+void page_repl_random_t::set_unload_threshold(unsigned int _unload_threshold) {
+    cache->assert_thread();
+    unload_threshold = _unload_threshold;
+    make_space();
+}
+
 evictable_t *page_repl_random_t::get_first_buf() {
     cache->assert_thread();
     if (array.size() == 0) return NULL;
     return array.get(0);
 }
+
+unsigned int page_repl_random_t::num_bufs() {
+    cache->assert_thread();
+    return array.size();
+}
+
+evictable_t *page_repl_random_t::get_buf(unsigned int index) {
+    cache->assert_thread();
+    rassert(index < array.size());
+    return array.get(index);
+}
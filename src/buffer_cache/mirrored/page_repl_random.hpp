@@ -63,6 +63,10 @@ public:
     // 'space_needed' less than the user-specified memory limit.
     void make_space(unsigned int space_needed = 0);
 
+    // Changes the number of blocks the cache may keep in memory.  Shrinking the
+    // threshold evicts blocks right away, as far as make_space can.
+    void set_unload_threshold(unsigned int _unload_threshold);
+
     /* The page replacement component actually serves two roles. In addition to its primary role as
     a mechanism for kicking out buffers when memory runs low, it also has the job of keeping track
     of all of the buffers in memory in such a way that the cache can quickly request a pointer to
@@ -72,6 +76,10 @@ public:
     rather than keeping a buffer list of its own. */
     evictable_t *get_first_buf();
 
+    // The bufs in memory, in no particular order.
+    unsigned int num_bufs();
+    evictable_t *get_buf(unsigned int index);
+
 private:
     unsigned int unload_threshold;
     cache_t *cache;
@@ -42,6 +42,9 @@ mc_cache_stats_t::mc_cache_stats_t(perfmon_collection_t *parent)
       pm_n_blocks_dirty(),
       pm_n_blocks_total(),
       pm_n_blocks_evicted(),
+      pm_n_blocks_prefetched(),
+      pm_n_blocks_prewarm_pending(),
+      pm_n_blocks_prewarmed(),
       pm_block_size(),
       cache_collection_membership(&cache_collection,
           &pm_registered_snapshots, "registered_snapshots",
@@ -62,6 +65,9 @@ mc_cache_stats_t::mc_cache_stats_t(perfmon_collection_t *parent)
           &pm_n_blocks_dirty, "blocks_dirty",
           &pm_n_blocks_total, "blocks_total",
           &pm_n_blocks_evicted, "blocks_evicted",
+          &pm_n_blocks_prefetched, "blocks_prefetched",
+          &pm_n_blocks_prewarm_pending, "blocks_prewarm_pending",
+          &pm_n_blocks_prewarmed, "blocks_prewarmed",
           &pm_block_size, "block_size",
           NULLPTR) { }
 
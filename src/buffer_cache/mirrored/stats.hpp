@@ -4,6 +4,31 @@
 
 #include "perfmon/perfmon.hpp"
 
+/* A cheap snapshot of what a cache is holding and doing, for introspection.
+Taking one doesn't touch any blocks. */
+struct mc_cache_introspection_t {
+    mc_cache_introspection_t()
+        : block_size(0), max_size(0), blocks_in_memory(0), blocks_dirty(0),
+          blocks_being_read(0), blocks_being_prefetched(0), blocks_being_written(0),
+          active_flushes(0), snapshots(0), snapshotted_blocks(0) { }
+
+    int64_t block_size;
+    int64_t max_size;
+    int64_t blocks_in_memory;
+    int64_t blocks_dirty;
+
+    // Blocks on their way in from the serializer, and dirty blocks on their way
+    // out to it.  `blocks_being_prefetched` includes the blocks being prewarmed.
+    int64_t blocks_being_read;
+    int64_t blocks_being_prefetched;
+    int64_t blocks_being_written;
+    int64_t active_flushes;
+
+    // Snapshotted transactions, and the old block versions kept around for them.
+    int64_t snapshots;
+    int64_t snapshotted_blocks;
+};
+
 /* A class to hold all the stats we care about for this cache. */
 struct mc_cache_stats_t {
     perfmon_collection_t cache_collection;
@@ -48,6 +73,14 @@ struct mc_cache_stats_t {
     // used in buffer_cache/mirrored/page_repl_random.cc
     perfmon_counter_t pm_n_blocks_evicted;
 
+    perfmon_counter_t pm_n_blocks_prefetched;
+
+    // Blocks on the hot list that are still waiting to be loaded, and the ones
+    // that were loaded, when the cache is prewarmed.
+    perfmon_counter_t
+        pm_n_blocks_prewarm_pending,
+        pm_n_blocks_prewarmed;
+
     /* This is for exposing the block size */
     struct perfmon_cache_custom_t : public perfmon_t {
     public:
@@ -8,11 +8,17 @@
 
 #include "arch/runtime/coroutines.hpp"
 #include "arch/runtime/runtime.hpp"
+#include "arch/timing.hpp"
 #include "buffer_cache/mirrored/mirrored.hpp"
+#include "concurrency/wait_any.hpp"
 #include "containers/scoped.hpp"
 #include "perfmon/perfmon.hpp"
 #include "serializer/serializer.hpp"
 
+/* How long a flush that nobody is waiting on may wait for a moment without
+write transactions before it takes the flush lock anyway. */
+static const int64_t FLUSH_PATIENCE_MS = 50;
+
 // TODO: We added a writeback->possibly_unthrottle_transactions() call
 // in the begin_transaction_fsm_t(..) constructor, where did that get
 // merged to now?
@@ -31,8 +37,12 @@ writeback_t::writeback_t(
     flush_timer(NULL),
     writeback_in_progress(false),
     active_flushes(0),
+    blocks_being_written(0),
     dirty_block_semaphore(_max_dirty_blocks),
     cache(_cache),
+    active_write_txns(0),
+    flush_patience_over(NULL),
+    write_txns_throttled(0),
     start_next_sync_immediately(false),
     to_pulse_when_last_active_flush_finishes(NULL) {
 
@@ -76,6 +86,11 @@ void writeback_t::sync(sync_callback_t *callback) {
 
     if (callback != NULL) {
         sync_callbacks.push_back(callback);
+
+        // Someone is waiting for the flush, so it shouldn't dawdle.
+        if (flush_patience_over != NULL) {
+            flush_patience_over->pulse_if_not_already_pulsed();
+        }
     }
 
     if (!writeback_in_progress && active_flushes < max_concurrent_flushes) {
@@ -99,11 +114,25 @@ void writeback_t::begin_transaction(mc_transaction_t *txn) {
 
     if (txn->get_access() == rwi_write) {
 
-        /* Throttling */
+        /* Throttling.  If we have to wait for dirty blocks to be flushed, a
+        flush that is waiting for write transactions to drain would only be
+        holding us up, so tell it to get going. */
+        const bool throttled = !dirty_block_semaphore.can_lock_now(txn->expected_change_count);
+        if (throttled) {
+            ++write_txns_throttled;
+            if (flush_patience_over != NULL) {
+                flush_patience_over->pulse_if_not_already_pulsed();
+            }
+        }
         dirty_block_semaphore.co_lock(txn->expected_change_count);
+        if (throttled) {
+            rassert(write_txns_throttled > 0);
+            --write_txns_throttled;
+        }
 
         /* Acquire flush lock in non-exclusive mode */
         flush_lock.co_lock(rwi_read);
+        ++active_write_txns;
     } else if (txn->get_access() == rwi_read_sync) {
 
         /* Throttling */
@@ -128,6 +157,12 @@ void writeback_t::on_transaction_commit(mc_transaction_t *txn) {
         dirty_block_semaphore.unlock(txn->expected_change_count);
 
         flush_lock.unlock();
+        rassert(active_write_txns > 0);
+        --active_write_txns;
+        if (flush_patience_over != NULL
+            && (active_write_txns == 0 || num_dirty_blocks() > flush_threshold)) {
+            flush_patience_over->pulse_if_not_already_pulsed();
+        }
 
         /* At the end of every write transaction, check if the number of dirty blocks exceeds the
         threshold to force writeback to start. */
@@ -334,6 +369,8 @@ void writeback_t::do_concurrent_flush() {
     flush_state_t state;
     intrusive_list_t<sync_callback_t> current_sync_callbacks; // Callbacks for this sync
 
+    wait_for_flush_patience();
+
     // Acquire flush lock to force write txn completion, and perform necessary preparations
     {
         /* Acquire exclusive flush_lock, forcing all write txns to complete. */
@@ -354,6 +391,7 @@ void writeback_t::do_concurrent_flush() {
         cache->stats->pm_flushes_writing.begin(&start_time);
         flush_acquire_bufs(transaction, &state);
     }
+    blocks_being_written += state.buf_writers.size();
 
     // Now that preparations are complete, send the writes to the serializer
     if (!state.serializer_writes.empty()) {
@@ -396,6 +434,7 @@ void writeback_t::do_concurrent_flush() {
         state.buf_writers[i]->wait_for_finish();
         delete state.buf_writers[i];
     }
+    blocks_being_written -= state.buf_writers.size();
     state.buf_writers.clear();
     delete transaction;
 
@@ -432,6 +471,32 @@ void writeback_t::do_concurrent_flush() {
     }
 }
 
+void writeback_t::wait_for_flush_patience() {
+    /* Write-locking `flush_lock` queues every new write transaction behind the
+    flush until all of the write transactions in flight have committed.  If
+    we wait for a moment when none are in flight, the flush gets the lock right
+    away and nobody has to wait for it.
+
+    That's only worth it for flushes that are on a timer.  If someone is
+    waiting for the flush, or there are so many dirty blocks that it's a
+    threshold flush, or write transactions are already blocked on
+    `dirty_block_semaphore` waiting for it, waiting would only make things
+    worse. */
+    if (active_write_txns == 0 || !sync_callbacks.empty() || cache->shutting_down
+        || write_txns_throttled > 0 || num_dirty_blocks() > flush_threshold) {
+        return;
+    }
+
+    cond_t patience_over;
+    signal_timer_t patience_timeout(FLUSH_PATIENCE_MS);
+    wait_any_t waiter(&patience_over, &patience_timeout);
+
+    rassert(flush_patience_over == NULL);
+    flush_patience_over = &patience_over;
+    waiter.wait_lazily_unordered();
+    flush_patience_over = NULL;
+}
+
 void writeback_t::flush_acquire_bufs(mc_transaction_t *transaction, flush_state_t *state) {
     /* Request read locks on all of the blocks we need to flush. */
     // Log the size of this flush
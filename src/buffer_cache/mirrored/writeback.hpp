@@ -56,6 +56,12 @@ public:
         return dirty_bufs.size();
     }
 
+    // The number of dirty blocks that flushes have handed to the serializer
+    // and that haven't been written yet.
+    unsigned int num_blocks_being_written() const {
+        return blocks_being_written;
+    }
+
     class local_buf_t : public intrusive_list_node_t<local_buf_t> {
     public:
         local_buf_t();
@@ -90,6 +96,7 @@ public:
     const unsigned int max_dirty_blocks;
 
     bool has_active_flushes() { return active_flushes > 0; }
+    unsigned int num_active_flushes() const { return active_flushes; }
 
 private:
     flush_time_randomizer_t flush_time_randomizer;
@@ -109,6 +116,7 @@ private:
 
     bool writeback_in_progress;
     unsigned int active_flushes;
+    unsigned int blocks_being_written;
 
     /* Use `adjustable_semaphore_t` instead of `semaphore_t` so we can get `force_lock()`. */
     adjustable_semaphore_t dirty_block_semaphore;
@@ -131,6 +139,20 @@ private:
 
     rwi_lock_t flush_lock;
 
+    /* The number of write transactions holding `flush_lock`.  Before a flush
+    that nobody is waiting on takes `flush_lock`, it waits (for up to
+    `FLUSH_PATIENCE_MS`) for this to drop to zero, so that it doesn't stall new
+    write transactions behind the ones in flight.  `flush_patience_over` is
+    pulsed when that happens, when someone calls `sync()` with a callback, or
+    when the flush stops being one that can afford to wait: the dirty blocks
+    pass `flush_threshold`, or a write transaction has to wait on
+    `dirty_block_semaphore`. */
+    unsigned int active_write_txns;
+    cond_t *flush_patience_over;
+
+    /* The number of write transactions waiting on `dirty_block_semaphore`. */
+    unsigned int write_txns_throttled;
+
     // List of things waiting for their data to be written to disk. They will be called back after
     // the next complete writeback cycle completes.
     intrusive_list_t<sync_callback_t> sync_callbacks;
@@ -170,6 +192,7 @@ private:
     struct flush_state_t;
     void start_concurrent_flush();
     void do_concurrent_flush();
+    void wait_for_flush_patience();
     void flush_acquire_bufs(mc_transaction_t *transaction, flush_state_t *state);
 };
 
@@ -0,0 +1,149 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include "buffer_cache/prewarm.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "errors.hpp"
+#include <boost/bind.hpp>
+
+#include "arch/runtime/coroutines.hpp"
+#include "arch/runtime/thread_pool.hpp"
+#include "buffer_cache/buffer_cache.hpp"
+#include "containers/archive/stl_types.hpp"
+#include "containers/archive/vector_stream.hpp"
+#include "logger.hpp"
+
+// Bump this when the format of the hot list file changes; older files are ignored.
+static const int32_t CACHE_HOT_LIST_VERSION = 1;
+
+static void read_hot_list_blocking(const std::string &path, bool *found_out,
+                                   std::string *contents_out) {
+    *found_out = blocking_read_file(path.c_str(), contents_out);
+}
+
+static void write_hot_list_blocking(const serializer_filepath_t &path,
+                                    const std::vector<char> *contents,
+                                    std::string *error_out) {
+    // The list is written next to the old one and moved over it, so that a
+    // crash leaves one or the other behind.
+    const std::string temp_path = path.temporary_path();
+    int fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        *error_out = strprintf("Could not open `%s` for writing: %s",
+                               temp_path.c_str(), errno_string(errno).c_str());
+        return;
+    }
+    size_t written = 0;
+    while (written < contents->size()) {
+        ssize_t res = ::write(fd, contents->data() + written, contents->size() - written);
+        if (res == -1 && errno == EINTR) {
+            continue;
+        }
+        if (res == -1) {
+            *error_out = strprintf("Could not write to `%s`: %s",
+                                   temp_path.c_str(), errno_string(errno).c_str());
+            ::close(fd);
+            ::unlink(temp_path.c_str());
+            return;
+        }
+        written += res;
+    }
+    if (fsync(fd) != 0) {
+        *error_out = strprintf("Could not sync `%s`: %s",
+                               temp_path.c_str(), errno_string(errno).c_str());
+        ::close(fd);
+        ::unlink(temp_path.c_str());
+        return;
+    }
+    ::close(fd);
+    if (::rename(temp_path.c_str(), path.permanent_path().c_str()) != 0) {
+        *error_out = strprintf("Could not rename `%s` to `%s`: %s",
+                               temp_path.c_str(), path.permanent_path().c_str(),
+                               errno_string(errno).c_str());
+        ::unlink(temp_path.c_str());
+    }
+}
+
+cache_prewarmer_t::cache_prewarmer_t(cache_t *_cache, const serializer_filepath_t &_hot_list_path)
+    : cache(_cache), hot_list_path(_hot_list_path),
+      prewarm_in_progress(true), save_in_progress(false),
+      timer(CACHE_HOT_LIST_SAVE_INTERVAL_MS, this) {
+    coro_t::spawn_sometime(boost::bind(&cache_prewarmer_t::prewarm, this,
+                                       auto_drainer_t::lock_t(&drainer)));
+}
+
+cache_prewarmer_t::~cache_prewarmer_t() {
+    assert_thread();
+}
+
+void cache_prewarmer_t::on_ring() {
+    assert_thread();
+    if (!prewarm_in_progress && !save_in_progress) {
+        save_in_progress = true;
+        coro_t::spawn_sometime(boost::bind(&cache_prewarmer_t::save_hot_list, this,
+                                           auto_drainer_t::lock_t(&drainer)));
+    }
+}
+
+void cache_prewarmer_t::prewarm(auto_drainer_t::lock_t keepalive) {
+    assert_thread();
+    keepalive.assert_is_holding(&drainer);
+
+    bool found;
+    std::string contents;
+    thread_pool_t::run_in_blocker_pool(boost::bind(&read_hot_list_blocking,
+                                                   hot_list_path.permanent_path(),
+                                                   &found, &contents));
+
+    std::vector<block_id_t> block_ids;
+    if (found) {
+        std::vector<char> data(contents.begin(), contents.end());
+        vector_read_stream_t stream(&data);
+        int32_t version;
+        archive_result_t res = deserialize(&stream, &version);
+        if (res == ARCHIVE_SUCCESS && version == CACHE_HOT_LIST_VERSION) {
+            res = deserialize(&stream, &block_ids);
+        }
+        if (res != ARCHIVE_SUCCESS || version != CACHE_HOT_LIST_VERSION) {
+            logWRN("Ignoring the unreadable cache hot list `%s`.\n",
+                   hot_list_path.permanent_path().c_str());
+            block_ids.clear();
+        }
+    }
+
+    try {
+        cache->prewarm(block_ids, keepalive.get_drain_signal());
+    } catch (const interrupted_exc_t &) {
+        // We're shutting down.
+    }
+    prewarm_in_progress = false;
+}
+
+void cache_prewarmer_t::save_hot_list(auto_drainer_t::lock_t keepalive) {
+    assert_thread();
+    keepalive.assert_is_holding(&drainer);
+
+    std::vector<block_id_t> block_ids;
+    cache->get_hot_block_ids(&block_ids);
+
+    write_message_t msg;
+    msg << CACHE_HOT_LIST_VERSION;
+    msg << block_ids;
+    vector_stream_t stream;
+    int res = send_write_message(&stream, &msg);
+    guarantee(res == 0);
+
+    std::string error;
+    thread_pool_t::run_in_blocker_pool(boost::bind(&write_hot_list_blocking, hot_list_path,
+                                                   &stream.vector(), &error));
+    if (!error.empty()) {
+        logWRN("Could not save the cache hot list: %s\n", error.c_str());
+    }
+
+    save_in_progress = false;
+}
@@ -0,0 +1,40 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#ifndef BUFFER_CACHE_PREWARM_HPP_
+#define BUFFER_CACHE_PREWARM_HPP_
+
+#include "arch/timing.hpp"
+#include "buffer_cache/types.hpp"
+#include "concurrency/auto_drainer.hpp"
+#include "utils.hpp"
+
+/* Keeps a cache warm across restarts.  Every `CACHE_HOT_LIST_SAVE_INTERVAL_MS`
+it saves the ids of the blocks in the cache, hottest first, to a file of its
+own.  When it is created, it loads the blocks on the list that was saved last
+back into the cache (see `mc_cache_t::prewarm()`), in the background while the
+cache serves queries; destroying it stops that.  It lives on the cache's
+thread, and the cache must outlive it. */
+class cache_prewarmer_t : public home_thread_mixin_t, private repeating_timer_callback_t {
+public:
+    cache_prewarmer_t(cache_t *cache, const serializer_filepath_t &hot_list_path);
+    ~cache_prewarmer_t();
+
+private:
+    void on_ring();
+    void prewarm(auto_drainer_t::lock_t keepalive);
+    void save_hot_list(auto_drainer_t::lock_t keepalive);
+
+    cache_t *cache;
+    const serializer_filepath_t hot_list_path;
+
+    // We don't save the list until we're done loading the last one, which
+    // would otherwise be overwritten with whatever made it into the cache.
+    bool prewarm_in_progress;
+    bool save_in_progress;
+
+    auto_drainer_t drainer;
+    repeating_timer_t timer;
+
+    DISABLE_COPYING(cache_prewarmer_t);
+};
+
+#endif  // BUFFER_CACHE_PREWARM_HPP_
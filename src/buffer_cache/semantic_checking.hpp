@@ -26,6 +26,8 @@ make sure that the inner cache obeys the proper semantics. */
 template<class inner_cache_t> class scc_buf_lock_t;
 template<class inner_cache_t> class scc_transaction_t;
 template<class inner_cache_t> class scc_cache_t;
+class cache_balancer_t;
+struct mc_cache_introspection_t;
 
 typedef uint32_t crc_t;
 
@@ -101,6 +103,10 @@ public:
 
     void get_subtree_recencies(block_id_t *block_ids, size_t num_block_ids, repli_timestamp_t *recencies_out, get_subtree_recencies_callback_t *cb);
 
+    void prefetch_block(block_id_t block_id) {
+        inner_transaction.prefetch_block(block_id);
+    }
+
     scc_cache_t<inner_cache_t> *get_cache() const { return cache; }
     scc_cache_t<inner_cache_t> *cache;
 
@@ -110,6 +116,10 @@ public:
         inner_transaction.set_token_pair(token_pair); 
     }
 
+    void set_recency_timestamp(repli_timestamp_t recency_timestamp) {
+        inner_transaction.set_recency_timestamp(recency_timestamp);
+    }
+
 private:
     bool snapshotted; // Disables CRC checks
 
@@ -138,8 +148,16 @@ public:
 
     bool offer_read_ahead_buf(block_id_t block_id, void *buf, const counted_t<standard_block_token_t>& token, repli_timestamp_t recency_timestamp);
     bool contains_block(block_id_t block_id);
+    const void *peek_block_if_resident(block_id_t block_id);
     unsigned int num_blocks();
 
+    void register_with_balancer(cache_balancer_t *balancer);
+    void set_max_size(int64_t max_size);
+    void introspect(mc_cache_introspection_t *out);
+    void get_hot_block_ids(std::vector<block_id_t> *out);
+    void prewarm(const std::vector<block_id_t> &block_ids, signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t);
+
     coro_fifo_t& co_begin_coro_fifo() { return inner_cache.co_begin_coro_fifo(); }
 
 private:
@@ -194,6 +194,38 @@ bool scc_cache_t<inner_cache_t>::contains_block(block_id_t block_id) {
     return inner_cache.contains_block(block_id);
 }
 
+template<class inner_cache_t>
+const void *scc_cache_t<inner_cache_t>::peek_block_if_resident(block_id_t block_id) {
+    return inner_cache.peek_block_if_resident(block_id);
+}
+
+template<class inner_cache_t>
+void scc_cache_t<inner_cache_t>::register_with_balancer(cache_balancer_t *balancer) {
+    inner_cache.register_with_balancer(balancer);
+}
+
+template<class inner_cache_t>
+void scc_cache_t<inner_cache_t>::set_max_size(int64_t max_size) {
+    inner_cache.set_max_size(max_size);
+}
+
+template<class inner_cache_t>
+void scc_cache_t<inner_cache_t>::introspect(mc_cache_introspection_t *out) {
+    inner_cache.introspect(out);
+}
+
+template<class inner_cache_t>
+void scc_cache_t<inner_cache_t>::get_hot_block_ids(std::vector<block_id_t> *out) {
+    inner_cache.get_hot_block_ids(out);
+}
+
+template<class inner_cache_t>
+void scc_cache_t<inner_cache_t>::prewarm(const std::vector<block_id_t> &block_ids,
+                                         signal_t *interruptor)
+    THROWS_ONLY(interrupted_exc_t) {
+    inner_cache.prewarm(block_ids, interruptor);
+}
+
 template<class inner_cache_t>
 unsigned int scc_cache_t<inner_cache_t>::num_blocks() {
     return inner_cache.num_blocks();
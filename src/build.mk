@@ -264,7 +264,7 @@ RT_CXXFLAGS += -DMIGRATION_SCRIPT_LOCATION=\"$(scripts_dir)/rdb_migrate\"
 
 SOURCES := $(shell find $(SOURCE_DIR) -name '*.cc')
 
-SERVER_EXEC_SOURCES := $(filter-out $(SOURCE_DIR)/unittest/%,$(SOURCES))
+SERVER_EXEC_SOURCES := $(filter-out $(SOURCE_DIR)/unittest/% $(SOURCE_DIR)/microbench/%,$(SOURCES))
 
 QL2_PROTO_NAMES := rdb_protocol/ql2 rdb_protocol/ql2_extensions
 QL2_PROTO_SOURCES := $(foreach _,$(QL2_PROTO_NAMES),$(SOURCE_DIR)/$_.proto)
@@ -280,10 +280,14 @@ OBJS := $(QL2_PROTO_OBJS) $(patsubst %,$(OBJ_DIR)/%.o,$(NAMES))
 
 SERVER_EXEC_OBJS := $(QL2_PROTO_OBJS) $(patsubst $(SOURCE_DIR)/%.cc,$(OBJ_DIR)/%.o,$(SERVER_EXEC_SOURCES))
 
-SERVER_NOMAIN_OBJS := $(QL2_PROTO_OBJS) $(patsubst $(SOURCE_DIR)/%.cc,$(OBJ_DIR)/%.o,$(filter-out %/main.cc,$(SOURCES)))
+SERVER_NOMAIN_OBJS := $(QL2_PROTO_OBJS) $(patsubst $(SOURCE_DIR)/%.cc,$(OBJ_DIR)/%.o,$(filter-out %/main.cc $(SOURCE_DIR)/microbench/%,$(SOURCES)))
 
 SERVER_UNIT_TEST_OBJS := $(SERVER_NOMAIN_OBJS) $(OBJ_DIR)/unittest/main.o
 
+# The microbenchmarks don't use gtest, so they leave the unit tests out.
+SERVER_MICROBENCH_OBJS := $(filter-out $(OBJ_DIR)/unittest/%,$(SERVER_NOMAIN_OBJS)) \
+                          $(patsubst $(SOURCE_DIR)/%.cc,$(OBJ_DIR)/%.o,$(filter $(SOURCE_DIR)/microbench/%,$(SOURCES)))
+
 ##### Version number handling
 
 RT_CXXFLAGS += -DRETHINKDB_VERSION=\"$(RETHINKDB_VERSION)\"
@@ -308,6 +312,12 @@ unit: $(BUILD_DIR)/$(SERVER_UNIT_TEST_NAME)
 	$P RUN $(SERVER_UNIT_TEST_NAME)
 	$(BUILD_DIR)/$(SERVER_UNIT_TEST_NAME) --gtest_filter=$(UNIT_TEST_FILTER)
 
+.PHONY: microbench
+microbench: $(BUILD_DIR)/$(SERVER_MICROBENCH_NAME)
+	$P RUN $(SERVER_MICROBENCH_NAME)
+	$(BUILD_DIR)/$(SERVER_MICROBENCH_NAME) --filter '$(MICROBENCH_FILTER)' --output $(MICROBENCH_OUTPUT)
+	echo "Wrote microbenchmark results to $(MICROBENCH_OUTPUT)"
+
 .PRECIOUS: $(PROTO_DIR)/. $(QL2_PROTO_HEADERS) $(QL2_PROTO_SOURCES)
 
 $(PROTO_DIR)/%.pb.h $(PROTO_DIR)/%.pb.cc: $(SOURCE_DIR)/%.proto | $(PROTOC_DEP) $(PROTO_DIR)/.
@@ -345,6 +355,10 @@ $(BUILD_DIR)/$(SERVER_UNIT_TEST_NAME): $(SERVER_UNIT_TEST_OBJS) $(UNIT_STATIC_LI
 	$P LD $@
 	$(RT_CXX) $(SERVER_UNIT_TEST_OBJS) $(RT_LDFLAGS) $(UNIT_STATIC_LIBRARY_PATH) -o $@ $(LD_OUTPUT_FILTER)
 
+$(BUILD_DIR)/$(SERVER_MICROBENCH_NAME): $(SERVER_MICROBENCH_OBJS) | $(BUILD_DIR)/. $(TCMALLOC_DEP)
+	$P LD $@
+	$(RT_CXX) $(SERVER_MICROBENCH_OBJS) $(RT_LDFLAGS) -o $@ $(LD_OUTPUT_FILTER)
+
 $(BUILD_DIR)/$(GDB_FUNCTIONS_NAME):
 	$P CP $@
 	cp $(SCRIPTS_DIR)/$(GDB_FUNCTIONS_NAME) $@
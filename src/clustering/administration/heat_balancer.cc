@@ -0,0 +1,295 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include "clustering/administration/heat_balancer.hpp"
+
+#include <algorithm>
+
+#include "errors.hpp"
+#include <boost/bind.hpp>
+
+#include "arch/runtime/coroutines.hpp"
+#include "clustering/administration/cli/key_parsing.hpp"
+#include "clustering/administration/suggester.hpp"
+#include "config/args.hpp"
+#include "logger.hpp"
+
+// A shard needs at least this many samples before we trust where its load is.
+static const size_t HEAT_BALANCER_MIN_SPLIT_SAMPLES = 64;
+
+template <class protocol_t>
+void find_hot_shards(const namespaces_semilattice_metadata_t<protocol_t> &namespaces,
+                     const std::map<namespace_id_t, range_heat_samples_t> &heat,
+                     const machine_id_t &us,
+                     double interval_secs,
+                     const std::map<namespace_id_t, double> &other_primary_ops_per_sec,
+                     std::map<namespace_id_t, double> *primary_ops_per_sec_out,
+                     std::vector<hot_shard_t> *hot_shards_out) {
+    for (typename namespaces_semilattice_metadata_t<protocol_t>::namespace_map_t::const_iterator
+             it = namespaces.namespaces.begin(); it != namespaces.namespaces.end(); ++it) {
+        std::map<namespace_id_t, range_heat_samples_t>::const_iterator h = heat.find(it->first);
+        if (it->second.is_deleted() || h == heat.end() || h->second.samples.empty()) {
+            continue;
+        }
+        const namespace_semilattice_metadata_t<protocol_t> &ns = it->second.get_ref();
+        if (ns.shards.in_conflict() || ns.blueprint.in_conflict()) {
+            continue;
+        }
+        const nonoverlapping_regions_t<protocol_t> shards = ns.shards.get();
+
+        // Only the shard's primary speaks for it.
+        const persistable_blueprint_t<protocol_t> blueprint = ns.blueprint.get();
+        typename persistable_blueprint_t<protocol_t>::role_map_t::const_iterator roles
+            = blueprint.machines_roles.find(us);
+        if (roles == blueprint.machines_roles.end()) {
+            continue;
+        }
+
+        // Find the primary shard with the most samples.  The samples in the
+        // other shards are writes replicated to us, which their primaries
+        // count.
+        const std::vector<range_heat_sample_t> &samples = h->second.samples;
+        typename nonoverlapping_regions_t<protocol_t>::iterator hottest = shards.end();
+        size_t hottest_samples = 0;
+        size_t primary_samples = 0;
+        for (typename nonoverlapping_regions_t<protocol_t>::iterator s = shards.begin();
+             s != shards.end(); ++s) {
+            typename persistable_blueprint_t<protocol_t>::region_to_role_map_t::const_iterator role
+                = roles->second.find(*s);
+            if (role == roles->second.end() || role->second != blueprint_role_primary) {
+                continue;
+            }
+            size_t n = 0;
+            for (size_t i = 0; i < samples.size(); ++i) {
+                n += s->inner.contains_key(samples[i].key) ? 1 : 0;
+            }
+            primary_samples += n;
+            if (n > hottest_samples) {
+                hottest = s;
+                hottest_samples = n;
+            }
+        }
+        if (hottest == shards.end()) {
+            continue;
+        }
+
+        const double ops_per_sample = (h->second.reads + h->second.writes)
+            / static_cast<double>(samples.size()) / interval_secs;
+        const double our_ops_per_sec = primary_samples * ops_per_sample;
+        (*primary_ops_per_sec_out)[it->first] += our_ops_per_sec;
+        if (shards.size() >= HEAT_BALANCER_MAX_SHARDS) {
+            continue;
+        }
+
+        double table_ops_per_sec = our_ops_per_sec;
+        std::map<namespace_id_t, double>::const_iterator others
+            = other_primary_ops_per_sec.find(it->first);
+        if (others != other_primary_ops_per_sec.end()) {
+            table_ops_per_sec += others->second;
+        }
+
+        const double ops_per_sec = hottest_samples * ops_per_sample;
+        const double share = ops_per_sec / table_ops_per_sec;
+        const double even_share = 1.0 / shards.size();
+        if (ops_per_sec < HEAT_BALANCER_MIN_OPS_PER_SEC
+            || share < std::min(1.0, HEAT_BALANCER_IMBALANCE_FACTOR * even_share)) {
+            continue;
+        }
+
+        hot_shard_t hot;
+        if (!suggest_heat_split_point(samples, hottest->inner,
+                                      HEAT_BALANCER_MIN_SPLIT_SAMPLES, &hot.split_point)) {
+            continue;
+        }
+        hot.namespace_id = it->first;
+        hot.shard = hottest->inner;
+        hot.ops_per_sec = ops_per_sec;
+        hot.share = share;
+        hot_shards_out->push_back(hot);
+    }
+}
+
+template void find_hot_shards<memcached_protocol_t>(
+        const namespaces_semilattice_metadata_t<memcached_protocol_t> &namespaces,
+        const std::map<namespace_id_t, range_heat_samples_t> &heat,
+        const machine_id_t &us,
+        double interval_secs,
+        const std::map<namespace_id_t, double> &other_primary_ops_per_sec,
+        std::map<namespace_id_t, double> *primary_ops_per_sec_out,
+        std::vector<hot_shard_t> *hot_shards_out);
+template void find_hot_shards<rdb_protocol_t>(
+        const namespaces_semilattice_metadata_t<rdb_protocol_t> &namespaces,
+        const std::map<namespace_id_t, range_heat_samples_t> &heat,
+        const machine_id_t &us,
+        double interval_secs,
+        const std::map<namespace_id_t, double> &other_primary_ops_per_sec,
+        std::map<namespace_id_t, double> *primary_ops_per_sec_out,
+        std::vector<hot_shard_t> *hot_shards_out);
+
+heat_balancer_t::heat_balancer_t(range_heat_registry_t *_registry,
+                                 const boost::shared_ptr<semilattice_readwrite_view_t<cluster_semilattice_metadata_t> > &_semilattice_view,
+                                 const clone_ptr_t<watchable_t<std::map<peer_id_t, cluster_directory_metadata_t> > > &_directory_view,
+                                 const machine_id_t &_us,
+                                 bool _auto_split)
+    : registry(_registry),
+      semilattice_view(_semilattice_view),
+      directory_view(_directory_view),
+      us(_us),
+      auto_split(_auto_split),
+      primary_ops_per_sec(std::map<namespace_id_t, double>()),
+      balance_in_progress(false),
+      timer(HEAT_BALANCER_INTERVAL_MS, this) { }
+
+heat_balancer_t::~heat_balancer_t() {
+    assert_thread();
+}
+
+clone_ptr_t<watchable_t<std::map<namespace_id_t, double> > > heat_balancer_t::get_primary_ops_per_sec_watchable() {
+    assert_thread();
+    return primary_ops_per_sec.get_watchable();
+}
+
+void heat_balancer_t::on_ring() {
+    assert_thread();
+    if (!balance_in_progress) {
+        balance_in_progress = true;
+        coro_t::spawn_sometime(boost::bind(&heat_balancer_t::balance, this,
+                                           auto_drainer_t::lock_t(&drainer)));
+    }
+}
+
+void heat_balancer_t::balance(auto_drainer_t::lock_t keepalive) {
+    assert_thread();
+    keepalive.assert_is_holding(&drainer);
+
+    std::map<namespace_id_t, range_heat_samples_t> heat;
+    registry->collect(&heat);
+
+    for (std::map<namespace_id_t, int>::iterator it = cooldowns.begin(); it != cooldowns.end();) {
+        if (--it->second <= 0) {
+            cooldowns.erase(it++);
+        } else {
+            ++it;
+        }
+    }
+
+    const double interval_secs = HEAT_BALANCER_INTERVAL_MS / 1000.0;
+    cluster_semilattice_metadata_t metadata = semilattice_view->get();
+    std::map<namespace_id_t, double> other_ops_per_sec, our_ops_per_sec;
+    get_other_primary_ops_per_sec(&other_ops_per_sec);
+    std::vector<hot_shard_t> memcached_hot_shards, rdb_hot_shards;
+    find_hot_shards(*metadata.memcached_namespaces, heat, us, interval_secs,
+                    other_ops_per_sec, &our_ops_per_sec, &memcached_hot_shards);
+    find_hot_shards(*metadata.rdb_namespaces, heat, us, interval_secs,
+                    other_ops_per_sec, &our_ops_per_sec, &rdb_hot_shards);
+    primary_ops_per_sec.set_value(our_ops_per_sec);
+    apply_cooldowns(&memcached_hot_shards);
+    apply_cooldowns(&rdb_hot_shards);
+
+    if (auto_split && (!memcached_hot_shards.empty() || !rdb_hot_shards.empty())) {
+        bool changed = false;
+        if (!memcached_hot_shards.empty()) {
+            cow_ptr_t<namespaces_semilattice_metadata_t<memcached_protocol_t> >::change_t
+                change(&metadata.memcached_namespaces);
+            changed = split_hot_shards(memcached_hot_shards, change.get()) || changed;
+        }
+        if (!rdb_hot_shards.empty()) {
+            cow_ptr_t<namespaces_semilattice_metadata_t<rdb_protocol_t> >::change_t
+                change(&metadata.rdb_namespaces);
+            changed = split_hot_shards(rdb_hot_shards, change.get()) || changed;
+        }
+
+        if (changed) {
+            try {
+                // Prefer distribution, so that the new shards' primaries end up
+                // on different machines.
+                fill_in_blueprints(&metadata, directory_view->get(), us, true);
+                semilattice_view->join(metadata);
+            } catch (const missing_machine_exc_t &e) {
+                logWRN("Not splitting hot shards: %s", e.what());
+            }
+        }
+    }
+
+    balance_in_progress = false;
+}
+
+void heat_balancer_t::get_other_primary_ops_per_sec(std::map<namespace_id_t, double> *out) {
+    std::map<peer_id_t, cluster_directory_metadata_t> directory = directory_view->get();
+    for (std::map<peer_id_t, cluster_directory_metadata_t>::const_iterator it = directory.begin();
+         it != directory.end(); ++it) {
+        if (it->second.machine_id == us) {
+            continue;
+        }
+        for (std::map<namespace_id_t, double>::const_iterator jt = it->second.primary_ops_per_sec.begin();
+             jt != it->second.primary_ops_per_sec.end(); ++jt) {
+            (*out)[jt->first] += jt->second;
+        }
+    }
+}
+
+void heat_balancer_t::apply_cooldowns(std::vector<hot_shard_t> *hot_shards) {
+    std::vector<hot_shard_t> kept;
+    for (std::vector<hot_shard_t>::iterator it = hot_shards->begin(); it != hot_shards->end(); ++it) {
+        if (cooldowns.find(it->namespace_id) != cooldowns.end()) {
+            continue;
+        }
+        cooldowns[it->namespace_id] = HEAT_BALANCER_COOLDOWN_INTERVALS;
+        logINF("Shard %s of table %s is hot (%.0f operations per second, %.0f%% of the "
+               "table's load).  %s at %s, which splits its load evenly.",
+               key_range_to_cli_str(it->shard).c_str(),
+               uuid_to_str(it->namespace_id).c_str(),
+               it->ops_per_sec, it->share * 100,
+               auto_split ? "Splitting it" : "Consider splitting it",
+               key_to_cli_str(it->split_point).c_str());
+        kept.push_back(*it);
+    }
+    hot_shards->swap(kept);
+}
+
+template <class protocol_t>
+bool heat_balancer_t::split_hot_shards(const std::vector<hot_shard_t> &hot_shards,
+                                       namespaces_semilattice_metadata_t<protocol_t> *namespaces) {
+    bool changed = false;
+    for (std::vector<hot_shard_t>::const_iterator it = hot_shards.begin(); it != hot_shards.end(); ++it) {
+        typename namespaces_semilattice_metadata_t<protocol_t>::namespace_map_t::iterator ns_it
+            = namespaces->namespaces.find(it->namespace_id);
+        if (ns_it == namespaces->namespaces.end() || ns_it->second.is_deleted()) {
+            continue;
+        }
+        namespace_semilattice_metadata_t<protocol_t> *ns = ns_it->second.get_mutable();
+        if (ns->shards.in_conflict()) {
+            continue;
+        }
+
+        nonoverlapping_regions_t<protocol_t> &shards = ns->shards.get_mutable();
+        const typename protocol_t::region_t old_shard(it->shard);
+        typename nonoverlapping_regions_t<protocol_t>::iterator shard = shards.begin();
+        while (shard != shards.end() && !(*shard == old_shard)) {
+            ++shard;
+        }
+        if (shard == shards.end()) {
+            // The shards changed under us.
+            continue;
+        }
+
+        key_range_t left = it->shard;
+        left.right = key_range_t::right_bound_t(it->split_point);
+        key_range_t right = it->shard;
+        right.left = it->split_point;
+
+        shards.remove_region(shard);
+        bool add_success = shards.add_region(typename protocol_t::region_t(left));
+        guarantee(add_success);
+        add_success = shards.add_region(typename protocol_t::region_t(right));
+        guarantee(add_success);
+        ns->shards.upgrade_version(us);
+
+        // As in the admin CLI, changing the shards clears the pinnings.
+        region_map_t<protocol_t, machine_id_t> new_primaries(protocol_t::region_t::universe(), nil_uuid());
+        region_map_t<protocol_t, std::set<machine_id_t> > new_secondaries(protocol_t::region_t::universe(), std::set<machine_id_t>());
+        ns->primary_pinnings = ns->primary_pinnings.make_resolving_version(new_primaries, us);
+        ns->secondary_pinnings = ns->secondary_pinnings.make_resolving_version(new_secondaries, us);
+
+        changed = true;
+    }
+    return changed;
+}
@@ -0,0 +1,105 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#ifndef CLUSTERING_ADMINISTRATION_HEAT_BALANCER_HPP_
+#define CLUSTERING_ADMINISTRATION_HEAT_BALANCER_HPP_
+
+#include <map>
+#include <vector>
+
+#include "arch/timing.hpp"
+#include "btree/range_heat.hpp"
+#include "clustering/administration/metadata.hpp"
+#include "concurrency/auto_drainer.hpp"
+#include "concurrency/watchable.hpp"
+#include "containers/clone_ptr.hpp"
+#include "rpc/semilattice/view.hpp"
+
+/* A shard that gets more than its share of a table's load, and where to split
+it. */
+struct hot_shard_t {
+    namespace_id_t namespace_id;
+    key_range_t shard;
+    store_key_t split_point;
+    double ops_per_sec;
+    // The shard's part of the table's load across the cluster.
+    double share;
+};
+
+/* Finds the hot shards of the tables of one protocol that this machine is the
+primary of, given what the stores on this machine saw over the last
+`interval_secs` and how many operations per second the other machines' primary
+shards of each table got.  Also adds how many operations per second our own
+primary shards of each table got to `primary_ops_per_sec_out`.  Exposed for the
+unit tests. */
+template <class protocol_t>
+void find_hot_shards(const namespaces_semilattice_metadata_t<protocol_t> &namespaces,
+                     const std::map<namespace_id_t, range_heat_samples_t> &heat,
+                     const machine_id_t &us,
+                     double interval_secs,
+                     const std::map<namespace_id_t, double> &other_primary_ops_per_sec,
+                     std::map<namespace_id_t, double> *primary_ops_per_sec_out,
+                     std::vector<hot_shard_t> *hot_shards_out);
+
+/* Every `HEAT_BALANCER_INTERVAL_MS`, the heat balancer collects the range heat
+sketches of the stores on this machine and looks for shards that are hot: shards
+that get a lot of operations, and much more than an even share of their table's
+load.  Reads go to the primary, so the primary of a shard sees its whole load,
+and only the primary speaks for the shard.  A machine's stores also see the
+writes replicated to the shards it is a secondary of, so only the samples that
+land in its primary shards are counted.  Each machine publishes the load on its
+primary shards of each table in the directory, and a shard is judged against
+the sum of those over all the machines.
+
+For each hot shard it picks the key that divides the shard's sampled load in
+two.  By default it only logs the split point.  With `auto_split` it splits the
+shard in the cluster metadata, the way `split shard` in the admin CLI does, and
+lets the suggester lay out the new blueprint; the reactors then move primaries
+and backfill the new shards as for any other blueprint change.  A table isn't
+touched again for a few intervals after a split, so that its backfills can
+finish before its load is judged again. */
+class heat_balancer_t : public home_thread_mixin_t, private repeating_timer_callback_t {
+public:
+    heat_balancer_t(range_heat_registry_t *registry,
+                    const boost::shared_ptr<semilattice_readwrite_view_t<cluster_semilattice_metadata_t> > &semilattice_view,
+                    const clone_ptr_t<watchable_t<std::map<peer_id_t, cluster_directory_metadata_t> > > &directory_view,
+                    const machine_id_t &us,
+                    bool auto_split);
+    ~heat_balancer_t();
+
+    // The load on the shards we are the primary of, by table, for the directory.
+    clone_ptr_t<watchable_t<std::map<namespace_id_t, double> > > get_primary_ops_per_sec_watchable();
+
+private:
+    void on_ring();
+    void balance(auto_drainer_t::lock_t keepalive);
+
+    template <class protocol_t>
+    bool split_hot_shards(const std::vector<hot_shard_t> &hot_shards,
+                          namespaces_semilattice_metadata_t<protocol_t> *namespaces);
+
+    // Drops hot shards of tables that were looked at recently, and starts the
+    // cooldown of the others.
+    void apply_cooldowns(std::vector<hot_shard_t> *hot_shards);
+
+    // Sums up the load the other machines' primary shards of each table got.
+    void get_other_primary_ops_per_sec(std::map<namespace_id_t, double> *out);
+
+    range_heat_registry_t *const registry;
+    const boost::shared_ptr<semilattice_readwrite_view_t<cluster_semilattice_metadata_t> > semilattice_view;
+    const clone_ptr_t<watchable_t<std::map<peer_id_t, cluster_directory_metadata_t> > > directory_view;
+    const machine_id_t us;
+    const bool auto_split;
+
+    // How many more intervals each table is left alone for.
+    std::map<namespace_id_t, int> cooldowns;
+
+    watchable_variable_t<std::map<namespace_id_t, double> > primary_ops_per_sec;
+
+    bool balance_in_progress;
+
+    auto_drainer_t drainer;
+    repeating_timer_t timer;
+
+    DISABLE_COPYING(heat_balancer_t);
+};
+
+#endif  // CLUSTERING_ADMINISTRATION_HEAT_BALANCER_HPP_
@@ -10,6 +10,8 @@
 #include "clustering/administration/http/progress_app.hpp"
 #include "clustering/administration/http/semilattice_app.hpp"
 #include "clustering/administration/http/stat_app.hpp"
+#include "clustering/administration/http/stat_history_app.hpp"
+#include "clustering/administration/http/store_introspection_app.hpp"
 #include "clustering/administration/http/combining_app.hpp"
 #include "http/file_app.hpp"
 #include "http/http.hpp"
@@ -43,6 +45,8 @@ administrative_http_server_manager_t::administrative_http_server_manager_t(
         namespace_repo_t<memcached_protocol_t> *_namespace_repo,
         namespace_repo_t<rdb_protocol_t> *_rdb_namespace_repo,
         admin_tracker_t *_admin_tracker,
+        stat_history_t *_stat_history,
+        range_heat_registry_t *_heat_registry,
         http_app_t *reql_app,
         uuid_u _us,
         std::string path)
@@ -225,6 +229,12 @@ administrative_http_server_manager_t::administrative_http_server_manager_t(
     directory_app.init(new directory_http_app_t(_directory_metadata));
     issues_app.init(new issues_http_app_t(&_admin_tracker->issue_aggregator));
     stat_app.init(new stat_http_app_t(mbox_manager, _directory_metadata, _semilattice_metadata));
+    if (_stat_history != NULL) {
+        stat_history_app.init(new stat_history_http_app_t(_stat_history));
+    }
+    if (_heat_registry != NULL) {
+        store_introspection_app.init(new store_introspection_http_app_t(_heat_registry));
+    }
     last_seen_app.init(new last_seen_http_app_t(&_admin_tracker->last_seen_tracker));
     log_app.init(new log_http_app_t(mbox_manager,
         _directory_metadata->subview(&get_log_mailbox),
@@ -241,6 +251,12 @@ administrative_http_server_manager_t::administrative_http_server_manager_t(
     ajax_routes["directory"] = directory_app.get();
     ajax_routes["issues"] = issues_app.get();
     ajax_routes["stat"] = stat_app.get();
+    if (stat_history_app.has()) {
+        ajax_routes["stat_history"] = stat_history_app.get();
+    }
+    if (store_introspection_app.has()) {
+        ajax_routes["store_introspection"] = store_introspection_app.get();
+    }
     ajax_routes["last_seen"] = last_seen_app.get();
     ajax_routes["log"] = log_app.get();
     ajax_routes["progress"] = progress_app.get();
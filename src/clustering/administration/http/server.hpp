@@ -22,6 +22,10 @@ class auth_semilattice_http_app_t;
 class directory_http_app_t;
 class issues_http_app_t;
 class stat_http_app_t;
+class stat_history_http_app_t;
+class stat_history_t;
+class store_introspection_http_app_t;
+class range_heat_registry_t;
 class last_seen_http_app_t;
 class log_http_app_t;
 class progress_app_t;
@@ -44,6 +48,8 @@ public:
         namespace_repo_t<memcached_protocol_t> *_namespace_repo,
         namespace_repo_t<rdb_protocol_t> *_rdb_namespace_repo,
         admin_tracker_t *_admin_tracker,
+        stat_history_t *_stat_history,  // NULL if the stat history is off
+        range_heat_registry_t *_heat_registry,  // NULL if we're a proxy
         http_app_t *reql_app,
         uuid_u _us,
         std::string _path);
@@ -58,6 +64,8 @@ private:
     scoped_ptr_t<directory_http_app_t> directory_app;
     scoped_ptr_t<issues_http_app_t> issues_app;
     scoped_ptr_t<stat_http_app_t> stat_app;
+    scoped_ptr_t<stat_history_http_app_t> stat_history_app;
+    scoped_ptr_t<store_introspection_http_app_t> store_introspection_app;
     scoped_ptr_t<last_seen_http_app_t> last_seen_app;
     scoped_ptr_t<log_http_app_t> log_app;
     scoped_ptr_t<progress_app_t> progress_app;
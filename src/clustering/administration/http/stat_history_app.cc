@@ -0,0 +1,34 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include "clustering/administration/http/stat_history_app.hpp"
+
+#include "clustering/administration/stat_history.hpp"
+#include "http/json.hpp"
+
+stat_history_http_app_t::stat_history_http_app_t(stat_history_t *_history)
+    : history(_history) { }
+
+http_res_t stat_history_http_app_t::handle(const http_req_t &req) {
+    if (req.method != GET) {
+        return http_res_t(HTTP_METHOD_NOT_ALLOWED);
+    }
+
+    uint64_t since = 0;
+    for (std::vector<query_parameter_t>::const_iterator it = req.query_params.begin();
+         it != req.query_params.end(); ++it) {
+        if (it->key == "since") {
+            if (!strtou64_strict(it->val, 10, &since)) {
+                return http_error_res("Invalid since value: " + it->val);
+            }
+        } else {
+            return http_error_res("Invalid parameter: " + it->key + "=" + it->val);
+        }
+    }
+
+    scoped_cJSON_t body(NULL);
+    {
+        on_thread_t thread_switcher(history->home_thread());
+        body.reset(history->render_json(since));
+    }
+    body.AddItemToObject("interval_ms", cJSON_CreateNumber(history->get_interval_ms()));
+    return http_json_res(body.get());
+}
@@ -0,0 +1,23 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#ifndef CLUSTERING_ADMINISTRATION_HTTP_STAT_HISTORY_APP_HPP_
+#define CLUSTERING_ADMINISTRATION_HTTP_STAT_HISTORY_APP_HPP_
+
+#include "http/http.hpp"
+
+class stat_history_t;
+
+/* Serves this machine's stat history.  `GET ?since=<n>` returns the samples
+numbered `n` and after (all of them without `since`); see
+`stat_history_ring_t::render_json` for the format. */
+class stat_history_http_app_t : public http_app_t {
+public:
+    explicit stat_history_http_app_t(stat_history_t *_history);
+    http_res_t handle(const http_req_t &req);
+
+private:
+    stat_history_t *history;
+
+    DISABLE_COPYING(stat_history_http_app_t);
+};
+
+#endif /* CLUSTERING_ADMINISTRATION_HTTP_STAT_HISTORY_APP_HPP_ */
@@ -0,0 +1,103 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include "clustering/administration/http/store_introspection_app.hpp"
+
+#include <map>
+#include <vector>
+
+#include "arch/runtime/runtime.hpp"
+#include "btree/introspection.hpp"
+#include "btree/range_heat.hpp"
+#include "http/json.hpp"
+
+cJSON *render_key_range(const key_range_t &range) {
+    cJSON *res = cJSON_CreateObject();
+    cJSON_AddItemToObject(res, "left", cJSON_CreateString(key_to_debug_str(range.left).c_str()));
+    cJSON_AddItemToObject(res, "right", range.right.unbounded ? cJSON_CreateNull() :
+                          cJSON_CreateString(key_to_debug_str(range.right.key).c_str()));
+    return res;
+}
+
+cJSON *render_int64_vector(const std::vector<int64_t> &v) {
+    cJSON *res = cJSON_CreateArray();
+    for (size_t i = 0; i < v.size(); ++i) {
+        cJSON_AddItemToArray(res, cJSON_CreateNumber(v[i]));
+    }
+    return res;
+}
+
+cJSON *render_cache_introspection(const mc_cache_introspection_t &cache) {
+    cJSON *res = cJSON_CreateObject();
+    cJSON_AddItemToObject(res, "block_size", cJSON_CreateNumber(cache.block_size));
+    cJSON_AddItemToObject(res, "max_size", cJSON_CreateNumber(cache.max_size));
+    cJSON_AddItemToObject(res, "blocks_in_memory", cJSON_CreateNumber(cache.blocks_in_memory));
+    cJSON_AddItemToObject(res, "blocks_dirty", cJSON_CreateNumber(cache.blocks_dirty));
+    cJSON_AddItemToObject(res, "blocks_being_read", cJSON_CreateNumber(cache.blocks_being_read));
+    cJSON_AddItemToObject(res, "blocks_being_prefetched", cJSON_CreateNumber(cache.blocks_being_prefetched));
+    cJSON_AddItemToObject(res, "blocks_being_written", cJSON_CreateNumber(cache.blocks_being_written));
+    cJSON_AddItemToObject(res, "active_flushes", cJSON_CreateNumber(cache.active_flushes));
+    cJSON_AddItemToObject(res, "snapshots", cJSON_CreateNumber(cache.snapshots));
+    cJSON_AddItemToObject(res, "snapshotted_blocks", cJSON_CreateNumber(cache.snapshotted_blocks));
+    return res;
+}
+
+cJSON *render_btree_introspection(const btree_introspection_t &btree) {
+    cJSON *res = cJSON_CreateObject();
+    cJSON_AddItemToObject(res, "complete", cJSON_CreateBool(btree.complete));
+    cJSON_AddItemToObject(res, "blocks_seen_by_level", render_int64_vector(btree.blocks_seen_by_level));
+    cJSON_AddItemToObject(res, "blocks_resident_by_level", render_int64_vector(btree.blocks_resident_by_level));
+
+    cJSON *ranges = cJSON_CreateArray();
+    for (std::vector<btree_range_introspection_t>::const_iterator it = btree.ranges.begin();
+         it != btree.ranges.end(); ++it) {
+        cJSON *range = render_key_range(it->range);
+        cJSON_AddItemToObject(range, "blocks_seen", cJSON_CreateNumber(it->blocks_seen));
+        cJSON_AddItemToObject(range, "blocks_resident", cJSON_CreateNumber(it->blocks_resident));
+        cJSON_AddItemToObject(range, "resident_fraction", it->blocks_seen == 0 ? cJSON_CreateNull() :
+                              cJSON_CreateNumber(static_cast<double>(it->blocks_resident) / it->blocks_seen));
+        cJSON_AddItemToObject(range, "sampled_reads", cJSON_CreateNumber(it->sampled_reads));
+        cJSON_AddItemToObject(range, "sampled_writes", cJSON_CreateNumber(it->sampled_writes));
+        cJSON_AddItemToArray(ranges, range);
+    }
+    cJSON_AddItemToObject(res, "ranges", ranges);
+    return res;
+}
+
+cJSON *render_store_introspection(const store_introspection_t &store) {
+    cJSON *res = cJSON_CreateObject();
+    cJSON_AddItemToObject(res, "range", render_key_range(store.range));
+    cJSON_AddItemToObject(res, "reads", cJSON_CreateNumber(store.reads));
+    cJSON_AddItemToObject(res, "writes", cJSON_CreateNumber(store.writes));
+    cJSON_AddItemToObject(res, "cache", render_cache_introspection(store.cache));
+    cJSON_AddItemToObject(res, "btree", render_btree_introspection(store.btree));
+    return res;
+}
+
+store_introspection_http_app_t::store_introspection_http_app_t(range_heat_registry_t *_registry)
+    : registry(_registry) { }
+
+http_res_t store_introspection_http_app_t::handle(const http_req_t &req) {
+    if (req.method != GET) {
+        return http_res_t(HTTP_METHOD_NOT_ALLOWED);
+    }
+    if (!req.query_params.empty()) {
+        return http_error_res("Invalid parameter: " + req.query_params.front().key);
+    }
+
+    std::map<uuid_u, std::vector<store_introspection_t> > stores;
+    {
+        on_thread_t thread_switcher(registry->home_thread());
+        registry->introspect(&stores);
+    }
+
+    scoped_cJSON_t body(cJSON_CreateObject());
+    for (std::map<uuid_u, std::vector<store_introspection_t> >::const_iterator it = stores.begin();
+         it != stores.end(); ++it) {
+        cJSON *table = cJSON_CreateArray();
+        for (std::vector<store_introspection_t>::const_iterator jt = it->second.begin();
+             jt != it->second.end(); ++jt) {
+            cJSON_AddItemToArray(table, render_store_introspection(*jt));
+        }
+        body.AddItemToObject(uuid_to_str(it->first).c_str(), table);
+    }
+    return http_json_res(body.get());
+}
@@ -0,0 +1,23 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#ifndef CLUSTERING_ADMINISTRATION_HTTP_STORE_INTROSPECTION_APP_HPP_
+#define CLUSTERING_ADMINISTRATION_HTTP_STORE_INTROSPECTION_APP_HPP_
+
+#include "http/http.hpp"
+
+class range_heat_registry_t;
+
+/* Serves what each of this machine's stores has in memory, and where its load
+lands (see btree/introspection.hpp).  `GET` returns an object with an array of
+stores for each table uuid. */
+class store_introspection_http_app_t : public http_app_t {
+public:
+    explicit store_introspection_http_app_t(range_heat_registry_t *_registry);
+    http_res_t handle(const http_req_t &req);
+
+private:
+    range_heat_registry_t *registry;
+
+    DISABLE_COPYING(store_introspection_http_app_t);
+};
+
+#endif /* CLUSTERING_ADMINISTRATION_HTTP_STORE_INTROSPECTION_APP_HPP_ */
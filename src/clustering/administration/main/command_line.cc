@@ -13,6 +13,7 @@
 
 #include "errors.hpp"
 #include <boost/bind.hpp>
+#include <boost/tokenizer.hpp>
 
 #include "arch/io/disk.hpp"
 #include "arch/os_signal.hpp"
@@ -308,17 +309,23 @@ public:
                  const std::vector<host_and_port_t> &_joins,
                  service_address_ports_t _ports,
                  std::string _web_assets,
+                 const stat_history_options_t &_stat_history_options,
+                 bool _auto_split_hot_shards,
                  boost::optional<std::string> _config_file):
         spawner_info(_spawner_info),
         joins(&_joins),
         ports(_ports),
         web_assets(_web_assets),
+        stat_history_options(_stat_history_options),
+        auto_split_hot_shards(_auto_split_hot_shards),
         config_file(_config_file) { }
 
     extproc::spawner_info_t *spawner_info;
     const std::vector<host_and_port_t> *joins;
     service_address_ports_t ports;
     std::string web_assets;
+    stat_history_options_t stat_history_options;
+    bool auto_split_hot_shards;
     boost::optional<std::string> config_file;
 };
 
@@ -634,6 +641,7 @@ std::string uname_msr() {
 void run_rethinkdb_serve(const base_path_t &base_path,
                          const serve_info_t& serve_info,
                          const int max_concurrent_io_requests,
+                         const int64_t total_cache_size,
                          const machine_id_t *our_machine_id,
                          const cluster_semilattice_metadata_t *cluster_metadata,
                          bool *const result_out) {
@@ -648,6 +656,7 @@ void run_rethinkdb_serve(const base_path_t &base_path,
     }
 
     logINF("Loading data from directory %s\n", base_path.path().c_str());
+    logINF("Using %" PRIi64 " MB of memory for the tables' caches\n", static_cast<int64_t>(total_cache_size / MEGABYTE));
 
     io_backender_t io_backender(max_concurrent_io_requests);
 
@@ -686,11 +695,14 @@ void run_rethinkdb_serve(const base_path_t &base_path,
         *result_out = serve(serve_info.spawner_info,
                             &io_backender,
                             base_path,
+                            total_cache_size,
                             cluster_metadata_file.get(),
                             auth_metadata_file.get(),
                             look_up_peers_addresses(*serve_info.joins),
                             serve_info.ports,
                             serve_info.web_assets,
+                            serve_info.stat_history_options,
+                            serve_info.auto_split_hot_shards,
                             &sigint_cond,
                             serve_info.config_file);
 
@@ -706,11 +718,13 @@ void run_rethinkdb_serve(const base_path_t &base_path,
 void run_rethinkdb_porcelain(const base_path_t &base_path,
                              const name_string_t &machine_name,
                              const int max_concurrent_io_requests,
+                             const int64_t total_cache_size,
                              const bool new_directory,
                              const serve_info_t &serve_info,
                              bool *const result_out) {
     if (!new_directory) {
         run_rethinkdb_serve(base_path, serve_info, max_concurrent_io_requests,
+                            total_cache_size,
                             NULL, NULL,
                             result_out);
     } else {
@@ -744,6 +758,7 @@ void run_rethinkdb_porcelain(const base_path_t &base_path,
 
         run_rethinkdb_serve(base_path, serve_info,
                             max_concurrent_io_requests,
+                            total_cache_size,
                             &our_machine_id, &cluster_metadata, result_out);
     }
 }
@@ -757,6 +772,7 @@ void run_rethinkdb_proxy(const serve_info_t &serve_info, bool *const result_out)
                                   look_up_peers_addresses(*serve_info.joins),
                                   serve_info.ports,
                                   serve_info.web_assets,
+                                  serve_info.stat_history_options,
                                   &sigint_cond,
                                   serve_info.config_file);
     } catch (const host_lookup_exc_t &ex) {
@@ -799,6 +815,47 @@ options::help_section_t get_file_options(std::vector<options::option_t> *options
     return help;
 }
 
+options::help_section_t get_cache_options(std::vector<options::option_t> *options_out) {
+    options::help_section_t help("Cache options");
+    options_out->push_back(options::option_t(options::names_t("--cache-size"),
+                                             options::OPTIONAL));
+    help.add("--cache-size mb",
+             "total memory (in megabytes) for the caches of all the tables on this"
+             " machine, defaults to half of the physical memory");
+    return help;
+}
+
+options::help_section_t get_stat_history_options(std::vector<options::option_t> *options_out) {
+    options::help_section_t help("Stat history options");
+    options_out->push_back(options::option_t(options::names_t("--stats-interval"),
+                                             options::OPTIONAL,
+                                             strprintf("%d", DEFAULT_STAT_HISTORY_INTERVAL_MS)));
+    help.add("--stats-interval ms",
+             "how often to sample the stats into this machine's stat history, 0 turns"
+             " the history off");
+    options_out->push_back(options::option_t(options::names_t("--stats-history"),
+                                             options::OPTIONAL,
+                                             strprintf("%d", DEFAULT_STAT_HISTORY_SAMPLES)));
+    help.add("--stats-history n", "how many samples of the stats to keep");
+    options_out->push_back(options::option_t(options::names_t("--stats-filter"),
+                                             options::OPTIONAL));
+    help.add("--stats-filter paths",
+             "comma-separated paths of the stats to sample (as in the stat page's"
+             " filter), defaults to all of them");
+    return help;
+}
+
+options::help_section_t get_sharding_options(std::vector<options::option_t> *options_out) {
+    options::help_section_t help("Sharding options");
+    options_out->push_back(options::option_t(options::names_t("--auto-split-hot-shards"),
+                                             options::OPTIONAL_NO_PARAMETER));
+    help.add("--auto-split-hot-shards",
+             "split shards that this machine is the primary of when they get much more"
+             " than their share of their table's load, instead of only logging where"
+             " to split them");
+    return help;
+}
+
 options::help_section_t get_config_file_options(std::vector<options::option_t> *options_out) {
     options::help_section_t help("Configuration file options");
     options_out->push_back(options::option_t(options::names_t("--config-file"),
@@ -950,8 +1007,11 @@ void get_rethinkdb_create_options(std::vector<options::help_section_t> *help_out
 void get_rethinkdb_serve_options(std::vector<options::help_section_t> *help_out,
                                  std::vector<options::option_t> *options_out) {
     help_out->push_back(get_file_options(options_out));
+    help_out->push_back(get_cache_options(options_out));
     help_out->push_back(get_network_options(false, options_out));
     help_out->push_back(get_web_options(options_out));
+    help_out->push_back(get_stat_history_options(options_out));
+    help_out->push_back(get_sharding_options(options_out));
     help_out->push_back(get_cpu_options(options_out));
     help_out->push_back(get_service_options(options_out));
     help_out->push_back(get_setuser_options(options_out));
@@ -964,6 +1024,7 @@ void get_rethinkdb_proxy_options(std::vector<options::help_section_t> *help_out,
                                  std::vector<options::option_t> *options_out) {
     help_out->push_back(get_network_options(true, options_out));
     help_out->push_back(get_web_options(options_out));
+    help_out->push_back(get_stat_history_options(options_out));
     help_out->push_back(get_service_options(options_out));
     help_out->push_back(get_setuser_options(options_out));
     help_out->push_back(get_help_options(options_out));
@@ -1038,9 +1099,12 @@ void get_rethinkdb_import_options(std::vector<options::help_section_t> *help_out
 void get_rethinkdb_porcelain_options(std::vector<options::help_section_t> *help_out,
                                      std::vector<options::option_t> *options_out) {
     help_out->push_back(get_file_options(options_out));
+    help_out->push_back(get_cache_options(options_out));
     help_out->push_back(get_machine_options(options_out));
     help_out->push_back(get_network_options(false, options_out));
     help_out->push_back(get_web_options(options_out));
+    help_out->push_back(get_stat_history_options(options_out));
+    help_out->push_back(get_sharding_options(options_out));
     help_out->push_back(get_cpu_options(options_out));
     help_out->push_back(get_service_options(options_out));
     help_out->push_back(get_setuser_options(options_out));
@@ -1201,6 +1265,70 @@ MUST_USE bool parse_io_threads_option(const std::map<std::string, options::value
     return true;
 }
 
+int64_t get_default_total_cache_size() {
+    const long num_pages = sysconf(_SC_PHYS_PAGES);  // NOLINT(runtime/int)
+    const long page_size = sysconf(_SC_PAGESIZE);  // NOLINT(runtime/int)
+    if (num_pages <= 0 || page_size <= 0) {
+        return GIGABYTE;
+    }
+    return static_cast<int64_t>(DEFAULT_MAX_CACHE_RATIO * num_pages * page_size);
+}
+
+MUST_USE bool parse_cache_size_option(const std::map<std::string, options::values_t> &opts,
+                                      int64_t *total_cache_size_out) {
+    boost::optional<std::string> cache_size = get_optional_option(opts, "--cache-size");
+    if (!cache_size) {
+        *total_cache_size_out = get_default_total_cache_size();
+        return true;
+    }
+
+    int64_t cache_size_mb;
+    if (!strtoi64_strict(*cache_size, 10, &cache_size_mb)
+        || cache_size_mb <= 0
+        || cache_size_mb > TERABYTE / MEGABYTE) {
+        fprintf(stderr, "ERROR: cache-size must be a number of megabytes between 1 and %lld\n",
+                TERABYTE / MEGABYTE);
+        return false;
+    }
+    *total_cache_size_out = cache_size_mb * MEGABYTE;
+    return true;
+}
+
+MUST_USE bool parse_stat_history_options(const std::map<std::string, options::values_t> &opts,
+                                         stat_history_options_t *options_out) {
+    const int max_interval_ms = 60 * 60 * 1000;
+    const int interval_ms = get_single_int(opts, "--stats-interval");
+    if (interval_ms < 0 || interval_ms > max_interval_ms) {
+        fprintf(stderr, "ERROR: stats-interval must be between 0 and %d milliseconds\n",
+                max_interval_ms);
+        return false;
+    }
+    const int num_samples = get_single_int(opts, "--stats-history");
+    if (num_samples <= 0 || num_samples > MILLION) {
+        fprintf(stderr, "ERROR: stats-history must be between 1 and %lld\n", MILLION);
+        return false;
+    }
+    options_out->interval_ms = interval_ms;
+    options_out->num_samples = num_samples;
+
+    boost::optional<std::string> filter = get_optional_option(opts, "--stats-filter");
+    if (filter) {
+        typedef boost::escaped_list_separator<char> separator_t;
+        typedef boost::tokenizer<separator_t> tokenizer_t;
+        separator_t commas("\\", ",", "");
+        try {
+            tokenizer_t t(*filter, commas);
+            for (tokenizer_t::const_iterator it = t.begin(); it != t.end(); ++it) {
+                options_out->filter_paths.insert(*it);
+            }
+        } catch (const boost::escaped_list_error &e) {
+            fprintf(stderr, "ERROR: could not parse stats-filter (%s)\n", e.what());
+            return false;
+        }
+    }
+    return true;
+}
+
 int main_rethinkdb_serve(int argc, char *argv[]) {
     std::vector<options::option_t> options;
     std::vector<options::help_section_t> help;
@@ -1235,6 +1363,16 @@ int main_rethinkdb_serve(int argc, char *argv[]) {
             return EXIT_FAILURE;
         }
 
+        int64_t total_cache_size;
+        if (!parse_cache_size_option(opts, &total_cache_size)) {
+            return EXIT_FAILURE;
+        }
+
+        stat_history_options_t stat_history_options;
+        if (!parse_stat_history_options(opts, &stat_history_options)) {
+            return EXIT_FAILURE;
+        }
+
         if (!check_existence(base_path)) {
             fprintf(stderr, "ERROR: The directory '%s' does not exist.  Run 'rethinkdb create -d \"%s\"' and try again.\n", base_path.path().c_str(), base_path.path().c_str());
             return EXIT_FAILURE;
@@ -1262,12 +1400,15 @@ int main_rethinkdb_serve(int argc, char *argv[]) {
         extproc::spawner_t::create(&spawner_info);
 
         serve_info_t serve_info(&spawner_info, joins, address_ports, web_path,
+                                stat_history_options,
+                                exists_option(opts, "--auto-split-hot-shards"),
                                 get_optional_option(opts, "--config-file"));
 
         bool result;
         run_in_thread_pool(boost::bind(&run_rethinkdb_serve, base_path,
                                        serve_info,
                                        max_concurrent_io_requests,
+                                       total_cache_size,
                                        static_cast<machine_id_t*>(NULL),
                                        static_cast<cluster_semilattice_metadata_t*>(NULL),
                                        &result),
@@ -1359,6 +1500,11 @@ int main_rethinkdb_proxy(int argc, char *argv[]) {
         const std::string web_path = get_web_path(opts, argv);
         const int num_workers = get_cpu_count();
 
+        stat_history_options_t stat_history_options;
+        if (!parse_stat_history_options(opts, &stat_history_options)) {
+            return EXIT_FAILURE;
+        }
+
         if (check_pid_file(opts) != EXIT_SUCCESS) {
             return EXIT_FAILURE;
         }
@@ -1376,6 +1522,8 @@ int main_rethinkdb_proxy(int argc, char *argv[]) {
         extproc::spawner_t::create(&spawner_info);
 
         serve_info_t serve_info(&spawner_info, joins, address_ports, web_path,
+                                stat_history_options,
+                                false,
                                 get_optional_option(opts, "--config-file"));
 
         bool result;
@@ -1563,6 +1711,16 @@ int main_rethinkdb_porcelain(int argc, char *argv[]) {
             return EXIT_FAILURE;
         }
 
+        int64_t total_cache_size;
+        if (!parse_cache_size_option(opts, &total_cache_size)) {
+            return EXIT_FAILURE;
+        }
+
+        stat_history_options_t stat_history_options;
+        if (!parse_stat_history_options(opts, &stat_history_options)) {
+            return EXIT_FAILURE;
+        }
+
         bool new_directory = false;
         // Attempt to create the directory early so that the log file can use it.
         if (!check_existence(base_path)) {
@@ -1596,6 +1754,8 @@ int main_rethinkdb_porcelain(int argc, char *argv[]) {
         extproc::spawner_t::create(&spawner_info);
 
         serve_info_t serve_info(&spawner_info, joins, address_ports, web_path,
+                                stat_history_options,
+                                exists_option(opts, "--auto-split-hot-shards"),
                                 get_optional_option(opts, "--config-file"));
 
         bool result;
@@ -1603,6 +1763,7 @@ int main_rethinkdb_porcelain(int argc, char *argv[]) {
                                        base_path,
                                        machine_name,
                                        max_concurrent_io_requests,
+                                       total_cache_size,
                                        new_directory,
                                        serve_info,
                                        &result),
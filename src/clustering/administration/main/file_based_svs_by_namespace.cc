@@ -14,10 +14,14 @@ template <class protocol_t>
 struct store_args_t {
     store_args_t(io_backender_t *_io_backender, const base_path_t &_base_path,
             namespace_id_t _namespace_id, int64_t _cache_size,
+            cache_balancer_t *_cache_balancer,
+            range_heat_registry_t *_heat_registry,
             perfmon_collection_t *_serializers_perfmon_collection, typename
             protocol_t::context_t *_ctx)
         : io_backender(_io_backender), base_path(_base_path),
           namespace_id(_namespace_id), cache_size(_cache_size),
+          cache_balancer(_cache_balancer),
+          heat_registry(_heat_registry),
           serializers_perfmon_collection(_serializers_perfmon_collection),
           ctx(_ctx)
     { }
@@ -25,7 +29,11 @@ struct store_args_t {
     io_backender_t *io_backender;
     base_path_t base_path;
     namespace_id_t namespace_id;
+    // The table's cache size is only where the caches start out; once they
+    // are registered, the cache balancer decides how big they get.
     int64_t cache_size;
+    cache_balancer_t *cache_balancer;
+    range_heat_registry_t *heat_registry;
     perfmon_collection_t *serializers_perfmon_collection;
     typename protocol_t::context_t *ctx;
 };
@@ -34,6 +42,14 @@ std::string hash_shard_perfmon_name(int hash_shard_number) {
     return strprintf("shard_%d", hash_shard_number);
 }
 
+// Where each store keeps the list of the blocks in its cache (see `cache_prewarmer_t`).
+serializer_filepath_t hot_list_file_name(const base_path_t &base_path, namespace_id_t namespace_id,
+                                         int hash_shard_number) {
+    return serializer_filepath_t(base_path, strprintf("%s.hot_blocks_%d",
+                                                      uuid_to_str(namespace_id).c_str(),
+                                                      hash_shard_number));
+}
+
 template <class protocol_t>
 void do_construct_existing_store(int i,
                                  store_args_t<protocol_t> store_args,
@@ -56,6 +72,13 @@ void do_construct_existing_store(int i,
     typename protocol_t::store_t *store = new typename protocol_t::store_t(multiplexer->proxies[i], hash_shard_perfmon_name(i),
                                                                            store_args.cache_size, false, store_args.serializers_perfmon_collection,
                                                                            store_args.ctx, store_args.io_backender, store_args.base_path);
+    if (store_args.cache_balancer != NULL) {
+        store->register_with_cache_balancer(store_args.cache_balancer);
+    }
+    if (store_args.heat_registry != NULL) {
+        store->register_with_heat_registry(store_args.heat_registry, store_args.namespace_id);
+    }
+    store->enable_cache_prewarm(hot_list_file_name(store_args.base_path, store_args.namespace_id, i));
     (*stores_out->stores())[i].init(store);
     store_views[i] = store;
 }
@@ -73,6 +96,13 @@ void do_create_new_store(int i,
     typename protocol_t::store_t *store = new typename protocol_t::store_t(multiplexer->proxies[i], hash_shard_perfmon_name(i),
                                                                            store_args.cache_size, true, store_args.serializers_perfmon_collection,
                                                                            store_args.ctx, store_args.io_backender, store_args.base_path);
+    if (store_args.cache_balancer != NULL) {
+        store->register_with_cache_balancer(store_args.cache_balancer);
+    }
+    if (store_args.heat_registry != NULL) {
+        store->register_with_heat_registry(store_args.heat_registry, store_args.namespace_id);
+    }
+    store->enable_cache_prewarm(hot_list_file_name(store_args.base_path, store_args.namespace_id, i));
     (*stores_out->stores())[i].init(store);
     store_views[i] = store;
 }
@@ -108,7 +138,8 @@ file_based_svs_by_namespace_t<protocol_t>::get_svs(
 
     int res = access(serializer_filepath.permanent_path().c_str(), R_OK | W_OK);
     store_args_t<protocol_t> store_args(io_backender_, base_path_,
-            namespace_id, cache_size, serializers_perfmon_collection, ctx);
+            namespace_id, cache_size, cache_balancer_, heat_registry_,
+            serializers_perfmon_collection, ctx);
     if (res == 0) {
         filepath_file_opener_t file_opener(serializer_filepath, io_backender_);
 
@@ -195,6 +226,12 @@ void file_based_svs_by_namespace_t<protocol_t>::destroy_svs(namespace_id_t names
     const std::string filepath = file_name_for(namespace_id).permanent_path();
     const int res = ::unlink(filepath.c_str());
     guarantee_err(res == 0 || errno == ENOENT, "unlink failed for file %s", filepath.c_str());
+
+    for (int i = 0; i < CLUSTER_CPU_SHARDING_FACTOR; ++i) {
+        const std::string hot_list_path = hot_list_file_name(base_path_, namespace_id, i).permanent_path();
+        const int hot_list_res = ::unlink(hot_list_path.c_str());
+        guarantee_err(hot_list_res == 0 || errno == ENOENT, "unlink failed for file %s", hot_list_path.c_str());
+    }
 }
 
 template <class protocol_t>
@@ -6,10 +6,18 @@
 
 #include "clustering/administration/reactor_driver.hpp"
 
+class cache_balancer_t;
+class range_heat_registry_t;
+
 template <class protocol_t>
 class file_based_svs_by_namespace_t : public svs_by_namespace_t<protocol_t> {
 public:
-    file_based_svs_by_namespace_t(io_backender_t *io_backender, const base_path_t& base_path) : io_backender_(io_backender), base_path_(base_path) { }
+    file_based_svs_by_namespace_t(io_backender_t *io_backender,
+                                  cache_balancer_t *cache_balancer,
+                                  range_heat_registry_t *heat_registry,
+                                  const base_path_t& base_path)
+        : io_backender_(io_backender), cache_balancer_(cache_balancer),
+          heat_registry_(heat_registry), base_path_(base_path) { }
 
     void get_svs(perfmon_collection_t *serializers_perfmon_collection, namespace_id_t namespace_id,
                  int64_t cache_size,
@@ -24,6 +32,8 @@ public:
 private:
 
     io_backender_t *io_backender_;
+    cache_balancer_t *cache_balancer_;
+    range_heat_registry_t *heat_registry_;
     const base_path_t base_path_;
 
     DISABLE_COPYING(file_based_svs_by_namespace_t);
@@ -5,8 +5,10 @@
 
 #include "arch/arch.hpp"
 #include "arch/os_signal.hpp"
+#include "buffer_cache/mirrored/balancer.hpp"
 #include "clustering/administration/admin_tracker.hpp"
 #include "clustering/administration/auto_reconnect.hpp"
+#include "clustering/administration/heat_balancer.hpp"
 #include "clustering/administration/http/server.hpp"
 #include "clustering/administration/issues/local.hpp"
 #include "clustering/administration/logger.hpp"
@@ -65,13 +67,17 @@ bool do_serve(
     extproc::spawner_info_t *spawner_info,
     io_backender_t *io_backender,
     bool i_am_a_server,
-    // NB. filepath & persistent_file are used iff i_am_a_server is true.
+    // NB. filepath, persistent_file & total_cache_size are used iff i_am_a_server is true.
     const base_path_t &base_path,
+    int64_t total_cache_size,
     metadata_persistence::cluster_persistent_file_t *cluster_metadata_file,
     metadata_persistence::auth_persistent_file_t *auth_metadata_file,
     const peer_address_set_t &joins,
     service_address_ports_t address_ports,
     std::string web_assets,
+    const stat_history_options_t &stat_history_options,
+    // Used iff i_am_a_server is true.
+    bool auto_split_hot_shards,
     signal_t *stop_cond,
     const boost::optional<std::string> &config_file) {
     try {
@@ -186,6 +192,11 @@ bool do_serve(
 
         sys_stats_collector_t sys_stats_collector(base_path, &sys_stats_collection);
 
+        scoped_ptr_t<stat_history_t> stat_history;
+        if (stat_history_options.interval_ms > 0) {
+            stat_history.init(new stat_history_t(stat_history_options));
+        }
+
         scoped_ptr_t<initial_joiner_t> initial_joiner;
         if (!joins.empty()) {
             initial_joiner.init(new initial_joiner_t(&connectivity_cluster, &connectivity_cluster_run, joins));
@@ -228,10 +239,17 @@ bool do_serve(
         rdb_ctx.ns_repo = &rdb_namespace_repo;
 
         {
+            // All the tables' caches on this machine share one memory budget.
+            scoped_ptr_t<cache_balancer_t> cache_balancer(!i_am_a_server ? NULL :
+                new cache_balancer_t(total_cache_size));
+            // Where the load on the tables' stores lands, for the heat balancer.
+            scoped_ptr_t<range_heat_registry_t> heat_registry(!i_am_a_server ? NULL :
+                new range_heat_registry_t);
+
             // Reactor drivers
 
             // Dummy
-            file_based_svs_by_namespace_t<mock::dummy_protocol_t> dummy_svs_source(io_backender, base_path);
+            file_based_svs_by_namespace_t<mock::dummy_protocol_t> dummy_svs_source(io_backender, cache_balancer.get(), heat_registry.get(), base_path);
             scoped_ptr_t<reactor_driver_t<mock::dummy_protocol_t> > dummy_reactor_driver(!i_am_a_server ? NULL :
                 new reactor_driver_t<mock::dummy_protocol_t>(
                     base_path,
@@ -255,7 +273,7 @@ bool do_serve(
                         &our_root_directory_variable));
 
             // Memcached
-            file_based_svs_by_namespace_t<memcached_protocol_t> memcached_svs_source(io_backender, base_path);
+            file_based_svs_by_namespace_t<memcached_protocol_t> memcached_svs_source(io_backender, cache_balancer.get(), heat_registry.get(), base_path);
             scoped_ptr_t<reactor_driver_t<memcached_protocol_t> > memcached_reactor_driver(!i_am_a_server ? NULL :
                 new reactor_driver_t<memcached_protocol_t>(
                     base_path,
@@ -279,7 +297,7 @@ bool do_serve(
                         &our_root_directory_variable));
 
             // RDB
-            file_based_svs_by_namespace_t<rdb_protocol_t> rdb_svs_source(io_backender, base_path);
+            file_based_svs_by_namespace_t<rdb_protocol_t> rdb_svs_source(io_backender, cache_balancer.get(), heat_registry.get(), base_path);
             scoped_ptr_t<reactor_driver_t<rdb_protocol_t> > rdb_reactor_driver(!i_am_a_server ? NULL :
                 new reactor_driver_t<rdb_protocol_t>(
                     base_path,
@@ -302,6 +320,19 @@ bool do_serve(
                         rdb_reactor_driver->get_watchable(),
                         &our_root_directory_variable));
 
+            scoped_ptr_t<heat_balancer_t> heat_balancer(!i_am_a_server ? NULL :
+                new heat_balancer_t(heat_registry.get(),
+                                    semilattice_manager_cluster.get_root_view(),
+                                    directory_read_manager.get_root_view(),
+                                    machine_id,
+                                    auto_split_hot_shards));
+            scoped_ptr_t<field_copier_t<std::map<namespace_id_t, double>, cluster_directory_metadata_t> >
+                heat_balancer_directory_copier(!i_am_a_server ? NULL :
+                    new field_copier_t<std::map<namespace_id_t, double>, cluster_directory_metadata_t>(
+                        &cluster_directory_metadata_t::primary_ops_per_sec,
+                        heat_balancer->get_primary_ops_per_sec_watchable(),
+                        &our_root_directory_variable));
+
             {
                 parser_maker_t<mock::dummy_protocol_t, mock::dummy_protocol_parser_t> dummy_parser_maker(
                     &mailbox_manager,
@@ -359,6 +390,8 @@ bool do_serve(
                                 &memcached_namespace_repo,
                                 &rdb_namespace_repo,
                                 &admin_tracker,
+                                stat_history.get_or_null(),
+                                heat_registry.get_or_null(),
                                 rdb_pb2_server.get_http_app(),
                                 machine_id,
                                 web_assets));
@@ -408,22 +441,28 @@ bool do_serve(
 bool serve(extproc::spawner_info_t *spawner_info,
            io_backender_t *io_backender,
            const base_path_t &base_path,
+           int64_t total_cache_size,
            metadata_persistence::cluster_persistent_file_t *cluster_persistent_file,
            metadata_persistence::auth_persistent_file_t *auth_persistent_file,
            const peer_address_set_t &joins,
            service_address_ports_t address_ports,
            std::string web_assets,
+           const stat_history_options_t &stat_history_options,
+           bool auto_split_hot_shards,
            signal_t *stop_cond,
            const boost::optional<std::string>& config_file) {
     return do_serve(spawner_info,
                     io_backender,
                     true,
                     base_path,
+                    total_cache_size,
                     cluster_persistent_file,
                     auth_persistent_file,
                     joins,
                     address_ports,
                     web_assets,
+                    stat_history_options,
+                    auto_split_hot_shards,
                     stop_cond,
                     config_file);
 }
@@ -432,6 +471,7 @@ bool serve_proxy(extproc::spawner_info_t *spawner_info,
                  const peer_address_set_t &joins,
                  service_address_ports_t address_ports,
                  std::string web_assets,
+                 const stat_history_options_t &stat_history_options,
                  signal_t *stop_cond,
                  const boost::optional<std::string>& config_file) {
     // TODO: filepath doesn't _seem_ ignored.
@@ -440,11 +480,14 @@ bool serve_proxy(extproc::spawner_info_t *spawner_info,
                     NULL,
                     false,
                     base_path_t(""),
+                    0,
                     NULL,
                     NULL,
                     joins,
                     address_ports,
                     web_assets,
+                    stat_history_options,
+                    false,
                     stop_cond,
                     config_file);
 }
@@ -7,6 +7,7 @@
 
 #include "clustering/administration/metadata.hpp"
 #include "clustering/administration/persist.hpp"
+#include "clustering/administration/stat_history.hpp"
 #include "arch/address.hpp"
 
 namespace extproc { class spawner_info_t; }
@@ -71,11 +72,14 @@ long time to compile. */
 bool serve(extproc::spawner_info_t *spawner_info,
            io_backender_t *io_backender,
            const base_path_t &base_path,
+           int64_t total_cache_size,
            metadata_persistence::cluster_persistent_file_t *cluster_persistent_file,
            metadata_persistence::auth_persistent_file_t *auth_persistent_file,
            const peer_address_set_t &joins,
            service_address_ports_t ports,
            std::string web_assets,
+           const stat_history_options_t &stat_history_options,
+           bool auto_split_hot_shards,
            signal_t *stop_cond,
            const boost::optional<std::string>& config_file);
 
@@ -83,6 +87,7 @@ bool serve_proxy(extproc::spawner_info_t *spawner_info,
                  const peer_address_set_t &joins,
                  service_address_ports_t ports,
                  std::string web_assets,
+                 const stat_history_options_t &stat_history_options,
                  signal_t *stop_cond,
                  const boost::optional<std::string>& config_file);
 
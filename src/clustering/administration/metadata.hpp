@@ -119,7 +119,11 @@ public:
     std::list<local_issue_t> local_issues;
     cluster_directory_peer_type_t peer_type;
 
-    RDB_MAKE_ME_SERIALIZABLE_12(dummy_namespaces, memcached_namespaces, rdb_namespaces, machine_id, peer_id, ips, get_stats_mailbox_address, semilattice_change_mailbox, auth_change_mailbox, log_mailbox, local_issues, peer_type);
+    /* How many operations per second the shards we are the primary of got, by
+    table, as of our heat balancer's last look. */
+    std::map<namespace_id_t, double> primary_ops_per_sec;
+
+    RDB_MAKE_ME_SERIALIZABLE_13(dummy_namespaces, memcached_namespaces, rdb_namespaces, machine_id, peer_id, ips, get_stats_mailbox_address, semilattice_change_mailbox, auth_change_mailbox, log_mailbox, local_issues, peer_type, primary_ops_per_sec);
 };
 
 // ctx-less json adapter for directory_echo_wrapper_t
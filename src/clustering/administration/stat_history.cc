@@ -0,0 +1,166 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include "clustering/administration/stat_history.hpp"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include <algorithm>
+
+#include "errors.hpp"
+#include <boost/bind.hpp>
+
+#include "arch/runtime/coroutines.hpp"
+#include "config/args.hpp"
+#include "http/json.hpp"
+#include "perfmon/collect.hpp"
+#include "perfmon/core.hpp"
+
+stat_history_options_t::stat_history_options_t()
+    : interval_ms(DEFAULT_STAT_HISTORY_INTERVAL_MS),
+      num_samples(DEFAULT_STAT_HISTORY_SAMPLES) { }
+
+stat_history_ring_t::series_t::series_t(size_t _num_samples)
+    : values(_num_samples, NAN), last_present(0) { }
+
+stat_history_ring_t::stat_history_ring_t(size_t _num_samples)
+    : num_samples(_num_samples), next_sample(0), times_ms(_num_samples, 0) {
+    guarantee(num_samples > 0);
+}
+
+void stat_history_ring_t::add_sample(int64_t time_ms,
+                                     const std::map<std::string, double> &values) {
+    const uint64_t sample = next_sample++;
+    times_ms[slot(sample)] = time_ms;
+
+    // Overwrite the oldest sample, and forget stats that no sample we keep has
+    // a value for.
+    for (std::map<std::string, series_t>::iterator it = series.begin();
+         it != series.end();) {
+        if (it->second.last_present + num_samples <= sample) {
+            series.erase(it++);
+        } else {
+            it->second.values[slot(sample)] = NAN;
+            ++it;
+        }
+    }
+
+    for (std::map<std::string, double>::const_iterator it = values.begin();
+         it != values.end(); ++it) {
+        std::map<std::string, series_t>::iterator s = series.find(it->first);
+        if (s == series.end()) {
+            s = series.insert(std::make_pair(it->first, series_t(num_samples))).first;
+        }
+        s->second.values[slot(sample)] = it->second;
+        s->second.last_present = sample;
+    }
+}
+
+cJSON *stat_history_ring_t::render_json(uint64_t since) const {
+    const uint64_t oldest = next_sample > num_samples ? next_sample - num_samples : 0;
+    const uint64_t first = std::min(std::max(since, oldest), next_sample);
+
+    scoped_cJSON_t times(cJSON_CreateArray());
+    for (uint64_t i = first; i < next_sample; ++i) {
+        const int64_t time_ms = times_ms[slot(i)];
+        const int64_t delta = i == first ? time_ms : time_ms - times_ms[slot(i - 1)];
+        times.AddItemToArray(cJSON_CreateNumber(delta));
+    }
+
+    scoped_cJSON_t stats(cJSON_CreateObject());
+    for (std::map<std::string, series_t>::const_iterator it = series.begin();
+         it != series.end(); ++it) {
+        if (first == next_sample || it->second.last_present < first) {
+            continue;
+        }
+        scoped_cJSON_t values(cJSON_CreateArray());
+        bool have_previous = false;
+        double previous = 0;
+        for (uint64_t i = first; i < next_sample; ++i) {
+            const double value = it->second.values[slot(i)];
+            if (isnan(value)) {
+                values.AddItemToArray(cJSON_CreateNull());
+            } else {
+                values.AddItemToArray(
+                    cJSON_CreateNumber(have_previous ? value - previous : value));
+                previous = value;
+                have_previous = true;
+            }
+        }
+        stats.AddItemToObject(it->first.c_str(), values.release());
+    }
+
+    scoped_cJSON_t res(cJSON_CreateObject());
+    res.AddItemToObject("first", cJSON_CreateNumber(first));
+    res.AddItemToObject("next", cJSON_CreateNumber(next_sample));
+    res.AddItemToObject("times", times.release());
+    res.AddItemToObject("stats", stats.release());
+    return res.release();
+}
+
+void flatten_perfmon_result(const perfmon_result_t &result, const std::string &prefix,
+                            std::map<std::string, double> *values_out) {
+    if (result.is_string()) {
+        const std::string *str = result.get_string();
+        if (str->empty()) {
+            return;
+        }
+        char *end;
+        const double value = strtod(str->c_str(), &end);
+        // Only numbers go into the history.
+        if (*end == '\0' && isfinite(value)) {
+            (*values_out)[prefix] = value;
+        }
+    } else {
+        for (perfmon_result_t::const_iterator it = result.begin(); it != result.end(); ++it) {
+            flatten_perfmon_result(*it->second,
+                                   prefix.empty() ? it->first : prefix + "/" + it->first,
+                                   values_out);
+        }
+    }
+}
+
+stat_history_t::stat_history_t(const stat_history_options_t &options)
+    : interval_ms(options.interval_ms),
+      ring(options.num_samples),
+      sample_in_progress(false),
+      timer(options.interval_ms, this) {
+    guarantee(interval_ms > 0);
+    if (!options.filter_paths.empty()) {
+        filter.init(new perfmon_filter_t(options.filter_paths));
+    }
+}
+
+stat_history_t::~stat_history_t() {
+    assert_thread();
+}
+
+cJSON *stat_history_t::render_json(uint64_t since) const {
+    assert_thread();
+    return ring.render_json(since);
+}
+
+void stat_history_t::on_ring() {
+    assert_thread();
+    // If collecting the stats takes longer than the interval, we skip a sample
+    // rather than pile up collections.
+    if (!sample_in_progress) {
+        sample_in_progress = true;
+        coro_t::spawn_sometime(boost::bind(&stat_history_t::take_sample, this,
+                                           auto_drainer_t::lock_t(&drainer)));
+    }
+}
+
+void stat_history_t::take_sample(auto_drainer_t::lock_t keepalive) {
+    assert_thread();
+    keepalive.assert_is_holding(&drainer);
+
+    scoped_ptr_t<perfmon_result_t> stats = perfmon_get_stats();
+    if (filter.has()) {
+        filter->filter(&stats);
+    }
+    std::map<std::string, double> values;
+    flatten_perfmon_result(*stats, "", &values);
+    ring.add_sample(current_microtime() / THOUSAND, values);
+
+    sample_in_progress = false;
+}
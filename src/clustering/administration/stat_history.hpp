@@ -0,0 +1,106 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#ifndef CLUSTERING_ADMINISTRATION_STAT_HISTORY_HPP_
+#define CLUSTERING_ADMINISTRATION_STAT_HISTORY_HPP_
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "arch/timing.hpp"
+#include "concurrency/auto_drainer.hpp"
+#include "containers/scoped.hpp"
+#include "utils.hpp"
+
+class perfmon_filter_t;
+class perfmon_result_t;
+struct cJSON;
+
+struct stat_history_options_t {
+    stat_history_options_t();
+
+    // How often to take a sample; 0 turns the stat history off.
+    int64_t interval_ms;
+    // How many samples to keep.
+    size_t num_samples;
+    // Which stats to sample, as paths like the stat app's `filter` parameter
+    // takes.  Empty means all of them.
+    std::set<std::string> filter_paths;
+};
+
+/* The last `num_samples` samples of a set of numeric stats.  Samples are
+numbered from 0 in the order they are added; every stat has one slot per
+sample, which is empty for samples taken while the stat didn't exist. */
+class stat_history_ring_t {
+public:
+    explicit stat_history_ring_t(size_t num_samples);
+
+    void add_sample(int64_t time_ms, const std::map<std::string, double> &values);
+
+    // The number of the next sample to be added.
+    uint64_t get_next_sample() const { return next_sample; }
+
+    /* Renders the samples numbered `since` and after that are still kept as
+
+        {"first": <number of the first sample>, "next": <next sample number>,
+         "times": [<series>], "stats": {"<path>": [<series>], ...}}
+
+    where each series has one entry per sample.  The first value of a series
+    is absolute and every value after it is the difference from the value
+    before it; missing values are null and don't break the chain.  Stats that
+    have no values in the range are left out.  Clients that ask for
+    `since=<next>` the next time get only what they haven't seen. */
+    cJSON *render_json(uint64_t since) const;
+
+private:
+    struct series_t {
+        explicit series_t(size_t num_samples);
+        std::vector<double> values;
+        uint64_t last_present;
+    };
+
+    size_t slot(uint64_t sample) const { return sample % num_samples; }
+
+    const size_t num_samples;
+    uint64_t next_sample;
+    std::vector<int64_t> times_ms;
+    std::map<std::string, series_t> series;
+
+    DISABLE_COPYING(stat_history_ring_t);
+};
+
+// Collects the numeric values in `result` by their slash-separated paths.
+void flatten_perfmon_result(const perfmon_result_t &result, const std::string &prefix,
+                            std::map<std::string, double> *values_out);
+
+/* Each machine keeps its own stat history: every `interval_ms` it snapshots the
+selected stats into a `stat_history_ring_t`, which the stat history HTTP app
+serves.  Stats are collected once per interval no matter how many dashboards
+are watching, instead of once per request for each of them. */
+class stat_history_t : public home_thread_mixin_t, private repeating_timer_callback_t {
+public:
+    explicit stat_history_t(const stat_history_options_t &options);
+    ~stat_history_t();
+
+    int64_t get_interval_ms() const { return interval_ms; }
+
+    // See `stat_history_ring_t::render_json`.
+    cJSON *render_json(uint64_t since) const;
+
+private:
+    void on_ring();
+    void take_sample(auto_drainer_t::lock_t keepalive);
+
+    const int64_t interval_ms;
+    scoped_ptr_t<perfmon_filter_t> filter;
+    stat_history_ring_t ring;
+
+    bool sample_in_progress;
+
+    auto_drainer_t drainer;
+    repeating_timer_t timer;
+
+    DISABLE_COPYING(stat_history_t);
+};
+
+#endif  // CLUSTERING_ADMINISTRATION_STAT_HISTORY_HPP_
@@ -13,6 +13,7 @@
 #include "clustering/immediate_consistency/branch/multistore.hpp"
 // TODO: Make us not include master.hpp -- we do it only for the ack_checker_t type.
 #include "clustering/immediate_consistency/query/master.hpp"
+#include "config/args.hpp"
 #include "rpc/mailbox/typed.hpp"
 #include "rpc/semilattice/view/field.hpp"
 #include "rpc/semilattice/view/member.hpp"
@@ -208,11 +209,13 @@ class broadcaster_t<protocol_t>::dispatchee_t : public intrusive_list_node_t<dis
 public:
     dispatchee_t(broadcaster_t *c, listener_business_card_t<protocol_t> d) THROWS_NOTHING :
         write_mailbox(d.write_mailbox), is_readable(false),
+        write_batch_mailbox(d.write_batch_mailbox),
         queue_count(),
         queue_count_membership(&c->broadcaster_collection, &queue_count, uuid_to_str(d.write_mailbox.get_peer().get_uuid()) + "_broadcast_queue_count"),
         background_write_queue(&queue_count),
         // TODO magic constant
         background_write_workers(100, &background_write_queue, &background_write_caller),
+        batch_flush_scheduled(false),
         controller(c),
         upgrade_mailbox(controller->mailbox_manager,
             boost::bind(&dispatchee_t::upgrade, this, _1, _2, auto_drainer_t::lock_t(&drainer)), mailbox_callback_mode_inline),
@@ -257,6 +260,27 @@ public:
         return write_mailbox.get_peer();
     }
 
+    /* Writes to this mirror go out in batches. A write that starts while no
+    batch is waiting schedules a flush for when the writes that are ready to
+    run have had their turn, so a lone write is hardly delayed, while under
+    load every write that starts in the meantime goes into the same message.
+    A batch that reaches `BROADCASTER_WRITE_BATCH_MAX_WRITES` goes out right
+    away. `keepalive` must be a lock on this dispatchee's drainer. */
+    void add_to_batch(const listener_batched_write_t<protocol_t> &write,
+                      auto_drainer_t::lock_t keepalive) THROWS_NOTHING {
+        keepalive.assert_is_holding(&drainer);
+        batch.push_back(write);
+        if (batch.size() >= BROADCASTER_WRITE_BATCH_MAX_WRITES) {
+            send_batch();
+        } else if (!batch_flush_scheduled) {
+            /* The flush holds a copy of the caller's lock rather than a new
+            one, because the drainer may be draining already; the writes in
+            the batch have entered the fifo and must be sent regardless. */
+            batch_flush_scheduled = true;
+            coro_t::spawn_sometime(boost::bind(&dispatchee_t::flush_batch, this, keepalive));
+        }
+    }
+
 private:
     /* The constructor spawns `send_intro()` in the background. */
     void send_intro(listener_business_card_t<protocol_t> to_send_intro_to,
@@ -285,6 +309,20 @@ private:
         controller->readable_dispatchees.push_back(this);
     }
 
+    void flush_batch(auto_drainer_t::lock_t keepalive) THROWS_NOTHING {
+        keepalive.assert_is_holding(&drainer);
+        batch_flush_scheduled = false;
+        send_batch();
+    }
+
+    void send_batch() THROWS_NOTHING {
+        if (!batch.empty()) {
+            std::vector<listener_batched_write_t<protocol_t> > to_send;
+            to_send.swap(batch);
+            send(controller->mailbox_manager, write_batch_mailbox, to_send);
+        }
+    }
+
     void downgrade(mailbox_addr_t<void()> ack_addr, auto_drainer_t::lock_t) THROWS_NOTHING {
         {
             DEBUG_VAR mutex_assertion_t::acq_t acq(&controller->mutex);
@@ -303,6 +341,7 @@ public:
     bool is_readable;
     typename listener_business_card_t<protocol_t>::writeread_mailbox_t::address_t writeread_mailbox;
     typename listener_business_card_t<protocol_t>::read_mailbox_t::address_t read_mailbox;
+    typename listener_business_card_t<protocol_t>::write_batch_mailbox_t::address_t write_batch_mailbox;
 
     /* This is used to enforce that operations are performed on the
        destination machine in the same order that we send them, even if the
@@ -323,6 +362,11 @@ public:
 
 private:
     coro_pool_t<boost::function<void()> > background_write_workers;
+
+    /* The writes for the next batch, and whether a flush is on its way. */
+    std::vector<listener_batched_write_t<protocol_t> > batch;
+    bool batch_flush_scheduled;
+
     broadcaster_t *controller;
     auto_drainer_t drainer;
 
@@ -332,30 +376,9 @@ private:
     DISABLE_COPYING(dispatchee_t);
 };
 
-/* Functions to send a read or write to a mirror and wait for a response.
-Important: These functions must send the message before responding to
-`interruptor` being pulsed. */
-
-template<class protocol_t>
-void listener_write(
-        mailbox_manager_t *mailbox_manager,
-        const typename listener_business_card_t<protocol_t>::write_mailbox_t::address_t &write_mailbox,
-        const typename protocol_t::write_t &w, transition_timestamp_t ts,
-        order_token_t order_token, fifo_enforcer_write_token_t token,
-        signal_t *interruptor)
-        THROWS_ONLY(interrupted_exc_t)
-{
-    cond_t ack_cond;
-    mailbox_t<void()> ack_mailbox(
-        mailbox_manager,
-        boost::bind(&cond_t::pulse, &ack_cond),
-        mailbox_callback_mode_inline);
-
-    send(mailbox_manager, write_mailbox,
-         w, ts, order_token, token, ack_mailbox.get_address());
-
-    wait_interruptible(&ack_cond, interruptor);
-}
+/* Functions to send a read to a mirror and wait for a response. Important:
+These functions must send the message before responding to `interruptor` being
+pulsed. */
 
 template <class response_t>
 void store_listener_response(response_t *result_out, const response_t &result_in, cond_t *done) {
@@ -521,9 +544,22 @@ void broadcaster_t<protocol_t>::pick_a_readable_dispatchee(dispatchee_t **dispat
 template<class protocol_t>
 void broadcaster_t<protocol_t>::background_write(dispatchee_t *mirror, auto_drainer_t::lock_t mirror_lock, incomplete_write_ref_t write_ref, order_token_t order_token, fifo_enforcer_write_token_t token) THROWS_NOTHING {
     try {
-        listener_write<protocol_t>(mailbox_manager, mirror->write_mailbox,
-                                   write_ref.get()->write, write_ref.get()->timestamp, order_token, token,
-                                   mirror_lock.get_drain_signal());
+        cond_t ack_cond;
+        mailbox_t<void()> ack_mailbox(
+            mailbox_manager,
+            boost::bind(&cond_t::pulse, &ack_cond),
+            mailbox_callback_mode_inline);
+
+        /* Writes to a mirror that isn't readable are only acknowledged, and
+        it performs them with soft durability. */
+        mirror->add_to_batch(listener_batched_write_t<protocol_t>(
+                write_ref.get()->write, write_ref.get()->timestamp, order_token, token,
+                ack_mailbox.get_address(),
+                mailbox_addr_t<void(typename protocol_t::write_response_t)>(),
+                WRITE_DURABILITY_SOFT),
+            mirror_lock);
+
+        wait_interruptible(&ack_cond, mirror_lock.get_drain_signal());
     } catch (const interrupted_exc_t &) {
         return;
     }
@@ -539,7 +575,10 @@ void broadcaster_t<protocol_t>::background_writeread(dispatchee_t *mirror, auto_
             boost::bind(&store_listener_response<typename protocol_t::write_response_t>, &response, _1, &response_cond),
             mailbox_callback_mode_inline);
 
-        send(mailbox_manager, mirror->writeread_mailbox, write_ref.get()->write, write_ref.get()->timestamp, order_token, token, response_mailbox.get_address(), durability);
+        mirror->add_to_batch(listener_batched_write_t<protocol_t>(
+                write_ref.get()->write, write_ref.get()->timestamp, order_token, token,
+                mailbox_addr_t<void()>(), response_mailbox.get_address(), durability),
+            mirror_lock);
 
         wait_interruptible(&response_cond, mirror_lock.get_drain_signal());
 
@@ -1,6 +1,10 @@
 // Copyright 2010-2012 RethinkDB, all rights reserved.
 #include "clustering/immediate_consistency/branch/listener.hpp"
 
+#include <algorithm>
+
+#include <boost/ptr_container/ptr_vector.hpp>
+
 #include "clustering/generic/registrant.hpp"
 #include "clustering/generic/resource.hpp"
 #include "clustering/immediate_consistency/branch/backfillee.hpp"
@@ -27,6 +31,17 @@ the backfill will be faster but the cluster will only serve queries slowly
 during the backfill. */
 #define WRITE_QUEUE_SEMAPHORE_TRICKLE_FRACTION 0.5
 
+/* `WRITE_GROUP_MAX_SIZE` is the most writes that get applied to the store in a
+single transaction. Bigger groups save more superblock acquisitions, but keep
+the writes at the end of the group waiting longer. */
+#define WRITE_GROUP_MAX_SIZE 64
+
+/* `WRITE_GROUPS_MAX_IN_FLIGHT` is how many groups get applied at the same
+time. The store still applies their writes in order, but while one group's
+transaction is traversing the btree, the next one can already be acquiring
+the superblock and its blocks. */
+#define WRITE_GROUPS_MAX_IN_FLIGHT 8
+
 #ifndef NDEBUG
 template <class protocol_t>
 struct version_leq_metainfo_checker_callback_t : public metainfo_checker_callback_t<protocol_t> {
@@ -69,6 +84,8 @@ listener_t<protocol_t>::listener_t(const base_path_t &base_path,
     uuid_(generate_uuid()),
     perfmon_collection_(),
     perfmon_collection_membership_(backfill_stats_parent, &perfmon_collection_, "backfill-serialization-" + uuid_to_str(uuid_)),
+    write_groups_in_flight_(0),
+    write_group_semaphore_(WRITE_QUEUE_CORO_POOL_SIZE),
     /* TODO: Put the file in the data directory, not here */
     write_queue_(io_backender,
                  serializer_filepath_t(base_path, "backfill-serialization-" + uuid_to_str(uuid_)),
@@ -84,6 +101,9 @@ listener_t<protocol_t>::listener_t(const base_path_t &base_path,
         mailbox_callback_mode_inline),
     read_mailbox_(mailbox_manager_,
         boost::bind(&listener_t::on_read, this, _1, _2, _3, _4, _5),
+        mailbox_callback_mode_inline),
+    write_batch_mailbox_(mailbox_manager_,
+        boost::bind(&listener_t::on_write_batch, this, _1),
         mailbox_callback_mode_inline)
 {
     boost::optional<boost::optional<broadcaster_business_card_t<protocol_t> > > business_card =
@@ -245,6 +265,8 @@ listener_t<protocol_t>::listener_t(const base_path_t &base_path,
     uuid_(generate_uuid()),
     perfmon_collection_(),
     perfmon_collection_membership_(backfill_stats_parent, &perfmon_collection_, "backfill-serialization-" + uuid_to_str(uuid_)),
+    write_groups_in_flight_(0),
+    write_group_semaphore_(WRITE_QUEUE_CORO_POOL_SIZE),
     /* TODO: Put the file in the data directory, not here */
     write_queue_(io_backender, serializer_filepath_t(base_path, "backfill-serialization-" + uuid_to_str(uuid_)), &perfmon_collection_),
     write_queue_semaphore_(WRITE_QUEUE_SEMAPHORE_LONG_TERM_CAPACITY,
@@ -258,6 +280,9 @@ listener_t<protocol_t>::listener_t(const base_path_t &base_path,
         mailbox_callback_mode_inline),
     read_mailbox_(mailbox_manager_,
         boost::bind(&listener_t::on_read, this, _1, _2, _3, _4, _5),
+        mailbox_callback_mode_inline),
+    write_batch_mailbox_(mailbox_manager_,
+        boost::bind(&listener_t::on_write_batch, this, _1),
         mailbox_callback_mode_inline)
 {
     branch_birth_certificate_t<protocol_t> this_branch_history;
@@ -379,7 +404,9 @@ void listener_t<protocol_t>::try_start_receiving_writes(
         registrant_.init(new registrant_t<listener_business_card_t<protocol_t> >(
             mailbox_manager_,
             broadcaster->subview(&listener_t<protocol_t>::get_registrar_from_broadcaster_bcard),
-            listener_business_card_t<protocol_t>(intro_mailbox.get_address(), write_mailbox_.get_address())));
+            listener_business_card_t<protocol_t>(intro_mailbox.get_address(),
+                                                 write_mailbox_.get_address(),
+                                                 write_batch_mailbox_.get_address())));
     } catch (const resource_lost_exc_t &) {
         throw broadcaster_lost_exc_t();
     }
@@ -447,38 +474,73 @@ void listener_t<protocol_t>::perform_enqueued_write(const write_queue_entry_t &q
         write_queue_has_drained_.pulse_if_not_already_pulsed();
     }
 
-    write_token_pair_t write_token_pair;
+    rassert(region_is_superset(svs_->get_region(), qe.write.get_region()));
+
     {
         fifo_enforcer_sink_t::exit_write_t fifo_exit(&store_entrance_sink_, qe.fifo_token);
         if (qe.transition_timestamp.timestamp_before() < backfill_end_timestamp) {
             return;
         }
         wait_interruptible(&fifo_exit, interruptor);
+        /* We wait for room while still in `store_entrance_sink_`, so the writes
+        behind us wait too and `write_group_` stays in order. */
+        write_group_semaphore_.co_lock_interruptible(interruptor);
         advance_current_timestamp_and_pulse_waiters(qe.transition_timestamp);
-        svs_->new_write_token_pair(&write_token_pair);
+        grouped_write_t *grouped_write = new grouped_write_t(qe);
+        write_group_.push_back(grouped_write);
+        svs_->new_write_token_pair(&grouped_write->token_pair);
     }
 
+    if (write_groups_in_flight_ < WRITE_GROUPS_MAX_IN_FLIGHT) {
+        apply_write_groups(interruptor);
+    }
+}
+
+template <class protocol_t>
+void listener_t<protocol_t>::apply_write_groups(signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t) {
+    rassert(write_groups_in_flight_ < WRITE_GROUPS_MAX_IN_FLIGHT);
+    ++write_groups_in_flight_;
+    try {
+        while (!write_group_.empty()) {
+            const size_t group_size = std::min<size_t>(write_group_.size(), WRITE_GROUP_MAX_SIZE);
+            boost::ptr_vector<grouped_write_t> group;
+            std::vector<typename protocol_t::write_response_t> responses(group_size);
+            std::vector<batched_store_write_t<protocol_t> > writes;
+            for (size_t i = 0; i < group_size; ++i) {
+                group.push_back(write_group_.pop_front().release());
+                const write_queue_entry_t &qe = group.back().entry;
+                writes.push_back(batched_store_write_t<protocol_t>(
+                    region_map_t<protocol_t, binary_blob_t>(svs_->get_region(),
+                        binary_blob_t(version_range_t(version_t(branch_id_, qe.transition_timestamp.timestamp_after())))),
+                    &qe.write,
+                    &responses[i],
+                    qe.transition_timestamp,
+                    qe.order_token,
+                    &group.back().token_pair));
+            }
+
 #ifndef NDEBUG
-        version_leq_metainfo_checker_callback_t<protocol_t> metainfo_checker_callback(qe.transition_timestamp.timestamp_before());
-        metainfo_checker_t<protocol_t> metainfo_checker(&metainfo_checker_callback, svs_->get_region());
+            version_leq_metainfo_checker_callback_t<protocol_t> metainfo_checker_callback(group.front().entry.transition_timestamp.timestamp_before());
+            metainfo_checker_t<protocol_t> metainfo_checker(&metainfo_checker_callback, svs_->get_region());
 #endif
 
-    typename protocol_t::write_response_t response;
-
-    rassert(region_is_superset(svs_->get_region(), qe.write.get_region()));
+            // This isn't used for client writes, so we don't want to wait for a disk ack.
+            svs_->write_batch(
+                DEBUG_ONLY(metainfo_checker, )
+                writes,
+                WRITE_DURABILITY_SOFT,
+                interruptor);
 
-    // This isn't used for client writes, so we don't want to wait for a disk ack.
-    svs_->write(
-        DEBUG_ONLY(metainfo_checker, )
-        region_map_t<protocol_t, binary_blob_t>(svs_->get_region(),
-            binary_blob_t(version_range_t(version_t(branch_id_, qe.transition_timestamp.timestamp_after())))),
-        qe.write,
-        &response,
-        WRITE_DURABILITY_SOFT,
-        qe.transition_timestamp,
-        qe.order_token,
-        &write_token_pair,
-        interruptor);
+            write_group_semaphore_.unlock(group_size);
+        }
+    } catch (const interrupted_exc_t &) {
+        /* We're shutting down; the writes behind us won't be applied either. */
+        write_group_.clear();
+        --write_groups_in_flight_;
+        throw;
+    }
+    --write_groups_in_flight_;
 }
 
 template <class protocol_t>
@@ -561,6 +623,23 @@ void listener_t<protocol_t>::perform_writeread(const typename protocol_t::write_
     }
 }
 
+template <class protocol_t>
+void listener_t<protocol_t>::on_write_batch(const std::vector<listener_batched_write_t<protocol_t> > &batch)
+        THROWS_NOTHING {
+    /* The writes still go through the fifo sinks one by one, so they reach the
+    store in order and each is acknowledged as soon as it's done. What the
+    batch saves is the messages. */
+    for (typename std::vector<listener_batched_write_t<protocol_t> >::const_iterator it = batch.begin();
+         it != batch.end(); ++it) {
+        if (it->is_writeread()) {
+            on_writeread(it->write, it->timestamp, it->order_token, it->fifo_token,
+                         it->response_addr, it->durability);
+        } else {
+            on_write(it->write, it->timestamp, it->order_token, it->fifo_token, it->ack_addr);
+        }
+    }
+}
+
 template <class protocol_t>
 void listener_t<protocol_t>::on_read(const typename protocol_t::read_t &read,
         state_timestamp_t expected_timestamp,
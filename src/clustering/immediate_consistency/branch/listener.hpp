@@ -3,6 +3,10 @@
 #define CLUSTERING_IMMEDIATE_CONSISTENCY_BRANCH_LISTENER_HPP_
 
 #include <map>
+#include <vector>
+
+#include "errors.hpp"
+#include <boost/ptr_container/ptr_deque.hpp>
 
 #include "clustering/immediate_consistency/branch/metadata.hpp"
 #include "concurrency/promise.hpp"
@@ -139,6 +143,17 @@ private:
         RDB_MAKE_ME_SERIALIZABLE_4(write, order_token, transition_timestamp, fifo_token);
     };
 
+    /* A write that has gotten its tokens from the store and is waiting to be
+    applied along with the writes around it. */
+    class grouped_write_t {
+    public:
+        explicit grouped_write_t(const write_queue_entry_t &e) : entry(e) { }
+        write_queue_entry_t entry;
+        write_token_pair_t token_pair;
+    private:
+        DISABLE_COPYING(grouped_write_t);
+    };
+
     // TODO: This boost optional boost optional crap is ... crap.  This isn't Haskell, this is *real* programming, people.
     static boost::optional<boost::optional<backfiller_business_card_t<protocol_t> > > get_backfiller_from_replier_bcard(const boost::optional<boost::optional<replier_business_card_t<protocol_t> > > &replier_bcard);
 
@@ -173,6 +188,12 @@ private:
     void perform_enqueued_write(const write_queue_entry_t &serialized_write, state_timestamp_t backfill_end_timestamp, signal_t *interruptor)
         THROWS_ONLY(interrupted_exc_t);
 
+    /* Applies the writes in `write_group_` until there are none left, a
+    group at a time. Several of these can run at once, each on its own
+    groups. */
+    void apply_write_groups(signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t);
+
     /* See the note at the place where `writeread_mailbox` is declared for an
     explanation of why `on_writeread()` and `on_read()` are here. */
 
@@ -193,6 +214,11 @@ private:
             auto_drainer_t::lock_t keepalive)
         THROWS_NOTHING;
 
+    /* Hands each write of a batch to `on_write()` or `on_writeread()`, in the
+    order the broadcaster sent them. */
+    void on_write_batch(const std::vector<listener_batched_write_t<protocol_t> > &batch)
+        THROWS_NOTHING;
+
     void on_read(const typename protocol_t::read_t &read,
             state_timestamp_t expected_timestamp,
             order_token_t order_token,
@@ -239,7 +265,22 @@ private:
     // backfillees how up to date it is.
     std::multimap<state_timestamp_t, cond_t *> synchronize_waiters_;
 
-    disk_backed_queue_wrapper_t<write_queue_entry_t> write_queue_;
+    /* Writes that have passed `store_entrance_sink_` but haven't been applied
+    yet. A `perform_enqueued_write()` that finds fewer than
+    `WRITE_GROUPS_MAX_IN_FLIGHT` groups being applied takes over, and hands
+    them to the store a group at a time, so that a replica which is catching up
+    pays for one transaction per group rather than one per write, while the
+    groups in flight still overlap their traversals. `write_group_semaphore_`
+    keeps the writes held here from outgrowing the coroutine pool that used to
+    hold them. */
+    boost::ptr_deque<grouped_write_t> write_group_;
+    int write_groups_in_flight_;
+    semaphore_t write_group_semaphore_;
+
+    /* Writes that arrive during the backfill.  They spill to an append-only log
+    rather than to a serializer and cache of their own. */
+    disk_backed_queue_wrapper_t<write_queue_entry_t,
+                                segmented_log_queue_t<write_queue_entry_t> > write_queue_;
     fifo_enforcer_sink_t write_queue_entrance_sink_;
     scoped_ptr_t<boost_function_callback_t<write_queue_entry_t> > write_queue_coro_pool_callback_;
     adjustable_semaphore_t write_queue_semaphore_;
@@ -268,6 +309,8 @@ private:
     typename listener_business_card_t<protocol_t>::writeread_mailbox_t writeread_mailbox_;
     typename listener_business_card_t<protocol_t>::read_mailbox_t read_mailbox_;
 
+    typename listener_business_card_t<protocol_t>::write_batch_mailbox_t write_batch_mailbox_;
+
     scoped_ptr_t<registrant_t<listener_business_card_t<protocol_t> > > registrant_;
 
     DISABLE_COPYING(listener_t);
@@ -4,6 +4,7 @@
 
 #include <map>
 #include <utility>
+#include <vector>
 
 #include "clustering/generic/registration_metadata.hpp"
 #include "clustering/immediate_consistency/branch/history.hpp"
@@ -17,6 +18,7 @@
 #include "timestamps.hpp"
 
 template <class> class listener_intro_t;
+template <class> class listener_batched_write_t;
 
 /* Every `listener_t` constructs a `listener_business_card_t` and sends it to
 the `broadcaster_t`. */
@@ -41,6 +43,11 @@ public:
                            mailbox_addr_t<void(typename protocol_t::write_response_t)>,
                            write_durability_t)> writeread_mailbox_t;
 
+    /* The master batches up writes and write-reads that it starts at about the
+    same time, and sends them to `write_batch_mailbox` as one message. Each of
+    them is acknowledged on its own. */
+    typedef mailbox_t<void(std::vector<listener_batched_write_t<protocol_t> >)> write_batch_mailbox_t;
+
     typedef mailbox_t<void(typename protocol_t::read_t,
                            state_timestamp_t,
                            order_token_t,
@@ -61,13 +68,48 @@ public:
 
     listener_business_card_t() { }
     listener_business_card_t(const typename intro_mailbox_t::address_t &im,
-                             const typename write_mailbox_t::address_t &wm)
-        : intro_mailbox(im), write_mailbox(wm) { }
+                             const typename write_mailbox_t::address_t &wm,
+                             const typename write_batch_mailbox_t::address_t &wbm)
+        : intro_mailbox(im), write_mailbox(wm), write_batch_mailbox(wbm) { }
 
     typename intro_mailbox_t::address_t intro_mailbox;
     typename write_mailbox_t::address_t write_mailbox;
+    typename write_batch_mailbox_t::address_t write_batch_mailbox;
+
+    RDB_MAKE_ME_SERIALIZABLE_3(intro_mailbox, write_mailbox, write_batch_mailbox);
+};
 
-    RDB_MAKE_ME_SERIALIZABLE_2(intro_mailbox, write_mailbox);
+/* One write in a batch sent to a `write_batch_mailbox`. A plain write, which
+the mirror only acknowledges, has an `ack_addr`; a write-read, which the mirror
+answers once the write is as durable as `durability` asks, has a
+`response_addr`. */
+template <class protocol_t>
+class listener_batched_write_t {
+public:
+    listener_batched_write_t() { }
+    listener_batched_write_t(const typename protocol_t::write_t &w,
+                             transition_timestamp_t ts,
+                             order_token_t ot,
+                             fifo_enforcer_write_token_t ft,
+                             mailbox_addr_t<void()> aa,
+                             mailbox_addr_t<void(typename protocol_t::write_response_t)> ra,
+                             write_durability_t d)
+        : write(w), timestamp(ts), order_token(ot), fifo_token(ft),
+          ack_addr(aa), response_addr(ra), durability(d) { }
+
+    bool is_writeread() const {
+        return !response_addr.is_nil();
+    }
+
+    typename protocol_t::write_t write;
+    transition_timestamp_t timestamp;
+    order_token_t order_token;
+    fifo_enforcer_write_token_t fifo_token;
+    mailbox_addr_t<void()> ack_addr;
+    mailbox_addr_t<void(typename protocol_t::write_response_t)> response_addr;
+    write_durability_t durability;
+
+    RDB_MAKE_ME_SERIALIZABLE_7(write, timestamp, order_token, fifo_token, ack_addr, response_addr, durability);
 };
 
 
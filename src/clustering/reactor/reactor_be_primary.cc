@@ -1,6 +1,7 @@
 // Copyright 2010-2013 RethinkDB, all rights reserved.
 #include "clustering/reactor/reactor.hpp"
 
+#include <algorithm>
 #include <exception>
 #include <vector>
 
@@ -15,6 +16,7 @@
 #include "clustering/immediate_consistency/query/direct_reader.hpp"
 #include "concurrency/cross_thread_signal.hpp"
 #include "concurrency/cross_thread_watchable.hpp"
+#include "config/args.hpp"
 
 template <class protocol_t>
 reactor_t<protocol_t>::backfill_candidate_t::backfill_candidate_t(version_range_t _version_range, std::vector<backfill_location_t> _places_to_get_this_version, bool _present_in_our_store)
@@ -349,23 +351,37 @@ bool reactor_t<protocol_t>::attempt_backfill_from_peers(directory_entry_t *direc
         if (it->second.present_in_our_store) {
             continue;
         } else {
-            backfill_session_id_t backfill_session_id = generate_uuid();
-            promise_t<bool> *p = new promise_t<bool>;
-            promises.push_back(p);
-            coro_t::spawn_sometime(boost::bind(&do_backfill<protocol_t>,
-                                               mailbox_manager,
-                                               branch_history_manager,
-                                               svs,
-                                               it->first,
-                                               it->second.places_to_get_this_version[0].backfiller,
-                                               backfill_session_id,
-                                               p,
-                                               interruptor));
-            reactor_business_card_details::backfill_location_t backfill_location(backfill_session_id,
-                                                                                 it->second.places_to_get_this_version[0].peer_id,
-                                                                                 it->second.places_to_get_this_version[0].activity_id);
-
-            backfills.push_back(backfill_location);
+            /* Every place in `places_to_get_this_version` has the version we
+             * want, so rather than streaming the whole region from one peer we
+             * split it by key and backfill the parts from different peers at
+             * the same time. (We're already split by hash; backfills of
+             * different parts of the hash space into the same store would
+             * step on each other's range deletions.) If a part fails, the
+             * next attempt finds the other parts up to date and skips them. */
+            const std::vector<typename backfill_candidate_t::backfill_location_t> &sources = it->second.places_to_get_this_version;
+            const std::vector<typename protocol_t::region_t> parts
+                = region_split_by_keys(it->first, std::min<int>(sources.size(), BACKFILL_MAX_SOURCES));
+            guarantee(parts.size() <= sources.size());
+
+            for (size_t i = 0; i < parts.size(); ++i) {
+                backfill_session_id_t backfill_session_id = generate_uuid();
+                promise_t<bool> *p = new promise_t<bool>;
+                promises.push_back(p);
+                coro_t::spawn_sometime(boost::bind(&do_backfill<protocol_t>,
+                                                   mailbox_manager,
+                                                   branch_history_manager,
+                                                   svs,
+                                                   parts[i],
+                                                   sources[i].backfiller,
+                                                   backfill_session_id,
+                                                   p,
+                                                   interruptor));
+                reactor_business_card_details::backfill_location_t backfill_location(backfill_session_id,
+                                                                                     sources[i].peer_id,
+                                                                                     sources[i].activity_id);
+
+                backfills.push_back(backfill_location);
+            }
         }
     }
 
@@ -12,6 +12,7 @@
 #include "concurrency/queue/passive_producer.hpp"
 #include "concurrency/wait_any.hpp"
 #include "containers/disk_backed_queue.hpp"
+#include "containers/segmented_log_queue.hpp"
 
 /* `disk_backed_queue_t` can't be used directly as a `passive_producer_t`
 because its `pop()` method can sometimes block, and `passive_producer_t`'s
@@ -22,9 +23,12 @@ a `passive_producer_t`.
 Note that it may sometimes indicate that no data is available even when the
 queue is not empty. This happens when we cannot read data from disk fast enough
 to keep up with the consumer. In this case, we will become available again when
-we have loaded the data into memory. */
+we have loaded the data into memory.
 
-template<class T>
+`disk_queue_t` is the queue that takes the overflow: `disk_backed_queue_t<T>`,
+or the lighter `segmented_log_queue_t<T>`. */
+
+template <class T, class disk_queue_t = disk_backed_queue_t<T> >
 class disk_backed_queue_wrapper_t : public passive_producer_t<T> {
 public:
     static const int memory_queue_capacity = 1000;
@@ -51,15 +55,15 @@ public:
             if (restart_copy_coro) {
                 restart_copy_coro = false;
                 coro_t::spawn_sometime(boost::bind(
-                    &disk_backed_queue_wrapper_t<T>::copy_from_disk_queue_to_memory_queue,
+                    &disk_backed_queue_wrapper_t::copy_from_disk_queue_to_memory_queue,
                     this, auto_drainer_t::lock_t(&drainer)));
             }
         } else {
             if (memory_queue.full()) {
-                disk_queue.init(new disk_backed_queue_t<T>(io_backender, filename, stats_parent));
+                disk_queue.init(new disk_queue_t(io_backender, filename, stats_parent));
                 disk_queue->push(value);
                 coro_t::spawn_sometime(boost::bind(
-                    &disk_backed_queue_wrapper_t<T>::copy_from_disk_queue_to_memory_queue,
+                    &disk_backed_queue_wrapper_t::copy_from_disk_queue_to_memory_queue,
                     this, auto_drainer_t::lock_t(&drainer)));
             } else {
                 memory_queue.push_back(value);
@@ -119,7 +123,7 @@ private:
 
     availability_control_t available_control;
     mutex_t push_mutex;
-    scoped_ptr_t<disk_backed_queue_t<T> > disk_queue;
+    scoped_ptr_t<disk_queue_t> disk_queue;
     boost::circular_buffer_space_optimized<T> memory_queue;
     cond_t *notify_when_room_in_memory_queue;
     size_t items_in_queue;
@@ -157,6 +157,10 @@ void adjustable_semaphore_t::set_capacity(int new_capacity) {
     pump();
 }
 
+bool adjustable_semaphore_t::can_lock_now(int count) const {
+    return current + count <= capacity || capacity == SEMAPHORE_NO_LIMIT || trickle_points >= count;
+}
+
 bool adjustable_semaphore_t::try_lock(int count) {
     if (current + count > capacity && capacity != SEMAPHORE_NO_LIMIT) {
         if (trickle_points >= count) {
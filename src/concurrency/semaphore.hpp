@@ -98,6 +98,10 @@ public:
 
     void set_capacity(int new_capacity);
 
+    /* Whether `lock(count)` would get the lock right away instead of waiting.
+    Doesn't take anything. */
+    bool can_lock_now(int count = 1) const;
+
 private:
     bool try_lock(int count);
 
@@ -82,10 +82,66 @@
 // Max number of blocks which can be read ahead in one i/o transaction (if enabled)
 #define MAX_READ_AHEAD_BLOCKS 32
 
-// Ratio of free ram to use for the cache by default
-// TODO: DEFAULT_MAX_CACHE_RATIO is unused. Should it be deleted?
+// When the reads on a file account walk forward through the file, the serializer reads
+// ahead of them in windows that start at MAX_READ_AHEAD_BLOCKS blocks and double up to
+// this many blocks, once the run is this many reads long
+#define MAX_SEQUENTIAL_READ_AHEAD_BLOCKS 256
+#define SEQUENTIAL_READ_AHEAD_MIN_RUN 2
+
+// How many file accounts the serializer follows sequential reads on at once
+#define MAX_SEQUENTIAL_READ_DETECTORS 64
+
+// Ratio of physical memory to use for the caches by default
 #define DEFAULT_MAX_CACHE_RATIO                   0.5
 
+// How often (in milliseconds) the cache balancer redistributes memory between the caches
+#define CACHE_BALANCER_INTERVAL_MS                1000
+
+// The cache balancer doesn't shrink a cache below this size, unless the total budget is
+// too small to give every cache that much
+#define CACHE_BALANCER_MIN_CACHE_SIZE             (8 * MEGABYTE)
+
+// How often (in milliseconds) each machine samples its stats into its stat history, and
+// how many samples it keeps, by default (see `--stats-interval` and `--stats-history`)
+#define DEFAULT_STAT_HISTORY_INTERVAL_MS          1000
+#define DEFAULT_STAT_HISTORY_SAMPLES              600
+
+// Each store records the key of one in this many reads and writes for its range heat
+// sketch, and keeps at most this many of those samples between two collections
+#define RANGE_HEAT_SAMPLE_RATE                    16
+#define RANGE_HEAT_MAX_SAMPLES                    256
+
+// How often (in milliseconds) each machine looks for hot shards it is the primary of
+#define HEAT_BALANCER_INTERVAL_MS                 (60 * 1000)
+
+// A shard is hot when it gets at least this many operations per second, and a share of
+// its table's load that is at least this factor times an even share
+#define HEAT_BALANCER_MIN_OPS_PER_SEC             1000
+#define HEAT_BALANCER_IMBALANCE_FACTOR            1.5
+
+// Tables aren't split automatically beyond this many shards, and a table that was just
+// split is left alone for this many intervals while it backfills
+#define HEAT_BALANCER_MAX_SHARDS                  32
+#define HEAT_BALANCER_COOLDOWN_INTERVALS          10
+
+// Store introspection walks at most this many of a btree's internal nodes, and lets
+// other coroutines run after every this many
+#define BTREE_INTROSPECTION_MAX_NODES             4096
+#define BTREE_INTROSPECTION_NODES_PER_YIELD       64
+
+// A primary that needs data backfills its region from at most this many of the peers that
+// have the latest version of it, each sending a part of the region's key range
+#define BACKFILL_MAX_SOURCES                      4
+
+// A broadcaster sends a mirror at most this many writes in one message
+#define BROADCASTER_WRITE_BATCH_MAX_WRITES        64
+
+// A segmented log queue writes its records out this many bytes at a time, and
+// keeps at most two such chunks in memory
+#define SEGMENTED_LOG_QUEUE_CHUNK_SIZE            MEGABYTE
+// ...and closes its files after this many chunks, once they've been popped
+#define SEGMENTED_LOG_QUEUE_CHUNKS_PER_SEGMENT    32
+
 
 // Maximum number of threads we support
 // TODO: make this dynamic where possible
@@ -120,6 +176,18 @@
 // then the page replacement algorithm will on average be unable to evict pages from the cache.
 #define PAGE_REPL_NUM_TRIES                       10
 
+// Blocks that are being prefetched may take up at most this fraction (as 1/n) of a cache
+#define MAX_PREFETCH_CACHE_FRACTION               16
+
+// Each cache saves the list of the blocks it holds this often (in milliseconds), and
+// after a restart it loads them back this many at a time, with the given IO priority
+#define CACHE_HOT_LIST_SAVE_INTERVAL_MS           (5 * 60 * 1000)
+#define CACHE_PREWARM_BATCH_BLOCKS                64
+#define CACHE_PREWARM_IO_PRIORITY                 16
+
+// How many children ahead of the one it is in a depth-first btree traversal prefetches
+#define DEFAULT_TRAVERSAL_PREFETCH_WINDOW         8
+
 // How large can the key be, in bytes?  This value needs to fit in a byte.
 #define MAX_KEY_SIZE                              250
 
@@ -131,8 +199,17 @@
 // memcached specifies the maximum value size to be 1MB, but customers asked this to be much higher
 #define MAX_VALUE_SIZE                            (10 * MEGABYTE)
 
-// Values larger than this will be streamed in a get operation
-#define MAX_BUFFERED_GET_SIZE                     MAX_VALUE_SIZE // streaming is too slow for now, so we disable it completely
+// Values larger than this will be written straight from the value's buffer in a get
+// operation, rather than copied through the connection's write buffer
+#define MAX_BUFFERED_GET_SIZE                     (64 * KILOBYTE)
+
+// How many blocks of a large value a get acquires at once, while it copies the value
+#define MEMCACHED_GET_CHUNK_BLOCKS                8
+
+// How many bytes of values of at least MAX_BUFFERED_GET_SIZE the gets on one thread
+// may have copied out at once; further gets of large values wait for those copies
+// to be sent off and freed
+#define MEMCACHED_LARGE_GET_MEMORY_LIMIT          (64 * MEGABYTE)
 
 // If a single connection sends this many 'noreply' commands, the next command will
 // have to wait until the first one finishes
@@ -210,6 +287,17 @@
 
 #define MAX_COROS_PER_THREAD                      10000
 
+// How many compiled ReQL query plans each thread keeps around for queries of the
+// same shape (see rdb_protocol/plan_cache.hpp).
+#define QUERY_PLAN_CACHE_SIZE                     256
+
+// How deeply arrays and objects can nest in JSON that `ql::read_json` accepts.
+// Datums are destroyed, compared and printed recursively on coroutine stacks
+// (see COROUTINE_STACK_SIZE), so they can't be arbitrarily deep.  This is the
+// same as protocol buffers' default recursion limit, which already bounds the
+// datums clients send.
+#define JSON_READER_MAX_NESTING_DEPTH             100
+
 
 // Size of a cache line (used in cache_line_padded_t).
 #define CACHE_LINE_SIZE                           64
@@ -19,13 +19,15 @@ void debug_print(printf_buffer_t *buf, const counted_t<data_buffer_t>& ptr) {
     }
 }
 
-counted_t<data_buffer_t> data_buffer_t::create(int64_t size) {
-    static_assert(sizeof(data_buffer_t) == sizeof(ref_count_) + sizeof(size_),
+counted_t<data_buffer_t> data_buffer_t::create(int64_t size,
+                                               data_buffer_release_callback_t *release_callback) {
+    static_assert(sizeof(data_buffer_t) == sizeof(ref_count_) + sizeof(size_) + sizeof(release_callback_),
                   "data_buffer_t is not a packed struct type");
 
     rassert(size >= 0 && static_cast<uint64_t>(size) <= SIZE_MAX - sizeof(data_buffer_t));
     data_buffer_t *b = static_cast<data_buffer_t *>(malloc(sizeof(data_buffer_t) + size));
     b->ref_count_ = 0;
     b->size_ = size;
+    b->release_callback_ = release_callback;
     return counted_t<data_buffer_t>(b);
 }
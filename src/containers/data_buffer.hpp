@@ -7,10 +7,20 @@
 
 class printf_buffer_t;
 
+/* Lets whoever created a `data_buffer_t` find out when it's freed, which can
+happen on any thread. */
+class data_buffer_release_callback_t {
+public:
+    virtual void on_data_buffer_released(int64_t size) = 0;
+protected:
+    virtual ~data_buffer_release_callback_t() { }
+};
+
 struct data_buffer_t {
 private:
     intptr_t ref_count_;
     size_t size_;
+    data_buffer_release_callback_t *release_callback_;
     char bytes_[];
 
     friend void counted_add_ref(data_buffer_t *buffer);
@@ -21,10 +31,16 @@ private:
 public:
     static void destroy(data_buffer_t *p) {
         rassert(p->ref_count_ == 0);
+        data_buffer_release_callback_t *release_callback = p->release_callback_;
+        const int64_t size = p->size_;
         free(p);
+        if (release_callback != NULL) {
+            release_callback->on_data_buffer_released(size);
+        }
     }
 
-    static counted_t<data_buffer_t> create(int64_t size);
+    static counted_t<data_buffer_t> create(int64_t size,
+                                           data_buffer_release_callback_t *release_callback = NULL);
 
     char *buf() { return bytes_; }
     const char *buf() const { return bytes_; }
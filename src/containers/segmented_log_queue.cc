@@ -0,0 +1,177 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include "containers/segmented_log_queue.hpp"
+
+#include <inttypes.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "arch/arch.hpp"
+#include "arch/io/disk.hpp"
+#include "config/args.hpp"
+
+static const int64_t SEGMENT_SIZE = SEGMENTED_LOG_QUEUE_CHUNK_SIZE * SEGMENTED_LOG_QUEUE_CHUNKS_PER_SEGMENT;
+
+internal_segmented_log_queue_t::internal_segmented_log_queue_t(io_backender_t *_io_backender,
+                                                               const serializer_filepath_t& filename,
+                                                               perfmon_collection_t *stats_parent)
+    : io_backender(_io_backender),
+      segment_path_prefix(filename.temporary_path()),
+      queue_size(0),
+      push_offset(0),
+      pop_offset(0),
+      tail_chunk(static_cast<char *>(malloc_aligned(SEGMENTED_LOG_QUEUE_CHUNK_SIZE, DEVICE_BLOCK_SIZE))),
+      head_chunk(NULL),
+      head_chunk_index(-1),
+      perfmon_membership(stats_parent, &perfmon_collection, filename.permanent_path().c_str()),
+      perfmon_counters_membership(&perfmon_collection,
+                                  &chunks_written, "chunks_written",
+                                  &chunks_read, "chunks_read",
+                                  NULL) { }
+
+internal_segmented_log_queue_t::~internal_segmented_log_queue_t() {
+    for (std::map<int64_t, file_t *>::iterator it = segments.begin(); it != segments.end(); ++it) {
+        delete it->second;
+    }
+    free(tail_chunk);
+    free(head_chunk);
+}
+
+void internal_segmented_log_queue_t::push(const write_message_t &wm) {
+    mutex_t::acq_t mutex_acq(&mutex);
+
+    intrusive_list_t<write_buffer_t> *buffers = const_cast<write_message_t &>(wm).unsafe_expose_buffers();
+    int64_t record_size = 0;
+    for (write_buffer_t *p = buffers->head(); p; p = buffers->next(p)) {
+        record_size += p->size;
+    }
+
+    append(&record_size, sizeof(record_size));
+    for (write_buffer_t *p = buffers->head(); p; p = buffers->next(p)) {
+        append(p->data, p->size);
+    }
+
+    queue_size++;
+}
+
+void internal_segmented_log_queue_t::pop(std::vector<char> *buf_out) {
+    guarantee(size() != 0);
+    mutex_t::acq_t mutex_acq(&mutex);
+
+    int64_t record_size;
+    read(&record_size, sizeof(record_size));
+    guarantee(record_size >= 0, "corruption in segmented log queue");
+    std::vector<char> data_vec(record_size);
+    read(data_vec.data(), record_size);
+
+    queue_size--;
+
+    close_consumed_segments();
+
+    buf_out->swap(data_vec);
+}
+
+bool internal_segmented_log_queue_t::empty() {
+    return queue_size == 0;
+}
+
+int64_t internal_segmented_log_queue_t::size() {
+    return queue_size;
+}
+
+void internal_segmented_log_queue_t::append(const void *data, int64_t n) {
+    const char *p = static_cast<const char *>(data);
+    while (n > 0) {
+        const int64_t offset_in_chunk = push_offset % SEGMENTED_LOG_QUEUE_CHUNK_SIZE;
+        const int64_t count = std::min<int64_t>(n, SEGMENTED_LOG_QUEUE_CHUNK_SIZE - offset_in_chunk);
+        memcpy(tail_chunk + offset_in_chunk, p, count);
+        p += count;
+        n -= count;
+        push_offset += count;
+
+        if (push_offset % SEGMENTED_LOG_QUEUE_CHUNK_SIZE == 0) {
+            write_tail_chunk(push_offset / SEGMENTED_LOG_QUEUE_CHUNK_SIZE - 1);
+        }
+    }
+}
+
+void internal_segmented_log_queue_t::read(void *out, int64_t n) {
+    guarantee(pop_offset + n <= push_offset);
+    char *p = static_cast<char *>(out);
+    while (n > 0) {
+        const int64_t chunk = pop_offset / SEGMENTED_LOG_QUEUE_CHUNK_SIZE;
+        const int64_t offset_in_chunk = pop_offset % SEGMENTED_LOG_QUEUE_CHUNK_SIZE;
+        const int64_t count = std::min<int64_t>(n, SEGMENTED_LOG_QUEUE_CHUNK_SIZE - offset_in_chunk);
+
+        const char *source;
+        if (chunk == push_offset / SEGMENTED_LOG_QUEUE_CHUNK_SIZE) {
+            source = tail_chunk;
+        } else {
+            if (chunk != head_chunk_index) {
+                load_head_chunk(chunk);
+            }
+            source = head_chunk;
+        }
+        memcpy(p, source + offset_in_chunk, count);
+        p += count;
+        n -= count;
+        pop_offset += count;
+    }
+}
+
+void internal_segmented_log_queue_t::write_tail_chunk(int64_t chunk) {
+    if (pop_offset >= (chunk + 1) * SEGMENTED_LOG_QUEUE_CHUNK_SIZE) {
+        // Everything in it has been popped already.
+        return;
+    }
+
+    const int64_t segment = chunk / SEGMENTED_LOG_QUEUE_CHUNKS_PER_SEGMENT;
+    std::map<int64_t, file_t *>::iterator it = segments.find(segment);
+    if (it == segments.end()) {
+        const std::string path = strprintf("%s.%" PRIi64, segment_path_prefix.c_str(), segment);
+        scoped_ptr_t<file_t> file;
+        const file_open_result_t res = open_direct_file(path.c_str(),
+                                                        linux_file_t::mode_read | linux_file_t::mode_write
+                                                        | linux_file_t::mode_create | linux_file_t::mode_truncate,
+                                                        io_backender,
+                                                        &file);
+        if (res.outcome == file_open_result_t::ERROR) {
+            crash_due_to_inaccessible_database_file(path.c_str(), res);
+        }
+
+        /* Nobody else needs to see the file, and this way it goes away when we
+        close it or crash. */
+        const int unlink_res = ::unlink(path.c_str());
+        guarantee_err(unlink_res == 0, "unlink() failed");
+
+        file->set_size(SEGMENT_SIZE);
+        it = segments.insert(std::make_pair(segment, file.release())).first;
+    }
+
+    const int64_t offset_in_segment = (chunk % SEGMENTED_LOG_QUEUE_CHUNKS_PER_SEGMENT) * SEGMENTED_LOG_QUEUE_CHUNK_SIZE;
+    co_write(it->second, offset_in_segment, SEGMENTED_LOG_QUEUE_CHUNK_SIZE, tail_chunk, DEFAULT_DISK_ACCOUNT);
+    ++chunks_written;
+}
+
+void internal_segmented_log_queue_t::load_head_chunk(int64_t chunk) {
+    const int64_t segment = chunk / SEGMENTED_LOG_QUEUE_CHUNKS_PER_SEGMENT;
+    std::map<int64_t, file_t *>::iterator it = segments.find(segment);
+    guarantee(it != segments.end());
+
+    if (head_chunk == NULL) {
+        head_chunk = static_cast<char *>(malloc_aligned(SEGMENTED_LOG_QUEUE_CHUNK_SIZE, DEVICE_BLOCK_SIZE));
+    }
+    const int64_t offset_in_segment = (chunk % SEGMENTED_LOG_QUEUE_CHUNKS_PER_SEGMENT) * SEGMENTED_LOG_QUEUE_CHUNK_SIZE;
+    co_read(it->second, offset_in_segment, SEGMENTED_LOG_QUEUE_CHUNK_SIZE, head_chunk, DEFAULT_DISK_ACCOUNT);
+    head_chunk_index = chunk;
+    ++chunks_read;
+}
+
+void internal_segmented_log_queue_t::close_consumed_segments() {
+    const int64_t first_live_segment = pop_offset / SEGMENT_SIZE;
+    while (!segments.empty() && segments.begin()->first < first_live_segment) {
+        delete segments.begin()->second;
+        segments.erase(segments.begin());
+    }
+}
@@ -0,0 +1,113 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#ifndef CONTAINERS_SEGMENTED_LOG_QUEUE_HPP_
+#define CONTAINERS_SEGMENTED_LOG_QUEUE_HPP_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "concurrency/mutex.hpp"
+#include "containers/archive/vector_stream.hpp"
+#include "perfmon/perfmon.hpp"
+#include "serializer/types.hpp"
+
+class file_t;
+class io_backender_t;
+
+/* A lighter alternative to `internal_disk_backed_queue_t`, with the same
+interface.  Instead of a serializer and a cache of its own, it appends each
+record (its size, then its serialized bytes) to an in-memory tail chunk of
+`SEGMENTED_LOG_QUEUE_CHUNK_SIZE` bytes, and writes the chunk out in one
+sequential write when it fills up.  The chunks go into segment files of
+`SEGMENTED_LOG_QUEUE_CHUNKS_PER_SEGMENT` chunks each.  Pops read a chunk at a
+time into an in-memory head chunk, or straight from the tail chunk once they
+catch up with the pushes.  A segment file is closed as soon as everything in it
+has been popped; the files are unlinked as soon as they are created, so that
+frees its space, as does a crash.
+
+A chunk that has been popped entirely by the time it fills up is never written
+at all, so a queue whose consumer keeps up never touches the disk. */
+class internal_segmented_log_queue_t {
+public:
+    internal_segmented_log_queue_t(io_backender_t *io_backender, const serializer_filepath_t& filename, perfmon_collection_t *stats_parent);
+    ~internal_segmented_log_queue_t();
+
+    void push(const write_message_t &value);
+
+    void pop(std::vector<char> *buf_out);
+
+    bool empty();
+
+    int64_t size();
+
+private:
+    void append(const void *data, int64_t n);
+    void read(void *out, int64_t n);
+
+    // Writes out the tail chunk, which has just filled up.
+    void write_tail_chunk(int64_t chunk);
+    void load_head_chunk(int64_t chunk);
+    void close_consumed_segments();
+
+    io_backender_t *const io_backender;
+    const std::string segment_path_prefix;
+
+    mutex_t mutex;
+    int64_t queue_size;
+
+    // Byte offsets in the log of everything ever pushed.
+    int64_t push_offset, pop_offset;
+
+    // Holds the chunk `push_offset` is in.
+    char *tail_chunk;
+    // Holds chunk `head_chunk_index` (if it isn't -1), which has been written out.
+    char *head_chunk;
+    int64_t head_chunk_index;
+
+    // The open segment files, by segment index.
+    std::map<int64_t, file_t *> segments;
+
+    perfmon_collection_t perfmon_collection;
+    perfmon_membership_t perfmon_membership;
+    perfmon_counter_t chunks_written, chunks_read;
+    perfmon_multi_membership_t perfmon_counters_membership;
+
+    DISABLE_COPYING(internal_segmented_log_queue_t);
+};
+
+template <class T>
+class segmented_log_queue_t {
+public:
+    segmented_log_queue_t(io_backender_t *io_backender, const serializer_filepath_t& filename, perfmon_collection_t *stats_parent)
+        : internal_(io_backender, filename, stats_parent) { }
+
+    void push(const T &t) {
+        write_message_t wm;
+        wm << t;
+        internal_.push(wm);
+    }
+
+    void pop(T *out) {
+        std::vector<char> data_vec;
+
+        internal_.pop(&data_vec);
+
+        vector_read_stream_t read_stream(&data_vec);
+        int res = deserialize(&read_stream, out);
+        guarantee_err(res == 0, "corruption in segmented log queue");
+    }
+
+    bool empty() {
+        return internal_.empty();
+    }
+
+    int64_t size() {
+        return internal_.size();
+    }
+
+private:
+    internal_segmented_log_queue_t internal_;
+    DISABLE_COPYING(segmented_log_queue_t);
+};
+
+#endif  // CONTAINERS_SEGMENTED_LOG_QUEUE_HPP_
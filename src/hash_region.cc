@@ -240,3 +240,66 @@ bool region_contains_key(const hash_region_t<key_range_t> &region, const store_k
     const uint64_t hash_value = hash_region_hasher(key.contents(), key.size());
     return region_contains_key_with_precomputed_hash(region, key, hash_value);
 }
+
+// The two bytes of `key` after the first `prefix` bytes, as a number, with
+// missing bytes counting as zero.
+static uint32_t key_digits_after(const store_key_t &key, int prefix) {
+    uint32_t res = 0;
+    for (int i = prefix; i < prefix + 2; ++i) {
+        res = (res << 8) | (i < key.size() ? key.contents()[i] : 0);
+    }
+    return res;
+}
+
+std::vector< hash_region_t<key_range_t> > region_split_by_keys(const hash_region_t<key_range_t> &region, int n) {
+    guarantee(n >= 1);
+    std::vector< hash_region_t<key_range_t> > res;
+    if (region_is_empty(region)) {
+        return res;
+    }
+
+    const store_key_t &left = region.inner.left;
+    const key_range_t::right_bound_t &right = region.inner.right;
+
+    /* The split points share the common prefix of the bounds, followed by two
+    bytes that lie between theirs. */
+    int prefix = 0;
+    if (!right.unbounded) {
+        while (prefix < left.size() && prefix < right.key.size()
+               && left.contents()[prefix] == right.key.contents()[prefix]) {
+            ++prefix;
+        }
+    }
+    if (prefix + 2 > MAX_KEY_SIZE) {
+        res.push_back(region);
+        return res;
+    }
+
+    const uint32_t lo = key_digits_after(left, prefix);
+    const uint32_t hi = right.unbounded ? 0x10000 : key_digits_after(right.key, prefix);
+    rassert(lo <= hi);
+
+    uint8_t buf[MAX_KEY_SIZE];
+    memcpy(buf, left.contents(), prefix);
+    store_key_t part_left = left;
+    uint32_t last_point = lo;
+    for (int i = 1; i < n; ++i) {
+        const uint32_t point = lo + static_cast<uint64_t>(hi - lo) * i / n;
+        if (point <= last_point) {
+            continue;
+        }
+        buf[prefix] = point >> 8;
+        buf[prefix + 1] = point & 0xff;
+        const store_key_t split(prefix + 2, buf);
+        res.push_back(hash_region_t<key_range_t>(region.beg, region.end,
+                                                 key_range_t(key_range_t::closed, part_left,
+                                                             key_range_t::open, split)));
+        part_left = split;
+        last_point = point;
+    }
+
+    key_range_t last = region.inner;
+    last.left = part_left;
+    res.push_back(hash_region_t<key_range_t>(region.beg, region.end, last));
+    return res;
+}
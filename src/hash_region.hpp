@@ -134,6 +134,13 @@ bool region_contains_key_with_precomputed_hash(const hash_region_t<key_range_t>
 
 bool region_contains_key(const hash_region_t<key_range_t> &region, const store_key_t &key);
 
+// Splits `region` along the key dimension into at most `n` non-empty regions
+// with its hash interval, cutting at evenly spaced points of the key space
+// between its bounds.  Used to spread a backfill over several peers; unlike the
+// hash dimension, parts of a key range can be backfilled into the same store
+// concurrently.
+std::vector< hash_region_t<key_range_t> > region_split_by_keys(const hash_region_t<key_range_t> &region, int n);
+
 template <class inner_region_t>
 bool region_overlaps(const hash_region_t<inner_region_t> &r1, const hash_region_t<inner_region_t> &r2) {
     return r1.beg < r2.end && r2.beg < r1.end
@@ -1,25 +1,78 @@
 // Copyright 2010-2012 RethinkDB, all rights reserved.
 #include "memcached/memcached_btree/btree_data_provider.hpp"
 
+#include <algorithm>
+
+#include "errors.hpp"
+#include <boost/bind.hpp>
+
 #include "buffer_cache/blob.hpp"
 #include "buffer_cache/buffer_cache.hpp"
 #include "containers/buffer_group.hpp"
-#include "containers/data_buffer.hpp"
+#include "do_on_thread.hpp"
 #include "memcached/memcached_btree/value.hpp"
 
-counted_t<data_buffer_t> value_to_data_buffer(const memcached_value_t *value, transaction_t *txn) {
+// The semaphore counts kilobytes, so that the budget fits in an `int`.
+large_value_budget_t::large_value_budget_t(int64_t limit)
+    : capacity(std::max<int64_t>(1, limit / KILOBYTE)), semaphore(capacity) { }
+
+int large_value_budget_t::units(int64_t size) const {
+    return std::max<int64_t>(1, std::min<int64_t>(capacity, ceil_divide(size, KILOBYTE)));
+}
+
+void large_value_budget_t::acquire(int64_t size) {
+    assert_thread();
+    semaphore.co_lock(units(size));
+}
+
+void large_value_budget_t::on_data_buffer_released(int64_t size) {
+    do_on_thread(home_thread(), boost::bind(&large_value_budget_t::release_units, this, units(size)));
+}
+
+void large_value_budget_t::release_units(int count) {
+    assert_thread();
+    semaphore.unlock(count);
+}
+
+// Budgets are never freed, since buffers charged to them can be freed late.
+static __thread large_value_budget_t *thread_large_value_budget = NULL;
+
+large_value_budget_t *get_thread_large_value_budget() {
+    if (thread_large_value_budget == NULL) {
+        thread_large_value_budget = new large_value_budget_t(MEMCACHED_LARGE_GET_MEMORY_LIMIT);
+    }
+    return thread_large_value_budget;
+}
+
+counted_t<data_buffer_t> value_to_data_buffer(const memcached_value_t *value, transaction_t *txn,
+                                              large_value_budget_t *budget) {
     txn->assert_thread();
 
     blob_t blob(const_cast<memcached_value_t *>(value)->value_ref(), blob::btree_maxreflen);
 
-    buffer_group_t group;
-    blob_acq_t acqs;
-    blob.expose_region(txn, rwi_read_outdated_ok, 0, blob.valuesize(), &group, &acqs);
-    size_t sz = group.get_size();
-    counted_t<data_buffer_t> ret = data_buffer_t::create(sz);
-    buffer_group_t tmp;
-    tmp.add_buffer(sz, ret->buf());
-    buffer_group_copy_data(&tmp, const_view(&group));
+    const int64_t size = blob.valuesize();
+    if (budget != NULL && size >= MAX_BUFFERED_GET_SIZE) {
+        budget->acquire(size);
+    } else {
+        budget = NULL;
+    }
+    counted_t<data_buffer_t> ret = data_buffer_t::create(size, budget);
+
+    /* We copy the value a few blocks at a time, and release each chunk's blocks
+    before we acquire the next ones, so that a get of a large value doesn't hold
+    on to all of its blocks at once. */
+    const int64_t chunk_size = MEMCACHED_GET_CHUNK_BLOCKS
+        * static_cast<int64_t>(txn->get_cache()->get_block_size().value());
+    for (int64_t offset = 0; offset < size; offset += chunk_size) {
+        const int64_t n = std::min(chunk_size, size - offset);
+        buffer_group_t group;
+        blob_acq_t acqs;
+        blob.expose_region(txn, rwi_read_outdated_ok, offset, n, &group, &acqs);
+        rassert(static_cast<int64_t>(group.get_size()) == n);
+        buffer_group_t tmp;
+        tmp.add_buffer(n, ret->buf() + offset);
+        buffer_group_copy_data(&tmp, const_view(&group));
+    }
 
     return ret;
 }
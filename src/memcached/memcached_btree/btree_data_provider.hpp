@@ -3,11 +3,45 @@
 #define MEMCACHED_MEMCACHED_BTREE_BTREE_DATA_PROVIDER_HPP_
 
 #include "buffer_cache/types.hpp"
+#include "concurrency/semaphore.hpp"
 #include "containers/counted.hpp"
+#include "containers/data_buffer.hpp"
 
 struct memcached_value_t;
-struct data_buffer_t;
 
-counted_t<data_buffer_t> value_to_data_buffer(const memcached_value_t *value, transaction_t *transaction);
+/* Limits how many bytes of large values the gets on one thread hold in memory
+at once.  A get of a value of at least `MAX_BUFFERED_GET_SIZE` takes the value's
+size out of the budget before copying it, and gives it back when the copy is
+freed, after the response has been sent off.  Smaller values don't count. */
+class large_value_budget_t : public data_buffer_release_callback_t, public home_thread_mixin_t {
+public:
+    explicit large_value_budget_t(int64_t limit);
+
+    // Waits until `size` bytes fit in the budget and takes them.  A value
+    // bigger than the whole budget only has to wait until nothing else holds
+    // any of it.
+    void acquire(int64_t size);
+
+    // Gives `size` bytes back; it can be called on any thread.
+    void on_data_buffer_released(int64_t size);
+
+private:
+    int units(int64_t size) const;
+    void release_units(int count);
+
+    const int capacity;
+    semaphore_t semaphore;
+
+    DISABLE_COPYING(large_value_budget_t);
+};
+
+// The budget that the gets on the current thread share, which has
+// `MEMCACHED_LARGE_GET_MEMORY_LIMIT` bytes.
+large_value_budget_t *get_thread_large_value_budget();
+
+// Copies the value out of the blob.  If `budget` isn't NULL, a large value's
+// copy is charged to it.
+counted_t<data_buffer_t> value_to_data_buffer(const memcached_value_t *value, transaction_t *transaction,
+                                              large_value_budget_t *budget = NULL);
 
 #endif // MEMCACHED_MEMCACHED_BTREE_BTREE_DATA_PROVIDER_HPP_
@@ -23,7 +23,7 @@ get_result_t memcached_get(const store_key_t &store_key, btree_slice_t *slice, e
         return get_result_t();
     }
 
-    counted_t<data_buffer_t> dp = value_to_data_buffer(value, txn);
+    counted_t<data_buffer_t> dp = value_to_data_buffer(value, txn, get_thread_large_value_budget());
 
     return get_result_t(dp, value->mcflags(), 0);
 }
@@ -99,6 +99,8 @@ struct txt_memcached_handler_t : public home_thread_mixin_debug_only_t {
     }
 
     void write_from_data_provider(data_buffer_t *dp) THROWS_NOTHING {
+        // Large values go out straight from their buffer instead of being
+        // copied into the connection's write buffer first.
         if (dp->size() < MAX_BUFFERED_GET_SIZE) {
             write(dp->buf(), dp->size());
         } else {
@@ -16,6 +16,7 @@
 #include "containers/iterators.hpp"
 #include "containers/scoped.hpp"
 #include "memcached/memcached_btree/append_prepend.hpp"
+#include "memcached/memcached_btree/btree_data_provider.hpp"
 #include "memcached/memcached_btree/delete.hpp"
 #include "memcached/memcached_btree/distribution.hpp"
 #include "memcached/memcached_btree/erase_range.hpp"
@@ -717,6 +718,23 @@ void store_t::protocol_reset_data(const region_t& subregion,
     memcached_erase_range(btree, &key_tester, subregion.inner, txn, superblock, interruptor);
 }
 
+class memcached_snapshot_export_value_exporter_t : public snapshot_export_value_exporter_t {
+public:
+    snapshot_export_value_format_t value_format() const {
+        return SNAPSHOT_EXPORT_RAW_VALUES;
+    }
+    void export_value(transaction_t *txn, const void *value, std::string *out) {
+        counted_t<data_buffer_t> data
+            = value_to_data_buffer(static_cast<const memcached_value_t *>(value), txn);
+        out->assign(data->buf(), data->size());
+    }
+};
+
+snapshot_export_value_exporter_t *store_t::get_snapshot_export_value_exporter() {
+    static memcached_snapshot_export_value_exporter_t exporter;
+    return &exporter;
+}
+
 class generic_debug_print_visitor_t : public boost::static_visitor<void> {
 public:
     explicit generic_debug_print_visitor_t(printf_buffer_t *buf) : buf_(buf) { }
@@ -217,6 +217,8 @@ public:
                                  superblock_t *superblock,
                                  write_token_pair_t *token_pair,
                                  signal_t *interruptor);
+
+        snapshot_export_value_exporter_t *get_snapshot_export_value_exporter();
     };
 
 };
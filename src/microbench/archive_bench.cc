@@ -0,0 +1,75 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include <map>
+#include <string>
+#include <vector>
+
+#include "containers/archive/stl_types.hpp"
+#include "containers/archive/vector_stream.hpp"
+#include "microbench/microbench.hpp"
+
+namespace microbench {
+
+typedef std::map<std::string, std::vector<int64_t> > archive_bench_value_t;
+
+/* Something shaped like the metadata and messages that go through the
+archive code: a map with short string keys, each with a few numbers. */
+void make_archive_bench_value(archive_bench_value_t *value_out) {
+    rng_t rng;
+    for (int i = 0; i < 64; ++i) {
+        std::vector<int64_t> numbers;
+        for (int j = 0; j < 8; ++j) {
+            numbers.push_back(rng.next());
+        }
+        (*value_out)[strprintf("field_%d", i)] = numbers;
+    }
+}
+
+/* Serializes the value into a `write_message_t` and flattens it into a byte
+vector, which is what sending it over a connection or writing it to a disk
+backed queue does. */
+void bench_archive_serialize(int64_t iterations, stopwatch_t *stopwatch) {
+    archive_bench_value_t value;
+    make_archive_bench_value(&value);
+    size_t bytes = 0;
+    stopwatch->start();
+    for (int64_t i = 0; i < iterations; ++i) {
+        write_message_t msg;
+        msg << value;
+        vector_stream_t stream;
+        int res = send_write_message(&stream, &msg);
+        guarantee(res == 0);
+        bytes += stream.vector().size();
+    }
+    stopwatch->stop();
+    guarantee(bytes != 0);
+}
+
+void bench_archive_deserialize(int64_t iterations, stopwatch_t *stopwatch) {
+    std::vector<char> serialized;
+    {
+        archive_bench_value_t value;
+        make_archive_bench_value(&value);
+        write_message_t msg;
+        msg << value;
+        vector_stream_t stream;
+        int res = send_write_message(&stream, &msg);
+        guarantee(res == 0);
+        serialized = stream.vector();
+    }
+    size_t entries = 0;
+    stopwatch->start();
+    for (int64_t i = 0; i < iterations; ++i) {
+        vector_read_stream_t stream(&serialized);
+        archive_bench_value_t value;
+        archive_result_t res = deserialize(&stream, &value);
+        guarantee(res == ARCHIVE_SUCCESS);
+        entries += value.size();
+    }
+    stopwatch->stop();
+    guarantee(entries != 0);
+}
+
+static registration_t archive_serialize("archive.serialize", 100 * THOUSAND, &bench_archive_serialize);
+static registration_t archive_deserialize("archive.deserialize", 100 * THOUSAND, &bench_archive_deserialize);
+
+}  // namespace microbench
@@ -0,0 +1,92 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include <string.h>
+
+#include <vector>
+
+#include "buffer_cache/blob.hpp"
+#include "buffer_cache/buffer_cache.hpp"
+#include "containers/buffer_group.hpp"
+#include "microbench/microbench.hpp"
+
+namespace microbench {
+
+// The size of each append, and of each read.
+static const int64_t BLOB_BENCH_CHUNK_SIZE = 1000;
+
+void append_to_blob(transaction_t *txn, blob_t *blob, const std::vector<char> &data) {
+    const int64_t old_size = blob->valuesize();
+    blob->append_region(txn, data.size());
+    buffer_group_t group;
+    blob_acq_t acq;
+    blob->expose_region(txn, rwi_write, old_size, data.size(), &group, &acq);
+    buffer_group_copy_data(&group, data.data(), data.size());
+}
+
+void clear_blob(cache_t *cache, blob_t *blob) {
+    transaction_t txn(cache, rwi_write, 1, repli_timestamp_t::distant_past,
+                      order_token_t::ignore, WRITE_DURABILITY_SOFT);
+    blob->clear(&txn);
+}
+
+/* Appends to a blob stored the way a memcached value is, in a write transaction
+of its own each time.  The blob grows to many levels of blocks over the run. */
+void bench_blob_append(int64_t iterations, stopwatch_t *stopwatch) {
+    cache_fixture_t fixture(256 * MEGABYTE);
+    std::vector<char> ref(blob::btree_maxreflen, 0);
+    blob_t blob(ref.data(), blob::btree_maxreflen);
+    const std::vector<char> data(BLOB_BENCH_CHUNK_SIZE, 'a');
+
+    stopwatch->start();
+    for (int64_t i = 0; i < iterations; ++i) {
+        transaction_t txn(fixture.cache(), rwi_write, 2, repli_timestamp_t::distant_past,
+                          order_token_t::ignore, WRITE_DURABILITY_SOFT);
+        append_to_blob(&txn, &blob, data);
+    }
+    stopwatch->stop();
+
+    clear_blob(fixture.cache(), &blob);
+}
+
+/* Reads chunks from random offsets of a 4 MB blob that's all in the cache. */
+void bench_blob_read(int64_t iterations, stopwatch_t *stopwatch) {
+    static const int64_t blob_size = 4 * MEGABYTE;
+    cache_fixture_t fixture(256 * MEGABYTE);
+    std::vector<char> ref(blob::btree_maxreflen, 0);
+    blob_t blob(ref.data(), blob::btree_maxreflen);
+    {
+        transaction_t txn(fixture.cache(), rwi_write, 2, repli_timestamp_t::distant_past,
+                          order_token_t::ignore, WRITE_DURABILITY_SOFT);
+        append_to_blob(&txn, &blob, std::vector<char>(blob_size, 'a'));
+    }
+
+    std::vector<int64_t> offsets;
+    rng_t rng;
+    for (int i = 0; i < 1024; ++i) {
+        offsets.push_back(rng.next(blob_size - BLOB_BENCH_CHUNK_SIZE));
+    }
+
+    std::vector<char> out(BLOB_BENCH_CHUNK_SIZE);
+    stopwatch->start();
+    for (int64_t i = 0; i < iterations; ++i) {
+        transaction_t txn(fixture.cache(), rwi_read, order_token_t::ignore);
+        buffer_group_t group;
+        blob_acq_t acq;
+        blob.expose_region(&txn, rwi_read, offsets[i % offsets.size()], BLOB_BENCH_CHUNK_SIZE,
+                           &group, &acq);
+        char *p = out.data();
+        for (size_t j = 0; j < group.num_buffers(); ++j) {
+            const buffer_group_t::buffer_t buffer = group.get_buffer(j);
+            memcpy(p, buffer.data, buffer.size);
+            p += buffer.size;
+        }
+    }
+    stopwatch->stop();
+    guarantee(out[0] == 'a');
+
+    clear_blob(fixture.cache(), &blob);
+}
+
+static registration_t blob_append("blob.append", 20 * THOUSAND, &bench_blob_append);
+static registration_t blob_read("blob.read", 200 * THOUSAND, &bench_blob_read);
+
+}  // namespace microbench
@@ -0,0 +1,187 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include <string>
+#include <vector>
+
+#include "btree/internal_node.hpp"
+#include "btree/leaf_node.hpp"
+#include "btree/node.hpp"
+#include "containers/scoped.hpp"
+#include "microbench/microbench.hpp"
+#include "repli_timestamp.hpp"
+
+static const int BENCH_VALUE_SIZE = 16;
+
+struct bench_value_t;
+
+// Every value is `BENCH_VALUE_SIZE` bytes.
+template <>
+class value_sizer_t<bench_value_t> : public value_sizer_t<void> {
+public:
+    explicit value_sizer_t<bench_value_t>(block_size_t bs) : block_size_(bs) { }
+
+    int size(UNUSED const void *value) const {
+        return BENCH_VALUE_SIZE;
+    }
+
+    bool fits(UNUSED const void *value, int length_available) const {
+        return BENCH_VALUE_SIZE <= length_available;
+    }
+
+    bool deep_fsck(UNUSED block_getter_t *getter, const void *value, int length_available, std::string *msg_out) const {
+        if (!fits(value, length_available)) {
+            *msg_out = strprintf("value does not fit within %d", length_available);
+            return false;
+        }
+        return true;
+    }
+
+    int max_possible_size() const {
+        return BENCH_VALUE_SIZE;
+    }
+
+    block_magic_t btree_leaf_magic() const {
+        block_magic_t magic = { { 'b', 'n', 'L', 'F' } };
+        return magic;
+    }
+
+    block_size_t block_size() const { return block_size_; }
+
+private:
+    block_size_t block_size_;
+
+    DISABLE_COPYING(value_sizer_t<bench_value_t>);
+};
+
+namespace microbench {
+
+static const int64_t NODE_BLOCK_SIZE = 4096;
+
+// More keys than fit in a node, in a fixed shuffled order.
+static const int NODE_KEYS = 512;
+
+void make_node_keys(std::vector<store_key_t> *keys_out) {
+    for (int i = 0; i < NODE_KEYS; ++i) {
+        keys_out->push_back(store_key_t(strprintf("user:%08d", i * 7919)));
+    }
+    rng_t rng;
+    shuffle(&rng, keys_out);
+}
+
+// Fills `node` with keys from the start of `keys` until it's full, and
+// returns how many went in.
+size_t fill_leaf(value_sizer_t<void> *sizer, leaf_node_t *node, const std::vector<store_key_t> &keys) {
+    char value[BENCH_VALUE_SIZE] = { 0 };
+    repli_timestamp_t tstamp = repli_timestamp_t::distant_past;
+    leaf::init(sizer, node);
+    size_t n = 0;
+    while (n < keys.size() && !leaf::is_full(sizer, node, keys[n].btree_key(), value)) {
+        tstamp = tstamp.next();
+        leaf::insert(sizer, node, keys[n].btree_key(), value, tstamp,
+                     key_modification_proof_t::real_proof());
+        ++n;
+    }
+    return n;
+}
+
+/* Inserts keys into a leaf node in random order until it's full, then starts
+over with an empty node.  Each iteration is one `is_full()` check and one
+`insert()`, like a btree write does. */
+void bench_leaf_insert(int64_t iterations, stopwatch_t *stopwatch) {
+    const block_size_t bs = block_size_t::unsafe_make(NODE_BLOCK_SIZE);
+    value_sizer_t<bench_value_t> sizer(bs);
+    scoped_malloc_t<leaf_node_t> node(bs.value());
+    std::vector<store_key_t> keys;
+    make_node_keys(&keys);
+
+    char value[BENCH_VALUE_SIZE] = { 0 };
+    repli_timestamp_t tstamp = repli_timestamp_t::distant_past;
+    leaf::init(&sizer, node.get());
+    size_t k = 0;
+    stopwatch->start();
+    for (int64_t i = 0; i < iterations; ++i) {
+        if (k == keys.size() || leaf::is_full(&sizer, node.get(), keys[k].btree_key(), value)) {
+            stopwatch->stop();
+            leaf::init(&sizer, node.get());
+            k = 0;
+            stopwatch->start();
+        }
+        tstamp = tstamp.next();
+        leaf::insert(&sizer, node.get(), keys[k].btree_key(), value, tstamp,
+                     key_modification_proof_t::real_proof());
+        ++k;
+    }
+    stopwatch->stop();
+}
+
+void bench_leaf_lookup(int64_t iterations, stopwatch_t *stopwatch) {
+    const block_size_t bs = block_size_t::unsafe_make(NODE_BLOCK_SIZE);
+    value_sizer_t<bench_value_t> sizer(bs);
+    scoped_malloc_t<leaf_node_t> node(bs.value());
+    std::vector<store_key_t> keys;
+    make_node_keys(&keys);
+    const size_t n = fill_leaf(&sizer, node.get(), keys);
+
+    char value[BENCH_VALUE_SIZE];
+    int64_t found = 0;
+    stopwatch->start();
+    for (int64_t i = 0; i < iterations; ++i) {
+        found += leaf::lookup(&sizer, node.get(), keys[i % n].btree_key(), value) ? 1 : 0;
+    }
+    stopwatch->stop();
+    guarantee(found == iterations);
+}
+
+/* Internal nodes store much smaller entries, so the same keys fill one up
+after more insertions. */
+void bench_internal_insert(int64_t iterations, stopwatch_t *stopwatch) {
+    const block_size_t bs = block_size_t::unsafe_make(NODE_BLOCK_SIZE);
+    scoped_malloc_t<internal_node_t> node(bs.value());
+    std::vector<store_key_t> keys;
+    make_node_keys(&keys);
+
+    internal_node::init(bs, node.get());
+    size_t k = 0;
+    stopwatch->start();
+    for (int64_t i = 0; i < iterations; ++i) {
+        if (k == keys.size() || internal_node::is_full(node.get())) {
+            stopwatch->stop();
+            internal_node::init(bs, node.get());
+            k = 0;
+            stopwatch->start();
+        }
+        bool success = internal_node::insert(bs, node.get(), keys[k].btree_key(), k, k + 1);
+        guarantee(success);
+        ++k;
+    }
+    stopwatch->stop();
+}
+
+void bench_internal_lookup(int64_t iterations, stopwatch_t *stopwatch) {
+    const block_size_t bs = block_size_t::unsafe_make(NODE_BLOCK_SIZE);
+    scoped_malloc_t<internal_node_t> node(bs.value());
+    std::vector<store_key_t> keys;
+    make_node_keys(&keys);
+
+    internal_node::init(bs, node.get());
+    size_t n = 0;
+    while (n < keys.size() && !internal_node::is_full(node.get())) {
+        bool success = internal_node::insert(bs, node.get(), keys[n].btree_key(), n, n + 1);
+        guarantee(success);
+        ++n;
+    }
+
+    uint64_t sum = 0;
+    stopwatch->start();
+    for (int64_t i = 0; i < iterations; ++i) {
+        sum += internal_node::lookup(node.get(), keys[i % n].btree_key());
+    }
+    stopwatch->stop();
+    guarantee(sum != 0);
+}
+
+static registration_t leaf_insert("leaf_node.insert", 2 * MILLION, &bench_leaf_insert);
+static registration_t leaf_lookup("leaf_node.lookup", 5 * MILLION, &bench_leaf_lookup);
+static registration_t internal_insert("internal_node.insert", 2 * MILLION, &bench_internal_insert);
+static registration_t internal_lookup("internal_node.lookup", 5 * MILLION, &bench_internal_lookup);
+
+}  // namespace microbench
@@ -0,0 +1,79 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include <string.h>
+
+#include <vector>
+
+#include "buffer_cache/buffer_cache.hpp"
+#include "microbench/microbench.hpp"
+
+/* In debug builds `cache_t` is `mc_cache_t` behind the semantic checking
+cache, so only the numbers from release builds say much about `mc_cache_t`. */
+
+namespace microbench {
+
+// The number of blocks created in each transaction while setting up.
+static const int CREATE_BATCH_SIZE = 64;
+
+void create_blocks(cache_t *cache, int count, std::vector<block_id_t> *ids_out) {
+    const int64_t block_size = cache->get_block_size().value();
+    for (int i = 0; i < count; i += CREATE_BATCH_SIZE) {
+        transaction_t txn(cache, rwi_write, CREATE_BATCH_SIZE, repli_timestamp_t::distant_past,
+                          order_token_t::ignore, WRITE_DURABILITY_SOFT);
+        for (int j = i; j < count && j < i + CREATE_BATCH_SIZE; ++j) {
+            buf_lock_t buf(&txn);
+            memset(buf.get_data_write(), j, block_size);
+            ids_out->push_back(buf.get_block_id());
+        }
+    }
+}
+
+// Acquires each block in `ids` for reading, in a transaction of its own, for
+// `iterations` acquisitions.
+void read_blocks(cache_t *cache, const std::vector<block_id_t> &ids, int64_t iterations,
+                 stopwatch_t *stopwatch) {
+    uint64_t sum = 0;
+    stopwatch->start();
+    for (int64_t i = 0; i < iterations; ++i) {
+        transaction_t txn(cache, rwi_read, order_token_t::ignore);
+        buf_lock_t buf(&txn, ids[i % ids.size()], rwi_read);
+        sum += *static_cast<const uint8_t *>(buf.get_data_read());
+    }
+    stopwatch->stop();
+    guarantee(sum != 0);
+}
+
+/* Everything fits in the cache, and has been read once already, so every
+acquisition is a hit. */
+void bench_cache_hit(int64_t iterations, stopwatch_t *stopwatch) {
+    static const int blocks = 1024;
+    cache_fixture_t fixture(64 * MEGABYTE);
+    std::vector<block_id_t> ids;
+    create_blocks(fixture.cache(), blocks, &ids);
+    rng_t rng;
+    shuffle(&rng, &ids);
+
+    stopwatch_t warmup;
+    read_blocks(fixture.cache(), ids, ids.size(), &warmup);
+
+    read_blocks(fixture.cache(), ids, iterations, stopwatch);
+}
+
+/* The blocks are written out and the cache restarted with room for a sixteenth
+of them.  Visiting them in a random order, nearly every acquisition has to
+read the block from the serializer. */
+void bench_cache_miss(int64_t iterations, stopwatch_t *stopwatch) {
+    static const int blocks = 4096;
+    cache_fixture_t fixture(64 * MEGABYTE);
+    std::vector<block_id_t> ids;
+    create_blocks(fixture.cache(), blocks, &ids);
+    fixture.restart_cache(blocks / 16 * fixture.cache()->get_block_size().ser_value());
+    rng_t rng;
+    shuffle(&rng, &ids);
+
+    read_blocks(fixture.cache(), ids, iterations, stopwatch);
+}
+
+static registration_t cache_hit("mc_cache.hit", MILLION, &bench_cache_hit);
+static registration_t cache_miss("mc_cache.miss", 10 * THOUSAND, &bench_cache_miss);
+
+}  // namespace microbench
@@ -0,0 +1,188 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include <string.h>
+
+#include <string>
+
+#include "http/json.hpp"
+#include "microbench/microbench.hpp"
+#include "rdb_protocol/datum.hpp"
+#include "rdb_protocol/env.hpp"
+#include "rdb_protocol/json_reader.hpp"
+
+namespace microbench {
+
+// A typical small document, the kind a table of users would hold.
+static const char *const DATUM_BENCH_JSON =
+    "{\"id\": \"a4c2f3e0-57b1-4c5a-9b7e-3f1d2e8c6a90\", "
+    "\"name\": \"Jane Smith\", \"email\": \"jane.smith@example.com\", "
+    "\"age\": 37, \"score\": 9812.25, \"active\": true, \"manager\": null, "
+    "\"tags\": [\"admin\", \"beta\", \"europe\", \"paying\"], "
+    "\"address\": {\"street\": \"10 Downing St\", \"city\": \"London\", "
+    "\"zip\": \"SW1A 2AA\", \"location\": [51.5034, -0.1276]}, "
+    "\"logins\": [1370000000, 1370003600, 1370007200, 1370010800, 1370014400]}";
+
+counted_t<const ql::datum_t> parse_bench_datum() {
+    scoped_cJSON_t json(cJSON_Parse(DATUM_BENCH_JSON));
+    guarantee(json.get() != NULL);
+    return make_counted<ql::datum_t>(json.get(), static_cast<ql::env_t *>(NULL));
+}
+
+void bench_datum_parse_json(int64_t iterations, stopwatch_t *stopwatch) {
+    size_t fields = 0;
+    stopwatch->start();
+    for (int64_t i = 0; i < iterations; ++i) {
+        fields += parse_bench_datum()->as_object().size();
+    }
+    stopwatch->stop();
+    guarantee(fields != 0);
+}
+
+void bench_datum_read_json(int64_t iterations, stopwatch_t *stopwatch) {
+    const size_t size = strlen(DATUM_BENCH_JSON);
+    size_t fields = 0;
+    stopwatch->start();
+    for (int64_t i = 0; i < iterations; ++i) {
+        std::string error;
+        counted_t<const ql::datum_t> datum = ql::read_json(DATUM_BENCH_JSON, size, &error);
+        guarantee(datum.has());
+        fields += datum->as_object().size();
+    }
+    stopwatch->stop();
+    guarantee(fields != 0);
+}
+
+/* An array of a thousand of the documents, about 400 KB, which is what an
+import or a big HTTP request hands the parser.  Dividing the size by the time
+per iteration gives the parsing throughput. */
+std::string make_bulk_bench_json() {
+    std::string json = "[";
+    for (int i = 0; i < 1000; ++i) {
+        if (i != 0) {
+            json += ",\n";
+        }
+        json += DATUM_BENCH_JSON;
+    }
+    json += "]";
+    return json;
+}
+
+void bench_datum_parse_json_bulk(int64_t iterations, stopwatch_t *stopwatch) {
+    const std::string json = make_bulk_bench_json();
+    size_t elements = 0;
+    stopwatch->start();
+    for (int64_t i = 0; i < iterations; ++i) {
+        scoped_cJSON_t cjson(cJSON_Parse(json.c_str()));
+        guarantee(cjson.get() != NULL);
+        ql::datum_t datum(cjson.get(), static_cast<ql::env_t *>(NULL));
+        elements += datum.size();
+    }
+    stopwatch->stop();
+    guarantee(elements != 0);
+}
+
+void bench_datum_read_json_bulk(int64_t iterations, stopwatch_t *stopwatch) {
+    const std::string json = make_bulk_bench_json();
+    size_t elements = 0;
+    stopwatch->start();
+    for (int64_t i = 0; i < iterations; ++i) {
+        std::string error;
+        counted_t<const ql::datum_t> datum = ql::read_json(json.data(), json.size(), &error);
+        guarantee(datum.has());
+        elements += datum->size();
+    }
+    stopwatch->stop();
+    guarantee(elements != 0);
+}
+
+void bench_datum_print_json(int64_t iterations, stopwatch_t *stopwatch) {
+    counted_t<const ql::datum_t> datum = parse_bench_datum();
+    size_t bytes = 0;
+    stopwatch->start();
+    for (int64_t i = 0; i < iterations; ++i) {
+        bytes += datum->as_json()->PrintUnformatted().size();
+    }
+    stopwatch->stop();
+    guarantee(bytes != 0);
+}
+
+/* Datums go over the wire, and into the btree, as `Datum` protocol buffers. */
+void bench_datum_serialize(int64_t iterations, stopwatch_t *stopwatch) {
+    counted_t<const ql::datum_t> datum = parse_bench_datum();
+    size_t bytes = 0;
+    stopwatch->start();
+    for (int64_t i = 0; i < iterations; ++i) {
+        Datum pb;
+        datum->write_to_protobuf(&pb);
+        std::string s;
+        pb.SerializeToString(&s);
+        bytes += s.size();
+    }
+    stopwatch->stop();
+    guarantee(bytes != 0);
+}
+
+void bench_datum_deserialize(int64_t iterations, stopwatch_t *stopwatch) {
+    std::string serialized;
+    {
+        Datum pb;
+        parse_bench_datum()->write_to_protobuf(&pb);
+        pb.SerializeToString(&serialized);
+    }
+    size_t fields = 0;
+    stopwatch->start();
+    for (int64_t i = 0; i < iterations; ++i) {
+        Datum pb;
+        bool res = pb.ParseFromString(serialized);
+        guarantee(res);
+        counted_t<const ql::datum_t> datum
+            = make_counted<ql::datum_t>(&pb, static_cast<ql::env_t *>(NULL));
+        fields += datum->as_object().size();
+    }
+    stopwatch->stop();
+    guarantee(fields != 0);
+}
+
+/* Builds an array of 500 small rows from its protocol buffer and drops it, over
+and over.  Each iteration allocates and frees some two thousand datums, so this
+times the datum allocator more than anything else; after the first iteration
+they should all come off the thread's free list. */
+void bench_datum_build_rows(int64_t iterations, stopwatch_t *stopwatch) {
+    Datum rows;
+    rows.set_type(Datum::R_ARRAY);
+    for (int i = 0; i < 500; ++i) {
+        Datum *row = rows.add_r_array();
+        row->set_type(Datum::R_OBJECT);
+        Datum_AssocPair *id = row->add_r_object();
+        id->set_key("id");
+        id->mutable_val()->set_type(Datum::R_NUM);
+        id->mutable_val()->set_r_num(i);
+        Datum_AssocPair *name = row->add_r_object();
+        name->set_key("name");
+        name->mutable_val()->set_type(Datum::R_STR);
+        name->mutable_val()->set_r_str(strprintf("row %d", i));
+        Datum_AssocPair *score = row->add_r_object();
+        score->set_key("score");
+        score->mutable_val()->set_type(Datum::R_NUM);
+        score->mutable_val()->set_r_num(i * 0.5);
+    }
+    size_t elements = 0;
+    stopwatch->start();
+    for (int64_t i = 0; i < iterations; ++i) {
+        counted_t<const ql::datum_t> datum
+            = make_counted<ql::datum_t>(&rows, static_cast<ql::env_t *>(NULL));
+        elements += datum->size();
+    }
+    stopwatch->stop();
+    guarantee(elements != 0);
+}
+
+static registration_t datum_parse_json("datum.parse_json", 200 * THOUSAND, &bench_datum_parse_json);
+static registration_t datum_read_json("datum.read_json", 200 * THOUSAND, &bench_datum_read_json);
+static registration_t datum_parse_json_bulk("datum.parse_json_bulk", 200, &bench_datum_parse_json_bulk);
+static registration_t datum_read_json_bulk("datum.read_json_bulk", 200, &bench_datum_read_json_bulk);
+static registration_t datum_print_json("datum.print_json", 200 * THOUSAND, &bench_datum_print_json);
+static registration_t datum_serialize("datum.serialize", 200 * THOUSAND, &bench_datum_serialize);
+static registration_t datum_build_rows("datum.build_rows", 2 * THOUSAND, &bench_datum_build_rows);
+static registration_t datum_deserialize("datum.deserialize", 200 * THOUSAND, &bench_datum_deserialize);
+
+}  // namespace microbench
@@ -0,0 +1,146 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "errors.hpp"
+#include <boost/bind.hpp>
+
+#include "arch/runtime/starter.hpp"
+#include "config/args.hpp"
+#include "microbench/microbench.hpp"
+#include "utils.hpp"
+
+namespace microbench {
+
+struct result_t {
+    std::string name;
+    int64_t iterations;
+    // The time each run took, fastest first.
+    std::vector<double> run_secs;
+};
+
+void run_benchmarks(const std::vector<benchmark_t> &benchmarks, int runs,
+                    std::vector<result_t> *results_out) {
+    for (std::vector<benchmark_t>::const_iterator it = benchmarks.begin(); it != benchmarks.end(); ++it) {
+        fprintf(stderr, "%s...", it->name.c_str());
+        result_t result;
+        result.name = it->name;
+        result.iterations = it->iterations;
+        for (int i = 0; i < runs; ++i) {
+            stopwatch_t stopwatch;
+            it->func(it->iterations, &stopwatch);
+            result.run_secs.push_back(stopwatch.secs());
+        }
+        std::sort(result.run_secs.begin(), result.run_secs.end());
+        fprintf(stderr, " %.1f ns/op\n", result.run_secs[0] * BILLION / result.iterations);
+        results_out->push_back(result);
+    }
+}
+
+/* Writes the results as a JSON object with a "benchmarks" array, one entry per
+benchmark, with the best and median of its runs.  The best time is the one to
+track, since noise only ever makes a run slower. */
+void write_json(FILE *out, int runs, const std::vector<result_t> &results) {
+    fprintf(out, "{\n");
+#ifdef NDEBUG
+    fprintf(out, "  \"debug\": false,\n");
+#else
+    fprintf(out, "  \"debug\": true,\n");
+#endif
+    fprintf(out, "  \"threads\": %d,\n", MICROBENCH_THREADS);
+    fprintf(out, "  \"runs\": %d,\n", runs);
+    fprintf(out, "  \"benchmarks\": [");
+    for (size_t i = 0; i < results.size(); ++i) {
+        const result_t &r = results[i];
+        const double best = r.run_secs.front();
+        const double median = r.run_secs[r.run_secs.size() / 2];
+        fprintf(out, "%s\n    {\"name\": \"%s\", \"iterations\": %" PRIi64 ", "
+                "\"best_secs\": %.9f, \"median_secs\": %.9f, "
+                "\"ns_per_op\": %.3f, \"ops_per_sec\": %.1f}",
+                i == 0 ? "" : ",",
+                r.name.c_str(), r.iterations,
+                best, median,
+                best * BILLION / r.iterations,
+                best > 0 ? r.iterations / best : 0.0);
+    }
+    fprintf(out, "\n  ]\n}\n");
+}
+
+void usage(const char *name) {
+    fprintf(stderr,
+            "Usage: %s [--filter SUBSTRING] [--runs N] [--output FILE] [--list]\n"
+            "Runs the storage engine microbenchmarks and writes their results as JSON\n"
+            "to FILE, or to stdout.  Only benchmarks whose names contain SUBSTRING are\n"
+            "run.  Each benchmark is run N times (3 by default).\n",
+            name);
+}
+
+}  // namespace microbench
+
+int main(int argc, char **argv) {
+    run_generic_global_startup_behavior();
+
+    std::string filter;
+    std::string output;
+    int runs = 3;
+    bool list = false;
+    for (int i = 1; i < argc; ++i) {
+        const bool has_arg = i + 1 < argc;
+        if (strcmp(argv[i], "--filter") == 0 && has_arg) {
+            filter = argv[++i];
+        } else if (strcmp(argv[i], "--output") == 0 && has_arg) {
+            output = argv[++i];
+        } else if (strcmp(argv[i], "--runs") == 0 && has_arg) {
+            runs = atoi(argv[++i]);
+            if (runs <= 0) {
+                microbench::usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--list") == 0) {
+            list = true;
+        } else {
+            microbench::usage(argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    std::vector<microbench::benchmark_t> benchmarks;
+    const std::vector<microbench::benchmark_t> all = microbench::registered_benchmarks();
+    for (std::vector<microbench::benchmark_t>::const_iterator it = all.begin(); it != all.end(); ++it) {
+        if (it->name.find(filter) != std::string::npos) {
+            benchmarks.push_back(*it);
+        }
+    }
+
+    if (list) {
+        for (size_t i = 0; i < benchmarks.size(); ++i) {
+            printf("%s\n", benchmarks[i].name.c_str());
+        }
+        return EXIT_SUCCESS;
+    }
+
+    std::vector<microbench::result_t> results;
+    run_in_thread_pool(boost::bind(&microbench::run_benchmarks, boost::cref(benchmarks), runs, &results),
+                       microbench::MICROBENCH_THREADS);
+
+    FILE *out = stdout;
+    if (!output.empty()) {
+        out = fopen(output.c_str(), "w");
+        if (out == NULL) {
+            fprintf(stderr, "Couldn't open %s: %s\n", output.c_str(), strerror(errno));
+            return EXIT_FAILURE;
+        }
+    }
+    microbench::write_json(out, runs, results);
+    if (out != stdout) {
+        fclose(out);
+    }
+    return EXIT_SUCCESS;
+}
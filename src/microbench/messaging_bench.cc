@@ -0,0 +1,41 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include "arch/runtime/runtime.hpp"
+#include "concurrency/pmap.hpp"
+#include "microbench/microbench.hpp"
+
+namespace microbench {
+
+/* Moves the coroutine to another thread and back: two cross-thread messages,
+each of which wakes the other thread's event loop. */
+void bench_thread_round_trip(int64_t iterations, stopwatch_t *stopwatch) {
+    const int here = get_thread_id();
+    const int there = (here + 1) % get_num_threads();
+    stopwatch->start();
+    for (int64_t i = 0; i < iterations; ++i) {
+        on_thread_t thread_switcher(there);
+    }
+    stopwatch->stop();
+}
+
+class visit_thread_t {
+public:
+    void operator()(int thread) const {
+        on_thread_t thread_switcher(thread);
+    }
+};
+
+/* Visits every thread at once and waits for them all to answer, the way
+per-thread structures like `one_per_thread_t` and the perfmon collection get
+updated. */
+void bench_thread_broadcast(int64_t iterations, stopwatch_t *stopwatch) {
+    stopwatch->start();
+    for (int64_t i = 0; i < iterations; ++i) {
+        pmap(get_num_threads(), visit_thread_t());
+    }
+    stopwatch->stop();
+}
+
+static registration_t thread_round_trip("thread.round_trip", 200 * THOUSAND, &bench_thread_round_trip);
+static registration_t thread_broadcast("thread.broadcast", 50 * THOUSAND, &bench_thread_broadcast);
+
+}  // namespace microbench
@@ -0,0 +1,108 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include "microbench/microbench.hpp"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "arch/io/disk.hpp"
+#include "buffer_cache/buffer_cache.hpp"
+#include "serializer/config.hpp"
+#include "serializer/translator.hpp"
+
+namespace microbench {
+
+stopwatch_t::stopwatch_t() : started(0), total(0), running(false) { }
+
+void stopwatch_t::start() {
+    rassert(!running);
+    running = true;
+    started = get_ticks();
+}
+
+void stopwatch_t::stop() {
+    const ticks_t now = get_ticks();
+    rassert(running);
+    running = false;
+    total += now - started;
+}
+
+double stopwatch_t::secs() const {
+    rassert(!running);
+    return ticks_to_secs(total);
+}
+
+static std::vector<benchmark_t> *benchmark_registry() {
+    // Registrations run during static initialization, in no particular
+    // order, so the registry can't be a global of its own.
+    static std::vector<benchmark_t> registry;
+    return &registry;
+}
+
+registration_t::registration_t(const char *name, int64_t iterations, benchmark_func_t func) {
+    benchmark_registry()->push_back(benchmark_t(name, iterations, func));
+}
+
+static bool benchmark_name_less(const benchmark_t &a, const benchmark_t &b) {
+    return a.name < b.name;
+}
+
+std::vector<benchmark_t> registered_benchmarks() {
+    std::vector<benchmark_t> ret = *benchmark_registry();
+    std::sort(ret.begin(), ret.end(), &benchmark_name_less);
+    return ret;
+}
+
+temp_directory_t::temp_directory_t() {
+    char tmpl[] = "/tmp/rdb_microbench.XXXXXX";
+    const char *res = mkdtemp(tmpl);
+    guarantee_err(res != NULL, "Couldn't create a temporary directory");
+    path = tmpl;
+    recreate_temporary_directory(base_path_t(path));
+}
+
+temp_directory_t::~temp_directory_t() {
+    // Whatever used the directory has unlinked its files by now.
+    int res = ::rmdir((path + "/" + TEMPORARY_DIRECTORY_NAME).c_str());
+    guarantee_err(res == 0, "Couldn't remove a temporary directory");
+    res = ::rmdir(path.c_str());
+    guarantee_err(res == 0, "Couldn't remove a temporary directory");
+}
+
+serializer_filepath_t temp_directory_t::file(const std::string &name) const {
+    return serializer_filepath_t(base_path_t(path), name);
+}
+
+cache_fixture_t::cache_fixture_t(int64_t cache_size)
+    : io_backender(new io_backender_t) {
+    filepath_file_opener_t file_opener(directory.file("cache"), io_backender.get());
+    standard_serializer_t::create(&file_opener,
+                                  standard_serializer_t::static_config_t());
+    serializer.init(new standard_serializer_t(standard_serializer_t::dynamic_config_t(),
+                                              &file_opener,
+                                              &get_global_perfmon_collection()));
+    file_opener.unlink_serializer_file();
+
+    std::vector<standard_serializer_t *> serializers;
+    serializers.push_back(serializer.get());
+    serializer_multiplexer_t::create(serializers, 1);
+    multiplexer.init(new serializer_multiplexer_t(serializers));
+
+    cache_t::create(multiplexer->proxies[0]);
+    restart_cache(cache_size);
+}
+
+cache_fixture_t::~cache_fixture_t() { }
+
+void cache_fixture_t::restart_cache(int64_t cache_size) {
+    cache_.reset();
+
+    mirrored_cache_config_t cache_config;
+    cache_config.max_size = cache_size;
+    cache_config.max_dirty_size = cache_size / 2;
+    cache_.init(new cache_t(multiplexer->proxies[0], cache_config,
+                            &get_global_perfmon_collection()));
+}
+
+}  // namespace microbench
@@ -0,0 +1,141 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#ifndef MICROBENCH_MICROBENCH_HPP_
+#define MICROBENCH_MICROBENCH_HPP_
+
+#include <string>
+#include <vector>
+
+#include "buffer_cache/types.hpp"
+#include "containers/scoped.hpp"
+#include "utils.hpp"
+
+class io_backender_t;
+class serializer_multiplexer_t;
+
+/* The microbenchmarks live in their own executable, `rethinkdb-microbench`,
+which is linked like the unit tests but without gtest.  Each one runs a fixed
+number of iterations of some operation on a fixed input, so that two runs of
+the same build do the same work and runs of different builds can be compared.
+The results are written out as JSON (see `main.cc`). */
+
+namespace microbench {
+
+// The number of threads in the thread pool the benchmarks run in.
+static const int MICROBENCH_THREADS = 4;
+
+/* Benchmarks time only the part of each iteration they care about, by
+starting and stopping the stopwatch around it.  Setup and teardown should
+happen with it stopped. */
+class stopwatch_t {
+public:
+    stopwatch_t();
+
+    void start();
+    void stop();
+
+    double secs() const;
+
+private:
+    ticks_t started;
+    ticks_t total;
+    bool running;
+
+    DISABLE_COPYING(stopwatch_t);
+};
+
+/* A benchmark runs `iterations` iterations of its operation.  It's called in a
+coroutine on thread 0 of a thread pool with `MICROBENCH_THREADS` threads. */
+typedef void (*benchmark_func_t)(int64_t iterations, stopwatch_t *stopwatch);
+
+struct benchmark_t {
+    benchmark_t(const std::string &_name, int64_t _iterations, benchmark_func_t _func)
+        : name(_name), iterations(_iterations), func(_func) { }
+
+    std::string name;
+    int64_t iterations;
+    benchmark_func_t func;
+};
+
+/* Benchmarks register themselves by declaring a static `registration_t`, the
+way gtest's `TEST()` does.  Names are of the form "component.operation". */
+class registration_t {
+public:
+    registration_t(const char *name, int64_t iterations, benchmark_func_t func);
+};
+
+// All registered benchmarks, sorted by name.
+std::vector<benchmark_t> registered_benchmarks();
+
+/* A deterministic xorshift generator, so that benchmarks see the same "random"
+keys and access patterns on every run. */
+class rng_t {
+public:
+    rng_t() : state(88172645463325252ULL) { }
+
+    uint64_t next() {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+
+    // Returns a number in [0, n).
+    uint64_t next(uint64_t n) {
+        return next() % n;
+    }
+
+private:
+    uint64_t state;
+};
+
+// Shuffles `v` in place with `rng`.
+template <class T>
+void shuffle(rng_t *rng, std::vector<T> *v) {
+    for (size_t i = v->size(); i > 1; --i) {
+        std::swap((*v)[i - 1], (*v)[rng->next(i)]);
+    }
+}
+
+/* A scratch directory under /tmp for benchmarks that need a file, and the
+`tmp` directory in it that serializer files get created in.  It's deleted,
+with everything in it, when it's destroyed. */
+class temp_directory_t {
+public:
+    temp_directory_t();
+    ~temp_directory_t();
+
+    serializer_filepath_t file(const std::string &name) const;
+
+private:
+    std::string path;
+
+    DISABLE_COPYING(temp_directory_t);
+};
+
+/* A cache on top of a freshly created serializer file, set up the way
+`internal_disk_backed_queue_t` sets up its own. */
+class cache_fixture_t {
+public:
+    explicit cache_fixture_t(int64_t cache_size);
+    ~cache_fixture_t();
+
+    cache_t *cache() { return cache_.get(); }
+
+    /* Destroys the cache, flushing everything in it to disk, and creates a new
+    one of the given size.  Any block it's asked for afterwards is a miss until
+    it has been loaded. */
+    void restart_cache(int64_t cache_size);
+
+private:
+    temp_directory_t directory;
+    scoped_ptr_t<io_backender_t> io_backender;
+    scoped_ptr_t<standard_serializer_t> serializer;
+    scoped_ptr_t<serializer_multiplexer_t> multiplexer;
+    scoped_ptr_t<cache_t> cache_;
+
+    DISABLE_COPYING(cache_fixture_t);
+};
+
+}  // namespace microbench
+
+#endif  // MICROBENCH_MICROBENCH_HPP_
@@ -0,0 +1,46 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include <string>
+
+#include "arch/io/disk.hpp"
+#include "containers/archive/stl_types.hpp"
+#include "containers/disk_backed_queue.hpp"
+#include "containers/segmented_log_queue.hpp"
+#include "microbench/microbench.hpp"
+
+namespace microbench {
+
+/* Pushes `iterations` values of `value_size` bytes onto a fresh queue and then
+pops them all off again, which is how the queues get used when a replica falls
+behind and then catches up. */
+template <class queue_t, size_t value_size>
+void bench_queue_push_pop(int64_t iterations, stopwatch_t *stopwatch) {
+    temp_directory_t directory;
+    io_backender_t io_backender;
+    queue_t queue(&io_backender, directory.file("queue"), &get_global_perfmon_collection());
+    const std::string value(value_size, 'a');
+    std::string popped;
+    stopwatch->start();
+    for (int64_t i = 0; i < iterations; ++i) {
+        queue.push(value);
+    }
+    for (int64_t i = 0; i < iterations; ++i) {
+        queue.pop(&popped);
+    }
+    stopwatch->stop();
+    guarantee(popped == value);
+}
+
+static registration_t disk_backed_queue_small("disk_backed_queue.push_pop_16", 20 * THOUSAND,
+    &bench_queue_push_pop<disk_backed_queue_t<std::string>, 16>);
+static registration_t disk_backed_queue_medium("disk_backed_queue.push_pop_1000", 20 * THOUSAND,
+    &bench_queue_push_pop<disk_backed_queue_t<std::string>, 1000>);
+static registration_t disk_backed_queue_large("disk_backed_queue.push_pop_10000", 20 * THOUSAND,
+    &bench_queue_push_pop<disk_backed_queue_t<std::string>, 10000>);
+static registration_t segmented_log_queue_small("segmented_log_queue.push_pop_16", 20 * THOUSAND,
+    &bench_queue_push_pop<segmented_log_queue_t<std::string>, 16>);
+static registration_t segmented_log_queue_medium("segmented_log_queue.push_pop_1000", 20 * THOUSAND,
+    &bench_queue_push_pop<segmented_log_queue_t<std::string>, 1000>);
+static registration_t segmented_log_queue_large("segmented_log_queue.push_pop_10000", 20 * THOUSAND,
+    &bench_queue_push_pop<segmented_log_queue_t<std::string>, 10000>);
+
+}  // namespace microbench
@@ -0,0 +1,99 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include <string.h>
+
+#include <vector>
+
+#include "arch/io/disk.hpp"
+#include "microbench/microbench.hpp"
+#include "serializer/log/log_serializer.hpp"
+
+namespace microbench {
+
+/* The benchmarks write to this many distinct block ids, over and over, so the
+file stays a fixed size and the garbage collector gets to run like it would
+under a steady write load. */
+static const int SERIALIZER_BENCH_BLOCKS = 4096;
+
+// The number of block writes per index write, which is about what a flush of
+// the cache does.
+static const int SERIALIZER_BENCH_WRITE_BATCH = 64;
+
+/* A `log_serializer_t` on a freshly created file. */
+class serializer_fixture_t {
+public:
+    serializer_fixture_t() {
+        filepath_file_opener_t file_opener(directory.file("serializer"), &io_backender);
+        log_serializer_t::create(&file_opener, log_serializer_t::static_config_t());
+        serializer.init(new log_serializer_t(log_serializer_t::dynamic_config_t(),
+                                             &file_opener,
+                                             &get_global_perfmon_collection()));
+        file_opener.unlink_serializer_file();
+
+        buf = serializer->malloc();
+        memset(buf, 'x', serializer->get_block_size().value());
+    }
+
+    ~serializer_fixture_t() {
+        serializer->free(buf);
+    }
+
+    // Writes `count` blocks, cycling through the block ids.
+    void write_blocks(int64_t count, file_account_t *account) {
+        for (int64_t i = 0; i < count; i += SERIALIZER_BENCH_WRITE_BATCH) {
+            std::vector<serializer_write_t> writes;
+            for (int64_t j = i; j < count && j < i + SERIALIZER_BENCH_WRITE_BATCH; ++j) {
+                writes.push_back(serializer_write_t::make_update(j % SERIALIZER_BENCH_BLOCKS,
+                                                                 repli_timestamp_t::distant_past,
+                                                                 buf));
+            }
+            do_writes(serializer.get(), writes, account);
+        }
+    }
+
+    temp_directory_t directory;
+    io_backender_t io_backender;
+    scoped_ptr_t<log_serializer_t> serializer;
+    void *buf;
+
+private:
+    DISABLE_COPYING(serializer_fixture_t);
+};
+
+void bench_serializer_write(int64_t iterations, stopwatch_t *stopwatch) {
+    serializer_fixture_t fixture;
+    scoped_ptr_t<file_account_t> account(
+        fixture.serializer->make_io_account(CACHE_WRITES_IO_PRIORITY, UNLIMITED_OUTSTANDING_REQUESTS));
+
+    stopwatch->start();
+    fixture.write_blocks(iterations, account.get());
+    stopwatch->stop();
+}
+
+/* Reads the blocks back one at a time, in a random order, the way cache
+misses do. */
+void bench_serializer_read(int64_t iterations, stopwatch_t *stopwatch) {
+    serializer_fixture_t fixture;
+    scoped_ptr_t<file_account_t> account(
+        fixture.serializer->make_io_account(CACHE_READS_IO_PRIORITY, UNLIMITED_OUTSTANDING_REQUESTS));
+    fixture.write_blocks(SERIALIZER_BENCH_BLOCKS, account.get());
+
+    std::vector<block_id_t> ids;
+    for (block_id_t i = 0; i < SERIALIZER_BENCH_BLOCKS; ++i) {
+        ids.push_back(i);
+    }
+    rng_t rng;
+    shuffle(&rng, &ids);
+
+    stopwatch->start();
+    for (int64_t i = 0; i < iterations; ++i) {
+        counted_t<ls_block_token_pointee_t> token
+            = fixture.serializer->index_read(ids[i % ids.size()]);
+        fixture.serializer->block_read(token, fixture.buf, account.get());
+    }
+    stopwatch->stop();
+}
+
+static registration_t serializer_write("log_serializer.block_write", 20 * THOUSAND, &bench_serializer_write);
+static registration_t serializer_read("log_serializer.block_read", 10 * THOUSAND, &bench_serializer_read);
+
+}  // namespace microbench
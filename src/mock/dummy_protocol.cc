@@ -173,6 +173,19 @@ std::vector<dummy_protocol_t::region_t> region_subtract_many(const dummy_protoco
     return result;
 }
 
+std::vector<dummy_protocol_t::region_t> region_split_by_keys(const dummy_protocol_t::region_t &r, int n) {
+    guarantee(n >= 1);
+    std::vector<dummy_protocol_t::region_t> result;
+    const size_t part_size = (r.keys.size() + n - 1) / n;
+    for (std::set<std::string>::const_iterator it = r.keys.begin(); it != r.keys.end(); ++it) {
+        if (result.empty() || result.back().keys.size() == part_size) {
+            result.push_back(dummy_protocol_t::region_t());
+        }
+        result.back().keys.insert(*it);
+    }
+    return result;
+}
+
 
 bool region_is_empty(const dummy_protocol_t::region_t &r) {
     return r.keys.empty();
@@ -17,6 +17,8 @@
 #include "perfmon/types.hpp"
 #include "utils.hpp"
 
+class cache_balancer_t;
+class range_heat_registry_t;
 class signal_t;
 class io_backender_t;
 class serializer_t;
@@ -110,6 +112,13 @@ public:
                 io_backender_t *io, const base_path_t &);
         ~store_t();
 
+        // The dummy store keeps its data in memory, so it has no cache to balance.
+        void register_with_cache_balancer(UNUSED cache_balancer_t *balancer) { }
+        // Nobody splits dummy tables by load.
+        void register_with_heat_registry(UNUSED range_heat_registry_t *registry,
+                                         UNUSED const uuid_u &namespace_id) { }
+        void enable_cache_prewarm(UNUSED const serializer_filepath_t &hot_list_path) { }
+
         void new_read_token(object_buffer_t<fifo_enforcer_sink_t::exit_read_t> *token_out) THROWS_NOTHING;
         void new_write_token(object_buffer_t<fifo_enforcer_sink_t::exit_write_t> *token_out) THROWS_NOTHING;
 
@@ -185,6 +194,7 @@ bool region_is_superset(dummy_protocol_t::region_t a, dummy_protocol_t::region_t
 dummy_protocol_t::region_t region_intersection(dummy_protocol_t::region_t a, dummy_protocol_t::region_t b);
 MUST_USE region_join_result_t region_join(const std::vector<dummy_protocol_t::region_t> &vec, dummy_protocol_t::region_t *out) THROWS_NOTHING;
 std::vector<dummy_protocol_t::region_t> region_subtract_many(const dummy_protocol_t::region_t &a, const std::vector<dummy_protocol_t::region_t>& b);
+std::vector<dummy_protocol_t::region_t> region_split_by_keys(const dummy_protocol_t::region_t &r, int n);
 bool region_is_empty(const dummy_protocol_t::region_t &r);
 bool region_overlaps(const dummy_protocol_t::region_t &r1, const dummy_protocol_t::region_t &r2);
 dummy_protocol_t::region_t drop_cpu_sharding(const dummy_protocol_t::region_t &r);
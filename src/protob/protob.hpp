@@ -100,6 +100,13 @@ private:
 // request_t::protob_type *underlying_protob_value(request_t *request);
 //
 // "request_t::protob_type" does not actually have to be defined.
+//
+// Clients that connect with context_t::json_magic_number get their responses
+// through another overload instead of as protocol buffers:
+//
+// // Writes `response` to `conn` for a client that asked for JSON.
+// void send_json_response(const response_t &response, context_t *ctx,
+//                         tcp_conn_t *conn, signal_t *closer);
 
 
 template <class request_t, class response_t, class context_t>
@@ -118,7 +125,7 @@ public:
 private:
 
     void handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &nconn, auto_drainer_t::lock_t);
-    void send(const response_t &, tcp_conn_t *conn, signal_t *closer) THROWS_ONLY(tcp_conn_write_closed_exc_t);
+    void send(const response_t &, context_t *ctx, tcp_conn_t *conn, signal_t *closer) THROWS_ONLY(tcp_conn_write_closed_exc_t);
     static auth_key_t read_auth_key(tcp_conn_t *conn, signal_t *interruptor);
 
     // For HTTP server
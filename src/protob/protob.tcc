@@ -116,7 +116,9 @@ void protob_server_t<request_t, response_t, context_t>::handle_conn(
             if (!auth_vclock.get().str().empty()) {
                 throw protob_server_exc_t("authorization required, client does not support it");
             }
-        } else if (client_magic_number == context_t::auth_magic_number) {
+        } else if (client_magic_number == context_t::auth_magic_number
+                   || client_magic_number == context_t::json_magic_number) {
+            ctx.json_responses = (client_magic_number == context_t::json_magic_number);
             auth_key_t provided_auth = read_auth_key(conn.get(), &ct_keepalive);
             if (!timing_sensitive_equals(provided_auth, auth_vclock.get())) {
                 throw protob_server_exc_t("incorrect authorization key");
@@ -178,7 +180,7 @@ void protob_server_t<request_t, response_t, context_t>::handle_conn(
             switch (cb_mode) {
             case INLINE:
                 if (force_response) {
-                    send(forced_response, conn.get(), &ct_keepalive);
+                    send(forced_response, &ctx, conn.get(), &ct_keepalive);
                 } else {
 #ifdef __linux
                     linux_event_watcher_t *ew = conn->get_event_watcher();
@@ -192,7 +194,7 @@ void protob_server_t<request_t, response_t, context_t>::handle_conn(
                     response_t response;
                     bool response_needed = f(request, &response, &ctx);
                     if (response_needed) {
-                        send(response, conn.get(), &ct_keepalive);
+                        send(response, &ctx, conn.get(), &ct_keepalive);
                     }
                 }
                 break;
@@ -217,8 +219,13 @@ void protob_server_t<request_t, response_t, context_t>::handle_conn(
 template <class request_t, class response_t, class context_t>
 void protob_server_t<request_t, response_t, context_t>::send(
     const response_t &res,
+    context_t *ctx,
     tcp_conn_t *conn,
     signal_t *closer) THROWS_ONLY(tcp_conn_write_closed_exc_t) {
+    if (ctx->json_responses) {
+        send_json_response(res, ctx, conn, closer);
+        return;
+    }
     int size = res.ByteSize();
     conn->write(&size, sizeof(res.ByteSize()), closer);
     scoped_array_t<char> data(size);
@@ -347,6 +347,28 @@ ARCHIVE_PRIM_MAKE_RANGED_SERIALIZABLE(durability_requirement_t,
                                       DURABILITY_REQUIREMENT_DEFAULT,
                                       DURABILITY_REQUIREMENT_SOFT);
 
+/* One write of a batch passed to `store_view_t::write_batch()`. The fields are
+the arguments of `store_view_t::write()`; the write, the response and the token
+pair are owned by the caller. */
+template <class protocol_t>
+struct batched_store_write_t {
+    batched_store_write_t(const region_map_t<protocol_t, binary_blob_t> &_new_metainfo,
+                          const typename protocol_t::write_t *_write,
+                          typename protocol_t::write_response_t *_response,
+                          transition_timestamp_t _timestamp,
+                          order_token_t _order_token,
+                          write_token_pair_t *_token_pair)
+        : new_metainfo(_new_metainfo), write(_write), response(_response),
+          timestamp(_timestamp), order_token(_order_token), token_pair(_token_pair) { }
+
+    region_map_t<protocol_t, binary_blob_t> new_metainfo;
+    const typename protocol_t::write_t *write;
+    typename protocol_t::write_response_t *response;
+    transition_timestamp_t timestamp;
+    order_token_t order_token;
+    write_token_pair_t *token_pair;
+};
+
 template <class protocol_t>
 class store_view_t : public home_thread_mixin_t {
 public:
@@ -414,6 +436,33 @@ public:
             signal_t *interruptor)
             THROWS_ONLY(interrupted_exc_t) = 0;
 
+    /* Performs several writes, in order, as if by calling `write()` for each of
+    them. Stores that can apply them in a single transaction do so, which saves
+    a superblock acquisition and a transaction per write when a replica is
+    catching up on a stream of small writes. `metainfo_expecter` is checked
+    against the metainfo before the first write only.
+    [Precondition] The token pairs were created in the order of the writes.
+    [May block] */
+    virtual void write_batch(
+            DEBUG_ONLY(const metainfo_checker_t<protocol_t>& metainfo_expecter, )
+            const std::vector<batched_store_write_t<protocol_t> > &writes,
+            write_durability_t durability,
+            signal_t *interruptor)
+            THROWS_ONLY(interrupted_exc_t) {
+#ifndef NDEBUG
+        trivial_metainfo_checker_callback_t<protocol_t> trivial_callback;
+#endif
+        for (size_t i = 0; i < writes.size(); ++i) {
+#ifndef NDEBUG
+            metainfo_checker_t<protocol_t> trivial_checker(&trivial_callback, metainfo_expecter.get_domain());
+#endif
+            write(DEBUG_ONLY(i == 0 ? metainfo_expecter : trivial_checker, )
+                  writes[i].new_metainfo, *writes[i].write, writes[i].response,
+                  durability, writes[i].timestamp, writes[i].order_token,
+                  writes[i].token_pair, interruptor);
+        }
+    }
+
     /* Expresses the changes that have happened since `start_point` as a
     series of `backfill_chunk_t` objects.
     [Precondition] start_point.get_domain() <= view->get_region()
@@ -582,6 +631,18 @@ public:
         store_view->write(DEBUG_ONLY(metainfo_checker, ) new_metainfo, write, response, durability, timestamp, order_token, token_pair, interruptor);
     }
 
+    void write_batch(
+            DEBUG_ONLY(const metainfo_checker_t<protocol_t>& metainfo_checker, )
+            const std::vector<batched_store_write_t<protocol_t> > &writes,
+            write_durability_t durability,
+            signal_t *interruptor)
+            THROWS_ONLY(interrupted_exc_t) {
+        home_thread_mixin_t::assert_thread();
+        rassert(region_is_superset(get_region(), metainfo_checker.get_domain()));
+
+        store_view->write_batch(DEBUG_ONLY(metainfo_checker, ) writes, durability, interruptor);
+    }
+
     // TODO: Make this take protocol_t::progress_t again (or maybe a
     // progress_receiver_t type that you define).
     bool send_backfill(
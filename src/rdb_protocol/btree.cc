@@ -1,4 +1,6 @@
 // Copyright 2010-2013 RethinkDB, all rights reserved.
+#include <algorithm>
+#include <map>
 #include <string>
 #include <vector>
 
@@ -304,17 +306,16 @@ void do_a_replace_from_batched_replace(auto_drainer_t::lock_t,
                                        ql::env_t *ql_env,
                                        promise_t<superblock_t *> *superblock_promise_or_null,
                                        Datum *response_out,
-                                       rdb_modification_report_cb_t *sindex_cb) {
+                                       rdb_modification_report_t *mod_report_out) {
     fifo_enforcer_sink_t::exit_write_t exiter(batched_replaces_fifo_sink, batched_replaces_fifo_token);
 
     ql::map_wire_func_t f = sttr.replace->f;
-    rdb_modification_report_t mod_report(sttr.replace->key);
+    *mod_report_out = rdb_modification_report_t(sttr.replace->key);
     rdb_replace_and_return_superblock(sttr.slice, sttr.timestamp, sttr.txn, superblock,
                                       sttr.replace->primary_key, sttr.replace->key, &f, ql_env,
-                                      superblock_promise_or_null, response_out, &mod_report.info);
+                                      superblock_promise_or_null, response_out, &mod_report_out->info);
 
     exiter.wait();
-    sindex_cb->on_mod_report(mod_report);
 }
 
 // The int64_t in replaces is ignored -- that's used for preserving order
@@ -325,37 +326,45 @@ void rdb_batched_replace(const std::vector<std::pair<int64_t, point_replace_t> >
                          transaction_t *txn, scoped_ptr_t<superblock_t> *superblock, ql::env_t *ql_env,
                          batched_replaces_response_t *response_out,
                          rdb_modification_report_cb_t *sindex_cb) {
-    fifo_enforcer_source_t batched_replaces_fifo_source;
-    fifo_enforcer_sink_t batched_replaces_fifo_sink;
+    // The secondary indexes are updated for the whole batch at once, after
+    // all of the replaces are done.
+    std::vector<rdb_modification_report_t> mod_reports(replaces.size());
 
-    // Note the destructor ordering: We have to drain write operations before
-    // destructing the batched_replaces_fifo_sink, because the coroutines being
-    // drained use said fifo.
-    auto_drainer_t drainer;
-
-    // Note the destructor ordering: We release the superblock before draining on all the write operations.
-    scoped_ptr_t<superblock_t> current_superblock(superblock->release());
-
-    response_out->point_replace_responses.resize(replaces.size());
-    for (size_t i = 0; i < replaces.size(); ++i) {
-        // Pass out the int64_t for shard/unshard reordering.
-        response_out->point_replace_responses[i].first = replaces[i].first;
-
-        // Pass out the point_replace_response_t.
-        promise_t<superblock_t *> superblock_promise;
-        coro_t::spawn(boost::bind(&do_a_replace_from_batched_replace,
-                                  auto_drainer_t::lock_t(&drainer),
-                                  &batched_replaces_fifo_sink,
-                                  batched_replaces_fifo_source.enter_write(),
-                                  slice_timestamp_txn_replace_t(slice, timestamp, txn, &replaces[i].second),
-                                  current_superblock.release(),
-                                  ql_env,
-                                  &superblock_promise,
-                                  &response_out->point_replace_responses[i].second,
-                                  sindex_cb));
-
-        current_superblock.init(superblock_promise.wait());
+    {
+        fifo_enforcer_source_t batched_replaces_fifo_source;
+        fifo_enforcer_sink_t batched_replaces_fifo_sink;
+
+        // Note the destructor ordering: We have to drain write operations before
+        // destructing the batched_replaces_fifo_sink, because the coroutines being
+        // drained use said fifo.
+        auto_drainer_t drainer;
+
+        // Note the destructor ordering: We release the superblock before draining on all the write operations.
+        scoped_ptr_t<superblock_t> current_superblock(superblock->release());
+
+        response_out->point_replace_responses.resize(replaces.size());
+        for (size_t i = 0; i < replaces.size(); ++i) {
+            // Pass out the int64_t for shard/unshard reordering.
+            response_out->point_replace_responses[i].first = replaces[i].first;
+
+            // Pass out the point_replace_response_t.
+            promise_t<superblock_t *> superblock_promise;
+            coro_t::spawn(boost::bind(&do_a_replace_from_batched_replace,
+                                      auto_drainer_t::lock_t(&drainer),
+                                      &batched_replaces_fifo_sink,
+                                      batched_replaces_fifo_source.enter_write(),
+                                      slice_timestamp_txn_replace_t(slice, timestamp, txn, &replaces[i].second),
+                                      current_superblock.release(),
+                                      ql_env,
+                                      &superblock_promise,
+                                      &response_out->point_replace_responses[i].second,
+                                      &mod_reports[i]));
+
+            current_superblock.init(superblock_promise.wait());
+        }
     }
+
+    sindex_cb->on_mod_reports(mod_reports);
 }
 
 void rdb_set(const store_key_t &key, boost::shared_ptr<scoped_cJSON_t> data, bool overwrite,
@@ -615,6 +624,12 @@ public:
         init(range);
     }
     void init(const key_range_t &range) {
+        // `count` without any transforms doesn't need to look at the values,
+        // so we count keys and only fill in the result in `finish`.  We still
+        // visit every key in the range: nothing records per-subtree counts.
+        counting_keys = transform.empty() && terminal
+            && boost::get<ql::count_wire_func_t>(&terminal->variant) != NULL;
+        keys_counted = 0;
         try {
             response->last_considered_key = range.left;
 
@@ -655,6 +670,11 @@ public:
                 response->last_considered_key = store_key;
             }
 
+            if (counting_keys) {
+                ++keys_counted;
+                return true;
+            }
+
             const rdb_value_t *rdb_value = reinterpret_cast<const rdb_value_t *>(value);
 
             json_list_t data;
@@ -722,6 +742,14 @@ public:
         }
 
     }
+    // Called once the traversal is done.
+    void finish() {
+        if (counting_keys && !bad_init) {
+            response->result = ql::wire_datum_t(
+                make_counted<ql::datum_t>(static_cast<double>(keys_counted)));
+        }
+    }
+
     bool bad_init;
     transaction_t *transaction;
     rget_read_response_t *response;
@@ -732,6 +760,9 @@ public:
 
     /* Only present if we're doing a sindex read.*/
     boost::optional<key_range_t> primary_key_range;
+
+    bool counting_keys;
+    int64_t keys_counted;
 };
 
 class result_finalizer_visitor_t : public boost::static_visitor<void> {
@@ -763,8 +794,21 @@ void rdb_rget_slice(btree_slice_t *slice, const key_range_t &range,
                     const rdb_protocol_details::transform_t &transform,
                     const boost::optional<rdb_protocol_details::terminal_t> &terminal,
                     rget_read_response_t *response) {
+    if (transform.empty() && terminal
+        && boost::get<ql::count_wire_func_t>(&terminal->variant) != NULL
+        && range == key_range_t::universe()) {
+        // A plain count of the whole btree is the population in its stat block.
+        response->result = ql::wire_datum_t(make_counted<ql::datum_t>(
+            static_cast<double>(get_btree_population(txn, superblock))));
+        response->last_considered_key = range.left;
+        response->truncated = false;
+        boost::apply_visitor(result_finalizer_visitor_t(), response->result);
+        return;
+    }
+
     rdb_rget_depth_first_traversal_callback_t callback(txn, ql_env, transform, terminal, range, response);
     btree_depth_first_traversal(slice, txn, superblock, range, &callback);
+    callback.finish();
 
     if (callback.cumulative_size >= rget_max_chunk_size) {
         response->truncated = true;
@@ -784,6 +828,7 @@ void rdb_rget_secondary_slice(btree_slice_t *slice, const key_range_t &range,
                     rget_read_response_t *response) {
     rdb_rget_depth_first_traversal_callback_t callback(txn, ql_env, transform, terminal, range, pk_range, response);
     btree_depth_first_traversal(slice, txn, superblock, range, &callback);
+    callback.finish();
 
     if (callback.cumulative_size >= rget_max_chunk_size) {
         response->truncated = true;
@@ -901,6 +946,15 @@ rdb_modification_report_cb_t::~rdb_modification_report_cb_t() {
 
 void rdb_modification_report_cb_t::on_mod_report(
         const rdb_modification_report_t &mod_report) {
+    on_mod_reports(std::vector<rdb_modification_report_t>(1, mod_report));
+}
+
+void rdb_modification_report_cb_t::on_mod_reports(
+        const std::vector<rdb_modification_report_t> &mod_reports) {
+    if (mod_reports.empty()) {
+        return;
+    }
+
     if (!sindex_block_.has()) {
         // Don't allow interruption here, or we may end up with inconsistent data
         cond_t dummy_interruptor;
@@ -912,30 +966,43 @@ void rdb_modification_report_cb_t::on_mod_report(
                 sindex_block_.get(), txn_, &sindexes_);
     }
 
-    mutex_t::acq_t acq;
-    store_->lock_sindex_queue(sindex_block_.get(), &acq);
+    {
+        mutex_t::acq_t acq;
+        store_->lock_sindex_queue(sindex_block_.get(), &acq);
 
-    write_message_t wm;
-    wm << rdb_sindex_change_t(mod_report);
-    store_->sindex_queue_push(wm, &acq);
+        for (auto it = mod_reports.begin(); it != mod_reports.end(); ++it) {
+            write_message_t wm;
+            wm << rdb_sindex_change_t(*it);
+            store_->sindex_queue_push(wm, &acq);
+        }
+    }
 
-    rdb_update_sindexes(sindexes_, &mod_report, txn_);
+    rdb_update_sindexes(sindexes_, mod_reports, txn_);
 }
 
 typedef btree_store_t<rdb_protocol_t>::sindex_access_vector_t sindex_access_vector_t;
 
+/* One change to a secondary index btree.  A NULL `added` means the key has to
+be deleted. */
+struct sindex_change_t {
+    sindex_change_t(const store_key_t &_key,
+                    const boost::shared_ptr<scoped_cJSON_t> &_added)
+        : key(_key), added(_added) { }
+
+    store_key_t key;
+    boost::shared_ptr<scoped_cJSON_t> added;
+};
+
+static bool sindex_change_less(const sindex_change_t &a, const sindex_change_t &b) {
+    return a.key < b.key;
+}
+
 /* Used below by rdb_update_sindexes. */
 void rdb_update_single_sindex(
         const btree_store_t<rdb_protocol_t>::sindex_access_t *sindex,
-        const rdb_modification_report_t *modification,
+        const std::vector<rdb_modification_report_t> *modifications,
         transaction_t *txn,
         auto_drainer_t::lock_t) {
-    // Note if you get this error it's likely that you've passed in a default
-    // constructed mod_report. Don't do that.  Mod reports should always be passed
-    // to a function as an output parameter before they're passed to this
-    // function.
-    guarantee(modification->primary_key.size() != 0);
-
     ql::map_wire_func_t mapping;
     vector_read_stream_t read_stream(&sindex->sindex.opaque_definition);
     int success = deserialize(&read_stream, &mapping);
@@ -949,75 +1016,100 @@ void rdb_update_single_sindex(
     cond_t non_interruptor;
     ql::env_t env(&non_interruptor);
 
-    superblock_t *super_block = sindex->super_block.get();
+    /* A row may be modified more than once in a batch.  Only its value before
+    the first modification is in the index, and only its value after the last
+    modification has to end up there. */
+    std::map<store_key_t, rdb_modification_info_t> net_modifications;
+    for (auto it = modifications->begin(); it != modifications->end(); ++it) {
+        // Note if you get this error it's likely that you've passed in a default
+        // constructed mod_report. Don't do that.  Mod reports should always be passed
+        // to a function as an output parameter before they're passed to this
+        // function.
+        guarantee(it->primary_key.size() != 0);
+
+        auto net = net_modifications.find(it->primary_key);
+        if (net == net_modifications.end()) {
+            net_modifications.insert(std::make_pair(it->primary_key, it->info));
+        } else {
+            net->second.added = it->info.added;
+        }
+    }
 
-    if (modification->info.deleted) {
-        try {
-            promise_t<superblock_t *> return_superblock_local;
-            {
+    std::vector<sindex_change_t> changes;
+    for (auto it = net_modifications.begin(); it != net_modifications.end(); ++it) {
+        if (it->second.deleted) {
+            try {
                 counted_t<const ql::datum_t> deleted =
-                    make_counted<ql::datum_t>(modification->info.deleted, &env);
+                    make_counted<ql::datum_t>(it->second.deleted, &env);
 
                 counted_t<const ql::datum_t> index =
                     mapping.compile(&env)->call(deleted)->as_datum();
 
-                store_key_t sindex_key(
-                    index->print_secondary(modification->primary_key));
+                changes.push_back(sindex_change_t(
+                    store_key_t(index->print_secondary(it->first)),
+                    boost::shared_ptr<scoped_cJSON_t>()));
+            } catch (const ql::base_exc_t &) {
+                // Do nothing (it wasn't actually in the index).
+            }
+        }
 
-                keyvalue_location_t<rdb_value_t> kv_location;
+        if (it->second.added) {
+            try {
+                counted_t<const ql::datum_t> added =
+                    make_counted<ql::datum_t>(it->second.added, &env);
 
-                find_keyvalue_location_for_write(txn, super_block,
-                                                 sindex_key.btree_key(),
-                                                 &kv_location,
-                                                 &sindex->btree->root_eviction_priority,
-                                                 &sindex->btree->stats,
-                                                 &return_superblock_local);
+                counted_t<const ql::datum_t> index
+                    = mapping.compile(&env)->call(added)->as_datum();
 
-                if (kv_location.value.has()) {
-                    kv_location_delete(&kv_location, sindex_key,
-                                       sindex->btree, repli_timestamp_t::distant_past, txn);
-                }
-                //The keyvalue location gets destroyed here.
+                changes.push_back(sindex_change_t(
+                    store_key_t(index->print_secondary(it->first)),
+                    it->second.added));
+            } catch (const ql::base_exc_t &) {
+                // Do nothing (we just drop the row from the index).
             }
-            super_block = return_superblock_local.wait();
-        } catch (const ql::base_exc_t &) {
-            // Do nothing (it wasn't actually in the index).
         }
     }
 
-    if (modification->info.added) {
-        try {
-            counted_t<const ql::datum_t> added =
-                make_counted<ql::datum_t>(modification->info.added, &env);
-
-            counted_t<const ql::datum_t> index
-                = mapping.compile(&env)->call(added)->as_datum();
-
-            store_key_t sindex_key(index->print_secondary(modification->primary_key));
+    /* Applying the changes in key order means that consecutive descents go
+    through the same nodes, which are still in the cache.  The sort is stable
+    so that if a row's index key didn't change, we delete it before setting it
+    again. */
+    std::stable_sort(changes.begin(), changes.end(), &sindex_change_less);
 
+    superblock_t *super_block = sindex->super_block.get();
+    for (auto it = changes.begin(); it != changes.end(); ++it) {
+        promise_t<superblock_t *> return_superblock_local;
+        {
             keyvalue_location_t<rdb_value_t> kv_location;
 
-            promise_t<superblock_t *> dummy;
-            find_keyvalue_location_for_write(txn,
-                                             super_block,
-                                             sindex_key.btree_key(),
+            find_keyvalue_location_for_write(txn, super_block,
+                                             it->key.btree_key(),
                                              &kv_location,
                                              &sindex->btree->root_eviction_priority,
                                              &sindex->btree->stats,
-                                             &dummy);
-
-            kv_location_set(&kv_location, sindex_key,
-                            modification->info.added, sindex->btree,
-                            repli_timestamp_t::distant_past, txn);
-        } catch (const ql::base_exc_t &) {
-            // Do nothing (we just drop the row from the index).
+                                             &return_superblock_local);
+
+            if (it->added) {
+                kv_location_set(&kv_location, it->key,
+                                it->added, sindex->btree,
+                                repli_timestamp_t::distant_past, txn);
+            } else if (kv_location.value.has()) {
+                kv_location_delete(&kv_location, it->key,
+                                   sindex->btree, repli_timestamp_t::distant_past, txn);
+            }
+            //The keyvalue location gets destroyed here.
         }
+        super_block = return_superblock_local.wait();
     }
 }
 
 void rdb_update_sindexes(const sindex_access_vector_t &sindexes,
-        const rdb_modification_report_t *modification,
+        const std::vector<rdb_modification_report_t> &modifications,
         transaction_t *txn) {
+    if (modifications.empty()) {
+        return;
+    }
+
     auto_drainer_t drainer;
 
     for (sindex_access_vector_t::const_iterator it  = sindexes.begin();
@@ -1025,10 +1117,18 @@ void rdb_update_sindexes(const sindex_access_vector_t &sindexes,
                                                 ++it) {
         coro_t::spawn_sometime(boost::bind(
                     &rdb_update_single_sindex, &*it,
-                    modification, txn, auto_drainer_t::lock_t(&drainer)));
+                    &modifications, txn, auto_drainer_t::lock_t(&drainer)));
     }
 }
 
+void rdb_update_sindexes(const sindex_access_vector_t &sindexes,
+        const rdb_modification_report_t *modification,
+        transaction_t *txn) {
+    rdb_update_sindexes(sindexes,
+                        std::vector<rdb_modification_report_t>(1, *modification),
+                        txn);
+}
+
 void rdb_erase_range_sindexes(const sindex_access_vector_t &sindexes,
         const rdb_erase_range_report_t *erase_range,
         transaction_t *txn, signal_t *interruptor) {
@@ -1101,6 +1201,7 @@ public:
         const leaf_node_t *leaf_node = static_cast<const leaf_node_t *>(leaf_node_buf->get_data_read());
         leaf::live_iter_t node_iter = leaf::iter_for_whole_leaf(leaf_node);
 
+        std::vector<rdb_modification_report_t> mod_reports;
         const btree_key_t *key;
         while ((key = node_iter.get_key(leaf_node))) {
             /* Grab relevant values from the leaf node. */
@@ -1109,12 +1210,12 @@ public:
             node_iter.step(leaf_node);
 
             store_key_t pk(key);
-            rdb_modification_report_t mod_report(pk);
+            mod_reports.push_back(rdb_modification_report_t(pk));
             const rdb_value_t *rdb_value = static_cast<const rdb_value_t *>(value);
-            mod_report.info.added = get_data(rdb_value, txn);
-
-            rdb_update_sindexes(sindexes, &mod_report, wtxn.get());
+            mod_reports.back().info.added = get_data(rdb_value, txn);
         }
+
+        rdb_update_sindexes(sindexes, mod_reports, wtxn.get());
     }
 
     void postprocess_internal_node(buf_lock_t *) { }
@@ -141,6 +141,9 @@ void rdb_erase_range(btree_slice_t *slice, key_tester_t *tester,
                      write_token_pair_t *token_pair,
                      signal_t *interruptor);
 
+// Reads the JSON document that `value` points to.
+boost::shared_ptr<scoped_cJSON_t> get_data(const rdb_value_t *value, transaction_t *txn);
+
 /* RGETS */
 size_t estimate_rget_response_size(const boost::shared_ptr<scoped_cJSON_t> &json);
 
@@ -149,6 +152,9 @@ struct rget_response_t {
     bool truncated;
 };
 
+/* A plain `count` of the whole btree is read off its stat block.  Any other
+`count`, such as one over part of the key range, still walks every key in the
+range, but without loading the values. */
 void rdb_rget_slice(btree_slice_t *slice, const key_range_t &range,
                     transaction_t *txn, superblock_t *superblock,
                     ql::env_t *ql_env,
@@ -215,6 +221,9 @@ public:
             boost::shared_ptr<scoped_cJSON_t> removed);
 
     void on_mod_report(const rdb_modification_report_t &mod_report);
+    // Like calling `on_mod_report` on each report, but updates the secondary
+    // indexes in one go.
+    void on_mod_reports(const std::vector<rdb_modification_report_t> &mod_reports);
 
     ~rdb_modification_report_cb_t();
 private:
@@ -236,6 +245,13 @@ void rdb_update_sindexes(
         const rdb_modification_report_t *modification,
         transaction_t *txn);
 
+/* Updates the secondary indexes for a batch of modifications, in the order
+they were made.  Each index's changes are sorted and applied in one pass. */
+void rdb_update_sindexes(
+        const btree_store_t<rdb_protocol_t>::sindex_access_vector_t &sindexes,
+        const std::vector<rdb_modification_report_t> &modifications,
+        transaction_t *txn);
+
 void rdb_erase_range_sindexes(
         const btree_store_t<rdb_protocol_t>::sindex_access_vector_t &sindexes,
         const rdb_erase_range_report_t *erase_range,
@@ -6,8 +6,12 @@
 #include <math.h>
 #include <algorithm>
 
+#include "errors.hpp"
+#include <boost/functional/hash.hpp>
+
 #include "rdb_protocol/env.hpp"
 #include "rdb_protocol/error.hpp"
+#include "rdb_protocol/func.hpp"
 #include "rdb_protocol/proto_utils.hpp"
 
 namespace ql {
@@ -31,6 +35,12 @@ datum_t::datum_t(const std::vector<counted_t<const datum_t> > &_array)
 datum_t::datum_t(const std::map<std::string, counted_t<const datum_t> > &_object)
     : type(R_OBJECT),
       r_object(new std::map<std::string, counted_t<const datum_t> >(_object)) { }
+datum_t::datum_t(std::vector<counted_t<const datum_t> > &&_array)
+    : type(R_ARRAY),
+      r_array(new std::vector<counted_t<const datum_t> >(std::move(_array))) { }
+datum_t::datum_t(std::map<std::string, counted_t<const datum_t> > &&_object)
+    : type(R_OBJECT),
+      r_object(new std::map<std::string, counted_t<const datum_t> >(std::move(_object))) { }
 datum_t::datum_t(datum_t::type_t _type) : type(_type) {
     r_sanity_check(type == R_ARRAY || type == R_OBJECT || type == R_NULL);
     switch (type) {
@@ -71,6 +81,61 @@ datum_t::~datum_t() {
     }
 }
 
+// Freed datums are threaded onto a per-thread free list through their first
+// word.  A datum freed on another thread than the one that allocated it simply
+// joins that thread's list.  The lists are capped so that a thread that once
+// held many datums doesn't keep the memory forever.
+#ifndef VALGRIND
+struct free_datum_t {
+    free_datum_t *next;
+};
+
+static const size_t MAX_FREE_DATUMS_PER_THREAD = 16384;
+
+static __thread free_datum_t *free_datums = NULL;
+static __thread size_t num_free_datums = 0;
+#endif
+
+static __thread uint64_t datum_allocations = 0;
+static __thread uint64_t datum_allocations_reused = 0;
+
+void *datum_t::operator new(size_t size) {
+    ++datum_allocations;
+#ifndef VALGRIND
+    if (size == sizeof(datum_t) && free_datums != NULL) {
+        free_datum_t *d = free_datums;
+        free_datums = d->next;
+        --num_free_datums;
+        ++datum_allocations_reused;
+        return d;
+    }
+#endif
+    return ::operator new(size);
+}
+
+void datum_t::operator delete(void *ptr, UNUSED size_t size) {
+    if (ptr == NULL) {
+        return;
+    }
+#ifndef VALGRIND
+    if (size == sizeof(datum_t) && num_free_datums < MAX_FREE_DATUMS_PER_THREAD) {
+        free_datum_t *d = static_cast<free_datum_t *>(ptr);
+        d->next = free_datums;
+        free_datums = d;
+        ++num_free_datums;
+        return;
+    }
+#endif
+    ::operator delete(ptr);
+}
+
+datum_allocation_stats_t get_datum_allocation_stats() {
+    datum_allocation_stats_t stats;
+    stats.allocations = datum_allocations;
+    stats.reused = datum_allocations_reused;
+    return stats;
+}
+
 void datum_t::init_str() {
     type = R_STR;
     r_str = new std::string();
@@ -522,7 +587,7 @@ datum_t::as_datum_stream(env_t *env,
 void datum_t::add(counted_t<const datum_t> val) {
     check_type(R_ARRAY);
     r_sanity_check(val.has());
-    r_array->push_back(val);
+    r_array->push_back(std::move(val));
 }
 
 MUST_USE bool datum_t::add(const std::string &key, counted_t<const datum_t> val,
@@ -530,8 +595,13 @@ MUST_USE bool datum_t::add(const std::string &key, counted_t<const datum_t> val,
     check_type(R_OBJECT);
     check_str_validity(key);
     r_sanity_check(val.has());
-    bool key_in_obj = r_object->count(key) > 0;
-    if (!key_in_obj || (clobber_bool == CLOBBER)) (*r_object)[key] = val;
+    auto it = r_object->lower_bound(key);
+    bool key_in_obj = it != r_object->end() && it->first == key;
+    if (!key_in_obj) {
+        r_object->insert(it, std::make_pair(key, std::move(val)));
+    } else if (clobber_bool == CLOBBER) {
+        it->second = std::move(val);
+    }
     return key_in_obj;
 }
 
@@ -619,6 +689,37 @@ int datum_t::cmp(const datum_t &rhs) const {
     }
 }
 
+size_t datum_t::hash() const {
+    size_t seed = get_type();
+    switch (get_type()) {
+    case R_NULL: break;
+    case R_BOOL: {
+        boost::hash_combine(seed, as_bool());
+    } break;
+    case R_NUM: {
+        // `cmp` considers 0.0 and -0.0 equal.
+        boost::hash_combine(seed, as_num() == 0 ? 0.0 : as_num());
+    } break;
+    case R_STR: {
+        boost::hash_combine(seed, *r_str);
+    } break;
+    case R_ARRAY: {
+        for (size_t i = 0; i < r_array->size(); ++i) {
+            boost::hash_combine(seed, (*r_array)[i]->hash());
+        }
+    } break;
+    case R_OBJECT: {
+        for (std::map<std::string, counted_t<const datum_t> >::const_iterator
+                 it = r_object->begin(); it != r_object->end(); ++it) {
+            boost::hash_combine(seed, it->first);
+            boost::hash_combine(seed, it->second->hash());
+        }
+    } break;
+    default: unreachable();
+    }
+    return seed;
+}
+
 bool datum_t::operator== (const datum_t &rhs) const { return cmp(rhs) == 0;  }
 bool datum_t::operator!= (const datum_t &rhs) const { return cmp(rhs) != 0;  }
 bool datum_t::operator<  (const datum_t &rhs) const { return cmp(rhs) == -1; }
@@ -651,6 +752,7 @@ datum_t::datum_t(const Datum *d, env_t *env) {
     } break;
     case Datum_DatumType_R_ARRAY: {
         init_array();
+        r_array->reserve(d->r_array_size());
         for (int i = 0; i < d->r_array_size(); ++i) {
             r_array->push_back(make_counted<datum_t>(&d->r_array(i), env));
         }
@@ -661,10 +763,11 @@ datum_t::datum_t(const Datum *d, env_t *env) {
             const Datum_AssocPair *ap = &d->r_object(i);
             const std::string &key = ap->key();
             check_str_validity(key);
-            rcheck(r_object->count(key) == 0,
+            auto it = r_object->lower_bound(key);
+            rcheck(it == r_object->end() || it->first != key,
                    base_exc_t::GENERIC,
                    strprintf("Duplicate key %s in object.", key.c_str()));
-            (*r_object)[key] = make_counted<datum_t>(&ap->val(), env);
+            r_object->insert(it, std::make_pair(key, make_counted<datum_t>(&ap->val(), env)));
         }
     } break;
     default: unreachable();
@@ -711,6 +814,36 @@ void datum_t::write_to_protobuf(Datum *d) const {
     }
 }
 
+size_t datum_t::estimated_size() const {
+    // Every datum pays for its type tag and a length prefix.
+    size_t size = 2;
+    switch (get_type()) {
+    case R_NULL: break;
+    case R_BOOL: {
+        size += 1;
+    } break;
+    case R_NUM: {
+        size += sizeof(double);
+    } break;
+    case R_STR: {
+        size += r_str->size();
+    } break;
+    case R_ARRAY: {
+        for (size_t i = 0; i < r_array->size(); ++i) {
+            size += (*r_array)[i]->estimated_size();
+        }
+    } break;
+    case R_OBJECT: {
+        for (std::map<std::string, counted_t<const datum_t> >::const_iterator
+                 it = r_object->begin(); it != r_object->end(); ++it) {
+            size += it->first.size() + it->second->estimated_size();
+        }
+    } break;
+    default: unreachable();
+    }
+    return size;
+}
+
 counted_t<const datum_t> wire_datum_t::get() const {
     r_sanity_check(state == COMPILED);
     return ptr;
@@ -746,8 +879,9 @@ bool wire_datum_map_t::has(counted_t<const datum_t> key) {
 
 counted_t<const datum_t> wire_datum_map_t::get(counted_t<const datum_t> key) {
     r_sanity_check(state == COMPILED);
-    r_sanity_check(has(key));
-    return map[key];
+    auto it = map.find(key);
+    r_sanity_check(it != map.end());
+    return it->second;
 }
 
 void wire_datum_map_t::set(counted_t<const datum_t> key, counted_t<const datum_t> val) {
@@ -755,6 +889,19 @@ void wire_datum_map_t::set(counted_t<const datum_t> key, counted_t<const datum_t
     map[key] = val;
 }
 
+void wire_datum_map_t::merge(const wire_datum_map_t &rhs,
+                             counted_t<func_t> reduce) {
+    r_sanity_check(state == COMPILED && rhs.state == COMPILED);
+    for (auto it = rhs.map.begin(); it != rhs.map.end(); ++it) {
+        auto lhs = map.find(it->first);
+        if (lhs == map.end()) {
+            map.insert(*it);
+        } else {
+            lhs->second = reduce->call_reduction(lhs->second, it->second);
+        }
+    }
+}
+
 void wire_datum_map_t::compile(env_t *env) {
     if (state == COMPILED) return;
     while (!map_pb.empty()) {
@@ -776,10 +923,21 @@ void wire_datum_map_t::finalize() {
     state = SERIALIZABLE;
 }
 
+static bool group_less(const std::pair<counted_t<const datum_t>,
+                                       counted_t<const datum_t> > &a,
+                       const std::pair<counted_t<const datum_t>,
+                                       counted_t<const datum_t> > &b) {
+    return *a.first < *b.first;
+}
+
 counted_t<const datum_t> wire_datum_map_t::to_arr() const {
     r_sanity_check(state == COMPILED);
+    std::vector<std::pair<counted_t<const datum_t>, counted_t<const datum_t> > >
+        sorted(map.begin(), map.end());
+    std::sort(sorted.begin(), sorted.end(), &group_less);
+
     scoped_ptr_t<datum_t> arr(new datum_t(datum_t::R_ARRAY));
-    for (auto it = map.begin(); it != map.end(); ++it) {
+    for (auto it = sorted.begin(); it != sorted.end(); ++it) {
         scoped_ptr_t<datum_t> obj(new datum_t(datum_t::R_OBJECT));
         bool b1 = obj->add("group", it->first);
         bool b2 = obj->add("reduction", it->second);
@@ -3,6 +3,7 @@
 
 #include <map>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -23,6 +24,7 @@ RDB_DECLARE_SERIALIZABLE(Datum);
 namespace ql {
 class datum_stream_t;
 class env_t;
+class func_t;
 class val_t;
 
 // These let us write e.g. `foo(NOTHROW) instead of `foo(false/*nothrow*/)`.
@@ -60,6 +62,9 @@ public:
     explicit datum_t(const char *cstr);
     explicit datum_t(const std::vector<counted_t<const datum_t> > &_array);
     explicit datum_t(const std::map<std::string, counted_t<const datum_t> > &_object);
+    // These take over the elements without touching their refcounts.
+    explicit datum_t(std::vector<counted_t<const datum_t> > &&_array);
+    explicit datum_t(std::map<std::string, counted_t<const datum_t> > &&_object);
 
     // These construct a datum from an equivalent representation.
     datum_t(const Datum *d, env_t *env);
@@ -68,8 +73,17 @@ public:
 
     ~datum_t();
 
+    // Queries create and destroy datums at a high rate, so freed datums are
+    // kept on a per-thread free list and handed out again (see datum.cc).
+    static void *operator new(size_t size);
+    static void operator delete(void *ptr, size_t size);
+
     void write_to_protobuf(Datum *out) const;
 
+    // A cheap estimate of how many bytes this datum takes up when serialized,
+    // used to keep batches of rows to a reasonable size.
+    size_t estimated_size() const;
+
     type_t get_type() const;
     const char *get_type_name() const;
     std::string print() const;
@@ -133,6 +147,9 @@ public:
     bool operator>(const datum_t &rhs) const;
     bool operator>=(const datum_t &rhs) const;
 
+    // Consistent with `cmp`: data that compare equal hash the same.
+    size_t hash() const;
+
     virtual void runtime_check(base_exc_t::type_t exc_type,
                                const char *test, const char *file, int line,
                                bool pred, std::string msg) const {
@@ -166,6 +183,14 @@ private:
     DISABLE_COPYING(datum_t);
 };
 
+// How many datums the current thread has allocated, and how many of those
+// allocations were served from its free list rather than by malloc.
+struct datum_allocation_stats_t {
+    uint64_t allocations;
+    uint64_t reused;
+};
+datum_allocation_stats_t get_datum_allocation_stats();
+
 // A `wire_datum_t` is necessary to serialize data over the wire.
 class wire_datum_t {
 public:
@@ -220,21 +245,33 @@ public:
     bool has(counted_t<const datum_t> key);
     counted_t<const datum_t> get(counted_t<const datum_t> key);
     void set(counted_t<const datum_t> key, counted_t<const datum_t> val);
+    // Adds the groups of `rhs`, combining the reductions of groups that are
+    // in both maps with `reduce`.
+    void merge(const wire_datum_map_t &rhs, counted_t<func_t> reduce);
 
     void compile(env_t *env);
     void finalize();
 
     counted_t<const datum_t> to_arr() const;
 private:
-    struct datum_value_compare_t {
-        bool operator()(counted_t<const datum_t> a, counted_t<const datum_t> b) const {
-            return *a < *b;
+    struct datum_value_hash_t {
+        size_t operator()(const counted_t<const datum_t> &d) const {
+            return d->hash();
+        }
+    };
+    struct datum_value_equal_t {
+        bool operator()(const counted_t<const datum_t> &a,
+                        const counted_t<const datum_t> &b) const {
+            return *a == *b;
         }
     };
 
-    std::map<counted_t<const datum_t>,
-             counted_t<const datum_t>,
-             datum_value_compare_t> map;
+    // Groups are only put in order once, by `to_arr`, so that looking up a
+    // group costs a hash instead of O(log n) `datum_t::cmp` calls.
+    std::unordered_map<counted_t<const datum_t>,
+                       counted_t<const datum_t>,
+                       datum_value_hash_t,
+                       datum_value_equal_t> map;
     std::vector<std::pair<Datum, Datum> > map_pb;
 
 public:
@@ -9,6 +9,42 @@
 
 namespace ql {
 
+// BATCHSPEC_T
+batchspec_t::batchspec_t(size_t _max_els, size_t _max_bytes, size_t _first_scaledown)
+    : max_els(_max_els), max_bytes(_max_bytes), first_scaledown(_first_scaledown) {
+    r_sanity_check(max_els > 0 && max_bytes > 0 && first_scaledown > 0);
+}
+
+// Reads a positive integer global optarg, or returns `default_val` if the
+// client didn't specify it.
+static size_t positive_optarg(env_t *env, const char *name, size_t default_val) {
+    counted_t<val_t> v = env->get_optarg(name);
+    if (!v.has()) {
+        return default_val;
+    }
+    int64_t i = v->as_int();
+    rcheck_target(v, base_exc_t::GENERIC, i > 0,
+                  strprintf("`%s` must be positive (got %" PRIi64 ").", name, i));
+    return i;
+}
+
+batchspec_t batchspec_t::user(env_t *env) {
+    return batchspec_t(positive_optarg(env, "batch_size", DEFAULT_MAX_ELS),
+                       positive_optarg(env, "max_batch_bytes", DEFAULT_MAX_BYTES),
+                       positive_optarg(env, "first_batch_scaledown",
+                                       DEFAULT_FIRST_SCALEDOWN));
+}
+
+batchspec_t batchspec_t::writes() {
+    return batchspec_t(WRITES_MAX_ELS, DEFAULT_MAX_BYTES, 1);
+}
+
+batchspec_t batchspec_t::first_batch() const {
+    return batchspec_t(std::max<size_t>(max_els / first_scaledown, 1),
+                       std::max<size_t>(max_bytes / first_scaledown, 1),
+                       1);
+}
+
 // DATUM_STREAM_T
 counted_t<datum_stream_t> datum_stream_t::slice(size_t l, size_t r) {
     return make_counted<slice_datum_stream_t>(env, l, r, this->counted_from_this());
@@ -32,16 +68,20 @@ counted_t<const datum_t> datum_stream_t::next() {
     }
 }
 
-std::vector<counted_t<const datum_t> > datum_stream_t::next_batch() {
+std::vector<counted_t<const datum_t> >
+datum_stream_t::next_batch(const batchspec_t &batchspec) {
     env->throw_if_interruptor_pulsed();
     try {
         std::vector<counted_t<const datum_t> > batch;
+        size_t batch_bytes = 0;
         for (;;) {
             counted_t<const datum_t> datum = next_impl();
-            if (datum.has()) {
-                batch.push_back(datum);
+            if (!datum.has()) {
+                return batch;
             }
-            if (!datum.has() || batch.size() == MAX_BATCH_SIZE) {
+            batch_bytes += datum->estimated_size();
+            batch.push_back(datum);
+            if (batchspec.is_full(batch.size(), batch_bytes)) {
                 return batch;
             }
         }
@@ -68,7 +108,7 @@ counted_t<const datum_t> eager_datum_stream_t::reduce(counted_t<val_t> base_val,
            "Cannot reduce over an empty stream with no base.");
 
     while (counted_t<const datum_t> rhs = next()) {
-        base = f->call(base, rhs)->as_datum();
+        base = f->call_reduction(base, rhs);
     }
     return base;
 }
@@ -83,9 +123,9 @@ counted_t<const datum_t> eager_datum_stream_t::gmr(counted_t<func_t> group,
         counted_t<const datum_t> el_map = map->call(el)->as_datum();
         if (!wd_map.has(el_group)) {
             wd_map.set(el_group,
-                       base.has() ? reduce->call(base, el_map)->as_datum() : el_map);
+                       base.has() ? reduce->call_reduction(base, el_map) : el_map);
         } else {
-            wd_map.set(el_group, reduce->call(wd_map.get(el_group), el_map)->as_datum());
+            wd_map.set(el_group, reduce->call_reduction(wd_map.get(el_group), el_map));
         }
     }
     return wd_map.to_arr();
@@ -189,7 +229,7 @@ counted_t<const datum_t> lazy_datum_stream_t::reduce(counted_t<val_t> base_val,
     if (wire_datum_t *wire_datum = boost::get<wire_datum_t>(&res)) {
         counted_t<const datum_t> datum = wire_datum->compile(env);
         if (base_val.has()) {
-            return f->call(base_val->as_datum(), datum)->as_datum();
+            return f->call_reduction(base_val->as_datum(), datum);
         } else {
             return datum;
         }
@@ -225,13 +265,15 @@ counted_t<const datum_t> lazy_datum_stream_t::gmr(counted_t<func_t> g,
             counted_t<const datum_t> key = dm_arr->get(f)->get("group");
             counted_t<const datum_t> val = dm_arr->get(f)->get("reduction");
             r_sanity_check(!map.has(key));
-            map.set(key, r->call(base, val)->as_datum());
+            map.set(key, r->call_reduction(base, val));
         }
         return map.to_arr();
     }
 }
 
 counted_t<const datum_t> lazy_datum_stream_t::next_impl() {
+    // The stream cache swaps in a new interruptor for every batch it reads.
+    json_stream->reset_interruptor(env->interruptor);
     boost::shared_ptr<scoped_cJSON_t> json = json_stream->next();
     return json ? make_counted<datum_t>(json, env) : counted_t<datum_t>();
 }
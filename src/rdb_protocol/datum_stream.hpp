@@ -13,6 +13,44 @@ class json_stream_t;
 
 namespace ql {
 
+// Describes how large a batch pulled out of a `datum_stream_t` may get.  A
+// batch is full as soon as it holds `max_els` elements or `max_bytes` bytes of
+// data, whichever comes first.  (A non-empty stream always yields at least one
+// element per batch, no matter how large that element is.)
+class batchspec_t {
+public:
+    // The limits requested by the client through the `batch_size`,
+    // `max_batch_bytes` and `first_batch_scaledown` global optargs, with
+    // defaults for the ones it didn't specify.
+    static batchspec_t user(env_t *env);
+    // The limits for the batches of rows that write terms process together.
+    static batchspec_t writes();
+
+    // The first batch of a stream is made smaller by `first_scaledown` so that
+    // clients see their first rows sooner.
+    batchspec_t first_batch() const;
+
+    bool is_full(size_t els, size_t bytes) const {
+        return els >= max_els || bytes >= max_bytes;
+    }
+
+private:
+#ifndef NDEBUG
+    static const size_t DEFAULT_MAX_ELS = 5;
+#else
+    static const size_t DEFAULT_MAX_ELS = 1000;
+#endif // NDEBUG
+    static const size_t DEFAULT_MAX_BYTES = MEGABYTE;
+    static const size_t DEFAULT_FIRST_SCALEDOWN = 4;
+    static const size_t WRITES_MAX_ELS = 100;
+
+    batchspec_t(size_t _max_els, size_t _max_bytes, size_t _first_scaledown);
+
+    size_t max_els;
+    size_t max_bytes;
+    size_t first_scaledown;
+};
+
 class datum_stream_t : public single_threaded_countable_t<datum_stream_t>,
                        public pb_rcheckable_t {
 public:
@@ -49,17 +87,15 @@ public:
     // Gets the next element from the stream.  (Wrapper around `next_impl`.)
     counted_t<const datum_t> next();
 
-    // Gets the next elements from the stream.  (Returns zero elements only when
-    // the end of the stream has been reached.  Otherwise, returns at least one
-    // element.)  (Wrapper around `next_batch_impl`.)
-    std::vector<counted_t<const datum_t> > next_batch();
+    // Gets the next elements from the stream, as many as fit in `batchspec`.
+    // (Returns zero elements only when the end of the stream has been reached.
+    // Otherwise, returns at least one element.)
+    std::vector<counted_t<const datum_t> > next_batch(const batchspec_t &batchspec);
 
 protected:
     env_t *env;
 
 private:
-    static const size_t MAX_BATCH_SIZE = 100;
-
     // Returns NULL upon end of stream.
     virtual counted_t<const datum_t> next_impl() = 0;
 };
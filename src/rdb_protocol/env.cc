@@ -62,6 +62,20 @@ bool env_t::var_allows_implicit(int varnum) {
     return varnum >= min_normal_gensym;
 }
 
+bool env_t::has_gensyms_to_spare() const {
+    return next_gensym_val > min_normal_gensym / 4;
+}
+
+void env_t::set_plan_literals(std::map<const Term *, term_t *> *literals) {
+    r_sanity_check(plan_literals == NULL || literals == NULL);
+    plan_literals = literals;
+}
+void env_t::record_plan_literal(const Term *source, term_t *term) {
+    if (plan_literals != NULL) {
+        (*plan_literals)[source] = term;
+    }
+}
+
 void env_t::push_implicit(counted_t<const datum_t> *val) {
     implicit_var.push(val);
 }
@@ -214,6 +228,7 @@ env_t::env_t(
   : uuid(generate_uuid()),
     optargs(_optargs),
     next_gensym_val(-2),
+    plan_literals(NULL),
     implicit_depth(0),
     pool(_pool_group->get()),
     ns_repo(_ns_repo),
@@ -232,6 +247,7 @@ env_t::env_t(
 env_t::env_t(signal_t *_interruptor)
   : uuid(generate_uuid()),
     next_gensym_val(-2),
+    plan_literals(NULL),
     implicit_depth(0),
     pool(NULL),
     ns_repo(NULL),
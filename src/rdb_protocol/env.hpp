@@ -40,9 +40,23 @@ public:
     // returns a globaly unique variable
     int gensym(bool allow_implicit = false);
     static bool var_allows_implicit(int varnum);
+    // False once a quarter of the gensyms have been handed out.  Envs that
+    // outlive a single query (see plan_cache.hpp) are retired at that point, so
+    // that no query runs out of them.
+    bool has_gensyms_to_spare() const;
 private:
     int next_gensym_val; // always negative
 
+public:
+    // While a plan for the query plan cache is being compiled, DATUM terms
+    // record themselves here by source node, so that the plan can rebind them
+    // to the literals of later queries with the same shape (see
+    // plan_cache.hpp).  NULL the rest of the time.
+    void set_plan_literals(std::map<const Term *, term_t *> *literals);
+    void record_plan_literal(const Term *source, term_t *term);
+private:
+    std::map<const Term *, term_t *> *plan_literals;
+
 public:
     // Bind a variable in the current scope.
     void push_var(int var, counted_t<const datum_t> *val);
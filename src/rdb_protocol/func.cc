@@ -11,13 +11,44 @@
 namespace ql {
 
 func_t::func_t(env_t *env, js::id_t id, counted_t<term_t> parent)
-    : pb_rcheckable_t(parent->backtrace()), source(parent->get_src()),
-      js_parent(parent), js_env(env), js_id(id) {
+    : pb_rcheckable_t(parent->backtrace()), builtin_reduction(NOT_BUILTIN),
+      source(parent->get_src()), js_parent(parent), js_env(env), js_id(id) {
     env->dump_scope(&scope);
 }
 
+// Whether `t` is `VAR(var)`, or `NTH(VAR(var), index)` if `index` isn't -1.
+static bool is_var_or_nth(const Term &t, int var, int index) {
+    const Term *v = &t;
+    if (index != -1) {
+        if (t.type() != Term_TermType_NTH || t.args_size() != 2
+            || t.optargs_size() != 0) {
+            return false;
+        }
+        const Term *i = &t.args(1);
+        if (i->type() != Term_TermType_DATUM
+            || i->datum().type() != Datum_DatumType_R_NUM
+            || i->datum().r_num() != index) {
+            return false;
+        }
+        v = &t.args(0);
+    }
+    return v->type() == Term_TermType_VAR && v->args_size() == 1
+        && v->optargs_size() == 0
+        && v->args(0).type() == Term_TermType_DATUM
+        && v->args(0).datum().type() == Datum_DatumType_R_NUM
+        && v->args(0).datum().r_num() == var;
+}
+
+static bool is_add_of(const Term &t, int lhs_var, int lhs_index,
+                      int rhs_var, int rhs_index) {
+    return t.type() == Term_TermType_ADD && t.args_size() == 2
+        && t.optargs_size() == 0
+        && is_var_or_nth(t.args(0), lhs_var, lhs_index)
+        && is_var_or_nth(t.args(1), rhs_var, rhs_index);
+}
+
 func_t::func_t(env_t *env, protob_t<const Term> _source)
-    : pb_rcheckable_t(_source), source(_source),
+    : pb_rcheckable_t(_source), builtin_reduction(NOT_BUILTIN), source(_source),
       js_env(NULL), js_id(js::INVALID_ID) {
     protob_t<const Term> t = _source;
     r_sanity_check(t->type() == Term_TermType_FUNC);
@@ -72,6 +103,17 @@ func_t::func_t(env_t *env, protob_t<const Term> _source)
 
     protob_t<const Term> body_source = t.make_child(&t->args(1));
     body = compile_term(env, body_source);
+    if (args.size() == 2) {
+        if (is_add_of(*body_source, args[0], -1, args[1], -1)) {
+            builtin_reduction = ADD_ARGS;
+        } else if (body_source->type() == Term_TermType_MAKE_ARRAY
+                   && body_source->args_size() == 2
+                   && body_source->optargs_size() == 0
+                   && is_add_of(body_source->args(0), args[0], 0, args[1], 0)
+                   && is_add_of(body_source->args(1), args[0], 1, args[1], 1)) {
+            builtin_reduction = ADD_PAIRS;
+        }
+    }
 
     for (size_t i = 0; i < args.size(); ++i) {
         env->pop_var(args[i]);
@@ -116,6 +158,43 @@ counted_t<val_t> func_t::call(const std::vector<counted_t<const datum_t> > &args
     }
 }
 
+static bool is_num_pair(const counted_t<const datum_t> &d) {
+    return d->get_type() == datum_t::R_ARRAY && d->size() >= 2
+        && d->get(0)->get_type() == datum_t::R_NUM
+        && d->get(1)->get_type() == datum_t::R_NUM;
+}
+
+counted_t<const datum_t> func_t::call_reduction(counted_t<const datum_t> lhs,
+                                                counted_t<const datum_t> rhs) {
+    try {
+        switch (builtin_reduction) {
+        case NOT_BUILTIN: break;
+        case ADD_ARGS: {
+            if (lhs->get_type() == datum_t::R_NUM
+                && rhs->get_type() == datum_t::R_NUM) {
+                return make_counted<datum_t>(lhs->as_num() + rhs->as_num());
+            }
+        } break;
+        case ADD_PAIRS: {
+            if (is_num_pair(lhs) && is_num_pair(rhs)) {
+                std::vector<counted_t<const datum_t> > pair;
+                pair.push_back(make_counted<datum_t>(
+                                   lhs->get(0)->as_num() + rhs->get(0)->as_num()));
+                pair.push_back(make_counted<datum_t>(
+                                   lhs->get(1)->as_num() + rhs->get(1)->as_num()));
+                return make_counted<datum_t>(pair);
+            }
+        } break;
+        default: unreachable();
+        }
+    } catch (const datum_exc_t &e) {
+        rfail(e.get_type(), "%s", e.what());
+        unreachable();
+    }
+    // Anything else (e.g. adding strings) goes through the general path.
+    return call(lhs, rhs)->as_datum();
+}
+
 counted_t<val_t> func_t::call() {
     std::vector<counted_t<const datum_t> > args;
     return call(args);
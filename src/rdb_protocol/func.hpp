@@ -37,6 +37,12 @@ public:
     counted_t<val_t> call(counted_t<const datum_t> arg);
     counted_t<val_t> call(counted_t<const datum_t> arg1, counted_t<const datum_t> arg2);
     bool filter_call(counted_t<const datum_t> arg);
+    // Calls a reduction function.  Reductions that just add up their
+    // arguments, like the ones `groupby` generates for `COUNT`, `SUM` and
+    // `AVG`, are evaluated without going through `body` when they're given
+    // numbers.
+    counted_t<const datum_t> call_reduction(counted_t<const datum_t> lhs,
+                                            counted_t<const datum_t> rhs);
 
     void dump_scope(std::map<int64_t, Datum> *out) const;
     bool is_deterministic() const;
@@ -49,6 +55,11 @@ private:
     scoped_array_t<counted_t<const datum_t> > argptrs;
     counted_t<term_t> body; // body to evaluate with functions bound
 
+    // `ADD_ARGS` is `{|a, b| a + b}`, `ADD_PAIRS` is
+    // `{|a, b| [a[0] + b[0], a[1] + b[1]]}`.
+    enum builtin_reduction_t { NOT_BUILTIN, ADD_ARGS, ADD_PAIRS };
+    builtin_reduction_t builtin_reduction;
+
     // This is what's serialized over the wire.
     friend class wire_func_t;
     protob_t<const Term> source;
@@ -0,0 +1,555 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include "rdb_protocol/json_reader.hpp"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <limits>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "config/args.hpp"
+#include "rdb_protocol/datum.hpp"
+#include "utils.hpp"
+
+namespace ql {
+
+/* The structural pass looks at the text in blocks of 64 bytes, and describes
+each block with 64-bit masks that have bit `i` set if byte `i` is of some kind. */
+static const size_t JSON_BLOCK_SIZE = 64;
+
+struct json_block_masks_t {
+    uint64_t quotes;
+    uint64_t backslashes;
+    uint64_t structurals;  // {}[]:,
+    uint64_t whitespace;
+};
+
+#if defined(__SSE2__)
+
+static inline uint64_t bytes_equal_mask(__m128i chunk, char c) {
+    return static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(c))));
+}
+
+static void classify_block(const char *block, json_block_masks_t *masks) {
+    masks->quotes = masks->backslashes = masks->structurals = masks->whitespace = 0;
+    for (size_t i = 0; i < JSON_BLOCK_SIZE; i += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + i));
+        masks->quotes |= bytes_equal_mask(chunk, '"') << i;
+        masks->backslashes |= bytes_equal_mask(chunk, '\\') << i;
+        masks->structurals |= (bytes_equal_mask(chunk, '{') | bytes_equal_mask(chunk, '}')
+                               | bytes_equal_mask(chunk, '[') | bytes_equal_mask(chunk, ']')
+                               | bytes_equal_mask(chunk, ':') | bytes_equal_mask(chunk, ',')) << i;
+        masks->whitespace |= (bytes_equal_mask(chunk, ' ') | bytes_equal_mask(chunk, '\t')
+                              | bytes_equal_mask(chunk, '\n') | bytes_equal_mask(chunk, '\r')) << i;
+    }
+}
+
+#else
+
+static void classify_block(const char *block, json_block_masks_t *masks) {
+    masks->quotes = masks->backslashes = masks->structurals = masks->whitespace = 0;
+    for (size_t i = 0; i < JSON_BLOCK_SIZE; ++i) {
+        const uint64_t bit = static_cast<uint64_t>(1) << i;
+        switch (block[i]) {
+        case '"': masks->quotes |= bit; break;
+        case '\\': masks->backslashes |= bit; break;
+        case '{': case '}': case '[': case ']': case ':': case ',':
+            masks->structurals |= bit;
+            break;
+        case ' ': case '\t': case '\n': case '\r': masks->whitespace |= bit; break;
+        default: break;
+        }
+    }
+}
+
+#endif  // defined(__SSE2__)
+
+/* Returns the bytes that are escaped by a backslash.  A backslash that is
+itself escaped doesn't escape anything.  `*escape_carry` says whether the first
+byte of the block is escaped by the last byte of the previous one.  Backslashes
+are rare enough that going through them one at a time is fine. */
+static uint64_t find_escaped(uint64_t backslashes, uint64_t *escape_carry) {
+    uint64_t escaped = 0;
+    if (*escape_carry != 0) {
+        escaped |= 1;
+        backslashes &= ~static_cast<uint64_t>(1);
+    }
+    *escape_carry = 0;
+    while (backslashes != 0) {
+        const int bit = __builtin_ctzll(backslashes);
+        if (bit == 63) {
+            *escape_carry = 1;
+            break;
+        }
+        escaped |= static_cast<uint64_t>(1) << (bit + 1);
+        backslashes &= ~(static_cast<uint64_t>(3) << bit);
+    }
+    return escaped;
+}
+
+// Bit `i` of the result is the XOR of bits `0` through `i` of `x`.
+static uint64_t prefix_xor(uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+/* Appends to `*out` the position of every unescaped quote, every bracket,
+colon and comma outside of strings, and the first byte of every literal (a
+number, `true`, `false` or `null`, or something invalid).  Everything else is
+either whitespace or inside a string.  Returns false if a string is left open
+at the end of the text. */
+static bool find_structurals(const char *json, size_t size, std::vector<uint32_t> *out) {
+    uint64_t escape_carry = 0;
+    // All ones if the previous block ended inside a string.
+    uint64_t in_string_carry = 0;
+    // Whether the previous byte was whitespace, a quote or a structural
+    // character, so that a literal starting here starts a new token.
+    uint64_t token_boundary_carry = 1;
+
+    char tail[JSON_BLOCK_SIZE];
+    for (size_t base = 0; base < size; base += JSON_BLOCK_SIZE) {
+        const char *block = json + base;
+        if (size - base < JSON_BLOCK_SIZE) {
+            memset(tail, ' ', JSON_BLOCK_SIZE);
+            memcpy(tail, block, size - base);
+            block = tail;
+        }
+
+        json_block_masks_t masks;
+        classify_block(block, &masks);
+
+        const uint64_t quotes = masks.quotes & ~find_escaped(masks.backslashes, &escape_carry);
+        // Set for an opening quote and the string's contents, but not for the
+        // closing quote.
+        const uint64_t in_string = prefix_xor(quotes) ^ in_string_carry;
+        in_string_carry = static_cast<uint64_t>(static_cast<int64_t>(in_string) >> 63);
+
+        const uint64_t structurals = masks.structurals & ~in_string;
+        const uint64_t whitespace = masks.whitespace & ~in_string;
+        const uint64_t token_boundaries = structurals | whitespace | quotes;
+        const uint64_t literal_starts = ~(token_boundaries | in_string)
+            & ((token_boundaries << 1) | token_boundary_carry);
+        token_boundary_carry = token_boundaries >> 63;
+
+        uint64_t positions = structurals | quotes | literal_starts;
+        while (positions != 0) {
+            const size_t offset = base + __builtin_ctzll(positions);
+            if (offset >= size) {
+                break;
+            }
+            out->push_back(offset);
+            positions &= positions - 1;
+        }
+    }
+    return in_string_carry == 0;
+}
+
+static bool is_token_boundary(char c) {
+    switch (c) {
+    case ' ': case '\t': case '\n': case '\r':
+    case '{': case '}': case '[': case ']': case ':': case ',': case '"':
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static int hex_digit_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static void append_utf8(uint32_t code_point, std::string *out) {
+    if (code_point < 0x80) {
+        out->push_back(code_point);
+    } else if (code_point < 0x800) {
+        out->push_back(0xc0 | (code_point >> 6));
+        out->push_back(0x80 | (code_point & 0x3f));
+    } else if (code_point < 0x10000) {
+        out->push_back(0xe0 | (code_point >> 12));
+        out->push_back(0x80 | ((code_point >> 6) & 0x3f));
+        out->push_back(0x80 | (code_point & 0x3f));
+    } else {
+        out->push_back(0xf0 | (code_point >> 18));
+        out->push_back(0x80 | ((code_point >> 12) & 0x3f));
+        out->push_back(0x80 | ((code_point >> 6) & 0x3f));
+        out->push_back(0x80 | (code_point & 0x3f));
+    }
+}
+
+/* The second pass.  Containers that are still open are kept on an explicit
+stack rather than recursing.  The datums it builds are still freed and printed
+recursively, though, so the stack isn't allowed to grow past
+JSON_READER_MAX_NESTING_DEPTH. */
+class json_reader_t {
+public:
+    json_reader_t(const char *_json, size_t _size) : json(_json), size(_size), next(0) { }
+
+    counted_t<const datum_t> read(std::string *error_out);
+
+private:
+    struct frame_t {
+        explicit frame_t(bool _is_object) : is_object(_is_object) { }
+        bool is_object;
+        std::vector<counted_t<const datum_t> > array;
+        std::map<std::string, counted_t<const datum_t> > object;
+        std::string key;
+    };
+
+    bool fail(size_t offset, const std::string &message) {
+        error = strprintf("%s at offset %zu.", message.c_str(), offset);
+        return false;
+    }
+
+    bool fail_at_end() {
+        return fail(size, "Unexpected end of JSON");
+    }
+
+    // The position of the next structural character, or `size` if there
+    // isn't one.
+    size_t peek_position() const {
+        return next < positions.size() ? positions[next] : size;
+    }
+
+    bool read_string(std::string *out);
+    bool read_key(std::string *out);
+    bool read_literal(counted_t<const datum_t> *out);
+    bool close_container(frame_t *frame, counted_t<const datum_t> *out);
+
+    const char *const json;
+    const size_t size;
+
+    std::vector<uint32_t> positions;
+    size_t next;
+
+    std::string error;
+
+    DISABLE_COPYING(json_reader_t);
+};
+
+bool json_reader_t::read_string(std::string *out) {
+    rassert(next < positions.size() && json[positions[next]] == '"');
+    // The structural pass doesn't record anything inside strings, and it has
+    // already checked that every string is closed, so the closing quote is the
+    // next position.
+    guarantee(next + 1 < positions.size());
+    const char *p = json + positions[next] + 1;
+    const char *const end = json + positions[next + 1];
+    rassert(*end == '"');
+    next += 2;
+
+    out->clear();
+    out->reserve(end - p);
+    while (p < end) {
+        // Copy everything up to the next escape or control character at once.
+        const char *run = p;
+        while (p < end && *p != '\\' && static_cast<unsigned char>(*p) >= 0x20) {
+            ++p;
+        }
+        out->append(run, p - run);
+        if (p == end) {
+            break;
+        }
+        if (*p != '\\') {
+            return fail(p - json, "Unescaped control character in string");
+        }
+        ++p;
+        rassert(p < end);
+        switch (*p) {
+        case '"': out->push_back('"'); break;
+        case '\\': out->push_back('\\'); break;
+        case '/': out->push_back('/'); break;
+        case 'b': out->push_back('\b'); break;
+        case 'f': out->push_back('\f'); break;
+        case 'n': out->push_back('\n'); break;
+        case 'r': out->push_back('\r'); break;
+        case 't': out->push_back('\t'); break;
+        case 'u': {
+            uint32_t code_point = 0;
+            for (int surrogate = 0; ; ++surrogate) {
+                if (end - p < 5) {
+                    return fail(p - json, "Truncated \\u escape in string");
+                }
+                uint32_t unit = 0;
+                for (int i = 1; i <= 4; ++i) {
+                    const int digit = hex_digit_value(p[i]);
+                    if (digit < 0) {
+                        return fail(p + i - json, "Invalid \\u escape in string");
+                    }
+                    unit = (unit << 4) | digit;
+                }
+                p += 4;
+                if (surrogate == 0) {
+                    if (unit >= 0xdc00 && unit <= 0xdfff) {
+                        return fail(p - json, "Unpaired UTF-16 surrogate in string");
+                    } else if (unit >= 0xd800 && unit <= 0xdbff) {
+                        // A high surrogate has to be followed by `\u` and a
+                        // low surrogate.
+                        if (end - p < 3 || p[1] != '\\' || p[2] != 'u') {
+                            return fail(p - json, "Unpaired UTF-16 surrogate in string");
+                        }
+                        code_point = unit;
+                        p += 2;
+                        continue;
+                    }
+                    code_point = unit;
+                } else {
+                    if (unit < 0xdc00 || unit > 0xdfff) {
+                        return fail(p - json, "Unpaired UTF-16 surrogate in string");
+                    }
+                    code_point = 0x10000 + ((code_point - 0xd800) << 10) + (unit - 0xdc00);
+                }
+                break;
+            }
+            if (code_point == 0) {
+                return fail(p - json, "NULL byte in string");
+            }
+            append_utf8(code_point, out);
+        } break;
+        default:
+            return fail(p - json, "Invalid escape in string");
+        }
+        ++p;
+    }
+    return true;
+}
+
+bool json_reader_t::read_key(std::string *out) {
+    if (next == positions.size()) {
+        return fail_at_end();
+    }
+    if (json[positions[next]] != '"') {
+        return fail(positions[next], "Expected a string as an object key");
+    }
+    if (!read_string(out)) {
+        return false;
+    }
+    if (next == positions.size()) {
+        return fail_at_end();
+    }
+    if (json[positions[next]] != ':') {
+        return fail(positions[next], "Expected `:` after an object key");
+    }
+    ++next;
+    return true;
+}
+
+bool json_reader_t::read_literal(counted_t<const datum_t> *out) {
+    const size_t start = positions[next];
+    size_t end = start;
+    while (end < size && !is_token_boundary(json[end])) {
+        ++end;
+    }
+    ++next;
+
+    const char *const p = json + start;
+    const size_t length = end - start;
+    if (length == 4 && memcmp(p, "true", 4) == 0) {
+        *out = make_counted<datum_t>(datum_t::R_BOOL, true);
+        return true;
+    } else if (length == 5 && memcmp(p, "false", 5) == 0) {
+        *out = make_counted<datum_t>(datum_t::R_BOOL, false);
+        return true;
+    } else if (length == 4 && memcmp(p, "null", 4) == 0) {
+        *out = make_counted<datum_t>(datum_t::R_NULL);
+        return true;
+    }
+
+    // Anything else has to be a number: -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+    size_t i = 0;
+    if (i < length && p[i] == '-') {
+        ++i;
+    }
+    if (i < length && p[i] == '0') {
+        ++i;
+    } else if (i < length && is_digit(p[i])) {
+        while (i < length && is_digit(p[i])) ++i;
+    } else {
+        return fail(start, "Invalid value");
+    }
+    if (i < length && p[i] == '.') {
+        ++i;
+        if (i == length || !is_digit(p[i])) {
+            return fail(start, "Invalid number");
+        }
+        while (i < length && is_digit(p[i])) ++i;
+    }
+    if (i < length && (p[i] == 'e' || p[i] == 'E')) {
+        ++i;
+        if (i < length && (p[i] == '+' || p[i] == '-')) {
+            ++i;
+        }
+        if (i == length || !is_digit(p[i])) {
+            return fail(start, "Invalid number");
+        }
+        while (i < length && is_digit(p[i])) ++i;
+    }
+    if (i != length) {
+        return fail(start, "Invalid number");
+    }
+
+    // `strtod` wants a NUL-terminated string, and the text we were given
+    // might end right after the number.
+    char buf[64];
+    std::string long_number;
+    const char *number = buf;
+    if (length < sizeof(buf)) {
+        memcpy(buf, p, length);
+        buf[length] = '\0';
+    } else {
+        long_number.assign(p, length);
+        number = long_number.c_str();
+    }
+    const double value = strtod(number, NULL);
+    // so we can use `isfinite` in a GCC 4.4.3-compatible way
+    using namespace std;  // NOLINT(build/namespaces)
+    if (!isfinite(value)) {
+        return fail(start, "Number out of range");
+    }
+    *out = make_counted<datum_t>(value);
+    return true;
+}
+
+bool json_reader_t::close_container(frame_t *frame, counted_t<const datum_t> *out) {
+    rassert(next < positions.size());
+    const char close = frame->is_object ? '}' : ']';
+    if (json[positions[next]] != close) {
+        return fail(positions[next], strprintf("Expected `,` or `%c`", close));
+    }
+    ++next;
+    if (frame->is_object) {
+        *out = make_counted<datum_t>(std::move(frame->object));
+    } else {
+        *out = make_counted<datum_t>(std::move(frame->array));
+    }
+    return true;
+}
+
+counted_t<const datum_t> json_reader_t::read(std::string *error_out) {
+    if (size > std::numeric_limits<uint32_t>::max()) {
+        *error_out = "JSON text is too large to parse.";
+        return counted_t<const datum_t>();
+    }
+    if (!find_structurals(json, size, &positions)) {
+        *error_out = "Unterminated string in JSON.";
+        return counted_t<const datum_t>();
+    }
+
+    std::vector<frame_t> stack;
+    counted_t<const datum_t> value;
+    for (;;) {
+        // Read a value.  If it's the start of an array or object, we go around
+        // again to read its first element.
+        if (next == positions.size()) {
+            fail_at_end();
+            break;
+        }
+        const char c = json[positions[next]];
+        if (c == '{' || c == '[') {
+            if (stack.size() == JSON_READER_MAX_NESTING_DEPTH) {
+                fail(positions[next], strprintf("Arrays and objects nested more than %d deep",
+                                                JSON_READER_MAX_NESTING_DEPTH));
+                break;
+            }
+            ++next;
+            stack.push_back(frame_t(c == '{'));
+            if (next < positions.size() && json[positions[next]] == (c == '{' ? '}' : ']')) {
+                close_container(&stack.back(), &value);
+                stack.pop_back();
+            } else {
+                if (c == '{' && !read_key(&stack.back().key)) {
+                    break;
+                }
+                continue;
+            }
+        } else if (c == '"') {
+            std::string str;
+            if (!read_string(&str)) {
+                break;
+            }
+            value = make_counted<datum_t>(std::move(str));
+        } else if (c == ']' || c == '}' || c == ':' || c == ',') {
+            fail(positions[next], strprintf("Unexpected `%c`", c));
+            break;
+        } else if (!read_literal(&value)) {
+            break;
+        }
+
+        // Put the value in its container, and close every container that ends
+        // after it, until one has another element to read.
+        bool read_another = false;
+        while (!stack.empty()) {
+            frame_t *frame = &stack.back();
+            if (frame->is_object) {
+                auto it = frame->object.lower_bound(frame->key);
+                if (it != frame->object.end() && it->first == frame->key) {
+                    fail(next == 0 ? 0 : positions[next - 1],
+                         strprintf("Duplicate key `%s` in object", frame->key.c_str()));
+                    break;
+                }
+                frame->object.insert(it, std::make_pair(frame->key, std::move(value)));
+            } else {
+                frame->array.push_back(std::move(value));
+            }
+
+            if (next == positions.size()) {
+                fail_at_end();
+                break;
+            }
+            if (json[positions[next]] == ',') {
+                ++next;
+                if (frame->is_object && !read_key(&frame->key)) {
+                    break;
+                }
+                read_another = true;
+                break;
+            }
+            if (!close_container(frame, &value)) {
+                break;
+            }
+            stack.pop_back();
+        }
+        if (!error.empty()) {
+            break;
+        }
+        if (read_another) {
+            continue;
+        }
+
+        if (next != positions.size()) {
+            fail(positions[next], "Unexpected data after the JSON value");
+            break;
+        }
+        return value;
+    }
+
+    guarantee(!error.empty());
+    *error_out = error;
+    return counted_t<const datum_t>();
+}
+
+counted_t<const datum_t> read_json(const char *json, size_t size, std::string *error_out) {
+    json_reader_t reader(json, size);
+    return reader.read(error_out);
+}
+
+}  // namespace ql
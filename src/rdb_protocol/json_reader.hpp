@@ -0,0 +1,30 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_JSON_READER_HPP_
+#define RDB_PROTOCOL_JSON_READER_HPP_
+
+#include <stddef.h>
+
+#include <string>
+
+#include "containers/counted.hpp"
+
+namespace ql {
+
+class datum_t;
+
+// Parses the JSON text in `[json, json + size)` straight into a datum, without
+// building a cJSON tree first.  The text doesn't need to be NUL-terminated.
+// Returns an empty pointer and sets `*error_out` if it isn't valid JSON, or if
+// it is JSON that can't be a datum (duplicate keys, NUL bytes in strings,
+// numbers too big to be finite, or arrays and objects nested more than
+// JSON_READER_MAX_NESTING_DEPTH deep).
+//
+// It works the way simdjson does: a first pass finds every quote, bracket,
+// colon, comma and start of a literal outside of strings, 64 bytes at a time
+// (using SSE2 where we have it), and a second pass walks that list of
+// positions to build the datum.
+counted_t<const datum_t> read_json(const char *json, size_t size, std::string *error_out);
+
+}  // namespace ql
+
+#endif  // RDB_PROTOCOL_JSON_READER_HPP_
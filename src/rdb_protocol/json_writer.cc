@@ -0,0 +1,201 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include "rdb_protocol/json_writer.hpp"
+
+#include <math.h>
+#include <stdio.h>
+
+#include <map>
+#include <vector>
+
+#include "rdb_protocol/datum.hpp"
+#include "rdb_protocol/error.hpp"
+#include "rdb_protocol/ql2.pb.h"
+
+namespace ql {
+
+static void write_json_string(const std::string &s, std::string *out) {
+    static const char hex_digits[] = "0123456789abcdef";
+    out->push_back('"');
+    const char *run_start = s.data();
+    const char *const end = s.data() + s.size();
+    for (const char *p = run_start; p < end; ++p) {
+        const unsigned char c = *p;
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        // Copy everything up to here in one go, then the escaped character.
+        out->append(run_start, p - run_start);
+        run_start = p + 1;
+        switch (c) {
+        case '"': out->append("\\\"", 2); break;
+        case '\\': out->append("\\\\", 2); break;
+        case '\b': out->append("\\b", 2); break;
+        case '\f': out->append("\\f", 2); break;
+        case '\n': out->append("\\n", 2); break;
+        case '\r': out->append("\\r", 2); break;
+        case '\t': out->append("\\t", 2); break;
+        default: {
+            const char escape[6] = { '\\', 'u', '0', '0',
+                                     hex_digits[c >> 4], hex_digits[c & 0xf] };
+            out->append(escape, sizeof(escape));
+        } break;
+        }
+    }
+    out->append(run_start, end - run_start);
+    out->push_back('"');
+}
+
+static void write_json_number(double d, std::string *out) {
+    // so we can use `isfinite` in a GCC 4.4.3-compatible way
+    using namespace std;  // NOLINT(build/namespaces)
+    r_sanity_check(isfinite(d));
+
+    char buf[32];
+    // Most numbers are integers, which we can print exactly and much faster
+    // than `%.17g` would.  (-0 goes the slow way, to keep its sign.)
+    static const double max_exact_integer = 9007199254740992.0;  // 2^53
+    if (d > -max_exact_integer && d < max_exact_integer && d == floor(d)
+        && !(d == 0 && signbit(d))) {
+        int64_t i = static_cast<int64_t>(d);
+        const bool negative = i < 0;
+        uint64_t u = negative ? -static_cast<uint64_t>(i) : i;
+        char *p = buf + sizeof(buf);
+        do {
+            *--p = '0' + (u % 10);
+            u /= 10;
+        } while (u != 0);
+        if (negative) {
+            *--p = '-';
+        }
+        out->append(p, buf + sizeof(buf) - p);
+    } else {
+        // 17 significant digits are enough to read back the same double.
+        int size = snprintf(buf, sizeof(buf), "%.17g", d);
+        guarantee(size > 0 && static_cast<size_t>(size) < sizeof(buf));
+        out->append(buf, size);
+    }
+}
+
+void write_json(const datum_t &datum, std::string *out) {
+    switch (datum.get_type()) {
+    case datum_t::R_NULL: {
+        out->append("null", 4);
+    } break;
+    case datum_t::R_BOOL: {
+        if (datum.as_bool()) {
+            out->append("true", 4);
+        } else {
+            out->append("false", 5);
+        }
+    } break;
+    case datum_t::R_NUM: {
+        write_json_number(datum.as_num(), out);
+    } break;
+    case datum_t::R_STR: {
+        write_json_string(datum.as_str(), out);
+    } break;
+    case datum_t::R_ARRAY: {
+        const std::vector<counted_t<const datum_t> > &array = datum.as_array();
+        out->push_back('[');
+        for (size_t i = 0; i < array.size(); ++i) {
+            if (i != 0) {
+                out->push_back(',');
+            }
+            write_json(*array[i], out);
+        }
+        out->push_back(']');
+    } break;
+    case datum_t::R_OBJECT: {
+        const std::map<std::string, counted_t<const datum_t> > &object = datum.as_object();
+        out->push_back('{');
+        for (std::map<std::string, counted_t<const datum_t> >::const_iterator
+                 it = object.begin(); it != object.end(); ++it) {
+            if (it != object.begin()) {
+                out->push_back(',');
+            }
+            write_json_string(it->first, out);
+            out->push_back(':');
+            write_json(*it->second, out);
+        }
+        out->push_back('}');
+    } break;
+    default: unreachable();
+    }
+}
+
+void write_json(const Datum &datum, std::string *out) {
+    switch (datum.type()) {
+    case Datum::R_NULL: {
+        out->append("null", 4);
+    } break;
+    case Datum::R_BOOL: {
+        if (datum.r_bool()) {
+            out->append("true", 4);
+        } else {
+            out->append("false", 5);
+        }
+    } break;
+    case Datum::R_NUM: {
+        write_json_number(datum.r_num(), out);
+    } break;
+    case Datum::R_STR: {
+        write_json_string(datum.r_str(), out);
+    } break;
+    case Datum::R_ARRAY: {
+        out->push_back('[');
+        for (int i = 0; i < datum.r_array_size(); ++i) {
+            if (i != 0) {
+                out->push_back(',');
+            }
+            write_json(datum.r_array(i), out);
+        }
+        out->push_back(']');
+    } break;
+    case Datum::R_OBJECT: {
+        out->push_back('{');
+        for (int i = 0; i < datum.r_object_size(); ++i) {
+            if (i != 0) {
+                out->push_back(',');
+            }
+            write_json_string(datum.r_object(i).key(), out);
+            out->push_back(':');
+            write_json(datum.r_object(i).val(), out);
+        }
+        out->push_back('}');
+    } break;
+    default: unreachable();
+    }
+}
+
+void write_json_response(const Response &res, const std::string &payload,
+                         std::string *head_out, std::string *tail_out) {
+    head_out->assign(strprintf("{\"t\":%d,\"r\":[", res.type()));
+
+    tail_out->clear();
+    for (int i = 0; i < res.response_size(); ++i) {
+        if (i != 0 || !payload.empty()) {
+            tail_out->push_back(',');
+        }
+        write_json(res.response(i), tail_out);
+    }
+    tail_out->push_back(']');
+    if (res.has_backtrace()) {
+        tail_out->append(",\"b\":[");
+        const Backtrace &bt = res.backtrace();
+        for (int i = 0; i < bt.frames_size(); ++i) {
+            if (i != 0) {
+                tail_out->push_back(',');
+            }
+            const Frame &frame = bt.frames(i);
+            if (frame.type() == Frame::POS) {
+                write_json_number(frame.pos(), tail_out);
+            } else {
+                write_json_string(frame.opt(), tail_out);
+            }
+        }
+        tail_out->push_back(']');
+    }
+    tail_out->push_back('}');
+}
+
+}  // namespace ql
@@ -0,0 +1,30 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_JSON_WRITER_HPP_
+#define RDB_PROTOCOL_JSON_WRITER_HPP_
+
+#include <string>
+
+class Datum;
+class Response;
+
+namespace ql {
+
+class datum_t;
+
+// These append JSON text to `out`, for clients that asked for JSON responses
+// (see `VersionDummy::V0_3` in ql2.proto).  They don't allocate anything but
+// the space in `out`, so a buffer that is cleared and reused stops allocating
+// once it is big enough.
+void write_json(const datum_t &datum, std::string *out);
+void write_json(const Datum &datum, std::string *out);
+
+// Writes a JSON response in two halves that go around `payload`, which holds
+// results that have already been written as JSON (comma-separated, without the
+// enclosing brackets).  Results in `res.response()` itself, such as error
+// messages, come after those in `payload`.
+void write_json_response(const Response &res, const std::string &payload,
+                         std::string *head_out, std::string *tail_out);
+
+}  // namespace ql
+
+#endif  // RDB_PROTOCOL_JSON_WRITER_HPP_
@@ -6,8 +6,19 @@
 #include "utils.hpp"
 #include <boost/make_shared.hpp>
 
+#include "rdb_protocol/datum.hpp"
+#include "rdb_protocol/json_reader.hpp"
+
 namespace rdb_protocol {
 
+boost::shared_ptr<scoped_cJSON_t> parse_http_document(const std::string &body, std::string *error_out) {
+    counted_t<const ql::datum_t> datum = ql::read_json(body.data(), body.size(), error_out);
+    if (!datum.has()) {
+        return boost::shared_ptr<scoped_cJSON_t>();
+    }
+    return datum->as_json();
+}
+
 query_http_app_t::query_http_app_t(const boost::shared_ptr<semilattice_read_view_t<cluster_semilattice_metadata_t> > &_semilattice_metadata,
                                    namespace_repo_t<rdb_protocol_t> * _ns_repo)
     : semilattice_metadata(_semilattice_metadata), ns_repo(_ns_repo)
@@ -102,10 +113,11 @@ http_res_t query_http_app_t::handle(const http_req_t &req) {
 
                 store_key_t key(*it);
 
-                boost::shared_ptr<scoped_cJSON_t> doc(new scoped_cJSON_t(cJSON_Parse(req.body.c_str())));
+                std::string error;
+                boost::shared_ptr<scoped_cJSON_t> doc = parse_http_document(req.body, &error);
 
-                if (!doc->get()) {
-                    return http_res_t(HTTP_BAD_REQUEST, "text/plain", "Json failed to parse");
+                if (!doc) {
+                    return http_res_t(HTTP_BAD_REQUEST, "text/plain", "Json failed to parse: " + error);
                 }
 
                 rdb_protocol_t::write_response_t write_res;
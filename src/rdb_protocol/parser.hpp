@@ -11,6 +11,11 @@
 
 namespace rdb_protocol {
 
+// Parses the body of a document write with `ql::read_json`, so that it gets
+// the same checks as a document inserted through a query.  Returns an empty
+// pointer and sets `*error_out` if the body isn't a valid document.
+boost::shared_ptr<scoped_cJSON_t> parse_http_document(const std::string &body, std::string *error_out);
+
 class query_http_app_t : public http_app_t {
 public:
     query_http_app_t(const boost::shared_ptr<semilattice_read_view_t<cluster_semilattice_metadata_t> > &_semilattice_metadata, namespace_repo_t<rdb_protocol_t> * _ns_repo);
@@ -7,6 +7,7 @@
 #include "concurrency/cross_thread_watchable.hpp"
 #include "concurrency/watchable.hpp"
 #include "rdb_protocol/counted_term.hpp"
+#include "rdb_protocol/json_writer.hpp"
 #include "rdb_protocol/stream_cache.hpp"
 #include "rpc/semilattice/view/field.hpp"
 
@@ -44,22 +45,36 @@ bool query2_server_t::handle(ql::protob_t<Query> q,
     signal_t *interruptor = query2_context->interruptor;
     guarantee(interruptor);
     response_out->set_token(q->token());
+    std::string *json_out = NULL;
+    if (query2_context->json_responses) {
+        json_out = &query2_context->json_payload;
+        json_out->clear();
+    }
 
     bool response_needed = true;
     try {
-        boost::shared_ptr<js::runner_t> js_runner = boost::make_shared<js::runner_t>();
-        int thread = get_thread_id();
-        guarantee(ctx->directory_read_manager);
-        scoped_ptr_t<ql::env_t> env(
-            new ql::env_t(
-                ctx->pool_group, ctx->ns_repo,
-                ctx->cross_thread_namespace_watchables[thread]->get_watchable(),
-                ctx->cross_thread_database_watchables[thread]->get_watchable(),
-                ctx->cluster_metadata, ctx->directory_read_manager,
-                js_runner, interruptor, ctx->machine_id,
-                std::map<std::string, ql::wire_func_t>()));
+        ql::query_plan_cache_t *plan_cache = plan_caches.get();
+        scoped_ptr_t<ql::query_plan_t> plan;
+        plan_cache->checkout(*q, interruptor, &plan);
+
+        // A cached plan brings the env it was compiled against.
+        scoped_ptr_t<ql::env_t> env;
+        if (!plan.has() || !plan->is_compiled()) {
+            boost::shared_ptr<js::runner_t> js_runner = boost::make_shared<js::runner_t>();
+            int thread = get_thread_id();
+            guarantee(ctx->directory_read_manager);
+            env.init(
+                new ql::env_t(
+                    ctx->pool_group, ctx->ns_repo,
+                    ctx->cross_thread_namespace_watchables[thread]->get_watchable(),
+                    ctx->cross_thread_database_watchables[thread]->get_watchable(),
+                    ctx->cluster_metadata, ctx->directory_read_manager,
+                    js_runner, interruptor, ctx->machine_id,
+                    std::map<std::string, ql::wire_func_t>()));
+        }
         // `ql::run` will set the status code
-        ql::run(q, &env, response_out, stream_cache2, &response_needed);
+        ql::run(q, &env, &plan, response_out, json_out, stream_cache2, &response_needed);
+        plan_cache->checkin(&plan);
     } catch (const interrupted_exc_t &e) {
         ql::fill_error(response_out, Response::RUNTIME_ERROR,
                        "Query interrupted.  Did you shut down the server?");
@@ -67,6 +82,15 @@ bool query2_server_t::handle(ql::protob_t<Query> q,
         ql::fill_error(response_out, Response::RUNTIME_ERROR,
                        strprintf("Unexpected exception: %s\n", e.what()));
     }
+    if (json_out != NULL
+        && (!response_needed
+            || (response_out->type() != Response::SUCCESS_ATOM
+                && response_out->type() != Response::SUCCESS_SEQUENCE
+                && response_out->type() != Response::SUCCESS_PARTIAL))) {
+        // Errors carry their message in `response_out`, not in the payload,
+        // and a payload that won't be sent mustn't end up in the next response.
+        json_out->clear();
+    }
 
     return response_needed;
 }
@@ -78,3 +102,21 @@ void make_empty_protob_bearer(ql::protob_t<Query> *request) {
 Query *underlying_protob_value(ql::protob_t<Query> *request) {
     return request->get();
 }
+
+void send_json_response(const Response &response, query2_server_t::context_t *ctx,
+                        tcp_conn_t *conn, signal_t *closer)
+    THROWS_ONLY(tcp_conn_write_closed_exc_t) {
+    // The payload, which is the bulk of the response, goes straight from the
+    // buffer it was written into to the connection.
+    std::string head, tail;
+    ql::write_json_response(response, ctx->json_payload, &head, &tail);
+    const int64_t token = response.token();
+    const int32_t size = head.size() + ctx->json_payload.size() + tail.size();
+    conn->write_buffered(&token, sizeof(token), closer);
+    conn->write_buffered(&size, sizeof(size), closer);
+    conn->write_buffered(head.data(), head.size(), closer);
+    conn->write_buffered(ctx->json_payload.data(), ctx->json_payload.size(), closer);
+    conn->write_buffered(tail.data(), tail.size(), closer);
+    conn->flush_buffer(closer);
+    ctx->json_payload.clear();
+}
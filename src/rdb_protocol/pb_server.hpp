@@ -11,6 +11,7 @@
 #include "clustering/administration/namespace_metadata.hpp"
 #include "protob/protob.hpp"
 #include "protocol_api.hpp"
+#include "rdb_protocol/plan_cache.hpp"
 #include "rdb_protocol/protocol.hpp"
 #include "rdb_protocol/ql2.hpp"
 
@@ -30,11 +31,17 @@ public:
     int get_port() const;
 
     struct context_t {
-        context_t() : interruptor(0) { }
+        context_t() : interruptor(0), json_responses(false) { }
         static const int32_t no_auth_magic_number = VersionDummy::V0_1;
         static const int32_t auth_magic_number = VersionDummy::V0_2;
+        // Like `auth_magic_number`, but responses are sent as JSON.
+        static const int32_t json_magic_number = VersionDummy::V0_3;
         ql::stream_cache2_t stream_cache2;
         signal_t *interruptor;
+        bool json_responses;
+        // With `json_responses`, the results for the response being built,
+        // already written as JSON.  Reused from one response to the next.
+        std::string json_payload;
     };
 private:
     MUST_USE bool handle(ql::protob_t<Query> q,
@@ -44,9 +51,16 @@ private:
     rdb_protocol_t::context_t *ctx;
     uuid_u parser_id;
     one_per_thread_t<int> thread_counters;
+    one_per_thread_t<ql::query_plan_cache_t> plan_caches;
 
     DISABLE_COPYING(query2_server_t);
 };
 
+// Overload used by protob_server_t to send responses to clients that asked
+// for JSON.
+void send_json_response(const Response &response, query2_server_t::context_t *ctx,
+                        tcp_conn_t *conn, signal_t *closer)
+    THROWS_ONLY(tcp_conn_write_closed_exc_t);
+
 
 #endif /* RDB_PROTOCOL_PB_SERVER_HPP_ */
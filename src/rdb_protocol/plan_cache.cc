@@ -0,0 +1,392 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include "rdb_protocol/plan_cache.hpp"
+
+#include "config/args.hpp"
+#include "perfmon/perfmon.hpp"
+#include "rdb_protocol/env.hpp"
+#include "rdb_protocol/term.hpp"
+#include "rdb_protocol/terms/terms.hpp"
+
+namespace ql {
+
+static perfmon_counter_t pm_query_plan_cache_hits, pm_query_plan_cache_misses,
+    pm_query_plan_cache_evictions, pm_query_plan_compile_usecs_saved;
+static perfmon_multi_membership_t pm_query_plan_cache_membership(
+    &get_global_perfmon_collection(),
+    &pm_query_plan_cache_hits, "query_plan_cache_hits",
+    &pm_query_plan_cache_misses, "query_plan_cache_misses",
+    &pm_query_plan_cache_evictions, "query_plan_cache_evictions",
+    &pm_query_plan_compile_usecs_saved, "query_plan_compile_usecs_saved",
+    NULLPTR);
+
+// Whether queries containing terms of this type can be cached.  A term type is
+// only allowed if compiling it compiles its arguments in place (so that every
+// literal ends up in a DATUM term we can rebind) and doesn't compile or copy
+// anything else that depends on the values of literals.
+static bool is_cacheable_term_type(Term::TermType type) {
+    switch (type) {
+    case Term::DATUM:
+    case Term::MAKE_ARRAY:
+    case Term::MAKE_OBJ:
+    case Term::VAR:
+    case Term::IMPLICIT_VAR:
+    case Term::DB:
+    case Term::TABLE:
+    case Term::GET:
+    case Term::GET_ALL:
+    case Term::EQ:
+    case Term::NE:
+    case Term::LT:
+    case Term::LE:
+    case Term::GT:
+    case Term::GE:
+    case Term::NOT:
+    case Term::ADD:
+    case Term::SUB:
+    case Term::MUL:
+    case Term::DIV:
+    case Term::MOD:
+    case Term::CONTAINS:
+    case Term::GETATTR:
+    case Term::NTH:
+    case Term::COUNT:
+    case Term::INSERT:
+    case Term::FUNCALL:
+    case Term::BRANCH:
+    case Term::ANY:
+    case Term::ALL:
+    case Term::FUNC:
+    case Term::DEFAULT:
+        return true;
+
+    case Term::JAVASCRIPT:
+    case Term::ERROR:
+    case Term::APPEND:
+    case Term::PREPEND:
+    case Term::DIFFERENCE:
+    case Term::SET_INSERT:
+    case Term::SET_INTERSECTION:
+    case Term::SET_UNION:
+    case Term::SET_DIFFERENCE:
+    case Term::SLICE:
+    case Term::INDEXES_OF:
+    case Term::KEYS:
+    case Term::HAS_FIELDS:
+    case Term::WITH_FIELDS:
+    case Term::PLUCK:
+    case Term::WITHOUT:
+    case Term::MERGE:
+    case Term::BETWEEN:
+    case Term::REDUCE:
+    case Term::MAP:
+    case Term::FILTER:
+    case Term::CONCATMAP:
+    case Term::ORDERBY:
+    case Term::DISTINCT:
+    case Term::UNION:
+    case Term::GROUPED_MAP_REDUCE:
+    case Term::LIMIT:
+    case Term::SKIP:
+    case Term::GROUPBY:
+    case Term::INNER_JOIN:
+    case Term::OUTER_JOIN:
+    case Term::EQ_JOIN:
+    case Term::ZIP:
+    case Term::INSERT_AT:
+    case Term::DELETE_AT:
+    case Term::CHANGE_AT:
+    case Term::SPLICE_AT:
+    case Term::COERCE_TO:
+    case Term::TYPEOF:
+    case Term::UPDATE:
+    case Term::DELETE:
+    case Term::REPLACE:
+    case Term::DB_CREATE:
+    case Term::DB_DROP:
+    case Term::DB_LIST:
+    case Term::TABLE_CREATE:
+    case Term::TABLE_DROP:
+    case Term::TABLE_LIST:
+    case Term::INDEX_CREATE:
+    case Term::INDEX_DROP:
+    case Term::INDEX_LIST:
+    case Term::ASC:
+    case Term::DESC:
+    case Term::INFO:
+    case Term::MATCH:
+    case Term::SAMPLE:
+    case Term::IS_EMPTY:
+    case Term::FOREACH:
+        return false;
+    default: unreachable();
+    }
+}
+
+// Whether the literals in argument `i` of `t` are parameters.  The ones that
+// are read while compiling (variable numbers, and the indexes `func_t` looks
+// at to recognize builtin reductions) are part of the shape instead; see
+// `walk_shape` for how variable numbers go into it.
+static bool arg_literals_are_parameters(const Term &t, int i) {
+    return t.type() != Term::VAR
+        && !(t.type() == Term::FUNC && i == 0)
+        && !(t.type() == Term::NTH && i == 1);
+}
+
+static const Term *get_arg(const Term *t, int i) { return &t->args(i); }
+static Term *get_arg(Term *t, int i) { return t->mutable_args(i); }
+static const Term *get_optarg(const Term *t, int i) { return &t->optargs(i).val(); }
+static Term *get_optarg(Term *t, int i) { return t->mutable_optargs(i)->mutable_val(); }
+
+static void append_string(const std::string &s, std::string *out) {
+    out->append(strprintf("%zu:", s.size()));
+    out->append(s);
+}
+
+// Reads the variable numbers a FUNC binds, if `vars` is in one of the forms
+// `func_t` accepts.
+static bool get_func_var_ids(const Term &vars, std::vector<double> *ids_out) {
+    if (vars.type() == Term::DATUM) {
+        if (vars.datum().type() != Datum::R_ARRAY) {
+            return false;
+        }
+        for (int i = 0; i < vars.datum().r_array_size(); ++i) {
+            const Datum &id = vars.datum().r_array(i);
+            if (id.type() != Datum::R_NUM) {
+                return false;
+            }
+            ids_out->push_back(id.r_num());
+        }
+        return true;
+    } else if (vars.type() == Term::MAKE_ARRAY && vars.optargs_size() == 0) {
+        for (int i = 0; i < vars.args_size(); ++i) {
+            const Term &id = vars.args(i);
+            if (id.type() != Term::DATUM || id.datum().type() != Datum::R_NUM) {
+                return false;
+            }
+            ids_out->push_back(id.datum().r_num());
+        }
+        return true;
+    }
+    return false;
+}
+
+// If `t` is a VAR naming a variable that a FUNC around it binds, sets `*depth_out`
+// to that variable's position in `var_scope`, counting from the outermost.
+static bool get_var_binding_depth(const Term &t, const std::vector<double> &var_scope,
+                                  size_t *depth_out) {
+    if (t.type() != Term::VAR || t.args_size() != 1 || t.optargs_size() != 0
+        || t.args(0).type() != Term::DATUM || t.args(0).datum().type() != Datum::R_NUM) {
+        return false;
+    }
+    const double id = t.args(0).datum().r_num();
+    // The innermost binding of a variable hides the outer ones.
+    for (size_t i = var_scope.size(); i > 0; --i) {
+        if (var_scope[i - 1] == id) {
+            *depth_out = i - 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Appends the shape of `t` to `shape_out` (if it isn't NULL) and its parameters
+// to `literals_out`, in the same order every time.  Returns false if `t` can't
+// be cached.
+//
+// Drivers number the variables of each lambda from a counter, so the same
+// query comes with different variable numbers every time it is built.  The
+// shape names variables by binding depth instead: a FUNC only records how many
+// variables it binds, and a VAR records which of the variables bound around
+// it (`var_scope`, outermost first) it is.  A plan compiled for one numbering
+// works for any other, because its terms and its protobuf agree with each
+// other.
+template <class term_ptr_t>
+static bool walk_shape(term_ptr_t t, bool literals_are_parameters,
+                       std::vector<double> *var_scope,
+                       std::string *shape_out,
+                       std::vector<term_ptr_t> *literals_out) {
+    if (!is_cacheable_term_type(t->type())) {
+        return false;
+    }
+    if (shape_out != NULL) {
+        shape_out->append(strprintf("%d(", t->type()));
+    }
+
+    size_t var_depth;
+    if (get_var_binding_depth(*t, *var_scope, &var_depth)) {
+        if (shape_out != NULL) {
+            shape_out->append(strprintf("@%zu)", var_depth));
+        }
+        return true;
+    }
+
+    const size_t outer_scope_size = var_scope->size();
+    int first_arg = 0;
+    if (t->type() == Term::FUNC && t->args_size() > 0
+        && get_func_var_ids(t->args(0), var_scope)) {
+        if (shape_out != NULL) {
+            shape_out->append(strprintf("#%zu", var_scope->size() - outer_scope_size));
+        }
+        first_arg = 1;
+    }
+
+    if (t->type() == Term::DATUM) {
+        if (literals_are_parameters) {
+            literals_out->push_back(t);
+            if (shape_out != NULL) {
+                shape_out->push_back('?');
+            }
+        } else if (shape_out != NULL) {
+            append_string(t->datum().SerializeAsString(), shape_out);
+        }
+    }
+    bool ok = true;
+    for (int i = first_arg; ok && i < t->args_size(); ++i) {
+        ok = walk_shape(get_arg(t, i),
+                        literals_are_parameters && arg_literals_are_parameters(*t, i),
+                        var_scope, shape_out, literals_out);
+    }
+    for (int i = 0; ok && i < t->optargs_size(); ++i) {
+        if (shape_out != NULL) {
+            append_string(t->optargs(i).key(), shape_out);
+        }
+        ok = walk_shape(get_optarg(t, i), literals_are_parameters,
+                        var_scope, shape_out, literals_out);
+    }
+    var_scope->resize(outer_scope_size);
+    if (ok && shape_out != NULL) {
+        shape_out->push_back(')');
+    }
+    return ok;
+}
+
+bool compute_query_shape(const Query &query, std::string *shape_out) {
+    if (query.type() != Query::START || !query.has_query()) {
+        return false;
+    }
+    std::vector<double> var_scope;
+    std::vector<const Term *> literals;
+    if (!walk_shape(&query.query(), true, &var_scope, shape_out, &literals)) {
+        return false;
+    }
+    // Global optargs are compiled into the env, so they have to match exactly.
+    for (int i = 0; i < query.global_optargs_size(); ++i) {
+        append_string(query.global_optargs(i).key(), shape_out);
+        append_string(query.global_optargs(i).val().SerializeAsString(), shape_out);
+    }
+    return true;
+}
+
+query_plan_t::query_plan_t(const std::string &_shape)
+    : shape(_shape), response_needed(true), compile_ticks(0) { }
+
+query_plan_t::~query_plan_t() { }
+
+bool query_plan_t::finish_compile(protob_t<Query> _query, counted_t<term_t> _root,
+                                  bool _response_needed, ticks_t _compile_ticks) {
+    r_sanity_check(!is_compiled());
+    query = _query;
+    root = _root;
+    response_needed = _response_needed;
+    compile_ticks = _compile_ticks;
+
+    std::vector<double> var_scope;
+    bool ok = walk_shape(query->mutable_query(), true, &var_scope,
+                         static_cast<std::string *>(NULL), &literal_slots);
+    r_sanity_check(ok);
+    for (size_t i = 0; i < literal_slots.size(); ++i) {
+        std::map<const Term *, term_t *>::const_iterator it
+            = compile_literals.find(literal_slots[i]);
+        if (it == compile_literals.end()) {
+            return false;
+        }
+        literal_terms.push_back(it->second);
+    }
+    compile_literals.clear();
+    return true;
+}
+
+void query_plan_t::bind(const Query &new_query) {
+    r_sanity_check(is_compiled());
+    std::vector<double> var_scope;
+    std::vector<const Term *> literals;
+    bool ok = walk_shape(&new_query.query(), true, &var_scope,
+                         static_cast<std::string *>(NULL), &literals);
+    r_sanity_check(ok && literals.size() == literal_slots.size());
+    for (size_t i = 0; i < literal_slots.size(); ++i) {
+        // Funcs that get shipped to the shards are serialized from `query`, so
+        // the protobuf has to be kept up to date as well as the terms.
+        *literal_slots[i]->mutable_datum() = literals[i]->datum();
+        rebind_datum_term(literal_terms[i]);
+    }
+}
+
+void query_plan_t::set_interruptor(signal_t *interruptor) {
+    r_sanity_check(env.has());
+    env->interruptor = interruptor;
+}
+
+bool query_plan_t::can_be_reused() const {
+    return is_compiled() && env.has() && env->has_gensyms_to_spare();
+}
+
+query_plan_cache_t::query_plan_cache_t() { }
+
+query_plan_cache_t::~query_plan_cache_t() {
+    for (std::list<query_plan_t *>::iterator it = lru.begin(); it != lru.end(); ++it) {
+        delete *it;
+    }
+}
+
+void query_plan_cache_t::checkout(const Query &query, signal_t *interruptor,
+                                  scoped_ptr_t<query_plan_t> *plan_out) {
+    r_sanity_check(!plan_out->has());
+    std::string shape;
+    if (!compute_query_shape(query, &shape)) {
+        return;
+    }
+
+    std::map<std::string, query_plan_t *>::iterator it = plans.find(shape);
+    if (it == plans.end()) {
+        ++pm_query_plan_cache_misses;
+        plan_out->init(new query_plan_t(shape));
+        return;
+    }
+
+    query_plan_t *plan = it->second;
+    plans.erase(it);
+    lru.erase(plan->lru_entry);
+    plan->set_interruptor(interruptor);
+    ++pm_query_plan_cache_hits;
+    pm_query_plan_compile_usecs_saved += plan->get_compile_ticks() / THOUSAND;
+    plan_out->init(plan);
+}
+
+void query_plan_cache_t::checkin(scoped_ptr_t<query_plan_t> *plan) {
+    if (!plan->has() || !(*plan)->can_be_reused()) {
+        plan->reset();
+        return;
+    }
+    // Another query of the same shape may have compiled its own plan while
+    // this one was checked out; one of them is enough.
+    if (plans.count((*plan)->get_shape()) != 0) {
+        plan->reset();
+        return;
+    }
+
+    query_plan_t *p = plan->release();
+    p->set_interruptor(NULL);
+    plans.insert(std::make_pair(p->get_shape(), p));
+    lru.push_front(p);
+    p->lru_entry = lru.begin();
+
+    while (plans.size() > QUERY_PLAN_CACHE_SIZE) {
+        query_plan_t *victim = lru.back();
+        lru.pop_back();
+        plans.erase(victim->get_shape());
+        delete victim;
+        ++pm_query_plan_cache_evictions;
+    }
+}
+
+}  // namespace ql
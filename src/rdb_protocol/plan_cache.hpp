@@ -0,0 +1,119 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_PLAN_CACHE_HPP_
+#define RDB_PROTOCOL_PLAN_CACHE_HPP_
+
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "containers/counted.hpp"
+#include "containers/scoped.hpp"
+#include "rdb_protocol/counted_term.hpp"
+#include "rdb_protocol/ql2.pb.h"
+#include "utils.hpp"
+
+class signal_t;
+
+namespace ql {
+
+class env_t;
+class term_t;
+
+/* A compiled query, kept so that the next query of the same shape doesn't have
+to be compiled again.  Two queries have the same shape if they differ only in
+the values of their literals; those literals are the plan's parameters, and
+`bind` copies them in before every run.  A plan owns the `env_t` its terms were
+compiled against, and it is used by one query at a time: the cache hands it out
+and takes it back. */
+class query_plan_t {
+public:
+    explicit query_plan_t(const std::string &shape);
+    ~query_plan_t();
+
+    const std::string &get_shape() const { return shape; }
+    bool is_compiled() const { return root.has(); }
+
+    // The table DATUM terms record themselves in while the plan is compiled
+    // (see `env_t::set_plan_literals`).
+    std::map<const Term *, term_t *> *get_compile_literals() { return &compile_literals; }
+
+    // Called by `run` once `root` has been compiled from `query`.  Returns false
+    // if some parameter didn't end up in a DATUM term of its own, in which case
+    // the plan can't be reused.
+    MUST_USE bool finish_compile(protob_t<Query> query, counted_t<term_t> root,
+                                 bool response_needed, ticks_t compile_ticks);
+
+    // Copies the literals of `query`, which must have the plan's shape, into
+    // the plan.  Throws like compiling the literals would.
+    void bind(const Query &query);
+    void set_interruptor(signal_t *interruptor);
+
+    // The env goes to `run` for the duration of a query and comes back if the
+    // plan can be reused.
+    void swap_env(scoped_ptr_t<env_t> *other) { env.swap(*other); }
+    bool can_be_reused() const;
+
+    counted_t<term_t> get_root() const { return root; }
+    bool get_response_needed() const { return response_needed; }
+    ticks_t get_compile_ticks() const { return compile_ticks; }
+
+private:
+    friend class query_plan_cache_t;
+
+    const std::string shape;
+
+    // Declared before the terms, so that it is destroyed after them.
+    scoped_ptr_t<env_t> env;
+
+    protob_t<Query> query;
+    counted_t<term_t> root;
+    bool response_needed;
+    ticks_t compile_ticks;
+
+    std::map<const Term *, term_t *> compile_literals;
+    // The parameters: DATUM nodes of `query` and the terms compiled from them.
+    std::vector<Term *> literal_slots;
+    std::vector<term_t *> literal_terms;
+
+    std::list<query_plan_t *>::iterator lru_entry;
+
+    DISABLE_COPYING(query_plan_t);
+};
+
+/* Each thread's `query2_server_t` keeps a `query_plan_cache_t` of recently used
+plans, keyed by shape and evicted in LRU order.  Only queries built entirely out
+of term types that compile their arguments in place can be cached: rewrites and
+the like copy their source protobuf when they are compiled, so a reused plan
+would keep the literals of the query it was compiled for.  Hits, misses and
+the compilation time the hits saved show up in the stats. */
+class query_plan_cache_t {
+public:
+    query_plan_cache_t();
+    ~query_plan_cache_t();
+
+    // For a START query whose shape can be cached, sets `*plan_out` to the
+    // cached plan for that shape, or to a new, uncompiled plan for `run` to
+    // compile if there is none.  A cached plan leaves the cache until it is
+    // checked back in.  Leaves `*plan_out` empty for other queries.
+    void checkout(const Query &query, signal_t *interruptor,
+                  scoped_ptr_t<query_plan_t> *plan_out);
+
+    // Takes back a plan that `run` left behind (if any).
+    void checkin(scoped_ptr_t<query_plan_t> *plan);
+
+private:
+    std::map<std::string, query_plan_t *> plans;
+    // Most recently used first.
+    std::list<query_plan_t *> lru;
+
+    DISABLE_COPYING(query_plan_cache_t);
+};
+
+// Computes the shape of a START query; returns false if it can't be cached.
+// Exposed for the unit tests.
+bool compute_query_shape(const Query &query, std::string *shape_out);
+
+}  // namespace ql
+
+#endif  // RDB_PROTOCOL_PLAN_CACHE_HPP_
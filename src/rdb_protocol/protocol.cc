@@ -601,7 +601,7 @@ public:
                             } else {
                                 ql::wire_datum_t local_rhs = *rhs;
                                 if (lhs) {
-                                    counted_t<const ql::datum_t> reduced_val = local_reduce_func.compile(&ql_env)->call(lhs->compile(&ql_env), local_rhs.compile(&ql_env))->as_datum();
+                                    counted_t<const ql::datum_t> reduced_val = local_reduce_func.compile(&ql_env)->call_reduction(lhs->compile(&ql_env), local_rhs.compile(&ql_env));
                                     rg_response->result = ql::wire_datum_t(reduced_val);
                                 } else {
                                     guarantee(boost::get<rget_read_response_t::empty_t>(&rg_response->result));
@@ -645,21 +645,8 @@ public:
                             r_sanity_check(rhs);
                             ql::wire_datum_map_t local_rhs = *rhs;
                             local_rhs.compile(&ql_env);
-
-                            counted_t<const ql::datum_t> rhs_arr = local_rhs.to_arr();
-                            for (size_t f = 0; f < rhs_arr->size(); ++f) {
-                                counted_t<const ql::datum_t> key
-                                    = rhs_arr->get(f)->get("group");
-                                counted_t<const ql::datum_t> val
-                                    = rhs_arr->get(f)->get("reduction");
-                                if (!map->has(key)) {
-                                    map->set(key, val);
-                                } else {
-                                    counted_t<ql::func_t> r
-                                        = local_gmr_func.compile_reduce(&ql_env);
-                                    map->set(key, r->call(map->get(key), val)->as_datum());
-                                }
-                            }
+                            map->merge(local_rhs,
+                                       local_gmr_func.compile_reduce(&ql_env));
                         }
                         boost::get<ql::wire_datum_map_t>(rg_response->result).finalize();
                     } else {
@@ -1597,6 +1584,22 @@ void store_t::protocol_reset_data(const region_t& subregion,
     rdb_erase_range(btree, &key_tester, subregion.inner, txn, superblock, this, token_pair, interruptor);
 }
 
+// Documents are exported as JSON, so that tools don't need our serialization.
+class rdb_snapshot_export_value_exporter_t : public snapshot_export_value_exporter_t {
+public:
+    snapshot_export_value_format_t value_format() const {
+        return SNAPSHOT_EXPORT_JSON_VALUES;
+    }
+    void export_value(transaction_t *txn, const void *value, std::string *out) {
+        *out = get_data(static_cast<const rdb_value_t *>(value), txn)->PrintUnformatted();
+    }
+};
+
+snapshot_export_value_exporter_t *store_t::get_snapshot_export_value_exporter() {
+    static rdb_snapshot_export_value_exporter_t exporter;
+    return &exporter;
+}
+
 region_t rdb_protocol_t::cpu_sharding_subspace(int subregion_number,
                                                int num_cpu_shards) {
     guarantee(subregion_number >= 0);
@@ -726,6 +726,8 @@ struct rdb_protocol_t {
                                  superblock_t *superblock,
                                  write_token_pair_t *token_pair,
                                  signal_t *interruptor);
+
+        snapshot_export_value_exporter_t *get_snapshot_export_value_exporter();
         context_t *ctx;
     };
 
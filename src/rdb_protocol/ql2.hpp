@@ -2,19 +2,27 @@
 #ifndef RDB_PROTOCOL_QL2_HPP_
 #define RDB_PROTOCOL_QL2_HPP_
 
+#include <string>
+
 #include "utils.hpp"
 
 #include "rdb_protocol/counted_term.hpp"
 #include "rdb_protocol/env.hpp"
+#include "rdb_protocol/plan_cache.hpp"
 #include "rdb_protocol/ql2.pb.h"
 #include "rdb_protocol/stream_cache.hpp"
 #include "rdb_protocol/term.hpp"
 
 namespace ql {
 // Runs a query!  This is all outside code should ever need to call.  See
-// term.cc for definition.
+// term.cc for definition.  `plan` holds what `query_plan_cache_t::checkout`
+// gave us; on a cache hit `*env_ptr` is empty, because the plan brings its own
+// env.  Whatever is left in `plan` afterwards can go back to the cache.  If
+// `json_out` isn't NULL, results are written there as JSON instead of into
+// `res` (see json_writer.hpp).
 void run(protob_t<Query> q, scoped_ptr_t<env_t> *env_ptr,
-         Response *res, stream_cache2_t *stream_cache2,
+         scoped_ptr_t<query_plan_t> *plan,
+         Response *res, std::string *json_out, stream_cache2_t *stream_cache2,
          bool *response_needed_out);
 } // namespace ql
 
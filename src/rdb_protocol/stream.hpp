@@ -78,6 +78,10 @@ public:
     boost::shared_ptr<scoped_cJSON_t> next();
     boost::shared_ptr<json_stream_t> add_transformation(const rdb_protocol_details::transform_variant_t &, ql::env_t *ql_env, const backtrace_t &backtrace);
 
+    virtual void reset_interruptor(signal_t *new_interruptor) {
+        stream->reset_interruptor(new_interruptor);
+    }
+
 private:
     boost::shared_ptr<json_stream_t> stream;
     ql::env_t *ql_env;
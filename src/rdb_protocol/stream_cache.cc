@@ -1,6 +1,12 @@
 #include "rdb_protocol/stream_cache.hpp"
 
+#include "errors.hpp"
+#include <boost/bind.hpp>
+
+#include "arch/runtime/coroutines.hpp"
+#include "concurrency/wait_any.hpp"
 #include "rdb_protocol/env.hpp"
+#include "rdb_protocol/json_writer.hpp"
 
 namespace ql {
 
@@ -10,10 +16,11 @@ bool stream_cache2_t::contains(int64_t key) {
 
 void stream_cache2_t::insert(int64_t key,
                              scoped_ptr_t<env_t> *val_env,
-                             counted_t<datum_stream_t> val_stream) {
+                             counted_t<datum_stream_t> val_stream,
+                             const batchspec_t &batchspec) {
     maybe_evict();
     std::pair<boost::ptr_map<int64_t, entry_t>::iterator, bool> res =
-        streams.insert(key, new entry_t(time(0), val_env, val_stream));
+        streams.insert(key, new entry_t(time(0), val_env, val_stream, batchspec));
     guarantee(res.second);
 }
 
@@ -22,43 +29,59 @@ void stream_cache2_t::erase(int64_t key) {
     guarantee(num_erased == 1);
 }
 
-bool stream_cache2_t::serve(int64_t key, Response *res, signal_t *interruptor) {
+bool stream_cache2_t::serve(int64_t key, Response *res, std::string *json_out,
+                            signal_t *interruptor) {
     boost::ptr_map<int64_t, entry_t>::iterator it = streams.find(key);
     if (it == streams.end()) return false;
     entry_t *entry = it->second;
     entry->last_activity = time(0);
+    r_sanity_check(!entry->sent_first_batch || entry->json == (json_out != NULL));
+    entry->json = (json_out != NULL);
+
+    // Wait for the batch we started reading after the last response.  (We
+    // can't wait inside the `catch` below, since we mustn't block there.)
+    if (entry->prefetch_done.has()) {
+        wait_interruptible(entry->prefetch_done.get(), interruptor);
+        entry->prefetch_done.reset();
+    }
+
     try {
+        if (entry->prefetch_exc) {
+            std::exception_ptr exc = entry->prefetch_exc;
+            entry->prefetch_exc = std::exception_ptr();
+            std::rethrow_exception(exc);
+        }
+
         // This is a hack.  Some streams have an interruptor that is invalid by
         // the time we reach here, so we just reset it to a good one.
         entry->env->interruptor = interruptor;
 
-        int chunk_size = 0;
-        if (entry->next_datum.has()) {
-            *res->add_response() = *entry->next_datum.get();
-            ++chunk_size;
-            entry->next_datum.reset();
+        if (!entry->batch_ready) {
+            entry->read_batch();
         }
-        while (counted_t<const datum_t> d = entry->stream->next()) {
-            d->write_to_protobuf(res->add_response());
-            if (entry->max_chunk_size && ++chunk_size >= entry->max_chunk_size) {
-                if (counted_t<const datum_t> next_d = entry->stream->next()) {
-                    r_sanity_check(!entry->next_datum.has());
-                    entry->next_datum.init(new Datum());
-                    next_d->write_to_protobuf(entry->next_datum.get());
-                    res->set_type(Response::SUCCESS_PARTIAL);
-                }
-                break;
-            }
+        if (json_out != NULL) {
+            // Swapping hands the entry back the caller's old buffer, so
+            // neither of them has to allocate again.
+            r_sanity_check(json_out->empty());
+            json_out->swap(entry->json_batch);
+            entry->json_batch.clear();
+        } else {
+            res->mutable_response()->Swap(entry->batch.mutable_response());
+            entry->batch.clear_response();
         }
+        entry->batch_ready = false;
     } catch (const std::exception &e) {
         erase(key);
         throw;
     }
-    if (!entry->next_datum.has()) {
+    if (entry->exhausted) {
         erase(key);
         res->set_type(Response::SUCCESS_SEQUENCE);
     } else {
-        r_sanity_check(res->type() == Response::SUCCESS_PARTIAL);
+        res->set_type(Response::SUCCESS_PARTIAL);
+        entry->prefetch_done.init(new cond_t());
+        coro_t::spawn_sometime(boost::bind(&entry_t::prefetch, entry,
+                                           auto_drainer_t::lock_t(&entry->drainer)));
     }
     return true;
 }
@@ -68,11 +91,66 @@ void stream_cache2_t::maybe_evict() {
 }
 
 stream_cache2_t::entry_t::entry_t(time_t _last_activity, scoped_ptr_t<env_t> *env_ptr,
-                                  counted_t<datum_stream_t> _stream)
+                                  counted_t<datum_stream_t> _stream,
+                                  const batchspec_t &_batchspec)
     : last_activity(_last_activity), env(env_ptr->release()), stream(_stream),
-      max_chunk_size(DEFAULT_MAX_CHUNK_SIZE), max_age(DEFAULT_MAX_AGE) { }
+      batchspec(_batchspec), max_age(DEFAULT_MAX_AGE), json(false), batch_ready(false),
+      sent_first_batch(false), exhausted(false) { }
 
 stream_cache2_t::entry_t::~entry_t() { }
 
+void stream_cache2_t::entry_t::read_batch() {
+    r_sanity_check(!batch_ready && batch.response_size() == 0 && json_batch.empty());
+    const batchspec_t spec = sent_first_batch ? batchspec : batchspec.first_batch();
+    sent_first_batch = true;
+
+    size_t batch_rows = 0;
+    size_t batch_bytes = 0;
+    for (;;) {
+        counted_t<const datum_t> d;
+        if (next_datum.has()) {
+            d.swap(next_datum);
+        } else {
+            d = stream->next();
+        }
+        if (!d.has()) {
+            exhausted = true;
+            break;
+        }
+        if (json) {
+            if (batch_rows != 0) {
+                json_batch.push_back(',');
+            }
+            write_json(*d, &json_batch);
+            batch_bytes = json_batch.size();
+        } else {
+            Datum *pb = batch.add_response();
+            d->write_to_protobuf(pb);
+            batch_bytes += pb->ByteSize();
+        }
+        ++batch_rows;
+        if (spec.is_full(batch_rows, batch_bytes)) {
+            next_datum = stream->next();
+            exhausted = !next_datum.has();
+            break;
+        }
+    }
+    batch_ready = true;
+}
+
+void stream_cache2_t::entry_t::prefetch(auto_drainer_t::lock_t lock) {
+    // The interruptor of the query that asked for the last batch is gone by
+    // now, so we read on behalf of nobody until the entry is destroyed.
+    env->interruptor = lock.get_drain_signal();
+    try {
+        read_batch();
+    } catch (...) {
+        batch.clear_response();
+        json_batch.clear();
+        prefetch_exc = std::current_exception();
+    }
+    prefetch_done->pulse();
+}
+
 
 } // namespace ql
@@ -4,11 +4,15 @@
 
 #include <time.h>
 
+#include <exception>
 #include <map>
+#include <string>
 
 #include "utils.hpp"
 #include <boost/shared_ptr.hpp>
 
+#include "concurrency/auto_drainer.hpp"
+#include "concurrency/cond_var.hpp"
 #include "concurrency/signal.hpp"
 #include "containers/scoped.hpp"
 #include "rdb_protocol/datum_stream.hpp"
@@ -26,29 +30,54 @@ public:
     stream_cache2_t() { }
     MUST_USE bool contains(int64_t key);
     void insert(int64_t key,
-                scoped_ptr_t<env_t> *val_env, counted_t<datum_stream_t> val_stream);
+                scoped_ptr_t<env_t> *val_env, counted_t<datum_stream_t> val_stream,
+                const batchspec_t &batchspec);
     void erase(int64_t key);
-    MUST_USE bool serve(int64_t key, Response *res, signal_t *interruptor);
+    // Puts the next batch of `key`'s stream into `res`, or, if `json_out` isn't
+    // NULL, writes it to `*json_out` as JSON and only fills in the type of
+    // `res` (see json_writer.hpp).  A connection uses one or the other.
+    MUST_USE bool serve(int64_t key, Response *res, std::string *json_out,
+                        signal_t *interruptor);
 private:
     void maybe_evict();
 
     struct entry_t {
         ~entry_t(); // `env_t` is incomplete
-#ifndef NDEBUG
-        static const int DEFAULT_MAX_CHUNK_SIZE = 5;
-#else
-        static const int DEFAULT_MAX_CHUNK_SIZE = 1000;
-#endif // NDEBUG
         static const time_t DEFAULT_MAX_AGE = 0; // 0 = never evict
         entry_t(time_t _last_activity, scoped_ptr_t<env_t> *env_ptr,
-                counted_t<datum_stream_t> _stream);
+                counted_t<datum_stream_t> _stream, const batchspec_t &_batchspec);
+
+        // Reads the next batch from `stream` into `batch`.
+        void read_batch();
+        // Reads the next batch in the background, so that it's ready by the
+        // time the client asks for it.
+        void prefetch(auto_drainer_t::lock_t lock);
+
         time_t last_activity;
         scoped_ptr_t<env_t> env; // steals ownership from env_ptr !!!
         counted_t<datum_stream_t> stream;
-        int max_chunk_size; // Size of 0 = unlimited
+        batchspec_t batchspec;
         time_t max_age;
 
-        scoped_ptr_t<Datum> next_datum;
+        // The batch that will be sent with the next response, and whether
+        // `read_batch` has filled it yet.  Batches for connections that get
+        // JSON responses go straight into `json_batch` instead.
+        bool json;
+        Response batch;
+        std::string json_batch;
+        bool batch_ready;
+        bool sent_first_batch;
+        // The element after `batch`, read to find out whether `batch` is the
+        // last one.
+        counted_t<const datum_t> next_datum;
+        bool exhausted;
+
+        // Non-NULL while a prefetch is running or hasn't been collected by
+        // `serve` yet.  A prefetch that failed leaves its exception here.
+        scoped_ptr_t<cond_t> prefetch_done;
+        std::exception_ptr prefetch_exc;
+
+        auto_drainer_t drainer;
     private:
         DISABLE_COPYING(entry_t);
     };
@@ -3,7 +3,9 @@
 
 #include "rdb_protocol/counted_term.hpp"
 #include "rdb_protocol/env.hpp"
+#include "rdb_protocol/json_writer.hpp"
 #include "rdb_protocol/pb_utils.hpp"
+#include "rdb_protocol/plan_cache.hpp"
 #include "rdb_protocol/stream_cache.hpp"
 #include "rdb_protocol/term_walker.hpp"
 #include "rdb_protocol/validate.hpp"
@@ -111,9 +113,26 @@ counted_t<term_t> compile_term(env_t *env, protob_t<const Term> t) {
     unreachable();
 }
 
+// Hands a plan whose query went through cleanly back to `run`'s caller, along
+// with the env it was compiled against.
+static void keep_plan(scoped_ptr_t<query_plan_t> *local_plan,
+                      scoped_ptr_t<env_t> *env_ptr,
+                      scoped_ptr_t<query_plan_t> *plan_out) {
+    if (local_plan->has()) {
+        (*local_plan)->swap_env(env_ptr);
+        plan_out->swap(*local_plan);
+    }
+}
+
 void run(protob_t<Query> q, scoped_ptr_t<env_t> *env_ptr,
-         Response *res, stream_cache2_t *stream_cache2,
+         scoped_ptr_t<query_plan_t> *plan,
+         Response *res, std::string *json_out, stream_cache2_t *stream_cache2,
          bool *response_needed_out) {
+    // The plan only goes back to the cache if the query evaluates to a datum
+    // without errors (see `keep_plan`); everything else drops it.
+    scoped_ptr_t<query_plan_t> local_plan;
+    local_plan.swap(*plan);
+
     try {
         validate_pb(*q);
     } catch (const base_exc_t &e) {
@@ -123,63 +142,98 @@ void run(protob_t<Query> q, scoped_ptr_t<env_t> *env_ptr,
 #ifdef INSTRUMENT
     debugf("Query: %s\n", q->DebugString().c_str());
 #endif // INSTRUMENT
-    env_t *env = env_ptr->get();
     int64_t token = q->token();
 
     switch (q->type()) {
     case Query_QueryType_START: {
         counted_t<term_t> root_term;
-        try {
-            Term *t = q->mutable_query();
-            preprocess_term(t);
-            Backtrace *t_bt = t->MutableExtension(ql2::extension::backtrace);
-
-
-            // We parse out the `noreply` optarg in a special step so that we
-            // don't send back an unneeded response in the case where another
-            // optional argument throws a compilation error.
-            for (int i = 0; i < q->global_optargs_size(); ++i) {
-                const Query::AssocPair &ap = q->global_optargs(i);
-                if (ap.key() == "noreply") {
-                    bool conflict = env->add_optarg(ap.key(), ap.val());
-                    r_sanity_check(!conflict);
-                    counted_t<val_t> noreply = env->get_optarg("noreply");
-                    r_sanity_check(noreply.has());
-                    *response_needed_out = !noreply->as_bool();
-                    break;
-                }
+        if (local_plan.has() && local_plan->is_compiled()) {
+            // We already have a plan for this shape; it just needs this
+            // query's literals.
+            try {
+                local_plan->bind(*q);
+            } catch (const exc_t &e) {
+                fill_error(res, Response::COMPILE_ERROR, e.what(), e.backtrace());
+                return;
+            } catch (const datum_exc_t &e) {
+                fill_error(res, Response::COMPILE_ERROR, e.what(), backtrace_t());
+                return;
             }
+            r_sanity_check(!env_ptr->has());
+            local_plan->swap_env(env_ptr);
+            root_term = local_plan->get_root();
+            *response_needed_out = local_plan->get_response_needed();
+        } else {
+            env_t *env = env_ptr->get();
+            try {
+                const ticks_t compile_start = get_ticks();
+                Term *t = q->mutable_query();
+                preprocess_term(t);
+                Backtrace *t_bt = t->MutableExtension(ql2::extension::backtrace);
+
 
-            // Parse global optargs
-            for (int i = 0; i < q->global_optargs_size(); ++i) {
-                const Query::AssocPair &ap = q->global_optargs(i);
-                if (ap.key() != "noreply") {
-                    bool conflict = env->add_optarg(ap.key(), ap.val());
-                    rcheck_toplevel(
-                        !conflict, base_exc_t::GENERIC,
-                        strprintf("Duplicate global optarg: %s", ap.key().c_str()));
+                // We parse out the `noreply` optarg in a special step so that we
+                // don't send back an unneeded response in the case where another
+                // optional argument throws a compilation error.
+                for (int i = 0; i < q->global_optargs_size(); ++i) {
+                    const Query::AssocPair &ap = q->global_optargs(i);
+                    if (ap.key() == "noreply") {
+                        bool conflict = env->add_optarg(ap.key(), ap.val());
+                        r_sanity_check(!conflict);
+                        counted_t<val_t> noreply = env->get_optarg("noreply");
+                        r_sanity_check(noreply.has());
+                        *response_needed_out = !noreply->as_bool();
+                        break;
+                    }
                 }
-            }
 
-            protob_t<Term> ewt = make_counted_term();
-            Term *const arg = ewt.get();
+                // Parse global optargs
+                for (int i = 0; i < q->global_optargs_size(); ++i) {
+                    const Query::AssocPair &ap = q->global_optargs(i);
+                    if (ap.key() != "noreply") {
+                        bool conflict = env->add_optarg(ap.key(), ap.val());
+                        rcheck_toplevel(
+                            !conflict, base_exc_t::GENERIC,
+                            strprintf("Duplicate global optarg: %s", ap.key().c_str()));
+                    }
+                }
 
-            N1(DB, NDATUM("test"));
+                protob_t<Term> ewt = make_counted_term();
+                Term *const arg = ewt.get();
 
-            propagate_backtrace(arg, t_bt); // duplicate toplevel backtrace
-            UNUSED bool _b = env->add_optarg("db", *arg);
-            //          ^^ UNUSED because user can override this value safely
+                N1(DB, NDATUM("test"));
 
-            // Parse actual query
-            root_term = compile_term(env, q.make_child(t));
-            // TODO: handle this properly
-        } catch (const exc_t &e) {
-            fill_error(res, Response::COMPILE_ERROR, e.what(), e.backtrace());
-            return;
-        } catch (const datum_exc_t &e) {
-            fill_error(res, Response::COMPILE_ERROR, e.what(), backtrace_t());
-            return;
+                propagate_backtrace(arg, t_bt); // duplicate toplevel backtrace
+                UNUSED bool _b = env->add_optarg("db", *arg);
+                //          ^^ UNUSED because user can override this value safely
+
+                // Parse actual query
+                if (local_plan.has()) {
+                    env->set_plan_literals(local_plan->get_compile_literals());
+                }
+                try {
+                    root_term = compile_term(env, q.make_child(t));
+                } catch (...) {
+                    env->set_plan_literals(NULL);
+                    throw;
+                }
+                if (local_plan.has()) {
+                    env->set_plan_literals(NULL);
+                    if (!local_plan->finish_compile(q, root_term, *response_needed_out,
+                                                    get_ticks() - compile_start)) {
+                        local_plan.reset();
+                    }
+                }
+                // TODO: handle this properly
+            } catch (const exc_t &e) {
+                fill_error(res, Response::COMPILE_ERROR, e.what(), e.backtrace());
+                return;
+            } catch (const datum_exc_t &e) {
+                fill_error(res, Response::COMPILE_ERROR, e.what(), backtrace_t());
+                return;
+            }
         }
+        env_t *env = env_ptr->get();
 
         try {
             rcheck_toplevel(!stream_cache2->contains(token),
@@ -201,16 +255,25 @@ void run(protob_t<Query> q, scoped_ptr_t<env_t> *env_ptr,
                 // operations inside of lazy operations, which means the writes
                 // will have already occured even if `val` is a sequence that we
                 // haven't yet exhuasted.
+                if (val->get_type().is_convertible(val_t::type_t::DATUM)) {
+                    keep_plan(&local_plan, env_ptr, plan);
+                }
                 return;
             }
 
             if (val->get_type().is_convertible(val_t::type_t::DATUM)) {
                 res->set_type(Response_ResponseType_SUCCESS_ATOM);
                 counted_t<const datum_t> d = val->as_datum();
-                d->write_to_protobuf(res->add_response());
+                if (json_out != NULL) {
+                    write_json(*d, json_out);
+                } else {
+                    d->write_to_protobuf(res->add_response());
+                }
+                keep_plan(&local_plan, env_ptr, plan);
             } else if (val->get_type().is_convertible(val_t::type_t::SEQUENCE)) {
-                stream_cache2->insert(token, env_ptr, val->as_seq());
-                bool b = stream_cache2->serve(token, res, env->interruptor);
+                batchspec_t batchspec = batchspec_t::user(env);
+                stream_cache2->insert(token, env_ptr, val->as_seq(), batchspec);
+                bool b = stream_cache2->serve(token, res, json_out, env->interruptor);
                 r_sanity_check(b);
             } else {
                 rfail_toplevel(base_exc_t::GENERIC,
@@ -228,7 +291,8 @@ void run(protob_t<Query> q, scoped_ptr_t<env_t> *env_ptr,
     } break;
     case Query_QueryType_CONTINUE: {
         try {
-            bool b = stream_cache2->serve(token, res, env->interruptor);
+            bool b = stream_cache2->serve(token, res, json_out,
+                                           env_ptr->get()->interruptor);
             rcheck_toplevel(b, base_exc_t::GENERIC,
                             strprintf("Token %" PRIi64 " not in stream cache.", token));
         } catch (const exc_t &e) {
@@ -12,6 +12,10 @@ public:
         : term_t(env, t),
           raw_val(new_val(make_counted<const datum_t>(&t->datum(), env))) {
         guarantee(raw_val.has());
+        env->record_plan_literal(t.get(), this);
+    }
+    void rebind() {
+        raw_val = new_val(make_counted<const datum_t>(&get_src()->datum(), env));
     }
 private:
     virtual bool is_deterministic_impl() const { return true; }
@@ -55,6 +59,11 @@ private:
 counted_t<term_t> make_datum_term(env_t *env, protob_t<const Term> term) {
     return make_counted<datum_term_t>(env, term);
 }
+void rebind_datum_term(term_t *term) {
+    datum_term_t *datum_term = dynamic_cast<datum_term_t *>(term);
+    guarantee(datum_term != NULL);
+    datum_term->rebind();
+}
 counted_t<term_t> make_make_array_term(env_t *env, protob_t<const Term> term) {
     return make_counted<make_array_term_t>(env, term);
 }
@@ -41,6 +41,9 @@ counted_t<term_t> make_funcall_term(env_t *env, protob_t<const Term> term);
 
 // datum_terms.cc
 counted_t<term_t> make_datum_term(env_t *env, protob_t<const Term> term);
+// Rebuilds the value of a term made by `make_datum_term` after its source
+// `Datum` has been overwritten (used by the query plan cache).
+void rebind_datum_term(term_t *term);
 counted_t<term_t> make_make_array_term(env_t *env, protob_t<const Term> term);
 counted_t<term_t> make_make_obj_term(env_t *env, protob_t<const Term> term);
 
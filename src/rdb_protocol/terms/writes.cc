@@ -122,7 +122,7 @@ private:
 
             for (;;) {
                 std::vector<counted_t<const datum_t> > datums
-                    = datum_stream->next_batch();
+                    = datum_stream->next_batch(batchspec_t::writes());
                 if (datums.empty()) {
                     break;
                 }
@@ -198,7 +198,7 @@ private:
             counted_t<datum_stream_t> ds = tblrows.second;
 
             for (;;) {
-                std::vector<counted_t<const datum_t> > datums = ds->next_batch();
+                std::vector<counted_t<const datum_t> > datums = ds->next_batch(batchspec_t::writes());
                 if (datums.empty()) {
                     break;
                 }
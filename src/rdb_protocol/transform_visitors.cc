@@ -184,7 +184,7 @@ void terminal_visitor_t::operator()(ql::gmr_wire_func_t &func) const {  // NOLIN
         obj->set(el_group, el_map);
     } else {
         counted_t<const ql::datum_t> lhs = obj->get(el_group);
-        obj->set(el_group, func.compile_reduce(ql_env)->call(lhs, el_map)->as_datum());
+        obj->set(el_group, func.compile_reduce(ql_env)->call_reduction(lhs, el_map));
     }
 }
 
@@ -198,7 +198,7 @@ void terminal_visitor_t::operator()(ql::reduce_wire_func_t &func) const {  // NO
     ql::wire_datum_t *d = boost::get<ql::wire_datum_t>(out);
     counted_t<const ql::datum_t> rhs(new ql::datum_t(json, ql_env));
     if (d) {
-        d->reset(func.compile(ql_env)->call(d->get(), rhs)->as_datum());
+        d->reset(func.compile(ql_env)->call_reduction(d->get(), rhs));
     } else {
         guarantee(boost::get<rget_read_response_t::empty_t>(out));
         *out = ql::wire_datum_t(rhs);
@@ -23,7 +23,7 @@ garbage collection. */
 data_block_manager_t::data_block_manager_t(const log_serializer_dynamic_config_t *_dynamic_config, extent_manager_t *em, log_serializer_t *_serializer, const log_serializer_on_disk_static_config_t *_static_config, log_serializer_stats_t *_stats)
     : stats(_stats), shutdown_callback(NULL), state(state_unstarted), dynamic_config(_dynamic_config),
       static_config(_static_config), extent_manager(em), serializer(_serializer),
-      next_active_extent(0), gc_state(), gc_stats(stats)
+      next_active_extent(0), outstanding_sequential_read_aheads(0), gc_state(), gc_stats(stats)
 {
     rassert(dynamic_config);
     rassert(static_config);
@@ -129,17 +129,18 @@ class dbm_read_ahead_fsm_t : public iocallback_t {
 public:
     data_block_manager_t *parent;
     iocallback_t *callback;
-    int64_t extent;
     void *read_ahead_buf;
     int64_t read_ahead_size;
     int64_t read_ahead_offset;
     int64_t off_in;
     void *buf_out;
 
+    // Reads the chunk of MAX_READ_AHEAD_BLOCKS blocks around `off_in`, which goes
+    // into `buf_out`, and offers the rest of the chunk to the read ahead callbacks.
     dbm_read_ahead_fsm_t(data_block_manager_t *p, int64_t _off_in, void *_buf_out, file_account_t *io_account, iocallback_t *cb)
         : parent(p), callback(cb), read_ahead_buf(NULL), off_in(_off_in), buf_out(_buf_out)
     {
-        extent = floor_aligned(off_in, parent->static_config->extent_size());
+        const int64_t extent = floor_aligned(off_in, parent->static_config->extent_size());
 
         // Read up to MAX_READ_AHEAD_BLOCKS blocks
         read_ahead_size = std::min<int64_t>(parent->static_config->extent_size(), MAX_READ_AHEAD_BLOCKS * int64_t(parent->static_config->block_size().ser_value()));
@@ -149,10 +150,22 @@ public:
         parent->dbfile->read_async(read_ahead_offset, read_ahead_size, read_ahead_buf, io_account, this);
     }
 
+    // Reads the given range ahead of a sequential run of reads, and offers all
+    // of it to the read ahead callbacks.  Nobody waits for it.
+    dbm_read_ahead_fsm_t(data_block_manager_t *p, int64_t _read_ahead_offset, int64_t _read_ahead_size, file_account_t *io_account)
+        : parent(p), callback(NULL), read_ahead_buf(NULL), read_ahead_size(_read_ahead_size),
+          read_ahead_offset(_read_ahead_offset), off_in(-1), buf_out(NULL)
+    {
+        rassert(floor_aligned(read_ahead_offset, parent->static_config->extent_size())
+                == floor_aligned(read_ahead_offset + read_ahead_size - 1, parent->static_config->extent_size()));
+        read_ahead_buf = malloc_aligned(read_ahead_size, DEVICE_BLOCK_SIZE);
+        parent->dbfile->read_async(read_ahead_offset, read_ahead_size, read_ahead_buf, io_account, this);
+    }
+
     void on_io_complete() {
-        rassert(off_in >= read_ahead_offset);
-        rassert(off_in < read_ahead_offset + read_ahead_size);
-        rassert(divides(parent->static_config->block_size().ser_value(), off_in - read_ahead_offset));
+        rassert(off_in == -1 || off_in >= read_ahead_offset);
+        rassert(off_in == -1 || off_in < read_ahead_offset + read_ahead_size);
+        rassert(off_in == -1 || divides(parent->static_config->block_size().ser_value(), off_in - read_ahead_offset));
 
         // Walk over the read ahead buffer and copy stuff...
         for (int64_t current_block = 0; current_block * parent->static_config->block_size().ser_value() < read_ahead_size; ++current_block) {
@@ -199,11 +212,58 @@ public:
 
         free(read_ahead_buf);
 
-        callback->on_io_complete();
+        if (callback) {
+            callback->on_io_complete();
+        } else {
+            parent->on_sequential_read_ahead_done();
+        }
         delete this;
     }
 };
 
+sequential_read_detector_t::sequential_read_detector_t()
+    : last_offset(-1), run_length(0), read_ahead_end(0), window(0) { }
+
+bool sequential_read_detector_t::on_read(int64_t offset, int64_t block_size, int64_t extent_size,
+                                         int64_t *read_ahead_offset_out, int64_t *read_ahead_size_out) {
+    const int64_t min_window = std::min<int64_t>(extent_size, MAX_READ_AHEAD_BLOCKS * block_size);
+    const int64_t max_window = std::min<int64_t>(extent_size, MAX_SEQUENTIAL_READ_AHEAD_BLOCKS * block_size);
+
+    // A read continues the run if it moves forward by no more than a read ahead
+    // chunk past what we have read so far.  Blocks that we read ahead don't
+    // get read again, so the reads the run makes skip over them.
+    if (last_offset != -1 && offset > last_offset
+        && offset <= std::max(last_offset, read_ahead_end) + min_window) {
+        ++run_length;
+    } else {
+        run_length = 0;
+        read_ahead_end = 0;
+        window = min_window;
+    }
+    last_offset = offset;
+
+    if (run_length < SEQUENTIAL_READ_AHEAD_MIN_RUN) {
+        return false;
+    }
+
+    const int64_t start = std::max(offset + block_size, read_ahead_end);
+    const int64_t target = offset + block_size + window;
+    if (start >= target) {
+        // What we read ahead last time still covers the window.
+        return false;
+    }
+    // Read aheads stop at the end of the extent; the next extent in the file
+    // isn't necessarily the next one that got written.
+    const int64_t extent_end = floor_aligned(start, extent_size) + extent_size;
+    const int64_t end = std::min(target, extent_end);
+
+    *read_ahead_offset_out = start;
+    *read_ahead_size_out = end - start;
+    read_ahead_end = end;
+    window = std::min(window * 2, max_window);
+    return true;
+}
+
 bool data_block_manager_t::should_perform_read_ahead(int64_t offset) {
     unsigned int extent_id = static_config->extent_index(offset);
 
@@ -215,6 +275,48 @@ bool data_block_manager_t::should_perform_read_ahead(int64_t offset) {
     return !entry->was_written && serializer->should_perform_read_ahead();
 }
 
+void data_block_manager_t::maybe_read_ahead_sequentially(int64_t off_in, file_account_t *io_account) {
+    if (!serializer->should_perform_sequential_read_ahead()) {
+        return;
+    }
+
+    std::map<file_account_t *, sequential_read_detector_t>::iterator detector = read_detectors.find(io_account);
+    if (detector == read_detectors.end()) {
+        // Accounts come and go with the stores that use them; rather than track
+        // that, we forget all runs once there are too many to be real ones.
+        if (read_detectors.size() >= MAX_SEQUENTIAL_READ_DETECTORS) {
+            read_detectors.clear();
+        }
+        detector = read_detectors.insert(std::make_pair(io_account, sequential_read_detector_t())).first;
+    }
+
+    int64_t read_ahead_offset, read_ahead_size;
+    if (!detector->second.on_read(off_in, static_config->block_size().ser_value(),
+                                  static_config->extent_size(),
+                                  &read_ahead_offset, &read_ahead_size)) {
+        return;
+    }
+
+    // Don't read ahead into free extents, or into ones that are being written to.
+    gc_entry *entry = entries.get(static_config->extent_index(read_ahead_offset));
+    if (entry == NULL || entry->state == gc_entry::state_active) {
+        return;
+    }
+
+    ++outstanding_sequential_read_aheads;
+    stats->pm_serializer_read_ahead_bytes += read_ahead_size;
+    new dbm_read_ahead_fsm_t(this, read_ahead_offset, read_ahead_size, io_account);
+}
+
+void data_block_manager_t::on_sequential_read_ahead_done() {
+    rassert(outstanding_sequential_read_aheads > 0);
+    --outstanding_sequential_read_aheads;
+    if (outstanding_sequential_read_aheads == 0 && state == state_shutting_down
+        && gc_state.step() == gc_ready) {
+        actually_shutdown();
+    }
+}
+
 void data_block_manager_t::read(int64_t off_in, void *buf_out, file_account_t *io_account, iocallback_t *cb) {
     rassert(state == state_ready);
 
@@ -226,6 +328,8 @@ void data_block_manager_t::read(int64_t off_in, void *buf_out, file_account_t *i
         data--;
         dbfile->read_async(off_in, static_config->block_size().ser_value(), data, io_account, cb);
     }
+
+    maybe_read_ahead_sequentially(off_in, io_account);
 }
 
 /*
@@ -634,7 +738,10 @@ void data_block_manager_t::run_gc() {
                 gc_state.set_step(gc_ready);
 
                 if (state == state_shutting_down) {
-                    actually_shutdown();
+                    // Otherwise the last read ahead to finish shuts us down.
+                    if (outstanding_sequential_read_aheads == 0) {
+                        actually_shutdown();
+                    }
                     return;
                 }
 
@@ -667,7 +774,7 @@ bool data_block_manager_t::shutdown(shutdown_callback_t *cb) {
     rassert(state == state_ready);
     state = state_shutting_down;
 
-    if (gc_state.step() != gc_ready) {
+    if (gc_state.step() != gc_ready || outstanding_sequential_read_aheads != 0) {
         shutdown_callback = cb;
         return false;
     } else {
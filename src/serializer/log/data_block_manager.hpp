@@ -2,6 +2,7 @@
 #ifndef SERIALIZER_LOG_DATA_BLOCK_MANAGER_HPP_
 #define SERIALIZER_LOG_DATA_BLOCK_MANAGER_HPP_
 
+#include <map>
 #include <vector>
 
 #include "arch/types.hpp"
@@ -82,6 +83,29 @@ private:
     DISABLE_COPYING(gc_entry);
 };
 
+/* Follows the block reads made through one file account, to tell runs of reads
+that walk forward through the file (range scans and backfills over leaves that
+were written in key order) from random point reads.  While a run lasts, it keeps
+a window of the file ahead of the reads being read ahead, and the window doubles
+from `MAX_READ_AHEAD_BLOCKS` up to `MAX_SEQUENTIAL_READ_AHEAD_BLOCKS` blocks for
+as long as the run goes on.  A read that doesn't continue the run ends it. */
+class sequential_read_detector_t {
+public:
+    sequential_read_detector_t();
+
+    // Called for every block read.  Returns true if the range it returns
+    // (which never crosses the end of an extent) should be read ahead.
+    MUST_USE bool on_read(int64_t offset, int64_t block_size, int64_t extent_size,
+                          int64_t *read_ahead_offset_out, int64_t *read_ahead_size_out);
+
+private:
+    int64_t last_offset;
+    int run_length;
+    // Everything up to here has already been read ahead.
+    int64_t read_ahead_end;
+    int64_t window;
+};
+
 class data_block_manager_t {
     friend class gc_entry;
     friend class dbm_read_ahead_fsm_t;
@@ -205,6 +229,10 @@ private:
 
     bool should_perform_read_ahead(int64_t offset);
 
+    // Reads ahead of `off_in` if the reads on `io_account` are sequential.
+    void maybe_read_ahead_sequentially(int64_t off_in, file_account_t *io_account);
+    void on_sequential_read_ahead_done();
+
     /* internal garbage collection structures */
     struct gc_read_callback_t : public iocallback_t {
         data_block_manager_t *parent;
@@ -263,6 +291,10 @@ private:
     /* Buffer used during GC. */
     std::vector<gc_write_t> gc_writes;
 
+    std::map<file_account_t *, sequential_read_detector_t> read_detectors;
+    // Sequential read-aheads don't hold up any read, so shutdown has to wait for them.
+    int outstanding_sequential_read_aheads;
+
     enum gc_step {
         gc_reconstruct, /* reconstructing on startup */
         gc_ready, /* ready to start */
@@ -120,6 +120,7 @@ log_serializer_stats_t::log_serializer_stats_t(perfmon_collection_t *parent)
       pm_serializer_data_blocks_written(),
       pm_serializer_old_garbage_blocks(),
       pm_serializer_old_total_blocks(),
+      pm_serializer_read_ahead_bytes(),
       pm_serializer_lba_gcs(),
       parent_collection_membership(parent, &serializer_collection, "serializer"),
       stats_membership(&serializer_collection,
@@ -138,6 +139,7 @@ log_serializer_stats_t::log_serializer_stats_t(perfmon_collection_t *parent)
           &pm_serializer_data_blocks_written, "serializer_data_blocks_written",
           &pm_serializer_old_garbage_blocks, "serializer_old_garbage_blocks",
           &pm_serializer_old_total_blocks, "serializer_old_total_blocks",
+          &pm_serializer_read_ahead_bytes, "serializer_read_ahead_bytes",
           &pm_serializer_lba_gcs, "serializer_lba_gcs",
           NULLPTR)
 { }
@@ -459,6 +461,14 @@ void log_serializer_t::block_read(const counted_t<ls_block_token_pointee_t>& tok
     data_block_manager->read(offset, buf, io_account, readcb);
 }
 
+int64_t log_serializer_t::get_block_offset(const counted_t<ls_block_token_pointee_t>& token) {
+    assert_thread();
+    rassert(state == state_ready);
+    std::map<ls_block_token_pointee_t *, int64_t>::const_iterator token_offsets_it = token_offsets.find(token.get());
+    guarantee(token_offsets_it != token_offsets.end());
+    return token_offsets_it->second;
+}
+
 // God this is such a hack.
 #ifndef SEMANTIC_SERIALIZER_CHECK
 counted_t<ls_block_token_pointee_t>
@@ -924,11 +934,24 @@ void log_serializer_t::register_read_ahead_cb(serializer_read_ahead_callback_t *
     assert_thread();
 
     read_ahead_callbacks.push_back(cb);
+    warming_up_read_ahead_callbacks.push_back(cb);
+}
+
+void log_serializer_t::finish_read_ahead_warm_up(serializer_read_ahead_callback_t *cb) {
+    assert_thread();
+
+    for (std::vector<serializer_read_ahead_callback_t*>::iterator cb_it = warming_up_read_ahead_callbacks.begin(); cb_it != warming_up_read_ahead_callbacks.end(); ++cb_it) {
+        if (*cb_it == cb) {
+            warming_up_read_ahead_callbacks.erase(cb_it);
+            break;
+        }
+    }
 }
 
 void log_serializer_t::unregister_read_ahead_cb(serializer_read_ahead_callback_t *cb) {
     assert_thread();
 
+    finish_read_ahead_warm_up(cb);
     for (std::vector<serializer_read_ahead_callback_t*>::iterator cb_it = read_ahead_callbacks.begin(); cb_it != read_ahead_callbacks.end(); ++cb_it) {
         if (*cb_it == cb) {
             read_ahead_callbacks.erase(cb_it);
@@ -948,6 +971,11 @@ bool log_serializer_t::offer_buf_to_read_ahead_callbacks(block_id_t block_id, vo
 }
 
 bool log_serializer_t::should_perform_read_ahead() {
+    assert_thread();
+    return dynamic_config.read_ahead && !warming_up_read_ahead_callbacks.empty();
+}
+
+bool log_serializer_t::should_perform_sequential_read_ahead() {
     assert_thread();
     return dynamic_config.read_ahead && !read_ahead_callbacks.empty();
 }
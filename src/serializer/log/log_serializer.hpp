@@ -129,6 +129,7 @@ public:
     file_account_t *make_io_account(int priority, int outstanding_requests_limit);
 
     void register_read_ahead_cb(serializer_read_ahead_callback_t *cb);
+    void finish_read_ahead_warm_up(serializer_read_ahead_callback_t *cb);
     void unregister_read_ahead_cb(serializer_read_ahead_callback_t *cb);
     block_id_t max_block_id();
     repli_timestamp_t get_recency(block_id_t id);
@@ -140,6 +141,8 @@ public:
 
     void block_read(const counted_t<ls_block_token_pointee_t>& token, void *buf, file_account_t *io_account);
 
+    int64_t get_block_offset(const counted_t<ls_block_token_pointee_t>& token);
+
     void index_write(const std::vector<index_write_op_t>& write_ops, file_account_t *io_account);
 
     counted_t<ls_block_token_pointee_t> block_write(const void *buf, block_id_t block_id, file_account_t *io_account, iocallback_t *cb);
@@ -158,6 +161,7 @@ private:
 
     bool offer_buf_to_read_ahead_callbacks(block_id_t block_id, void *buf, const counted_t<standard_block_token_t>& token, repli_timestamp_t recency_timestamp);
     bool should_perform_read_ahead();
+    bool should_perform_sequential_read_ahead();
 
     struct index_write_context_t {
         index_write_context_t() : next_metablock_write(NULL) { }
@@ -214,6 +218,8 @@ private:
 #endif
 
     std::vector<serializer_read_ahead_callback_t *> read_ahead_callbacks;
+    // The ones of `read_ahead_callbacks` whose caches are still warming up.
+    std::vector<serializer_read_ahead_callback_t *> warming_up_read_ahead_callbacks;
 
     const dynamic_config_t dynamic_config;
     static_config_t static_config;
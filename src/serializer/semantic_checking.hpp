@@ -62,6 +62,7 @@ public:
 
     void block_read(const counted_t< scs_block_token_t<inner_serializer_t> >& _token, void *buf, file_account_t *io_account, iocallback_t *callback);
     void block_read(const counted_t< scs_block_token_t<inner_serializer_t> >& _token, void *buf, file_account_t *io_account);
+    int64_t get_block_offset(const counted_t< scs_block_token_t<inner_serializer_t> >& _token);
 
     void index_write(const std::vector<index_write_op_t>& write_ops, file_account_t *io_account);
 
@@ -78,6 +79,7 @@ public:
     bool get_delete_bit(block_id_t id);
 
     void register_read_ahead_cb(UNUSED serializer_read_ahead_callback_t *cb);
+    void finish_read_ahead_warm_up(UNUSED serializer_read_ahead_callback_t *cb);
     void unregister_read_ahead_cb(UNUSED serializer_read_ahead_callback_t *cb);
 
 public:
@@ -189,6 +189,14 @@ block_read(const counted_t< scs_block_token_t<inner_serializer_t> >& _token, voi
     read_check_state(token, buf);
 }
 
+template<class inner_serializer_t>
+int64_t semantic_checking_serializer_t<inner_serializer_t>::
+get_block_offset(const counted_t< scs_block_token_t<inner_serializer_t> >& _token) {
+    scs_block_token_t<inner_serializer_t> *token = _token.get();
+    guarantee(token, "bad token");
+    return inner_serializer.get_block_offset(token->inner_token);
+}
+
 template<class inner_serializer_t>
 void semantic_checking_serializer_t<inner_serializer_t>::
 index_write(const std::vector<index_write_op_t>& write_ops, file_account_t *io_account) {
@@ -281,6 +289,10 @@ register_read_ahead_cb(UNUSED serializer_read_ahead_callback_t *cb) {
     // Ignore this, it might make the checking ineffective...
 }
 
+template<class inner_serializer_t>
+void semantic_checking_serializer_t<inner_serializer_t>::
+finish_read_ahead_warm_up(UNUSED serializer_read_ahead_callback_t *cb) { }
+
 template<class inner_serializer_t>
 void semantic_checking_serializer_t<inner_serializer_t>::
 unregister_read_ahead_cb(UNUSED serializer_read_ahead_callback_t *cb) { }
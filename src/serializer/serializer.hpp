@@ -54,8 +54,11 @@ public:
     /* Some serializer implementations support read-ahead to speed up cache warmup.
     This is supported through a serializer_read_ahead_callback_t which gets called whenever the serializer has read-ahead some buf.
     The callee can then decide whether it wants to use the offered buffer of discard it.
+    Once the callee's cache has warmed up, it calls finish_read_ahead_warm_up(); after
+    that it is only offered the blocks that the serializer reads ahead of sequential reads.
     */
     virtual void register_read_ahead_cb(serializer_read_ahead_callback_t *cb) = 0;
+    virtual void finish_read_ahead_warm_up(serializer_read_ahead_callback_t *cb) = 0;
     virtual void unregister_read_ahead_cb(serializer_read_ahead_callback_t *cb) = 0;
 
     /* Reading a block from the serializer */
@@ -65,6 +68,11 @@ public:
     // Blocking variant (requires coroutine context). Has default implementation.
     virtual void block_read(const counted_t<standard_block_token_t>& token, void *buf, file_account_t *io_account) = 0;
 
+    /* Where the block's data is in the file.  This is only good for putting
+    reads in the order of the file, so that many of them go through it in one
+    sweep; the block may move as soon as the token is released. */
+    virtual int64_t get_block_offset(const counted_t<standard_block_token_t>& token) = 0;
+
     /* The index stores three pieces of information for each ID:
      * 1. A pointer to a data block on disk (which may be NULL)
      * 2. A repli_timestamp_t, called the "recency"
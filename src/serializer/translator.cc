@@ -238,6 +238,10 @@ void translator_serializer_t::block_read(const counted_t<standard_block_token_t>
     return inner->block_read(token, buf, io_account);
 }
 
+int64_t translator_serializer_t::get_block_offset(const counted_t<standard_block_token_t>& token) {
+    return inner->get_block_offset(token);
+}
+
 counted_t<standard_block_token_t> translator_serializer_t::index_read(block_id_t block_id) {
     return inner->index_read(translate_block_id(block_id));
 }
@@ -308,6 +312,12 @@ void translator_serializer_t::register_read_ahead_cb(serializer_read_ahead_callb
     inner->register_read_ahead_cb(this);
     read_ahead_callback = cb;
 }
+void translator_serializer_t::finish_read_ahead_warm_up(DEBUG_VAR serializer_read_ahead_callback_t *cb) {
+    on_thread_t t(inner->home_thread());
+
+    rassert(cb == read_ahead_callback);
+    inner->finish_read_ahead_warm_up(this);
+}
 void translator_serializer_t::unregister_read_ahead_cb(DEBUG_VAR serializer_read_ahead_callback_t *cb) {
     on_thread_t t(inner->home_thread());
 
@@ -85,6 +85,7 @@ public:
     typedef serializer_read_ahead_callback_t serializer_read_ahead_callback_t;
 
     void register_read_ahead_cb(serializer_read_ahead_callback_t *cb);
+    void finish_read_ahead_warm_up(serializer_read_ahead_callback_t *cb);
     void unregister_read_ahead_cb(serializer_read_ahead_callback_t *cb);
 
 private:
@@ -142,6 +143,7 @@ public:
 
     void block_read(const counted_t<standard_block_token_t>& token, void *buf, file_account_t *io_account, iocallback_t *cb);
     void block_read(const counted_t<standard_block_token_t>& token, void *buf, file_account_t *io_account);
+    int64_t get_block_offset(const counted_t<standard_block_token_t>& token);
     counted_t<standard_block_token_t> index_read(block_id_t block_id);
 
 public:
@@ -0,0 +1,182 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "errors.hpp"
+#include <boost/bind.hpp>
+
+#include "arch/runtime/coroutines.hpp"
+#include "buffer_cache/blob.hpp"
+#include "buffer_cache/buffer_cache.hpp"
+#include "containers/buffer_group.hpp"
+#include "containers/data_buffer.hpp"
+#include "memcached/memcached_btree/btree_data_provider.hpp"
+#include "memcached/memcached_btree/value.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/server_test_helper.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+class data_provider_tester_t : public server_test_helper_t {
+public:
+    data_provider_tester_t() { }
+private:
+    void run_tests(cache_t *cache) {
+        // The value gets copied out a chunk of this many bytes at a time.
+        const int64_t chunk_size = MEMCACHED_GET_CHUNK_BLOCKS
+            * static_cast<int64_t>(cache->get_block_size().value());
+
+        std::vector<int64_t> sizes;
+        sizes.push_back(0);
+        sizes.push_back(1);
+        sizes.push_back(chunk_size - 1);
+        sizes.push_back(chunk_size);
+        sizes.push_back(chunk_size + 1);
+        // Values at least this big are the ones that get written out
+        // unbuffered, straight from the buffer `value_to_data_buffer` returns.
+        sizes.push_back(MAX_BUFFERED_GET_SIZE - 1);
+        sizes.push_back(MAX_BUFFERED_GET_SIZE);
+        sizes.push_back(MAX_BUFFERED_GET_SIZE + 1);
+        sizes.push_back(3 * MAX_BUFFERED_GET_SIZE + 12345);
+
+        for (size_t i = 0; i < sizes.size(); ++i) {
+            SCOPED_TRACE(strprintf("value size %" PRIi64, sizes[i]));
+            check_value_of_size(cache, sizes[i]);
+        }
+    }
+
+    void check_value_of_size(cache_t *cache, int64_t size) {
+        // A value with no metadata, so its blob reference starts right after
+        // the flags.
+        std::vector<char> value_buf(sizeof(memcached_value_t) + blob::btree_maxreflen, 0);
+        memcached_value_t *value = reinterpret_cast<memcached_value_t *>(value_buf.data());
+        value->metadata_flags.flags = 0;
+
+        std::string expected(size, '\0');
+        for (int64_t i = 0; i < size; ++i) {
+            expected[i] = 'a' + (i * 7 + i / 4096) % 26;
+        }
+
+        order_source_t order_source;
+        {
+            transaction_t txn(cache, rwi_write, 0, repli_timestamp_t::distant_past,
+                              order_source.check_in("check_value_of_size write"),
+                              WRITE_DURABILITY_SOFT);
+            blob_t blob(value->value_ref(), blob::btree_maxreflen);
+            blob.append_region(&txn, size);
+            buffer_group_t group;
+            blob_acq_t acq;
+            blob.expose_region(&txn, rwi_write, 0, size, &group, &acq);
+            buffer_group_copy_data(&group, expected.data(), size);
+        }
+
+        {
+            transaction_t txn(cache, rwi_read, order_source.check_in("check_value_of_size read"));
+            counted_t<data_buffer_t> data = value_to_data_buffer(value, &txn);
+            ASSERT_EQ(size, data->size());
+            EXPECT_TRUE(std::string(data->buf(), data->size()) == expected);
+        }
+
+        {
+            transaction_t txn(cache, rwi_write, 0, repli_timestamp_t::distant_past,
+                              order_source.check_in("check_value_of_size clear"),
+                              WRITE_DURABILITY_SOFT);
+            blob_t blob(value->value_ref(), blob::btree_maxreflen);
+            blob.clear(&txn);
+        }
+    }
+
+    DISABLE_COPYING(data_provider_tester_t);
+};
+
+TEST(BtreeDataProviderTest, ValueToDataBuffer) {
+    data_provider_tester_t().run();
+}
+
+/* A value, and gets of it that can be started in the background. */
+class budgeted_value_t {
+public:
+    budgeted_value_t(cache_t *_cache, int64_t size)
+        : cache(_cache), value_buf(sizeof(memcached_value_t) + blob::btree_maxreflen, 0) {
+        value()->metadata_flags.flags = 0;
+        transaction_t txn(cache, rwi_write, 0, repli_timestamp_t::distant_past,
+                          order_source.check_in("budgeted_value_t write"), WRITE_DURABILITY_SOFT);
+        blob_t blob(value()->value_ref(), blob::btree_maxreflen);
+        blob.append_region(&txn, size);
+    }
+
+    memcached_value_t *value() {
+        return reinterpret_cast<memcached_value_t *>(value_buf.data());
+    }
+
+    void get(large_value_budget_t *budget, counted_t<data_buffer_t> *out, cond_t *done) {
+        transaction_t txn(cache, rwi_read, order_source.check_in("budgeted_value_t read"));
+        *out = value_to_data_buffer(value(), &txn, budget);
+        done->pulse();
+    }
+
+private:
+    cache_t *cache;
+    order_source_t order_source;
+    std::vector<char> value_buf;
+};
+
+class budget_tester_t : public server_test_helper_t {
+private:
+    void run_tests(cache_t *cache) {
+        // Room for one large value and a bit, but not for two.
+        large_value_budget_t budget(MAX_BUFFERED_GET_SIZE + MAX_BUFFERED_GET_SIZE / 2);
+        budgeted_value_t large(cache, MAX_BUFFERED_GET_SIZE);
+        budgeted_value_t small(cache, MAX_BUFFERED_GET_SIZE - 1);
+        budgeted_value_t huge(cache, 3 * MAX_BUFFERED_GET_SIZE);
+
+        counted_t<data_buffer_t> first, second, third;
+        cond_t first_done, second_done, third_done;
+        large.get(&budget, &first, &first_done);
+        coro_t::spawn_now_dangerously(boost::bind(&budgeted_value_t::get, &large, &budget,
+                                                  &second, &second_done));
+        let_coroutines_run();
+        EXPECT_FALSE(second_done.is_pulsed());
+
+        // Small values aren't charged to the budget.
+        {
+            counted_t<data_buffer_t> small_copy;
+            cond_t small_done;
+            small.get(&budget, &small_copy, &small_done);
+            EXPECT_EQ(MAX_BUFFERED_GET_SIZE - 1, small_copy->size());
+        }
+        let_coroutines_run();
+        EXPECT_FALSE(second_done.is_pulsed());
+
+        // Freeing the first copy makes room for the second.
+        first.reset();
+        second_done.wait();
+        EXPECT_EQ(MAX_BUFFERED_GET_SIZE, second->size());
+
+        // A value bigger than the whole budget waits until nothing else is
+        // charged to it.
+        coro_t::spawn_now_dangerously(boost::bind(&budgeted_value_t::get, &huge, &budget,
+                                                  &third, &third_done));
+        let_coroutines_run();
+        EXPECT_FALSE(third_done.is_pulsed());
+        second.reset();
+        third_done.wait();
+        EXPECT_EQ(3 * MAX_BUFFERED_GET_SIZE, third->size());
+        third.reset();
+    }
+
+    void let_coroutines_run() {
+        for (int i = 0; i < 10; ++i) {
+            coro_t::yield();
+        }
+    }
+};
+
+TEST(BtreeDataProviderTest, LargeValueBudget) {
+    budget_tester_t().run();
+}
+
+}  // namespace unittest
@@ -0,0 +1,256 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "arch/runtime/coroutines.hpp"
+#include "btree/internal_node.hpp"
+#include "btree/introspection.hpp"
+#include "btree/leaf_node.hpp"
+#include "btree/node.hpp"
+#include "btree/operations.hpp"
+#include "buffer_cache/buffer_cache.hpp"
+#include "config/args.hpp"
+#include "containers/data_buffer.hpp"
+#include "memcached/memcached_btree/get.hpp"
+#include "memcached/memcached_btree/set.hpp"
+#include "serializer/translator.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/server_test_helper.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+// Long keys make for internal nodes with few children, so that a thousand keys
+// are enough for a tree with three levels.
+#define INTROSPECTION_TEST_KEYS 1000
+
+store_key_t introspection_test_key(int i) {
+    return store_key_t(strprintf("%05d", i) + std::string(200, 'k'));
+}
+
+/* A node of the tree, as seen through buf locks. */
+struct introspection_test_node_t {
+    block_id_t block_id;
+    size_t level;
+    std::vector<block_id_t> children;
+};
+
+class introspection_tester_t : public server_test_helper_t {
+protected:
+    void run_tests(UNUSED cache_t *cache) { }
+
+    void run_serializer_tests() {
+        cache_t::create(this->serializer);
+        mirrored_cache_config_t cache_cfg;
+        cache_cfg.flush_timer_ms = MILLION;
+        cache_cfg.flush_dirty_size = BILLION;
+        cache_cfg.max_size = GIGABYTE;
+
+        {
+            cache_t cache(this->serializer, cache_cfg, &get_global_perfmon_collection());
+            btree_slice_t::create(&cache, std::vector<char>(), std::vector<char>());
+            btree_slice_t slice(&cache, &get_global_perfmon_collection(), "unittest");
+            insert_keys(&slice);
+        }
+
+        // The tree is clean now, so its blocks can be evicted.
+        cache_t cache(this->serializer, cache_cfg, &get_global_perfmon_collection());
+        btree_slice_t slice(&cache, &get_global_perfmon_collection(), "unittest");
+
+        // Walking the tree with buf locks loads all of it.
+        block_id_t root_id;
+        {
+            order_source_t order_source;
+            scoped_ptr_t<transaction_t> txn;
+            scoped_ptr_t<real_superblock_t> superblock;
+            get_btree_superblock_and_txn_for_reading(&slice, rwi_read,
+                                                     order_source.check_in("introspection_test"),
+                                                     CACHE_SNAPSHOTTED_NO, &superblock, &txn);
+            root_id = superblock->get_root_block_id();
+            superblock->release();
+            walk_tree(txn.get(), root_id, 0, -1);
+
+            buf_lock_t root(txn.get(), root_id, rwi_read);
+            const void *peeked = cache.peek_block_if_resident(root_id);
+            ASSERT_TRUE(peeked != NULL);
+            EXPECT_EQ(0, memcmp(peeked, root.get_data_read(), cache.get_block_size().value()));
+        }
+        ASSERT_LE(3u, num_levels());
+        ASSERT_LT(1u, nodes[root_id].children.size());
+
+        btree_introspection_t full;
+        introspect_btree(&cache, SUPERBLOCK_ID, key_range_t::universe(), &full);
+        check_introspection(&cache, root_id, full);
+        EXPECT_TRUE(full.complete);
+        for (size_t level = 0; level < num_levels(); ++level) {
+            EXPECT_EQ(full.blocks_seen_by_level[level], full.blocks_resident_by_level[level]);
+        }
+        check_ranges(root_id, full);
+
+        // Evict all but one block, then read one key, which loads the path to
+        // it again.  Most of the root's other children stay evicted, so the
+        // blocks under them aren't seen.
+        cache.set_max_size(0);
+        cache.set_max_size(cache_cfg.max_size);
+        int evicted = 0;
+        for (std::map<block_id_t, introspection_test_node_t>::const_iterator it = nodes.begin();
+             it != nodes.end(); ++it) {
+            if (!cache.contains_block(it->first)) {
+                EXPECT_TRUE(cache.peek_block_if_resident(it->first) == NULL);
+                ++evicted;
+            }
+        }
+        EXPECT_LT(0, evicted);
+        {
+            order_source_t order_source;
+            scoped_ptr_t<transaction_t> txn;
+            scoped_ptr_t<real_superblock_t> superblock;
+            get_btree_superblock_and_txn_for_reading(&slice, rwi_read,
+                                                     order_source.check_in("introspection_test"),
+                                                     CACHE_SNAPSHOTTED_NO, &superblock, &txn);
+            memcached_get(introspection_test_key(INTROSPECTION_TEST_KEYS / 2), &slice, 0,
+                          txn.get(), superblock.get());
+        }
+        // Let any blocks that the serializer read ahead arrive, so that the
+        // cache doesn't change under the checks below.
+        for (int i = 0; i < 10; ++i) {
+            coro_t::yield();
+        }
+
+        btree_introspection_t partial;
+        introspect_btree(&cache, SUPERBLOCK_ID, key_range_t::universe(), &partial);
+        check_introspection(&cache, root_id, partial);
+        ASSERT_EQ(full.blocks_seen_by_level.size(), partial.blocks_seen_by_level.size());
+        EXPECT_EQ(full.blocks_seen_by_level[1], partial.blocks_seen_by_level[1]);
+        EXPECT_LT(partial.blocks_resident_by_level[1], partial.blocks_seen_by_level[1]);
+        EXPECT_LT(partial.blocks_seen_by_level[2], full.blocks_seen_by_level[2]);
+        ASSERT_EQ(full.ranges.size(), partial.ranges.size());
+        for (size_t i = 0; i < full.ranges.size(); ++i) {
+            EXPECT_TRUE(full.ranges[i].range == partial.ranges[i].range);
+        }
+    }
+
+    void insert_keys(btree_slice_t *slice) {
+        order_source_t order_source;
+        for (int i = 0; i < INTROSPECTION_TEST_KEYS; ++i) {
+            scoped_ptr_t<transaction_t> txn;
+            scoped_ptr_t<real_superblock_t> superblock;
+            get_btree_superblock_and_txn(slice, rwi_write, 1, repli_timestamp_t::distant_past,
+                                         order_source.check_in("insert_keys"),
+                                         WRITE_DURABILITY_SOFT, &superblock, &txn);
+            counted_t<data_buffer_t> data = data_buffer_t::create(10);
+            memset(data->buf(), 'a' + i % 26, data->size());
+            memcached_set(introspection_test_key(i), slice, data, 0, 0,
+                          add_policy_yes, replace_policy_yes, NO_CAS_SUPPLIED, 0, 0,
+                          repli_timestamp_t::distant_past, txn.get(), superblock.get());
+        }
+    }
+
+    // Records the subtree at `block_id`, and which child of the root each key
+    // is under.
+    void walk_tree(transaction_t *txn, block_id_t block_id, size_t level, int root_child) {
+        buf_lock_t lock(txn, block_id, rwi_read);
+        introspection_test_node_t *node = &nodes[block_id];
+        node->block_id = block_id;
+        node->level = level;
+
+        const node_t *data = static_cast<const node_t *>(lock.get_data_read());
+        if (node::is_internal(data)) {
+            const internal_node_t *inode = reinterpret_cast<const internal_node_t *>(data);
+            for (int i = 0; i < inode->npairs; ++i) {
+                node->children.push_back(internal_node::get_pair_by_index(inode, i)->lnode);
+            }
+            for (size_t i = 0; i < node->children.size(); ++i) {
+                walk_tree(txn, node->children[i], level + 1, level == 0 ? static_cast<int>(i) : root_child);
+            }
+        } else {
+            const leaf_node_t *lnode = reinterpret_cast<const leaf_node_t *>(data);
+            const btree_key_t *key;
+            for (leaf::live_iter_t it = leaf::iter_for_whole_leaf(lnode); (key = it.get_key(lnode)); it.step(lnode)) {
+                keys_by_root_child[root_child].push_back(store_key_t(key));
+            }
+        }
+    }
+
+    size_t num_levels() const {
+        size_t levels = 0;
+        for (std::map<block_id_t, introspection_test_node_t>::const_iterator it = nodes.begin();
+             it != nodes.end(); ++it) {
+            levels = std::max(levels, it->second.level + 1);
+        }
+        return levels;
+    }
+
+    // What `introspect_btree` should have seen below `block_id`, given which
+    // blocks are in the cache right now.
+    void count_expected(cache_t *cache, block_id_t block_id,
+                        std::vector<int64_t> *seen_by_level, std::vector<int64_t> *resident_by_level,
+                        btree_range_introspection_t *range) {
+        const introspection_test_node_t &node = nodes[block_id];
+        if (seen_by_level->size() <= node.level) {
+            seen_by_level->resize(node.level + 1, 0);
+            resident_by_level->resize(node.level + 1, 0);
+        }
+        ++(*seen_by_level)[node.level];
+        ++range->blocks_seen;
+        if (!cache->contains_block(block_id)) {
+            return;
+        }
+        ++(*resident_by_level)[node.level];
+        ++range->blocks_resident;
+        for (size_t i = 0; i < node.children.size(); ++i) {
+            count_expected(cache, node.children[i], seen_by_level, resident_by_level, range);
+        }
+    }
+
+    void check_introspection(cache_t *cache, block_id_t root_id, const btree_introspection_t &result) {
+        ASSERT_TRUE(cache->contains_block(SUPERBLOCK_ID));
+        ASSERT_TRUE(cache->contains_block(root_id));
+        const introspection_test_node_t &root = nodes[root_id];
+        std::vector<int64_t> seen_by_level(1, 1), resident_by_level(1, 1);
+        ASSERT_EQ(root.children.size(), result.ranges.size());
+        for (size_t i = 0; i < root.children.size(); ++i) {
+            btree_range_introspection_t expected;
+            count_expected(cache, root.children[i], &seen_by_level, &resident_by_level, &expected);
+            EXPECT_EQ(expected.blocks_seen, result.ranges[i].blocks_seen) << "range " << i;
+            EXPECT_EQ(expected.blocks_resident, result.ranges[i].blocks_resident) << "range " << i;
+        }
+        EXPECT_TRUE(seen_by_level == result.blocks_seen_by_level);
+        EXPECT_TRUE(resident_by_level == result.blocks_resident_by_level);
+    }
+
+    // The ranges cover the key space in order, and every key is in the range
+    // of the root's child it is under.
+    void check_ranges(block_id_t root_id, const btree_introspection_t &result) {
+        ASSERT_EQ(nodes[root_id].children.size(), result.ranges.size());
+        EXPECT_TRUE(result.ranges.front().range.left == store_key_t::min());
+        EXPECT_TRUE(result.ranges.back().range.right.unbounded);
+        for (size_t i = 0; i + 1 < result.ranges.size(); ++i) {
+            ASSERT_FALSE(result.ranges[i].range.right.unbounded);
+            EXPECT_TRUE(result.ranges[i].range.right.key == result.ranges[i + 1].range.left);
+        }
+        size_t keys_checked = 0;
+        for (std::map<int, std::vector<store_key_t> >::const_iterator it = keys_by_root_child.begin();
+             it != keys_by_root_child.end(); ++it) {
+            for (size_t i = 0; i < it->second.size(); ++i) {
+                EXPECT_TRUE(result.ranges[it->first].range.contains_key(it->second[i]))
+                    << "range " << it->first << ", key " << key_to_debug_str(it->second[i]);
+                ++keys_checked;
+            }
+        }
+        EXPECT_EQ(static_cast<size_t>(INTROSPECTION_TEST_KEYS), keys_checked);
+    }
+
+    std::map<block_id_t, introspection_test_node_t> nodes;
+    std::map<int, std::vector<store_key_t> > keys_by_root_child;
+};
+
+TEST(BtreeIntrospectionTest, CountsResidentBlocks) {
+    introspection_tester_t().run();
+}
+
+}  // namespace unittest
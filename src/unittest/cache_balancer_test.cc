@@ -0,0 +1,79 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include "unittest/gtest.hpp"
+
+#include "buffer_cache/mirrored/balancer.hpp"
+#include "config/args.hpp"
+
+namespace unittest {
+
+cache_balancer_sample_t make_sample(int64_t max_size, int64_t blocks_in_memory,
+                                    int64_t accesses, int64_t misses, ticks_t miss_ticks) {
+    cache_balancer_sample_t sample;
+    sample.block_size = 4 * KILOBYTE;
+    sample.max_size = max_size;
+    sample.blocks_in_memory = blocks_in_memory;
+    sample.accesses = accesses;
+    sample.misses = misses;
+    sample.miss_ticks = miss_ticks;
+    return sample;
+}
+
+int64_t sum(const std::vector<int64_t> &sizes) {
+    int64_t total = 0;
+    for (size_t i = 0; i < sizes.size(); ++i) {
+        total += sizes[i];
+    }
+    return total;
+}
+
+TEST(CacheBalancerTest, NoCaches) {
+    std::vector<int64_t> sizes;
+    compute_cache_balance(GIGABYTE, std::vector<cache_balancer_sample_t>(), &sizes);
+    ASSERT_TRUE(sizes.empty());
+}
+
+TEST(CacheBalancerTest, IdleCachesSplitEvenly) {
+    std::vector<cache_balancer_sample_t> samples;
+    samples.push_back(make_sample(256 * MEGABYTE, 0, 0, 0, 0));
+    samples.push_back(make_sample(256 * MEGABYTE, 0, 0, 0, 0));
+
+    std::vector<int64_t> sizes;
+    compute_cache_balance(512 * MEGABYTE, samples, &sizes);
+    ASSERT_EQ(2u, sizes.size());
+    EXPECT_EQ(sizes[0], sizes[1]);
+    EXPECT_LE(sum(sizes), 512 * MEGABYTE);
+}
+
+TEST(CacheBalancerTest, MissesAttractMemory) {
+    std::vector<cache_balancer_sample_t> samples;
+    // The first cache is thrashing, the second is idle.
+    samples.push_back(make_sample(256 * MEGABYTE, 65536, 100000, 50000, 5 * BILLION));
+    samples.push_back(make_sample(256 * MEGABYTE, 100, 0, 0, 0));
+
+    std::vector<int64_t> sizes;
+    compute_cache_balance(512 * MEGABYTE, samples, &sizes);
+    ASSERT_EQ(2u, sizes.size());
+    EXPECT_GT(sizes[0], 256 * MEGABYTE);
+    EXPECT_LT(sizes[1], 256 * MEGABYTE);
+    // The idle cache keeps its floor.
+    EXPECT_GE(sizes[1], CACHE_BALANCER_MIN_CACHE_SIZE);
+    EXPECT_LE(sum(sizes), 512 * MEGABYTE);
+}
+
+TEST(CacheBalancerTest, StaysWithinBudget) {
+    std::vector<cache_balancer_sample_t> samples;
+    // A new cache registered with more than the budget allows.
+    samples.push_back(make_sample(GIGABYTE, 200000, 1000, 10, 1000));
+    samples.push_back(make_sample(GIGABYTE, 200000, 1000, 500, MILLION));
+    samples.push_back(make_sample(GIGABYTE, 10, 0, 0, 0));
+
+    std::vector<int64_t> sizes;
+    compute_cache_balance(GIGABYTE, samples, &sizes);
+    ASSERT_EQ(3u, sizes.size());
+    EXPECT_LE(sum(sizes), GIGABYTE);
+    for (size_t i = 0; i < sizes.size(); ++i) {
+        EXPECT_GE(sizes[i], CACHE_BALANCER_MIN_CACHE_SIZE);
+    }
+}
+
+}  // namespace unittest
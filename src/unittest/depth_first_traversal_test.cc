@@ -0,0 +1,120 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "btree/depth_first_traversal.hpp"
+#include "btree/operations.hpp"
+#include "buffer_cache/buffer_cache.hpp"
+#include "config/args.hpp"
+#include "containers/data_buffer.hpp"
+#include "memcached/memcached_btree/set.hpp"
+#include "serializer/translator.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/server_test_helper.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+// Enough keys for the root to have a few dozen leaves under it.
+#define TRAVERSAL_TEST_KEYS 2000
+
+class collect_keys_callback_t : public depth_first_traversal_callback_t {
+public:
+    // Stops the traversal after `_limit` keys.
+    explicit collect_keys_callback_t(size_t _limit) : limit(_limit) { }
+    bool handle_pair(const btree_key_t *key, UNUSED const void *value) {
+        keys.push_back(std::string(reinterpret_cast<const char *>(key->contents), key->size));
+        return keys.size() < limit;
+    }
+    std::vector<std::string> keys;
+private:
+    size_t limit;
+};
+
+store_key_t traversal_test_key(int i) {
+    return store_key_t(strprintf("key%05d", i));
+}
+
+class traversal_tester_t : public server_test_helper_t {
+protected:
+    void run_tests(UNUSED cache_t *cache) { }
+
+    void run_serializer_tests() {
+        cache_t::create(this->serializer);
+        mirrored_cache_config_t cache_cfg;
+        cache_cfg.flush_timer_ms = MILLION;
+        cache_cfg.flush_dirty_size = BILLION;
+        cache_cfg.max_size = GIGABYTE;
+
+        {
+            cache_t cache(this->serializer, cache_cfg, &get_global_perfmon_collection());
+            btree_slice_t::create(&cache, std::vector<char>(), std::vector<char>());
+            btree_slice_t slice(&cache, &get_global_perfmon_collection(), "unittest");
+            insert_keys(&slice);
+        }
+
+        run_traversals(cache_cfg, key_range_t::universe(), SIZE_MAX);
+        run_traversals(cache_cfg, key_range_t::universe(), 300);
+        run_traversals(cache_cfg,
+                       key_range_t(key_range_t::closed, traversal_test_key(500),
+                                   key_range_t::open, traversal_test_key(1500)),
+                       SIZE_MAX);
+    }
+
+    void insert_keys(btree_slice_t *slice) {
+        order_source_t order_source;
+        for (int i = 0; i < TRAVERSAL_TEST_KEYS; ++i) {
+            scoped_ptr_t<transaction_t> txn;
+            scoped_ptr_t<real_superblock_t> superblock;
+            get_btree_superblock_and_txn(slice, rwi_write, 1, repli_timestamp_t::distant_past,
+                                         order_source.check_in("insert_keys"),
+                                         WRITE_DURABILITY_SOFT, &superblock, &txn);
+            counted_t<data_buffer_t> data = data_buffer_t::create(100);
+            memset(data->buf(), 'a' + i % 26, data->size());
+            memcached_set(traversal_test_key(i), slice, data, 0, 0,
+                          add_policy_yes, replace_policy_yes, NO_CAS_SUPPLIED, 0, 0,
+                          repli_timestamp_t::distant_past, txn.get(), superblock.get());
+        }
+    }
+
+    // Traverses `range` in a cache that starts out empty, so that the children
+    // come from disk, once with prefetching turned off and once with it on.
+    void run_traversals(const mirrored_cache_config_t &cache_cfg, const key_range_t &range, size_t limit) {
+        std::vector<std::string> expected;
+        for (int i = 0; i < TRAVERSAL_TEST_KEYS && expected.size() < limit; ++i) {
+            store_key_t key = traversal_test_key(i);
+            if (range.contains_key(key)) {
+                expected.push_back(key_to_unescaped_str(key));
+            }
+        }
+
+        const int windows[] = { 0, 1, DEFAULT_TRAVERSAL_PREFETCH_WINDOW, 64 };
+        for (size_t i = 0; i < sizeof(windows) / sizeof(windows[0]); ++i) {
+            SCOPED_TRACE(strprintf("prefetch window %d", windows[i]));
+            cache_t cache(this->serializer, cache_cfg, &get_global_perfmon_collection());
+            btree_slice_t slice(&cache, &get_global_perfmon_collection(), "unittest");
+            slice.traversal_prefetch_window = windows[i];
+
+            order_source_t order_source;
+            scoped_ptr_t<transaction_t> txn;
+            scoped_ptr_t<real_superblock_t> superblock;
+            get_btree_superblock_and_txn_for_reading(&slice, rwi_read,
+                                                     order_source.check_in("run_traversals"),
+                                                     CACHE_SNAPSHOTTED_NO, &superblock, &txn);
+            collect_keys_callback_t callback(limit);
+            const bool reached_end = btree_depth_first_traversal(&slice, txn.get(), superblock.get(),
+                                                                 range, &callback);
+            EXPECT_EQ(expected.size() < limit, reached_end);
+            EXPECT_TRUE(expected == callback.keys);
+        }
+    }
+};
+
+TEST(DepthFirstTraversalTest, PrefetchingDoesNotChangeResults) {
+    traversal_tester_t().run();
+}
+
+}  // namespace unittest
@@ -7,6 +7,7 @@
 #include "concurrency/queue/disk_backed_queue_wrapper.hpp"
 #include "containers/archive/stl_types.hpp"
 #include "containers/disk_backed_queue.hpp"
+#include "containers/segmented_log_queue.hpp"
 #include "unittest/unittest_utils.hpp"
 #include "unittest/gtest.hpp"
 
@@ -18,13 +19,14 @@ serializer_filepath_t dbq_serializer_path() {
     return manual_serializer_filepath(DBQ_TEST_PATH, std::string(DBQ_TEST_PATH) + ".create");
 }
 
+template <class queue_t>
 void run_many_ints_test() {
     static const int NUM_ELTS_IN_QUEUE = 1000;
     io_backender_t io_backender;
 
     const serializer_filepath_t serializer_path = dbq_serializer_path();
 
-    disk_backed_queue_t<int> queue(&io_backender, serializer_path, &get_global_perfmon_collection());
+    queue_t queue(&io_backender, serializer_path, &get_global_perfmon_collection());
     std::queue<int> ref_queue;
 
     for (int i = 0; i < NUM_ELTS_IN_QUEUE; ++i) {
@@ -42,16 +44,21 @@ void run_many_ints_test() {
 }
 
 TEST(DiskBackedQueue, ManyInts) {
-    unittest::run_in_thread_pool(&run_many_ints_test, 2);
+    unittest::run_in_thread_pool(&run_many_ints_test<disk_backed_queue_t<int> >, 2);
 }
 
+TEST(SegmentedLogQueue, ManyInts) {
+    unittest::run_in_thread_pool(&run_many_ints_test<segmented_log_queue_t<int> >, 2);
+}
+
+template <class queue_t>
 void run_big_values_test() {
     static const int NUM_BIG_ELTS_IN_QUEUE = 100;
     io_backender_t io_backender;
 
     const serializer_filepath_t serializer_path = dbq_serializer_path();
 
-    disk_backed_queue_t<std::string> queue(&io_backender, serializer_path, &get_global_perfmon_collection());
+    queue_t queue(&io_backender, serializer_path, &get_global_perfmon_collection());
     std::queue<std::string> ref_queue;
 
     std::string val;
@@ -71,19 +78,57 @@ void run_big_values_test() {
 }
 
 TEST(DiskBackedQueue, BigVals) {
-    unittest::run_in_thread_pool(&run_big_values_test, 2);
+    unittest::run_in_thread_pool(&run_big_values_test<disk_backed_queue_t<std::string> >, 2);
+}
+
+TEST(SegmentedLogQueue, BigVals) {
+    unittest::run_in_thread_pool(&run_big_values_test<segmented_log_queue_t<std::string> >, 2);
+}
+
+void run_interleaved_test() {
+    io_backender_t io_backender;
+
+    const serializer_filepath_t serializer_path = dbq_serializer_path();
+
+    // Pops that keep up with the pushes, and then fall a few chunks behind.
+    segmented_log_queue_t<std::string> queue(&io_backender, serializer_path, &get_global_perfmon_collection());
+    std::queue<std::string> ref_queue;
+    for (int i = 0; i < 4000; ++i) {
+        const std::string val(randint(10000), 'a' + i % 26);
+        queue.push(val);
+        ref_queue.push(val);
+        if (i < 2000 || i % 3 == 0) {
+            std::string x;
+            queue.pop(&x);
+            ASSERT_EQ(ref_queue.front(), x);
+            ref_queue.pop();
+        }
+    }
+    ASSERT_EQ(static_cast<int64_t>(ref_queue.size()), queue.size());
+    while (!ref_queue.empty()) {
+        std::string x;
+        queue.pop(&x);
+        ASSERT_EQ(ref_queue.front(), x);
+        ref_queue.pop();
+    }
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(SegmentedLogQueue, Interleaved) {
+    unittest::run_in_thread_pool(&run_interleaved_test, 2);
 }
 
 static void randomly_delay(int, signal_t *) {
     nap(randint(100));
 }
 
+template <class queue_wrapper_t>
 void run_concurrent_test() {
     io_backender_t io_backender;
 
     const serializer_filepath_t serializer_path = dbq_serializer_path();
 
-    disk_backed_queue_wrapper_t<int> queue(&io_backender, serializer_path, &get_global_perfmon_collection());
+    queue_wrapper_t queue(&io_backender, serializer_path, &get_global_perfmon_collection());
     boost_function_callback_t<int> callback(&randomly_delay);
     coro_pool_t<int> coro_pool(10, &queue, &callback);
     for (int i = 0; i < 1000; i++) {
@@ -94,7 +139,12 @@ void run_concurrent_test() {
 }
 
 TEST(DiskBackedQueue, Concurrent) {
-    unittest::run_in_thread_pool(&run_concurrent_test, 1);
+    unittest::run_in_thread_pool(&run_concurrent_test<disk_backed_queue_wrapper_t<int> >, 1);
+}
+
+TEST(SegmentedLogQueue, Concurrent) {
+    unittest::run_in_thread_pool(
+        &run_concurrent_test<disk_backed_queue_wrapper_t<int, segmented_log_queue_t<int> > >, 1);
 }
 
 } //namespace unittest
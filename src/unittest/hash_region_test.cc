@@ -112,9 +112,39 @@ TEST(HashRegionTest, SpecialNonSquareRegionJoin) {
     assert_equal(key_range_t::universe(), r.inner);
 }
 
-
-
-
+TEST(HashRegionTest, RegionSplitByKeys) {
+    uint64_t quarter = HASH_REGION_HASH_SIZE / 4;
+    key_range_t kr(key_range_t::closed, store_key_t("user:a"), key_range_t::open, store_key_t("user:z"));
+    hash_region_t<key_range_t> region(quarter, quarter * 2, kr);
+
+    std::vector<hash_region_t<key_range_t> > parts = region_split_by_keys(region, 3);
+    ASSERT_EQ(3u, parts.size());
+
+    // The parts keep the hash interval, and put the region back together.
+    for (size_t i = 0; i < parts.size(); ++i) {
+        ASSERT_EQ(quarter, parts[i].beg);
+        ASSERT_EQ(quarter * 2, parts[i].end);
+        ASSERT_FALSE(region_is_empty(parts[i]));
+    }
+    hash_region_t<key_range_t> joined;
+    ASSERT_EQ(REGION_JOIN_OK, region_join(parts, &joined));
+    ASSERT_TRUE(joined == region);
+
+    // The split points share the bounds' common prefix.
+    ASSERT_EQ(0, memcmp(parts[1].inner.left.contents(), "user:", 5));
+
+    // The whole key space splits too.
+    parts = region_split_by_keys(hash_region_t<key_range_t>::universe(), 4);
+    ASSERT_EQ(4u, parts.size());
+    ASSERT_EQ(REGION_JOIN_OK, region_join(parts, &joined));
+    ASSERT_TRUE(joined == hash_region_t<key_range_t>::universe());
+
+    // A range too narrow to split is left alone.
+    key_range_t narrow(key_range_t::closed, store_key_t("ab"), key_range_t::open, store_key_t(std::string("ab\0\1", 4)));
+    parts = region_split_by_keys(hash_region_t<key_range_t>(narrow), 4);
+    ASSERT_EQ(1u, parts.size());
+    assert_equal(narrow, parts[0].inner);
+}
 
 }  // namespace unittest
 
@@ -0,0 +1,143 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include <map>
+#include <string>
+#include <vector>
+
+#include "clustering/administration/heat_balancer.hpp"
+#include "memcached/protocol.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+class heat_balancer_test_table_t {
+public:
+    // A table with up to four shards, split at "b", "c" and "d".  `us` is the
+    // primary of the first `our_primaries` of them and a secondary of the rest,
+    // and `them` is the other way around.
+    heat_balancer_test_table_t(int num_shards, int our_primaries)
+        : ns_id(generate_uuid()), us(generate_uuid()), them(generate_uuid()) {
+        static const char *const split_points[] = { "b", "c", "d" };
+        std::vector<memcached_protocol_t::region_t> regions;
+        for (int i = 0; i < num_shards; ++i) {
+            key_range_t range = key_range_t::universe();
+            if (i > 0) {
+                range.left = store_key_t(split_points[i - 1]);
+            }
+            if (i < num_shards - 1) {
+                range.right = key_range_t::right_bound_t(store_key_t(split_points[i]));
+            }
+            regions.push_back(memcached_protocol_t::region_t(range));
+        }
+        nonoverlapping_regions_t<memcached_protocol_t> shards;
+        guarantee(shards.set_regions(regions));
+
+        persistable_blueprint_t<memcached_protocol_t> blueprint;
+        for (int i = 0; i < num_shards; ++i) {
+            const bool ours = i < our_primaries;
+            blueprint.machines_roles[us][regions[i]] = ours ? blueprint_role_primary : blueprint_role_secondary;
+            blueprint.machines_roles[them][regions[i]] = ours ? blueprint_role_secondary : blueprint_role_primary;
+        }
+
+        namespace_semilattice_metadata_t<memcached_protocol_t> ns;
+        ns.shards = vclock_t<nonoverlapping_regions_t<memcached_protocol_t> >(shards, us);
+        ns.blueprint = vclock_t<persistable_blueprint_t<memcached_protocol_t> >(blueprint, us);
+        namespaces.namespaces[ns_id] = deletable_t<namespace_semilattice_metadata_t<memcached_protocol_t> >(ns);
+    }
+
+    // Adds `n` sampled operations on keys that start with `prefix` and spread
+    // out evenly after it.
+    void add_samples(const std::string &prefix, int n) {
+        for (int i = 0; i < n; ++i) {
+            heat[ns_id].samples.push_back(range_heat_sample_t(store_key_t(prefix + strprintf("%03d", i)), false));
+        }
+    }
+
+    // Sets how many operations the stores saw in one second, of which the
+    // samples are a part.
+    void set_ops(int64_t ops) {
+        heat[ns_id].reads = ops;
+    }
+
+    void find(double their_primary_ops_per_sec) {
+        std::map<namespace_id_t, double> others;
+        others[ns_id] = their_primary_ops_per_sec;
+        our_primary_ops_per_sec.clear();
+        hot_shards.clear();
+        find_hot_shards(namespaces, heat, us, 1.0, others, &our_primary_ops_per_sec, &hot_shards);
+    }
+
+    namespace_id_t ns_id;
+    machine_id_t us, them;
+    namespaces_semilattice_metadata_t<memcached_protocol_t> namespaces;
+    std::map<namespace_id_t, range_heat_samples_t> heat;
+
+    std::map<namespace_id_t, double> our_primary_ops_per_sec;
+    std::vector<hot_shard_t> hot_shards;
+};
+
+TEST(HeatBalancer, BalancedSingleShardMachineIsNotHot) {
+    // All of our load is on our one primary shard, but the other machine's
+    // three shards get as much each.
+    heat_balancer_test_table_t table(4, 1);
+    table.add_samples("a", 256);
+    table.set_ops(100000);
+    table.find(300000);
+    EXPECT_EQ(100000, table.our_primary_ops_per_sec[table.ns_id]);
+    EXPECT_TRUE(table.hot_shards.empty());
+}
+
+TEST(HeatBalancer, SkewedShardIsHot) {
+    heat_balancer_test_table_t table(4, 1);
+    table.add_samples("a", 256);
+    table.set_ops(100000);
+    table.find(20000);
+    ASSERT_EQ(1u, table.hot_shards.size());
+    const hot_shard_t &hot = table.hot_shards[0];
+    EXPECT_TRUE(hot.namespace_id == table.ns_id);
+    EXPECT_TRUE(hot.shard.right == key_range_t::right_bound_t(store_key_t("b")));
+    EXPECT_TRUE(hot.shard.contains_key(hot.split_point));
+    EXPECT_TRUE(hot.split_point > store_key_t("a064"));
+    EXPECT_TRUE(hot.split_point < store_key_t("a192"));
+    EXPECT_EQ(100000, hot.ops_per_sec);
+    EXPECT_NEAR(100000.0 / 120000.0, hot.share, 1e-9);
+}
+
+TEST(HeatBalancer, ReplicatedWritesAreNotCounted) {
+    // Our store also sees the writes to the shard we are a secondary of.  Its
+    // primary counts those, so they must not make our own shard look hot, nor
+    // be published as ours.
+    heat_balancer_test_table_t table(2, 1);
+    table.add_samples("a", 64);
+    table.add_samples("b", 192);
+    table.set_ops(100000);
+    table.find(75000);
+    EXPECT_EQ(25000, table.our_primary_ops_per_sec[table.ns_id]);
+    EXPECT_TRUE(table.hot_shards.empty());
+}
+
+TEST(HeatBalancer, SingleShardTable) {
+    heat_balancer_test_table_t table(1, 1);
+    table.add_samples("a", 256);
+
+    // A table with one shard can't be balanced any other way.
+    table.set_ops(100000);
+    table.find(0);
+    EXPECT_EQ(1u, table.hot_shards.size());
+
+    // But it has to be busy enough.
+    table.set_ops(HEAT_BALANCER_MIN_OPS_PER_SEC / 2);
+    table.find(0);
+    EXPECT_TRUE(table.hot_shards.empty());
+}
+
+TEST(HeatBalancer, OnlyPrimariesSpeakForShards) {
+    // The other machine is the primary of the shard all of our load lands on.
+    heat_balancer_test_table_t table(2, 1);
+    table.add_samples("b", 256);
+    table.set_ops(100000);
+    table.find(100000);
+    EXPECT_TRUE(table.hot_shards.empty());
+    EXPECT_EQ(0, table.our_primary_ops_per_sec[table.ns_id]);
+}
+
+}  // namespace unittest
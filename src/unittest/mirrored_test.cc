@@ -3,6 +3,7 @@
 #include "errors.hpp"
 #include <boost/bind.hpp>
 
+#include "arch/runtime/coroutines.hpp"
 #include "buffer_cache/buffer_cache.hpp"
 #include "unittest/unittest_utils.hpp"
 #include "serializer/log/log_serializer.hpp" // for ls_buf_data_t
@@ -132,5 +133,175 @@ TEST(MirroredTest, Durability) {
     unittest::run_in_thread_pool(boost::bind(&durability_tester_t::check_snapshotted_file_contents, &tester));
 }
 
+class prewarm_tester_t : public server_test_helper_t {
+protected:
+    void run_tests(UNUSED cache_t *cache) { }
+
+    // We need a fresh cache on the same serializer, so we make our own caches.
+    void run_serializer_tests() {
+        cache_t::create(this->serializer);
+        mirrored_cache_config_t cache_cfg;
+        cache_cfg.flush_timer_ms = MILLION;
+        cache_cfg.flush_dirty_size = BILLION;
+        cache_cfg.max_size = GIGABYTE;
+
+        std::vector<block_id_t> hot_block_ids;
+        {
+            cache_t cache(this->serializer, cache_cfg, &get_global_perfmon_collection());
+            transaction_t txn(&cache, rwi_write, 0, repli_timestamp_t::distant_past,
+                              order_token_t::ignore, WRITE_DURABILITY_HARD);
+            for (uint64_t i = 0; i < 10; ++i) {
+                buf_lock_t buf(&txn);
+                *static_cast<uint64_t *>(buf.get_data_write()) = i;
+            }
+            cache.get_hot_block_ids(&hot_block_ids);
+        }
+        EXPECT_LE(10u, hot_block_ids.size());
+
+        cache_t cache(this->serializer, cache_cfg, &get_global_perfmon_collection());
+        cond_t non_interruptor;
+        cache.prewarm(hot_block_ids, &non_interruptor);
+        for (size_t i = 0; i < hot_block_ids.size(); ++i) {
+            EXPECT_TRUE(cache.contains_block(hot_block_ids[i]));
+        }
+    }
+};
+
+TEST(MirroredTest, PrewarmLoadsTheHotList) {
+    prewarm_tester_t().run();
+}
+
+class prewarm_race_tester_t : public server_test_helper_t {
+protected:
+    void run_tests(UNUSED cache_t *cache) { }
+
+    static void prewarm(cache_t *cache, block_id_t block_id, cond_t *done) {
+        cond_t non_interruptor;
+        cache->prewarm(std::vector<block_id_t>(1, block_id), &non_interruptor);
+        done->pulse();
+    }
+
+    void run_serializer_tests() {
+        cache_t::create(this->serializer);
+        mirrored_cache_config_t cache_cfg;
+        cache_cfg.flush_timer_ms = MILLION;
+        cache_cfg.flush_dirty_size = BILLION;
+        cache_cfg.max_size = GIGABYTE;
+
+        block_id_t block_id;
+        {
+            cache_t cache(this->serializer, cache_cfg, &get_global_perfmon_collection());
+            transaction_t txn(&cache, rwi_write, 0, repli_timestamp_t::distant_past,
+                              order_token_t::ignore, WRITE_DURABILITY_HARD);
+            buf_lock_t buf(&txn);
+            block_id = buf.get_block_id();
+            *static_cast<uint64_t *>(buf.get_data_write()) = value_A;
+        }
+
+        cache_t cache(this->serializer, cache_cfg, &get_global_perfmon_collection());
+
+        // The prewarm reads value_A, and the read doesn't complete until we
+        // let it.  Everything up to the read happens before `prewarm()` first
+        // blocks.
+        cond_t read_hold, prewarm_done;
+        this->mock_file_opener->hold_reads(&read_hold);
+        coro_t::spawn_now_dangerously(boost::bind(&prewarm_race_tester_t::prewarm,
+                                                  &cache, block_id, &prewarm_done));
+        this->mock_file_opener->hold_reads(NULL);
+        ASSERT_FALSE(prewarm_done.is_pulsed());
+
+        // Meanwhile, a query loads the block, changes it, and flushes it.
+        {
+            transaction_t txn(&cache, rwi_write, 0, repli_timestamp_t::distant_past,
+                              order_token_t::ignore, WRITE_DURABILITY_HARD);
+            buf_lock_t buf(&txn, block_id, rwi_write);
+            *static_cast<uint64_t *>(buf.get_data_write()) = value_B;
+        }
+
+        // Then the block gets evicted.
+        for (int i = 0; i < 1000 && cache.contains_block(block_id); ++i) {
+            cache.set_max_size(0);
+            coro_t::yield();
+        }
+        ASSERT_FALSE(cache.contains_block(block_id));
+        cache.set_max_size(cache_cfg.max_size);
+
+        // The prewarm's read of value_A finishes now, and has to be thrown away.
+        read_hold.pulse();
+        prewarm_done.wait();
+        EXPECT_FALSE(cache.contains_block(block_id));
+
+        transaction_t txn(&cache, rwi_read, order_token_t::ignore);
+        buf_lock_t buf(&txn, block_id, rwi_read);
+        EXPECT_EQ(value_B, *static_cast<const uint64_t *>(buf.get_data_read()));
+    }
+};
+
+TEST(MirroredTest, PrewarmDropsBlocksChangedDuringTheRead) {
+    prewarm_race_tester_t().run();
+}
+
+class threshold_flush_tester_t : public server_test_helper_t {
+protected:
+    void run_tests(UNUSED cache_t *cache) { }
+
+    static void begin_write(cache_t *cache, cond_t *began, cond_t *release, cond_t *done) {
+        {
+            transaction_t txn(cache, rwi_write, 0, repli_timestamp_t::distant_past,
+                              order_token_t::ignore, WRITE_DURABILITY_SOFT);
+            began->pulse();
+            release->wait();
+        }
+        done->pulse();
+    }
+
+    void run_serializer_tests() {
+        cache_t::create(this->serializer);
+        mirrored_cache_config_t cache_cfg;
+        cache_cfg.flush_timer_ms = NEVER_FLUSH;
+        cache_cfg.flush_dirty_size = 2 * this->serializer->get_block_size().ser_value();
+        cache_cfg.max_size = GIGABYTE;
+        cache_t cache(this->serializer, cache_cfg, &get_global_perfmon_collection());
+
+        // One write transaction stays open, while another one dirties more
+        // blocks than the flush threshold.
+        scoped_ptr_t<transaction_t> open_txn(new transaction_t(&cache, rwi_write, 0,
+                                                               repli_timestamp_t::distant_past,
+                                                               order_token_t::ignore,
+                                                               WRITE_DURABILITY_SOFT));
+        {
+            transaction_t txn(&cache, rwi_write, 3, repli_timestamp_t::distant_past,
+                              order_token_t::ignore, WRITE_DURABILITY_SOFT);
+            for (int i = 0; i < 3; ++i) {
+                buf_lock_t buf(&txn);
+                *static_cast<uint64_t *>(buf.get_data_write()) = i;
+            }
+        }
+
+        // That flush doesn't wait for a gap between write transactions, so it
+        // takes the flush lock ahead of the next write transaction, which has
+        // to wait until the open one commits.
+        for (int i = 0; i < 10; ++i) {
+            coro_t::yield();
+        }
+        cond_t began, release, done;
+        coro_t::spawn_sometime(boost::bind(&threshold_flush_tester_t::begin_write,
+                                           &cache, &began, &release, &done));
+        for (int i = 0; i < 10; ++i) {
+            coro_t::yield();
+        }
+        EXPECT_FALSE(began.is_pulsed());
+
+        open_txn.reset();
+        began.wait();
+        release.pulse();
+        done.wait();
+    }
+};
+
+TEST(MirroredTest, ThresholdFlushDoesNotWaitForWritesToDrain) {
+    threshold_flush_tester_t().run();
+}
+
 }  // namespace unittest
 
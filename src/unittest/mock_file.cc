@@ -5,11 +5,18 @@
 
 #include "arch/io/disk.hpp"
 #include "arch/runtime/coroutines.hpp"
+#include "concurrency/signal.hpp"
 #include "unittest/gtest.hpp"
 
 namespace unittest {
 
-mock_file_t::mock_file_t(mode_t mode, std::vector<char> *data) : mode_(mode), data_(data) {
+static void complete_io_after(signal_t *signal, linux_iocallback_t *cb) {
+    signal->wait_lazily_unordered();
+    cb->on_io_complete();
+}
+
+mock_file_t::mock_file_t(mode_t mode, std::vector<char> *data, signal_t *const *read_hold)
+    : mode_(mode), data_(data), read_hold_(read_hold) {
     guarantee(mode != 0);
     guarantee(data_ != NULL);
 }
@@ -26,6 +33,10 @@ void mock_file_t::set_size_at_least(size_t size) {
 void mock_file_t::read_async(size_t offset, size_t length, void *buf,
                              UNUSED file_account_t *account, linux_iocallback_t *cb) {
     read_blocking(offset, length, buf);
+    if (*read_hold_ != NULL) {
+        coro_t::spawn_sometime(std::bind(&complete_io_after, *read_hold_, cb));
+        return;
+    }
     // RSI: This is to silence the serializer disk_structure.cc reader_t
     // use-after-free bug: https://github.com/rethinkdb/rethinkdb/issues/738
     coro_t::spawn_sometime(std::bind(&linux_iocallback_t::on_io_complete, cb));
@@ -64,7 +75,7 @@ std::string mock_file_opener_t::file_name() const {
 
 void mock_file_opener_t::open_serializer_file_create_temporary(scoped_ptr_t<file_t> *file_out) {
     ASSERT_EQ(no_file, file_existence_state_);
-    file_out->init(new mock_file_t(mock_file_t::mode_rw, &file_));
+    file_out->init(new mock_file_t(mock_file_t::mode_rw, &file_, &read_hold_));
     file_existence_state_ = temporary_file;
 }
 
@@ -75,7 +86,7 @@ void mock_file_opener_t::move_serializer_file_to_permanent_location() {
 
 void mock_file_opener_t::open_serializer_file_existing(scoped_ptr_t<file_t> *file_out) {
     ASSERT_TRUE(file_existence_state_ == temporary_file || file_existence_state_ == permanent_file);
-    file_out->init(new mock_file_t(mock_file_t::mode_rw, &file_));
+    file_out->init(new mock_file_t(mock_file_t::mode_rw, &file_, &read_hold_));
 }
 
 void mock_file_opener_t::unlink_serializer_file() {
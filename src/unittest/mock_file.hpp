@@ -9,6 +9,8 @@
 #include "errors.hpp"
 #include "serializer/types.hpp"
 
+class signal_t;
+
 namespace unittest {
 
 class mock_file_t : public file_t {
@@ -16,7 +18,9 @@ public:
     // That mode_rw == (mode_read | mode_write) is no accident.
     enum mode_t { mode_read = 1, mode_write = 2, mode_rw = 3 };
 
-    mock_file_t(mode_t mode, std::vector<char> *data);
+    // Reads complete after `*read_hold` is pulsed, if it isn't NULL when they
+    // are issued.
+    mock_file_t(mode_t mode, std::vector<char> *data, signal_t *const *read_hold);
     ~mock_file_t();
 
     uint64_t get_size();
@@ -43,15 +47,22 @@ public:
 private:
     mode_t mode_;
     std::vector<char> *data_;
+    signal_t *const *read_hold_;
 
     DISABLE_COPYING(mock_file_t);
 };
 
 class mock_file_opener_t : public serializer_file_opener_t {
 public:
-    mock_file_opener_t() : file_existence_state_(no_file) { }
+    mock_file_opener_t() : file_existence_state_(no_file), read_hold_(NULL) { }
     std::string file_name() const;
 
+    // Reads of the file that are issued while `hold` is set don't complete
+    // until it is pulsed, so that tests can do things while a read is in
+    // flight.  The data is still read when the read is issued.  Pass NULL to
+    // let new reads complete right away again.
+    void hold_reads(signal_t *hold) { read_hold_ = hold; }
+
     void open_serializer_file_create_temporary(scoped_ptr_t<file_t> *file_out);
     void move_serializer_file_to_permanent_location();
     void open_serializer_file_existing(scoped_ptr_t<file_t> *file_out);
@@ -64,6 +75,7 @@ private:
     enum existence_state_t { no_file, temporary_file, permanent_file, unlinked_file };
     existence_state_t file_existence_state_;
     std::vector<char> file_;
+    signal_t *read_hold_;
 #ifdef SEMANTIC_SERIALIZER_CHECK
     std::vector<char> semantic_checking_file_;
 #endif
@@ -0,0 +1,118 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include <string>
+#include <vector>
+
+#include "btree/introspection.hpp"
+#include "btree/range_heat.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+void add_samples(const std::string &key, int n, std::vector<range_heat_sample_t> *samples) {
+    for (int i = 0; i < n; ++i) {
+        samples->push_back(range_heat_sample_t(store_key_t(key), i % 2 == 0));
+    }
+}
+
+TEST(RangeHeat, SketchSamplesOneInN) {
+    range_heat_sketch_t sketch;
+    int sampled = 0;
+    for (int i = 0; i < RANGE_HEAT_SAMPLE_RATE * 3; ++i) {
+        if (sketch.count(i % 3 == 0)) {
+            sketch.record(store_key_t("k"), false);
+            ++sampled;
+        }
+    }
+    EXPECT_EQ(3, sampled);
+
+    range_heat_samples_t out;
+    sketch.collect(&out);
+    EXPECT_EQ(RANGE_HEAT_SAMPLE_RATE * 3, out.reads + out.writes);
+    EXPECT_EQ(RANGE_HEAT_SAMPLE_RATE, out.writes);
+    EXPECT_EQ(3u, out.samples.size());
+
+    // Collecting starts over.
+    range_heat_samples_t again;
+    sketch.collect(&again);
+    EXPECT_EQ(0, again.reads + again.writes);
+    EXPECT_TRUE(again.samples.empty());
+}
+
+TEST(RangeHeat, SketchKeepsTheNewestSamples) {
+    range_heat_sketch_t sketch;
+    for (int i = 0; i < RANGE_HEAT_MAX_SAMPLES + 10; ++i) {
+        sketch.record(store_key_t(i < 10 ? "old" : "new"), true);
+    }
+    range_heat_samples_t out;
+    sketch.collect(&out);
+    ASSERT_EQ(static_cast<size_t>(RANGE_HEAT_MAX_SAMPLES), out.samples.size());
+    for (size_t i = 0; i < out.samples.size(); ++i) {
+        EXPECT_TRUE(out.samples[i].key == store_key_t("new"));
+    }
+}
+
+TEST(RangeHeat, PeekLeavesTheSketchAlone) {
+    range_heat_sketch_t sketch;
+    sketch.count(true);
+    sketch.record(store_key_t("k"), true);
+
+    range_heat_samples_t peeked;
+    sketch.peek(&peeked);
+    EXPECT_EQ(1, peeked.writes);
+    EXPECT_EQ(1u, peeked.samples.size());
+
+    range_heat_samples_t out;
+    sketch.collect(&out);
+    EXPECT_EQ(1, out.writes);
+    EXPECT_EQ(1u, out.samples.size());
+}
+
+TEST(RangeHeat, SplitPointDividesTheLoad) {
+    std::vector<range_heat_sample_t> samples;
+    add_samples("a", 10, &samples);
+    add_samples("b", 10, &samples);
+    add_samples("c", 10, &samples);
+    add_samples("d", 10, &samples);
+    // Outside of the range, so it doesn't count.
+    add_samples("z", 100, &samples);
+
+    const key_range_t range(key_range_t::none, store_key_t(),
+                            key_range_t::open, store_key_t("m"));
+    store_key_t split;
+    ASSERT_TRUE(suggest_heat_split_point(samples, range, 10, &split));
+    EXPECT_TRUE(split == store_key_t("c"));
+
+    // Not enough samples.
+    EXPECT_FALSE(suggest_heat_split_point(samples, range, 41, &split));
+}
+
+TEST(RangeHeat, NoSplitPointForOneHotKey) {
+    std::vector<range_heat_sample_t> samples;
+    add_samples("a", 2, &samples);
+    add_samples("hot", 100, &samples);
+    add_samples("z", 2, &samples);
+
+    // Neither side of any split would get a quarter of the load.
+    store_key_t split;
+    EXPECT_FALSE(suggest_heat_split_point(samples, key_range_t::universe(), 10, &split));
+}
+
+TEST(RangeHeat, IntrospectionChargesSamplesToTheirRange) {
+    btree_introspection_t btree;
+    btree.ranges.push_back(btree_range_introspection_t(
+        key_range_t(key_range_t::none, store_key_t(), key_range_t::open, store_key_t("m"))));
+    btree.ranges.push_back(btree_range_introspection_t(
+        key_range_t(key_range_t::closed, store_key_t("m"), key_range_t::none, store_key_t())));
+
+    std::vector<range_heat_sample_t> samples;
+    add_samples("a", 4, &samples);
+    add_samples("z", 7, &samples);
+    add_heat_samples_to_introspection(samples, &btree);
+
+    EXPECT_EQ(2, btree.ranges[0].sampled_reads);
+    EXPECT_EQ(2, btree.ranges[0].sampled_writes);
+    EXPECT_EQ(3, btree.ranges[1].sampled_reads);
+    EXPECT_EQ(4, btree.ranges[1].sampled_writes);
+}
+
+}  // namespace unittest
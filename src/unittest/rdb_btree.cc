@@ -6,6 +6,8 @@
 
 #include "arch/io/disk.hpp"
 #include "btree/btree_store.hpp"
+#include "btree/depth_first_traversal.hpp"
+#include "btree/operations.hpp"
 #include "buffer_cache/mirrored/config.hpp"
 #include "containers/archive/boost_types.hpp"
 #include "rdb_protocol/btree.hpp"
@@ -465,4 +467,143 @@ TEST(RDBBtree, SindexInterruptionViaStoreDelete) {
     run_in_thread_pool(&run_sindex_interruption_via_store_delete);
 }
 
+void delete_rows(int start, int finish, btree_store_t<rdb_protocol_t> *store) {
+    guarantee(start <= finish);
+    for (int i = start; i < finish; ++i) {
+        cond_t dummy_interruptor;
+        scoped_ptr_t<transaction_t> txn;
+        scoped_ptr_t<real_superblock_t> superblock;
+        write_token_pair_t token_pair;
+        store->new_write_token_pair(&token_pair);
+        store->acquire_superblock_for_write(rwi_write, repli_timestamp_t::invalid,
+                                            1, WRITE_DURABILITY_SOFT,
+                                            &token_pair, &txn, &superblock, &dummy_interruptor);
+        block_id_t sindex_block_id = superblock->get_sindex_block_id();
+
+        store_key_t pk(cJSON_print_primary(scoped_cJSON_t(cJSON_CreateNumber(i)).get(), backtrace_t()));
+        rdb_modification_report_t mod_report(pk);
+        point_delete_response_t response;
+        rdb_delete(pk, store->btree.get(), repli_timestamp_t::invalid, txn.get(),
+                   superblock.get(), &response, &mod_report.info);
+
+        // There are no secondary indexes to update, but the sindex token has
+        // to be used.
+        scoped_ptr_t<buf_lock_t> sindex_block;
+        store->acquire_sindex_block_for_write(&token_pair, txn.get(), &sindex_block,
+                                              sindex_block_id, &dummy_interruptor);
+    }
+}
+
+class count_pairs_callback_t : public depth_first_traversal_callback_t {
+public:
+    count_pairs_callback_t() : count(0) { }
+    bool handle_pair(UNUSED const btree_key_t *key, UNUSED const void *value) {
+        ++count;
+        return true;
+    }
+    int64_t count;
+};
+
+// Checks that the population in the stat block, which answers plain counts of
+// the whole table, is the number of keys a traversal finds.
+void check_population(btree_store_t<rdb_protocol_t> *store, int64_t expected) {
+    cond_t dummy_interruptor;
+    read_token_pair_t token_pair;
+    store->new_read_token_pair(&token_pair);
+    scoped_ptr_t<transaction_t> txn;
+    scoped_ptr_t<real_superblock_t> superblock;
+    store->acquire_superblock_for_read(rwi_read, &token_pair.main_read_token, &txn, &superblock,
+                                       &dummy_interruptor, true);
+    EXPECT_EQ(expected, get_btree_population(txn.get(), superblock.get()));
+
+    count_pairs_callback_t callback;
+    btree_depth_first_traversal(store->btree.get(), txn.get(), superblock.get(),
+                                key_range_t::universe(), &callback);
+    EXPECT_EQ(expected, callback.count);
+}
+
+void run_population_test() {
+    recreate_temporary_directory(base_path_t("."));
+    temp_file_t temp_file;
+
+    io_backender_t io_backender;
+
+    filepath_file_opener_t file_opener(temp_file.name(), &io_backender);
+    standard_serializer_t::create(
+        &file_opener,
+        standard_serializer_t::static_config_t());
+
+    standard_serializer_t serializer(
+        standard_serializer_t::dynamic_config_t(),
+        &file_opener,
+        &get_global_perfmon_collection());
+
+    rdb_protocol_t::store_t store(
+            &serializer,
+            "unit_test_store",
+            GIGABYTE,
+            true,
+            &get_global_perfmon_collection(),
+            NULL,
+            &io_backender,
+            base_path_t("."));
+
+    cond_t dummy_interruptor;
+
+    check_population(&store, 0);
+
+    insert_rows(0, TOTAL_KEYS_TO_INSERT, &store);
+    check_population(&store, TOTAL_KEYS_TO_INSERT);
+
+    // Inserting rows that are already there doesn't change the population.
+    insert_rows(0, TOTAL_KEYS_TO_INSERT / 10, &store);
+    check_population(&store, TOTAL_KEYS_TO_INSERT);
+
+    delete_rows(0, TOTAL_KEYS_TO_INSERT / 10, &store);
+    check_population(&store, TOTAL_KEYS_TO_INSERT - TOTAL_KEYS_TO_INSERT / 10);
+
+    // Deleting rows that aren't there doesn't change it either.
+    delete_rows(0, TOTAL_KEYS_TO_INSERT / 10, &store);
+    check_population(&store, TOTAL_KEYS_TO_INSERT - TOTAL_KEYS_TO_INSERT / 10);
+
+    // Erase part of the range, and count what's left the slow way.
+    const store_key_t erase_left(cJSON_print_primary(scoped_cJSON_t(cJSON_CreateNumber(TOTAL_KEYS_TO_INSERT / 2)).get(), backtrace_t()));
+    const store_key_t erase_right(cJSON_print_primary(scoped_cJSON_t(cJSON_CreateNumber(TOTAL_KEYS_TO_INSERT * 3 / 4)).get(), backtrace_t()));
+    const key_range_t erased(key_range_t::closed, std::min(erase_left, erase_right),
+                             key_range_t::open, std::max(erase_left, erase_right));
+    int64_t remaining = 0;
+    for (int i = TOTAL_KEYS_TO_INSERT / 10; i < TOTAL_KEYS_TO_INSERT; ++i) {
+        if (!erased.contains_key(store_key_t(cJSON_print_primary(scoped_cJSON_t(cJSON_CreateNumber(i)).get(), backtrace_t())))) {
+            ++remaining;
+        }
+    }
+    ASSERT_LT(remaining, TOTAL_KEYS_TO_INSERT - TOTAL_KEYS_TO_INSERT / 10);
+    {
+        write_token_pair_t token_pair;
+        store.new_write_token_pair(&token_pair);
+
+        scoped_ptr_t<transaction_t> txn;
+        scoped_ptr_t<real_superblock_t> super_block;
+        store.acquire_superblock_for_write(rwi_write,
+                                           repli_timestamp_t::invalid,
+                                           1,
+                                           WRITE_DURABILITY_SOFT,
+                                           &token_pair,
+                                           &txn,
+                                           &super_block,
+                                           &dummy_interruptor);
+
+        const hash_region_t<key_range_t> test_range = hash_region_t<key_range_t>::universe();
+        rdb_protocol_details::range_key_tester_t tester(&test_range);
+        rdb_erase_range(store.btree.get(), &tester, erased,
+                        txn.get(), super_block.get(), &store, &token_pair,
+                        &dummy_interruptor);
+    }
+    check_population(&store, remaining);
+}
+
+TEST(RDBBtree, PopulationCountsKeys) {
+    run_in_thread_pool(&run_population_test);
+}
+
 } //namespace unittest
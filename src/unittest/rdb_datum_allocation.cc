@@ -0,0 +1,83 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include "errors.hpp"
+#include <boost/bind.hpp>
+
+#include "rdb_protocol/counted_term.hpp"
+#include "rdb_protocol/datum.hpp"
+#include "rdb_protocol/env.hpp"
+#include "rdb_protocol/term.hpp"
+#include "rdb_protocol/val.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/rdb_env.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+static const int NUM_ROWS = 500;
+
+void add_num_field(Datum *object, const std::string &key, double value) {
+    Datum_AssocPair *pair = object->add_r_object();
+    pair->set_key(key);
+    pair->mutable_val()->set_type(Datum::R_NUM);
+    pair->mutable_val()->set_r_num(value);
+}
+
+void add_str_field(Datum *object, const std::string &key, const std::string &value) {
+    Datum_AssocPair *pair = object->add_r_object();
+    pair->set_key(key);
+    pair->mutable_val()->set_type(Datum::R_STR);
+    pair->mutable_val()->set_r_str(value);
+}
+
+// Builds and evaluates an array of `NUM_ROWS` small objects, and reports how
+// many datums that allocated and how many of them came from the free list.
+void eval_rows(test_rdb_env_t::instance_t *env_instance, ql::protob_t<const Term> term,
+               uint64_t *allocations_out, uint64_t *reused_out) {
+    const ql::datum_allocation_stats_t before = ql::get_datum_allocation_stats();
+    {
+        counted_t<ql::term_t> compiled_term = ql::compile_term(env_instance->get(), term);
+        counted_t<ql::val_t> result = compiled_term->eval();
+        ASSERT_EQ(static_cast<size_t>(NUM_ROWS), result->as_datum()->size());
+    }
+    const ql::datum_allocation_stats_t after = ql::get_datum_allocation_stats();
+    *allocations_out = after.allocations - before.allocations;
+    *reused_out = after.reused - before.reused;
+}
+
+void run_allocation_test(test_rdb_env_t *test_env) {
+    scoped_ptr_t<test_rdb_env_t::instance_t> env_instance;
+    test_env->make_env(&env_instance);
+
+    ql::protob_t<Term> term = ql::make_counted_term();
+    term->set_type(Term::DATUM);
+    Datum *rows = term->mutable_datum();
+    rows->set_type(Datum::R_ARRAY);
+    for (int i = 0; i < NUM_ROWS; ++i) {
+        Datum *row = rows->add_r_array();
+        row->set_type(Datum::R_OBJECT);
+        add_num_field(row, "id", i);
+        add_str_field(row, "name", strprintf("row %d", i));
+        add_num_field(row, "score", i * 0.5);
+    }
+
+    // The first evaluation fills the free list.
+    uint64_t cold_allocations, cold_reused;
+    eval_rows(env_instance.get(), term, &cold_allocations, &cold_reused);
+    EXPECT_LE(static_cast<uint64_t>(1 + 4 * NUM_ROWS), cold_allocations);
+    uint64_t warm_allocations, warm_reused;
+    eval_rows(env_instance.get(), term, &warm_allocations, &warm_reused);
+
+    // One array, plus an object and three fields per row.
+    EXPECT_LE(static_cast<uint64_t>(1 + 4 * NUM_ROWS), warm_allocations);
+#ifndef VALGRIND
+    // Everything the first evaluation freed is handed out again by the second.
+    EXPECT_EQ(warm_allocations, warm_reused);
+#endif
+}
+
+TEST(RdbDatum, WarmEvaluationReusesAllocations) {
+    test_rdb_env_t test_env;
+    unittest::run_in_thread_pool(boost::bind(run_allocation_test, &test_env));
+}
+
+}  // namespace unittest
@@ -0,0 +1,146 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include <string>
+
+#include "config/args.hpp"
+#include "http/json.hpp"
+#include "rdb_protocol/datum.hpp"
+#include "rdb_protocol/json_reader.hpp"
+#include "rdb_protocol/parser.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+counted_t<const ql::datum_t> read_json_string(const std::string &json) {
+    std::string error;
+    counted_t<const ql::datum_t> datum = ql::read_json(json.data(), json.size(), &error);
+    EXPECT_TRUE(datum.has()) << json << ": " << error;
+    return datum;
+}
+
+// Reading JSON directly has to give the same datum as going through cJSON.
+void expect_same_as_cjson(const std::string &json) {
+    scoped_cJSON_t cjson(cJSON_Parse(json.c_str()));
+    ASSERT_TRUE(cjson.get() != NULL) << json;
+    ql::datum_t expected(cjson.get(), static_cast<ql::env_t *>(NULL));
+    counted_t<const ql::datum_t> datum = read_json_string(json);
+    ASSERT_TRUE(datum.has());
+    EXPECT_TRUE(expected == *datum) << json;
+}
+
+void expect_invalid(const std::string &json) {
+    std::string error;
+    EXPECT_FALSE(ql::read_json(json.data(), json.size(), &error).has()) << json;
+    EXPECT_FALSE(error.empty()) << json;
+}
+
+void run_json_reader_test() {
+    expect_same_as_cjson("null");
+    expect_same_as_cjson("true");
+    expect_same_as_cjson(" false ");
+    expect_same_as_cjson("0");
+    expect_same_as_cjson("-17");
+    expect_same_as_cjson("0.5");
+    expect_same_as_cjson("-2.5e-7");
+    expect_same_as_cjson("1E+100");
+    expect_same_as_cjson("\"abc\"");
+    expect_same_as_cjson("[]");
+    expect_same_as_cjson("{}");
+    expect_same_as_cjson("[1, \"x\", [null, {}], {\"a\": [true]}]");
+    expect_same_as_cjson("{\"b\": {\"c\": \"str\"}, \"a\": [0.5, null]}");
+    expect_same_as_cjson("\n{\t\"a\" :\r\n1 , \"b\":2}\n");
+
+    // Escapes, including ones that straddle the 64-byte blocks the structural
+    // pass works on.
+    expect_same_as_cjson("\"a\\\"b\\\\c\\/d\\b\\f\\n\\r\\t\"");
+    for (size_t padding = 55; padding < 70; ++padding) {
+        expect_same_as_cjson("[\"" + std::string(padding, 'x') + "\\\\\", \"\\\"\"]");
+        expect_same_as_cjson("{\"" + std::string(padding, 'y') + "\\\"\": 1}");
+    }
+
+    // Non-ASCII text is passed through, and `\u` escapes become UTF-8.
+    expect_same_as_cjson("\"caf\xc3\xa9\"");
+    EXPECT_EQ("caf\xc3\xa9", read_json_string("\"caf\\u00e9\"")->as_str());
+    EXPECT_EQ("\xe4\xb8\xad", read_json_string("\"\\u4E2D\"")->as_str());
+    EXPECT_EQ("\xf0\x9f\x98\x80", read_json_string("\"\\ud83d\\ude00\"")->as_str());
+
+    // Nesting is allowed up to the limit and no further.
+    const size_t max_depth = JSON_READER_MAX_NESTING_DEPTH;
+    expect_same_as_cjson(std::string(max_depth, '[') + std::string(max_depth, ']'));
+    expect_same_as_cjson(std::string(max_depth - 1, '[') + "{\"a\": 1}"
+                         + std::string(max_depth - 1, ']'));
+    expect_invalid(std::string(max_depth + 1, '[') + std::string(max_depth + 1, ']'));
+    expect_invalid(std::string(max_depth, '[') + "{\"a\": 1}" + std::string(max_depth, ']'));
+    expect_invalid(std::string(100000, '[') + std::string(100000, ']'));
+
+    expect_invalid("");
+    expect_invalid("   ");
+    expect_invalid("[1,]");
+    expect_invalid("[1 2]");
+    expect_invalid("[[1]");
+    expect_invalid("[1]]");
+    expect_invalid("{\"a\"}");
+    expect_invalid("{\"a\":}");
+    expect_invalid("{1: 2}");
+    expect_invalid("\"abc");
+    expect_invalid("\"abc\\\"");
+    expect_invalid("\"a\"b");
+    expect_invalid("truex");
+    expect_invalid("nul");
+    expect_invalid("01");
+    expect_invalid("1.");
+    expect_invalid("+1");
+    expect_invalid("NaN");
+    expect_invalid("1 2");
+    expect_invalid("\"\\x\"");
+    expect_invalid("\"\\u12\"");
+    expect_invalid("\"\\ud800\"");
+    expect_invalid("\"a\x01\"");
+
+    // Valid JSON that isn't a valid datum.
+    expect_invalid("1e999");
+    expect_invalid("\"\\u0000\"");
+    expect_invalid("{\"a\": 1, \"a\": 2}");
+
+    // The text doesn't have to be NUL-terminated, and nothing after `size` is
+    // looked at.
+    const std::string digits = "[12345]";
+    std::string error;
+    EXPECT_FALSE(ql::read_json(digits.data(), 4, &error).has());
+    counted_t<const ql::datum_t> prefix = ql::read_json(digits.data() + 1, 3, &error);
+    ASSERT_TRUE(prefix.has());
+    EXPECT_EQ(123.0, prefix->as_num());
+}
+
+TEST(RdbJsonReader, Datums) {
+    run_in_thread_pool(run_json_reader_test);
+}
+
+void expect_http_document_rejected(const std::string &body) {
+    std::string error;
+    EXPECT_FALSE(rdb_protocol::parse_http_document(body, &error)) << body;
+    EXPECT_FALSE(error.empty()) << body;
+}
+
+void run_http_document_test() {
+    const std::string body = "{\"id\": 7, \"name\": \"caf\\u00e9\", \"tags\": [true, null, 0.5]}";
+    std::string error;
+    boost::shared_ptr<scoped_cJSON_t> doc = rdb_protocol::parse_http_document(body, &error);
+    ASSERT_TRUE(doc) << error;
+    ql::datum_t stored(doc->get(), static_cast<ql::env_t *>(NULL));
+    EXPECT_TRUE(stored == *read_json_string(body));
+    EXPECT_EQ("caf\xc3\xa9", stored.get("name")->as_str());
+
+    // cJSON took these, and the store wrote them as they were.
+    expect_http_document_rejected("{\"id\": 1, \"id\": 2}");
+    expect_http_document_rejected("{\"id\": 1e999}");
+    expect_http_document_rejected("{\"id\": 1} trailing");
+
+    expect_http_document_rejected("");
+}
+
+TEST(RdbJsonReader, HttpDocuments) {
+    run_in_thread_pool(run_http_document_test);
+}
+
+}  // namespace unittest
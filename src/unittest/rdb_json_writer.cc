@@ -0,0 +1,85 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include <map>
+#include <string>
+#include <vector>
+
+#include "rdb_protocol/datum.hpp"
+#include "rdb_protocol/json_writer.hpp"
+#include "rdb_protocol/ql2.pb.h"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+std::string datum_json(const ql::datum_t &d) {
+    std::string out;
+    ql::write_json(d, &out);
+    return out;
+}
+
+void run_json_writer_test() {
+    EXPECT_EQ("null", datum_json(ql::datum_t(ql::datum_t::R_NULL)));
+    EXPECT_EQ("true", datum_json(ql::datum_t(ql::datum_t::R_BOOL, true)));
+    EXPECT_EQ("false", datum_json(ql::datum_t(ql::datum_t::R_BOOL, false)));
+
+    EXPECT_EQ("0", datum_json(ql::datum_t(0.0)));
+    EXPECT_EQ("-0", datum_json(ql::datum_t(-0.0)));
+    EXPECT_EQ("42", datum_json(ql::datum_t(42.0)));
+    EXPECT_EQ("-17", datum_json(ql::datum_t(-17.0)));
+    EXPECT_EQ("9007199254740991", datum_json(ql::datum_t(9007199254740991.0)));
+    EXPECT_EQ("0.5", datum_json(ql::datum_t(0.5)));
+    EXPECT_EQ("1e+100", datum_json(ql::datum_t(1e100)));
+
+    EXPECT_EQ("\"abc\"", datum_json(ql::datum_t("abc")));
+    EXPECT_EQ("\"a\\\"b\\\\c\\n\\u0001\"",
+              datum_json(ql::datum_t(std::string("a\"b\\c\n\x01"))));
+    EXPECT_EQ("\"caf\xc3\xa9\"", datum_json(ql::datum_t("caf\xc3\xa9")));
+
+    std::vector<counted_t<const ql::datum_t> > array;
+    array.push_back(make_counted<ql::datum_t>(1.0));
+    array.push_back(make_counted<ql::datum_t>("x"));
+    std::map<std::string, counted_t<const ql::datum_t> > object;
+    object["b"] = make_counted<ql::datum_t>(array);
+    object["a"] = make_counted<ql::datum_t>(ql::datum_t::R_NULL);
+    ql::datum_t nested(object);
+    EXPECT_EQ("{\"a\":null,\"b\":[1,\"x\"]}", datum_json(nested));
+
+    // The protobuf version has to write the same thing.
+    Datum pb;
+    nested.write_to_protobuf(&pb);
+    std::string pb_json;
+    ql::write_json(pb, &pb_json);
+    EXPECT_EQ(datum_json(nested), pb_json);
+}
+
+TEST(RdbJsonWriter, Datums) {
+    run_in_thread_pool(run_json_writer_test);
+}
+
+TEST(RdbJsonWriter, Response) {
+    Response res;
+    res.set_token(5);
+    res.set_type(Response::SUCCESS_SEQUENCE);
+    std::string head, tail;
+
+    ql::write_json_response(res, "1,2", &head, &tail);
+    EXPECT_EQ("{\"t\":2,\"r\":[1,2]}", head + "1,2" + tail);
+
+    ql::write_json_response(res, "", &head, &tail);
+    EXPECT_EQ("{\"t\":2,\"r\":[]}", head + tail);
+
+    res.set_type(Response::RUNTIME_ERROR);
+    Datum *msg = res.add_response();
+    msg->set_type(Datum::R_STR);
+    msg->set_r_str("oops");
+    Frame *frame = res.mutable_backtrace()->add_frames();
+    frame->set_type(Frame::POS);
+    frame->set_pos(1);
+    frame = res.mutable_backtrace()->add_frames();
+    frame->set_type(Frame::OPT);
+    frame->set_opt("index");
+    ql::write_json_response(res, "", &head, &tail);
+    EXPECT_EQ("{\"t\":18,\"r\":[\"oops\"],\"b\":[1,\"index\"]}", head + tail);
+}
+
+}  // namespace unittest
@@ -0,0 +1,108 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include <string>
+
+#include "rdb_protocol/plan_cache.hpp"
+#include "rdb_protocol/ql2.pb.h"
+#include "rdb_protocol/term.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+Term *add_plan_arg(Term *term, Term::TermType type) {
+    Term *arg = term->add_args();
+    arg->set_type(type);
+    return arg;
+}
+
+void add_plan_num_arg(Term *term, double num) {
+    Term *arg = add_plan_arg(term, Term::DATUM);
+    arg->mutable_datum()->set_type(Datum::R_NUM);
+    arg->mutable_datum()->set_r_num(num);
+}
+
+void add_plan_var_arg(Term *term, double var) {
+    add_plan_num_arg(add_plan_arg(term, Term::VAR), var);
+}
+
+// Adds a call of a one-argument lambda binding `var` to `term`, and returns the
+// lambda's FUNC for the body to be added to.  Drivers send the variables as a
+// MAKE_ARRAY of numbers.
+Term *add_plan_funcall_arg(Term *term, double var, double arg) {
+    Term *funcall = add_plan_arg(term, Term::FUNCALL);
+    Term *func = add_plan_arg(funcall, Term::FUNC);
+    add_plan_num_arg(add_plan_arg(func, Term::MAKE_ARRAY), var);
+    add_plan_num_arg(funcall, arg);
+    return func;
+}
+
+// r.expr(3).do(lambda x: r.expr(2).do(lambda y: x + y + `literal`)), with
+// variable numbers `outer` and `inner`, and the innermost VAR numbered
+// `second_term_var`.
+Query make_plan_query(double outer, double inner, double second_term_var, double literal) {
+    Query query;
+    query.set_type(Query::START);
+    query.set_token(1);
+    Term *root = query.mutable_query();
+    root->set_type(Term::FUNCALL);
+    Term *outer_func = add_plan_arg(root, Term::FUNC);
+    add_plan_num_arg(add_plan_arg(outer_func, Term::MAKE_ARRAY), outer);
+    add_plan_num_arg(root, 3);
+
+    Term *inner_func = add_plan_funcall_arg(outer_func, inner, 2);
+    Term *add = add_plan_arg(inner_func, Term::ADD);
+    add_plan_var_arg(add, outer);
+    add_plan_var_arg(add, second_term_var);
+    add_plan_num_arg(add, literal);
+    return query;
+}
+
+std::string plan_shape(const Query &query) {
+    std::string shape;
+    EXPECT_TRUE(ql::compute_query_shape(query, &shape));
+    return shape;
+}
+
+TEST(RdbPlanCache, VariableNumbersAreNotPartOfTheShape) {
+    const std::string shape = plan_shape(make_plan_query(1, 2, 2, 1));
+
+    // A driver building the same query again numbers the variables from
+    // where its counter got to.
+    EXPECT_EQ(shape, plan_shape(make_plan_query(17, 18, 18, 1)));
+    EXPECT_EQ(shape, plan_shape(make_plan_query(5, 3, 3, 1)));
+
+    // The literals are parameters.
+    EXPECT_EQ(shape, plan_shape(make_plan_query(17, 18, 18, 100)));
+}
+
+TEST(RdbPlanCache, VariableBindingsArePartOfTheShape) {
+    const std::string shape = plan_shape(make_plan_query(1, 2, 2, 1));
+
+    // `x + x` instead of `x + y`.
+    EXPECT_NE(shape, plan_shape(make_plan_query(1, 2, 1, 1)));
+
+    // If the inner lambda binds the same number as the outer one, both VARs
+    // name the inner variable.
+    const std::string shadowed = plan_shape(make_plan_query(1, 1, 1, 1));
+    EXPECT_NE(shape, shadowed);
+    EXPECT_EQ(shadowed, plan_shape(make_plan_query(4, 4, 4, 1)));
+}
+
+TEST(RdbPlanCache, VariableListFormsAreEquivalent) {
+    // FUNC takes its variables as a DATUM array too.
+    Query query = make_plan_query(1, 2, 2, 1);
+    Term *outer_func = query.mutable_query()->mutable_args(0);
+    Term *vars = outer_func->mutable_args(0);
+    vars->Clear();
+    vars->set_type(Term::DATUM);
+    vars->mutable_datum()->set_type(Datum::R_ARRAY);
+    Datum *var = vars->mutable_datum()->add_r_array();
+    var->set_type(Datum::R_NUM);
+    var->set_r_num(9);
+    Term *var_ref = outer_func->mutable_args(1)->mutable_args(0)->mutable_args(1)->mutable_args(0);
+    ASSERT_EQ(Term::VAR, var_ref->type());
+    var_ref->mutable_args(0)->mutable_datum()->set_r_num(9);
+
+    EXPECT_EQ(plan_shape(make_plan_query(1, 2, 2, 1)), plan_shape(query));
+}
+
+}  // namespace unittest
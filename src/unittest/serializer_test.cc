@@ -1,5 +1,8 @@
+#include <algorithm>
+
 #include "arch/runtime/starter.hpp"
 #include "serializer/config.hpp"
+#include "serializer/log/data_block_manager.hpp"
 #include "unittest/mock_file.hpp"
 #include "unittest/gtest.hpp"
 
@@ -20,5 +23,52 @@ TEST(SerializerTest, CreateConstructDestroy) {
     run_in_thread_pool(run_CreateConstructDestroy, 4);
 }
 
+TEST(SerializerTest, SequentialReadDetectorIgnoresRandomReads) {
+    const int64_t block_size = 4096;
+    const int64_t extent_size = 512 * block_size;
+    sequential_read_detector_t detector;
+    const int64_t blocks[] = { 100, 7, 300, 301, 50, 51, 20, 400, 12 };
+    for (size_t i = 0; i < sizeof(blocks) / sizeof(blocks[0]); ++i) {
+        int64_t offset, size;
+        EXPECT_FALSE(detector.on_read(blocks[i] * block_size, block_size, extent_size,
+                                      &offset, &size));
+    }
+}
+
+TEST(SerializerTest, SequentialReadDetectorGrowsWindow) {
+    const int64_t block_size = 4096;
+    const int64_t extent_size = 512 * block_size;
+    sequential_read_detector_t detector;
+    int64_t offset, size;
+
+    // The run has to be SEQUENTIAL_READ_AHEAD_MIN_RUN reads long first.
+    int64_t block = 0;
+    for (; block < SEQUENTIAL_READ_AHEAD_MIN_RUN; ++block) {
+        EXPECT_FALSE(detector.on_read(block * block_size, block_size, extent_size,
+                                      &offset, &size));
+    }
+
+    int64_t window = MAX_READ_AHEAD_BLOCKS;
+    int64_t read_ahead_end = 0;
+    for (;;) {
+        ASSERT_TRUE(detector.on_read(block * block_size, block_size, extent_size,
+                                     &offset, &size));
+        EXPECT_EQ(std::max(block + 1, read_ahead_end) * block_size, offset);
+        read_ahead_end = offset / block_size + size / block_size;
+        if (read_ahead_end == 512) {
+            // Read aheads stop at the end of the extent.
+            EXPECT_LE(size, extent_size - offset);
+            break;
+        }
+        EXPECT_EQ((block + 1 + window) * block_size, offset + size);
+        window = std::min<int64_t>(window * 2, MAX_SEQUENTIAL_READ_AHEAD_BLOCKS);
+        // Skip the blocks that were read ahead, like the cache would.
+        block = read_ahead_end - 1;
+    }
+
+    // Jumping back ends the run.
+    EXPECT_FALSE(detector.on_read(3 * block_size, block_size, extent_size, &offset, &size));
+}
+
 
 }  // namespace unittest
@@ -0,0 +1,291 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <time.h>
+
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "arch/io/disk.hpp"
+#include "btree/snapshot_export.hpp"
+#include "memcached/protocol.hpp"
+#include "unittest/clustering_utils.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+std::string read_whole_file(const std::string &path) {
+    std::ifstream f(path.c_str(), std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
+
+void run_writer_format_test() {
+    temp_file_t file;
+    const std::string path = file.name().permanent_path();
+
+    {
+        snapshot_export_writer_t writer(path, SNAPSHOT_EXPORT_RAW_VALUES, repli_timestamp_t::distant_past);
+        writer.add_row(store_key_t("a").btree_key(), "first");
+        writer.add_row(store_key_t("b").btree_key(), "");
+        writer.finish_block(key_range_t(key_range_t::none, store_key_t(),
+                                        key_range_t::open, store_key_t("m")));
+        writer.finish_block(key_range_t(key_range_t::closed, store_key_t("m"),
+                                        key_range_t::none, store_key_t()));
+        repli_timestamp_t max_recency;
+        max_recency.longtime = 7;
+        writer.finish(max_recency);
+    }
+    EXPECT_EQ(-1, ::access((path + ".tmp").c_str(), F_OK));
+
+    const std::string contents = read_whole_file(path);
+    ASSERT_LE(sizeof(snapshot_export_header_t) + sizeof(snapshot_export_footer_t), contents.size());
+
+    snapshot_export_header_t header;
+    memcpy(&header, contents.data(), sizeof(header));
+    EXPECT_EQ(0, memcmp(header.magic, SNAPSHOT_EXPORT_HEADER_MAGIC, sizeof(header.magic)));
+    EXPECT_EQ(static_cast<uint32_t>(SNAPSHOT_EXPORT_VERSION), header.version);
+    EXPECT_EQ(static_cast<uint32_t>(SNAPSHOT_EXPORT_RAW_VALUES), header.value_format);
+
+    snapshot_export_footer_t footer;
+    memcpy(&footer, contents.data() + contents.size() - sizeof(footer), sizeof(footer));
+    EXPECT_EQ(0, memcmp(footer.magic, SNAPSHOT_EXPORT_FOOTER_MAGIC, sizeof(footer.magic)));
+    EXPECT_EQ(7u, footer.max_recency);
+    ASSERT_EQ(2u, footer.num_blocks);
+    ASSERT_EQ(contents.size() - sizeof(footer),
+              footer.index_offset + 2 * sizeof(snapshot_export_index_entry_t));
+
+    snapshot_export_index_entry_t first, second;
+    memcpy(&first, contents.data() + footer.index_offset, sizeof(first));
+    memcpy(&second, contents.data() + footer.index_offset + sizeof(first), sizeof(second));
+
+    // Two rows: "a" => "first" and "b" => "".
+    EXPECT_EQ(sizeof(header), first.offset);
+    EXPECT_EQ(2u, first.num_rows);
+    EXPECT_EQ((1 + 1 + 4 + 5) + (1 + 1 + 4), first.size);
+    EXPECT_EQ(0, first.left_size);
+    EXPECT_EQ(0, first.right_unbounded);
+    ASSERT_EQ(1, first.right_size);
+    EXPECT_EQ('m', first.right[0]);
+    EXPECT_EQ(std::string("\x01" "a" "\x05\0\0\0" "first", 11),
+              contents.substr(first.offset, 11));
+
+    // The second range is empty, but the index still says so.
+    EXPECT_EQ(first.offset + first.size, second.offset);
+    EXPECT_EQ(0u, second.num_rows);
+    EXPECT_EQ(0u, second.size);
+    ASSERT_EQ(1, second.left_size);
+    EXPECT_EQ('m', second.left[0]);
+    EXPECT_EQ(1, second.right_unbounded);
+}
+
+TEST(SnapshotExport, WriterFormat) {
+    run_in_thread_pool(&run_writer_format_test);
+}
+
+void run_unfinished_writer_test() {
+    temp_file_t file;
+    const std::string path = file.name().permanent_path() + ".unfinished";
+    {
+        snapshot_export_writer_t writer(path, SNAPSHOT_EXPORT_JSON_VALUES, repli_timestamp_t::distant_past);
+        writer.add_row(store_key_t("a").btree_key(), "{}");
+    }
+    // Neither the partial file nor the final one is left behind.
+    EXPECT_EQ(-1, ::access((path + ".tmp").c_str(), F_OK));
+    EXPECT_EQ(-1, ::access(path.c_str(), F_OK));
+}
+
+TEST(SnapshotExport, UnfinishedWriterLeavesNoFile) {
+    run_in_thread_pool(&run_unfinished_writer_test);
+}
+
+// A data block of a snapshot export, read back.
+struct snapshot_block_t {
+    key_range_t range;
+    std::map<std::string, std::string> rows;
+};
+
+// Reads the blocks of the export at `path`, and its footer's `max_recency`.
+void read_snapshot_export(const std::string &path, std::vector<snapshot_block_t> *blocks_out,
+                          repli_timestamp_t *max_recency_out) {
+    const std::string contents = read_whole_file(path);
+    ASSERT_LE(sizeof(snapshot_export_header_t) + sizeof(snapshot_export_footer_t), contents.size());
+    snapshot_export_footer_t footer;
+    memcpy(&footer, contents.data() + contents.size() - sizeof(footer), sizeof(footer));
+    ASSERT_EQ(contents.size() - sizeof(footer),
+              footer.index_offset + footer.num_blocks * sizeof(snapshot_export_index_entry_t));
+    max_recency_out->longtime = footer.max_recency;
+
+    for (uint64_t i = 0; i < footer.num_blocks; ++i) {
+        snapshot_export_index_entry_t entry;
+        memcpy(&entry, contents.data() + footer.index_offset + i * sizeof(entry), sizeof(entry));
+        snapshot_block_t block;
+        block.range.left = store_key_t(entry.left_size, entry.left);
+        block.range.right = entry.right_unbounded
+            ? key_range_t::right_bound_t()
+            : key_range_t::right_bound_t(store_key_t(entry.right_size, entry.right));
+
+        size_t pos = entry.offset;
+        for (uint32_t j = 0; j < entry.num_rows; ++j) {
+            const uint8_t key_size = contents[pos];
+            const std::string key = contents.substr(pos + 1, key_size);
+            pos += 1 + key_size;
+            uint32_t value_size;
+            memcpy(&value_size, contents.data() + pos, sizeof(value_size));
+            pos += sizeof(value_size);
+            block.rows[key] = contents.substr(pos, value_size);
+            pos += value_size;
+        }
+        EXPECT_EQ(entry.offset + entry.size, pos);
+        blocks_out->push_back(block);
+    }
+}
+
+void snapshot_test_set(memcached_protocol_t::store_t *store, order_source_t *order_source,
+                       const std::string &key, const std::string &value, int64_t timestamp) {
+    state_timestamp_t before = state_timestamp_t::zero();
+    for (int64_t i = 0; i < timestamp; ++i) {
+        before = transition_timestamp_t::starting_from(before).timestamp_after();
+    }
+    const transition_timestamp_t transition = transition_timestamp_t::starting_from(before);
+
+    sarc_mutation_t set;
+    set.key = store_key_t(key);
+    set.data = data_buffer_t::create(value.size());
+    memcpy(set.data->buf(), value.data(), value.size());
+    set.flags = 0;
+    set.exptime = 0;
+    set.add_policy = add_policy_yes;
+    set.replace_policy = replace_policy_yes;
+
+    cond_t non_interruptor;
+#ifndef NDEBUG
+    trivial_metainfo_checker_callback_t<memcached_protocol_t> metainfo_checker_callback;
+    metainfo_checker_t<memcached_protocol_t> metainfo_checker(&metainfo_checker_callback, store->get_region());
+#endif
+    memcached_protocol_t::write_response_t response;
+    write_token_pair_t token_pair;
+    store->new_write_token_pair(&token_pair);
+    store->write(DEBUG_ONLY(metainfo_checker, )
+                 region_map_t<memcached_protocol_t, binary_blob_t>(store->get_region(),
+                     binary_blob_t(version_range_t(version_t::zero()))),
+                 memcached_protocol_t::write_t(set, time(NULL), 12345), &response,
+                 WRITE_DURABILITY_SOFT, transition,
+                 order_source->check_in("snapshot_test_set"), &token_pair, &non_interruptor);
+}
+
+// Checks that every block holds exactly the rows of `expected` in its range,
+// and, if `full`, that the blocks cover every key in order.
+void check_snapshot_blocks(const std::vector<snapshot_block_t> &blocks,
+                           const std::map<std::string, std::string> &expected, bool full) {
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        std::map<std::string, std::string> in_range;
+        for (std::map<std::string, std::string>::const_iterator it = expected.begin(); it != expected.end(); ++it) {
+            if (blocks[i].range.contains_key(store_key_t(it->first))) {
+                in_range.insert(*it);
+            }
+        }
+        EXPECT_TRUE(in_range == blocks[i].rows) << "block " << i;
+        if (i > 0) {
+            ASSERT_FALSE(blocks[i - 1].range.right.unbounded);
+            if (full) {
+                EXPECT_TRUE(blocks[i - 1].range.right.key == blocks[i].range.left);
+            } else {
+                EXPECT_TRUE(blocks[i - 1].range.right.key <= blocks[i].range.left);
+            }
+        }
+    }
+    if (full) {
+        ASSERT_FALSE(blocks.empty());
+        EXPECT_TRUE(blocks.front().range.left == store_key_t::min());
+        EXPECT_TRUE(blocks.back().range.right.unbounded);
+    }
+}
+
+void run_store_export_test() {
+    order_source_t order_source;
+    io_backender_t io_backender;
+    test_store_t<memcached_protocol_t> test_store(&io_backender, &order_source,
+                                                  static_cast<memcached_protocol_t::context_t *>(NULL));
+    memcached_protocol_t::store_t *store = &test_store.store;
+    cond_t non_interruptor;
+    temp_file_t full_file, incremental_file;
+
+    // Enough rows for a few dozen leaves.
+    std::map<std::string, std::string> expected;
+    for (int i = 0; i < 600; ++i) {
+        const std::string key = strprintf("key%03d", i);
+        expected[key] = key + std::string(100, 'a' + i % 26);
+        snapshot_test_set(store, &order_source, key, expected[key], 1);
+    }
+
+    store->export_snapshot(full_file.name().permanent_path(), repli_timestamp_t::distant_past,
+                           &non_interruptor);
+    std::vector<snapshot_block_t> full_blocks;
+    repli_timestamp_t full_max_recency;
+    read_snapshot_export(full_file.name().permanent_path(), &full_blocks, &full_max_recency);
+    check_snapshot_blocks(full_blocks, expected, true);
+    ASSERT_GT(full_blocks.size(), 3u);
+
+    // Change one row and add another, much later.
+    expected["key300"] = "changed";
+    snapshot_test_set(store, &order_source, "key300", expected["key300"], 10);
+    expected["key300x"] = "added";
+    snapshot_test_set(store, &order_source, "key300x", expected["key300x"], 10);
+
+    const repli_timestamp_t incremental_max_recency
+        = store->export_snapshot(incremental_file.name().permanent_path(), full_max_recency.next(),
+                                 &non_interruptor);
+    EXPECT_GT(incremental_max_recency, full_max_recency);
+    std::vector<snapshot_block_t> incremental_blocks;
+    repli_timestamp_t read_max_recency;
+    read_snapshot_export(incremental_file.name().permanent_path(), &incremental_blocks, &read_max_recency);
+    EXPECT_TRUE(read_max_recency == incremental_max_recency);
+    check_snapshot_blocks(incremental_blocks, expected, false);
+
+    // Only the leaves that changed are there, and they have both rows.
+    ASSERT_FALSE(incremental_blocks.empty());
+    EXPECT_LT(incremental_blocks.size(), full_blocks.size());
+    size_t rows_found = 0;
+    for (size_t i = 0; i < incremental_blocks.size(); ++i) {
+        rows_found += incremental_blocks[i].rows.count("key300");
+        rows_found += incremental_blocks[i].rows.count("key300x");
+    }
+    EXPECT_EQ(2u, rows_found);
+}
+
+TEST(SnapshotExport, StoreFullAndIncremental) {
+    run_in_thread_pool(&run_store_export_test);
+}
+
+void run_empty_store_export_test() {
+    order_source_t order_source;
+    io_backender_t io_backender;
+    test_store_t<memcached_protocol_t> test_store(&io_backender, &order_source,
+                                                  static_cast<memcached_protocol_t::context_t *>(NULL));
+    cond_t non_interruptor;
+    temp_file_t file;
+
+    // An empty store says that its whole range is empty, in an incremental
+    // export too.
+    repli_timestamp_t since;
+    since.longtime = 5;
+    test_store.store.export_snapshot(file.name().permanent_path(), since, &non_interruptor);
+    std::vector<snapshot_block_t> blocks;
+    repli_timestamp_t max_recency;
+    read_snapshot_export(file.name().permanent_path(), &blocks, &max_recency);
+    ASSERT_EQ(1u, blocks.size());
+    EXPECT_TRUE(blocks[0].range == key_range_t::universe());
+    EXPECT_TRUE(blocks[0].rows.empty());
+}
+
+TEST(SnapshotExport, EmptyStore) {
+    run_in_thread_pool(&run_empty_store_export_test);
+}
+
+}  // namespace unittest
@@ -0,0 +1,79 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include <map>
+#include <string>
+
+#include "clustering/administration/stat_history.hpp"
+#include "http/json.hpp"
+#include "perfmon/core.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+std::string render_history(const stat_history_ring_t &ring, uint64_t since) {
+    scoped_cJSON_t json(ring.render_json(since));
+    return json.PrintUnformatted();
+}
+
+TEST(StatHistory, DeltaEncoding) {
+    stat_history_ring_t ring(4);
+    EXPECT_EQ("{\"first\":0,\"next\":0,\"times\":[],\"stats\":{}}", render_history(ring, 0));
+
+    std::map<std::string, double> values;
+    values["a"] = 10;
+    values["b"] = 5;
+    ring.add_sample(1000, values);
+    values["a"] = 13;
+    values.erase("b");
+    ring.add_sample(2000, values);
+    values["a"] = 12;
+    values["b"] = 8;
+    ring.add_sample(3005, values);
+
+    EXPECT_EQ("{\"first\":0,\"next\":3,\"times\":[1000,1000,1005],"
+              "\"stats\":{\"a\":[10,3,-1],\"b\":[5,null,3]}}",
+              render_history(ring, 0));
+    // Asking for what came after the samples we have already seen.
+    EXPECT_EQ("{\"first\":2,\"next\":3,\"times\":[3005],"
+              "\"stats\":{\"a\":[12],\"b\":[8]}}",
+              render_history(ring, 2));
+    EXPECT_EQ("{\"first\":3,\"next\":3,\"times\":[],\"stats\":{}}",
+              render_history(ring, 3));
+    EXPECT_EQ("{\"first\":3,\"next\":3,\"times\":[],\"stats\":{}}",
+              render_history(ring, 100));
+}
+
+TEST(StatHistory, Retention) {
+    stat_history_ring_t ring(2);
+    std::map<std::string, double> values;
+    values["gone"] = 1;
+    ring.add_sample(0, values);
+    values.clear();
+    for (int i = 1; i <= 4; ++i) {
+        values["n"] = i;
+        ring.add_sample(i * 10, values);
+    }
+    EXPECT_EQ(5u, ring.get_next_sample());
+    // Only the last two samples are kept, and "gone" is in neither of them.
+    EXPECT_EQ("{\"first\":3,\"next\":5,\"times\":[30,10],\"stats\":{\"n\":[3,1]}}",
+              render_history(ring, 0));
+}
+
+TEST(StatHistory, FlattenPerfmonResult) {
+    perfmon_result_t result;
+    result.reset_type(perfmon_result_t::type_map);
+    result.insert("count", new perfmon_result_t("42"));
+    result.insert("name", new perfmon_result_t("not a number"));
+    result.insert("empty", new perfmon_result_t(""));
+    perfmon_result_t *inner = new perfmon_result_t;
+    inner->reset_type(perfmon_result_t::type_map);
+    inner->insert("rate", new perfmon_result_t("0.5"));
+    result.insert("inner", inner);
+
+    std::map<std::string, double> values;
+    flatten_perfmon_result(result, "", &values);
+    ASSERT_EQ(2u, values.size());
+    EXPECT_EQ(42, values["count"]);
+    EXPECT_EQ(0.5, values["inner/rate"]);
+}
+
+}  // namespace unittest
@@ -0,0 +1,221 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include <string.h>
+#include <time.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "errors.hpp"
+#include <boost/bind.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include "arch/io/disk.hpp"
+#include "arch/runtime/coroutines.hpp"
+#include "backfill_progress.hpp"
+#include "memcached/protocol.hpp"
+#include "unittest/clustering_utils.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+// The writes in the batch are this many timestamps apart.
+#define WRITE_BATCH_TEST_TIMESTAMP_STEP 10
+
+// How many keys the tree starts out with.
+#define WRITE_BATCH_TEST_FILL_KEYS 600
+
+state_timestamp_t advance_timestamp(state_timestamp_t t, int steps) {
+    for (int i = 0; i < steps; ++i) {
+        t = transition_timestamp_t::starting_from(t).timestamp_after();
+    }
+    return t;
+}
+
+memcached_protocol_t::write_t make_set(const std::string &key, const std::string &value) {
+    sarc_mutation_t set;
+    set.key = store_key_t(key);
+    set.data = data_buffer_t::create(value.size());
+    memcpy(set.data->buf(), value.data(), value.size());
+    set.flags = 0;
+    set.exptime = 0;
+    set.add_policy = add_policy_yes;
+    set.replace_policy = replace_policy_yes;
+    return memcached_protocol_t::write_t(set, time(NULL), 12345);
+}
+
+// Reads `key` with a token that was taken between two writes of the batch, and
+// stores its value, or "" if it isn't there.
+void read_between_writes(memcached_protocol_t::store_t *store,
+                         const std::string &key,
+                         order_token_t order_token,
+                         read_token_pair_t *token_pair,
+                         std::string *value_out,
+                         cond_t *done) {
+    get_query_t get;
+    get.key = store_key_t(key);
+    memcached_protocol_t::read_t read(get, time(NULL));
+    memcached_protocol_t::read_response_t response;
+#ifndef NDEBUG
+    trivial_metainfo_checker_callback_t<memcached_protocol_t> metainfo_checker_callback;
+    metainfo_checker_t<memcached_protocol_t> metainfo_checker(&metainfo_checker_callback, store->get_region());
+#endif
+    cond_t non_interruptor;
+    store->read(DEBUG_ONLY(metainfo_checker, ) read, &response, order_token, token_pair, &non_interruptor);
+    get_result_t result = boost::get<get_result_t>(response.result);
+    *value_out = result.value.has() ? std::string(result.value->buf(), result.value->size()) : "";
+    done->pulse();
+}
+
+class collect_recencies_callback_t : public send_backfill_callback_t<memcached_protocol_t> {
+public:
+    bool should_backfill_impl(UNUSED const memcached_protocol_t::store_t::metainfo_t &metainfo) {
+        return true;
+    }
+    void send_chunk(const memcached_protocol_t::backfill_chunk_t &chunk, UNUSED signal_t *interruptor) THROWS_NOTHING {
+        const memcached_protocol_t::backfill_chunk_t::key_value_pair_t *pair
+            = boost::get<memcached_protocol_t::backfill_chunk_t::key_value_pair_t>(&chunk.val);
+        if (pair != NULL) {
+            recencies[key_to_unescaped_str(pair->backfill_atom.key)] = pair->backfill_atom.recency;
+        }
+    }
+    std::map<std::string, repli_timestamp_t> recencies;
+};
+
+void run_write_batch_test() {
+    order_source_t order_source;
+    io_backender_t io_backender;
+    test_store_t<memcached_protocol_t> test_store(&io_backender, &order_source,
+                                                  static_cast<memcached_protocol_t::context_t *>(NULL));
+    memcached_protocol_t::store_t *store = &test_store.store;
+    const branch_id_t branch_id = generate_uuid();
+    cond_t non_interruptor;
+#ifndef NDEBUG
+    trivial_metainfo_checker_callback_t<memcached_protocol_t> metainfo_checker_callback;
+    metainfo_checker_t<memcached_protocol_t> metainfo_checker(&metainfo_checker_callback, store->get_region());
+#endif
+
+    // Enough keys for a few levels of btree, so that the batch's writes land
+    // in different leaves.
+    const transition_timestamp_t fill_timestamp = transition_timestamp_t::starting_from(state_timestamp_t::zero());
+    for (int i = 0; i < WRITE_BATCH_TEST_FILL_KEYS; ++i) {
+        const std::string key = strprintf("k%03d", i);
+        memcached_protocol_t::write_response_t response;
+        write_token_pair_t token_pair;
+        store->new_write_token_pair(&token_pair);
+        store->write(DEBUG_ONLY(metainfo_checker, )
+                     region_map_t<memcached_protocol_t, binary_blob_t>(store->get_region(),
+                         binary_blob_t(version_range_t(version_t(branch_id, fill_timestamp.timestamp_after())))),
+                     make_set(key, "old " + key + std::string(100, '.')), &response,
+                     WRITE_DURABILITY_SOFT, fill_timestamp,
+                     order_source.check_in("run_write_batch_test fill"), &token_pair, &non_interruptor);
+    }
+
+    // Write `i` sets one key in the `i`th quarter of the keys, and its metainfo
+    // covers that quarter, so that we can tell whose metainfo stuck.
+    const int num_writes = 4;
+    const int keys_per_write = WRITE_BATCH_TEST_FILL_KEYS / num_writes;
+    std::vector<std::string> keys;
+    std::vector<memcached_protocol_t::write_t> writes;
+    std::vector<transition_timestamp_t> timestamps;
+    std::vector<memcached_protocol_t::region_t> regions;
+    for (int i = 0; i < num_writes; ++i) {
+        keys.push_back(strprintf("k%03d", i * keys_per_write + keys_per_write / 2));
+        writes.push_back(make_set(keys[i], "new " + keys[i]));
+        timestamps.push_back(transition_timestamp_t::starting_from(
+            advance_timestamp(state_timestamp_t::zero(), (i + 1) * WRITE_BATCH_TEST_TIMESTAMP_STEP)));
+        key_range_t range = key_range_t::universe();
+        if (i > 0) {
+            range.left = store_key_t(strprintf("k%03d", i * keys_per_write));
+        }
+        if (i < num_writes - 1) {
+            range.right = key_range_t::right_bound_t(store_key_t(strprintf("k%03d", (i + 1) * keys_per_write)));
+        }
+        regions.push_back(memcached_protocol_t::region_t(range));
+    }
+
+    // Two reads get their tokens between the second and the third write, so
+    // the batch can't keep its transaction open for the third write and has to
+    // commit and start over.  The second and the fourth write join the
+    // transaction of the write before them.
+    boost::ptr_vector<write_token_pair_t> write_tokens;
+    read_token_pair_t read_tokens[2];
+    std::vector<order_token_t> write_order_tokens;
+    std::vector<order_token_t> read_order_tokens;
+    for (int i = 0; i < num_writes; ++i) {
+        if (i == 2) {
+            for (int j = 0; j < 2; ++j) {
+                store->new_read_token_pair(&read_tokens[j]);
+                read_order_tokens.push_back(order_source.check_in("run_write_batch_test read").with_read_mode());
+            }
+        }
+        write_tokens.push_back(new write_token_pair_t);
+        store->new_write_token_pair(&write_tokens.back());
+        write_order_tokens.push_back(order_source.check_in("run_write_batch_test write"));
+    }
+
+    std::string read_values[2];
+    cond_t reads_done[2];
+    for (int j = 0; j < 2; ++j) {
+        coro_t::spawn_sometime(boost::bind(&read_between_writes, store, keys[j + 1], read_order_tokens[j],
+                                           &read_tokens[j], &read_values[j], &reads_done[j]));
+    }
+
+    std::vector<memcached_protocol_t::write_response_t> responses(num_writes);
+    std::vector<batched_store_write_t<memcached_protocol_t> > batch;
+    for (int i = 0; i < num_writes; ++i) {
+        batch.push_back(batched_store_write_t<memcached_protocol_t>(
+            region_map_t<memcached_protocol_t, binary_blob_t>(regions[i],
+                binary_blob_t(version_range_t(version_t(branch_id, timestamps[i].timestamp_after())))),
+            &writes[i], &responses[i], timestamps[i], write_order_tokens[i], &write_tokens[i]));
+    }
+    store->write_batch(DEBUG_ONLY(metainfo_checker, ) batch, WRITE_DURABILITY_SOFT, &non_interruptor);
+    reads_done[0].wait();
+    reads_done[1].wait();
+
+    for (int i = 0; i < num_writes; ++i) {
+        EXPECT_EQ(sr_stored, boost::get<set_result_t>(responses[i].result));
+    }
+
+    // The reads see the writes before them, and not the ones after them.
+    EXPECT_EQ("new " + keys[1], read_values[0]);
+    EXPECT_EQ("old " + keys[2] + std::string(100, '.'), read_values[1]);
+
+    // Every write updated the metainfo, not just the first of each transaction.
+    object_buffer_t<fifo_enforcer_sink_t::exit_read_t> metainfo_token;
+    store->new_read_token(&metainfo_token);
+    region_map_t<memcached_protocol_t, binary_blob_t> metainfo;
+    store->do_get_metainfo(order_source.check_in("run_write_batch_test metainfo").with_read_mode(),
+                           &metainfo_token, &non_interruptor, &metainfo);
+    for (int i = 0; i < num_writes; ++i) {
+        const region_map_t<memcached_protocol_t, binary_blob_t> part = metainfo.mask(regions[i]);
+        const binary_blob_t expected(version_range_t(version_t(branch_id, timestamps[i].timestamp_after())));
+        for (region_map_t<memcached_protocol_t, binary_blob_t>::const_iterator it = part.begin(); it != part.end(); ++it) {
+            EXPECT_TRUE(it->second == expected) << "write " << i;
+        }
+    }
+
+    // Every write gives the blocks it changes its own recency, including the
+    // ones that joined a transaction, so a backfill from between the first and
+    // the second write finds the last three and not the first.
+    collect_recencies_callback_t backfill_callback;
+    traversal_progress_combiner_t progress;
+    read_token_pair_t backfill_tokens;
+    store->new_read_token_pair(&backfill_tokens);
+    const state_timestamp_t backfill_start = advance_timestamp(
+        state_timestamp_t::zero(), WRITE_BATCH_TEST_TIMESTAMP_STEP + WRITE_BATCH_TEST_TIMESTAMP_STEP / 2);
+    store->send_backfill(region_map_t<memcached_protocol_t, state_timestamp_t>(store->get_region(), backfill_start),
+                         &backfill_callback, &progress, &backfill_tokens, &non_interruptor);
+    EXPECT_EQ(0u, backfill_callback.recencies.count(keys[0]));
+    for (int i = 1; i < num_writes; ++i) {
+        ASSERT_EQ(1u, backfill_callback.recencies.count(keys[i])) << keys[i];
+        EXPECT_TRUE(backfill_callback.recencies[keys[i]] == timestamps[i].to_repli_timestamp()) << keys[i];
+    }
+}
+
+TEST(BtreeStore, WriteBatch) {
+    run_in_thread_pool(&run_write_batch_test);
+}
+
+}  // namespace unittest